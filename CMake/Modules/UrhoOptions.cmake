@@ -110,6 +110,7 @@ _option2(URHO3D_CSHARP             "Enable C# support"
 set(URHO3D_NETFX net471 CACHE STRING "TargetFramework value for .NET projects")
 set_property(CACHE URHO3D_NETFX PROPERTY STRINGS net46 net461 net462 net47 net471 net472 net48)
 _option2(URHO3D_FILEWATCHER       "Watch filesystem for resource changes"                 ${URHO3D_ENABLE_ALL} "URHO3D_THREADING"              OFF)
+_option(URHO3D_SMALL_OBJECT_ALLOCATOR "Use small object allocator for scene nodes and components" ON)
 _option(URHO3D_SPHERICAL_HARMONICS "Use spherical harmonics for ambient lighting"         ON)
 _option(URHO3D_HASH_DEBUG         "Enable StringHash name debugging"                      ${URHO3D_ENABLE_ALL}                                    )
 _option(URHO3D_MONOLITHIC_HEADER  "Create Urho3DAll.h which includes all engine headers." OFF                                                     )
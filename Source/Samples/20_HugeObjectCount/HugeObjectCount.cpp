@@ -76,7 +76,11 @@ void HugeObjectCount::CreateScene()
     auto* cache = GetSubsystem<ResourceCache>();
 
     if (!scene_)
+    {
         scene_ = new Scene(context_);
+        // Update world transforms of the rotating boxes together once per frame
+        scene_->SetBatchedTransformUpdate(true);
+    }
     else
     {
         scene_->Clear();
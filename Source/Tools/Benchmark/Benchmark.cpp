@@ -0,0 +1,712 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+// Command line utility always uses console.
+#define URHO3D_WIN32_CONSOLE
+
+#include <Urho3D/Container/Allocator.h>
+#include <Urho3D/Core/CommandLine.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Engine/Application.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/Graphics/AnimatedModel.h>
+#include <Urho3D/Graphics/AnimationController.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Light.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/OcclusionBuffer.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/Renderer.h>
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/Graphics/View.h>
+#include <Urho3D/Graphics/Viewport.h>
+#include <Urho3D/Graphics/Zone.h>
+#include <Urho3D/IO/BinaryArchive.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Math/MathKernels.h>
+#include <Urho3D/Math/Random.h>
+#include <Urho3D/Resource/JSONFile.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SplinePath.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+
+using namespace Urho3D;
+
+namespace
+{
+
+/// Number of heap allocations made through operator new.
+std::atomic<unsigned long long> numHeapAllocations{};
+/// Number of bytes allocated through operator new.
+std::atomic<unsigned long long> numHeapBytes{};
+
+/// Sizes of the objects allocated by a typical scene.
+const size_t objectSizes[] = { sizeof(RefCount), sizeof(WorkItem), sizeof(SplinePath), sizeof(Node) };
+
+/// Return elapsed time in milliseconds.
+double GetMSec(HiresTimer& timer)
+{
+    return timer.GetUSec(true) / 1000.0;
+}
+
+/// Minimum, maximum and total of a per-frame measurement.
+struct FrameStatistic
+{
+    /// Add the value of one frame.
+    void Add(double value)
+    {
+        min_ = Min(min_, value);
+        max_ = Max(max_, value);
+        total_ += value;
+        ++count_;
+    }
+
+    /// Return as JSON.
+    JSONValue ToJSON() const
+    {
+        JSONValue value;
+        value["mean"] = count_ ? total_ / count_ : 0.0;
+        value["min"] = count_ ? min_ : 0.0;
+        value["max"] = max_;
+        return value;
+    }
+
+    double min_{M_INFINITY};
+    double max_{};
+    double total_{};
+    unsigned count_{};
+};
+
+/// Reserve objects of mixed sizes, then free them, either on the same or on another thread.
+template <class Reserve, class Free>
+double BenchmarkAllocations(unsigned count, bool crossThread, const Reserve& reserve, const Free& free)
+{
+    const unsigned numSizes = sizeof(objectSizes) / sizeof(objectSizes[0]);
+    ea::vector<void*> objects(count);
+
+    HiresTimer timer;
+    for (unsigned i = 0; i < count; ++i)
+        objects[i] = reserve(objectSizes[i % numSizes]);
+
+    const auto freeAll = [&]()
+    {
+        for (unsigned i = 0; i < count; ++i)
+            free(objects[i], objectSizes[i % numSizes]);
+    };
+
+    if (crossThread)
+        std::thread(freeAll).join();
+    else
+        freeAll();
+    return GetMSec(timer);
+}
+
+}
+
+// Count the heap allocations for the render benchmark. Allocations made by the engine are counted as well, unless it is a
+// Windows DLL with its own operator new.
+void* operator new(std::size_t size)
+{
+    ++numHeapAllocations;
+    numHeapBytes += size;
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+class BenchmarkApplication : public Application
+{
+    URHO3D_OBJECT(BenchmarkApplication, Application);
+public:
+    explicit BenchmarkApplication(Context* context) : Application(context)
+    {
+    }
+
+    void Setup() override
+    {
+        engineParameters_[EP_ENGINE_CLI_PARAMETERS] = false;
+        engineParameters_[EP_SOUND] = false;
+        engineParameters_[EP_HEADLESS] = true;
+        engineParameters_[EP_LOG_LEVEL] = LOG_WARNING;
+        engineParameters_[EP_WORKER_THREADS] = false;
+
+        auto& app = GetCommandLineParser();
+        app.require_subcommand(1);
+        app.add_option("-w,--workers", numWorkers_, "Number of worker threads, defaults to one less than physical CPU cores.");
+
+        CLI::App* allocator = app.add_subcommand("allocator", "Measure scene build and teardown with the small object allocator against the system allocator.");
+        allocator->add_option("-n,--nodes", numNodes_, "Number of scene nodes.")->set_default_val("100000");
+        allocator->add_option("-i,--iterations", numIterations_, "Number of iterations, the best result is reported.")->set_default_val("5");
+
+        CLI::App* culling = app.add_subcommand("culling", "Measure frustum and ray queries with the flattened octree against the octant hierarchy.");
+        culling->add_option("-n,--drawables", numDrawables_, "Number of static drawables.")->set_default_val("100000");
+        culling->add_option("-q,--queries", numQueries_, "Number of queries of each kind.")->set_default_val("1000");
+
+        CLI::App* occlusion = app.add_subcommand("occlusion", "Measure software occlusion rendering and testing per frame, with and without worker threads.");
+        occlusion->add_option("-o,--occluders", numOccluders_, "Number of box occluders.")->set_default_val("500");
+        occlusion->add_option("-t,--tests", numOcclusionTests_, "Number of occludee boxes tested per frame.")->set_default_val("20000");
+        occlusion->add_option("-s,--size", occlusionBufferSize_, "Occlusion buffer width.")->set_default_val("256");
+        occlusion->add_option("-f,--frames", numFrames_, "Number of frames, the best result is reported.")->set_default_val("100");
+
+        CLI::App* render = app.add_subcommand("render", "Measure the CPU stages of a view update on a synthetic scene without a GPU and report them as JSON.");
+        render->add_option("-s,--static", numStaticModels_, "Number of static models.")->set_default_val("10000");
+        render->add_option("-l,--lights", numLights_, "Number of point lights.")->set_default_val("16");
+        render->add_option("-a,--animated", numAnimatedModels_, "Number of animated models.")->set_default_val("100");
+        render->add_option("-f,--frames", numFrames_, "Number of measured frames.")->set_default_val("100");
+        render->add_option("-o,--output", outputFileName_, "Write the JSON report to a file instead of standard output.");
+
+        CLI::App* serialization = app.add_subcommand("serialization", "Measure binary scene save and load with direct attribute access against Variant conversion.");
+        serialization->add_option("-n,--nodes", numNodes_, "Number of scene nodes.")->set_default_val("100000");
+        serialization->add_option("-i,--iterations", numIterations_, "Number of iterations, the best result is reported.")->set_default_val("5");
+    }
+
+    void Start() override
+    {
+#ifdef URHO3D_THREADING
+        GetSubsystem<WorkQueue>()->CreateThreads(numWorkers_);
+#endif
+
+        if (GetCommandLineParser().got_subcommand("allocator"))
+            BenchmarkAllocator();
+        if (GetCommandLineParser().got_subcommand("culling"))
+            BenchmarkCulling();
+        if (GetCommandLineParser().got_subcommand("occlusion"))
+            BenchmarkOcclusion();
+        if (GetCommandLineParser().got_subcommand("render"))
+            BenchmarkRender();
+        if (GetCommandLineParser().got_subcommand("serialization"))
+            BenchmarkSerialization();
+
+        engine_->Exit();
+    }
+
+private:
+    /// Compare the small object allocator against malloc and measure scene build and teardown.
+    void BenchmarkAllocator()
+    {
+        const unsigned numObjects = numNodes_ * 4;
+        const auto smallObjectReserve = [](size_t size) { return SmallObjectReserve(size); };
+        const auto smallObjectFree = [](void* ptr, size_t size) { SmallObjectFree(ptr, size); };
+        const auto systemReserve = [](size_t size) { return malloc(size); };
+        const auto systemFree = [](void* ptr, size_t) { free(ptr); };
+
+        double smallObject = M_INFINITY, system = M_INFINITY;
+        double smallObjectCrossThread = M_INFINITY, systemCrossThread = M_INFINITY;
+        double sceneBuild = M_INFINITY, sceneTeardown = M_INFINITY;
+        for (unsigned i = 0; i < numIterations_; ++i)
+        {
+            smallObject = Min(smallObject, BenchmarkAllocations(numObjects, false, smallObjectReserve, smallObjectFree));
+            system = Min(system, BenchmarkAllocations(numObjects, false, systemReserve, systemFree));
+            smallObjectCrossThread = Min(smallObjectCrossThread, BenchmarkAllocations(numObjects, true, smallObjectReserve, smallObjectFree));
+            systemCrossThread = Min(systemCrossThread, BenchmarkAllocations(numObjects, true, systemReserve, systemFree));
+
+            HiresTimer timer;
+            auto scene = MakeShared<Scene>(context_);
+            BuildScene(scene);
+            sceneBuild = Min(sceneBuild, GetMSec(timer));
+            scene = nullptr;
+            sceneTeardown = Min(sceneTeardown, GetMSec(timer));
+        }
+
+#if URHO3D_SMALL_OBJECT_ALLOCATOR
+        const char* sceneAllocator = "small object allocator";
+#else
+        const char* sceneAllocator = "system allocator";
+#endif
+        PrintLine(Format("{} objects of {} to {} bytes, best of {} iterations:", numObjects, objectSizes[0], objectSizes[3], numIterations_));
+        PrintLine(Format("  small object allocator:                   {:8.2f} ms", smallObject));
+        PrintLine(Format("  system allocator:                         {:8.2f} ms", system));
+        PrintLine(Format("  small object allocator, free on thread:   {:8.2f} ms", smallObjectCrossThread));
+        PrintLine(Format("  system allocator, free on thread:         {:8.2f} ms", systemCrossThread));
+        PrintLine(Format("Scene of {} nodes using {}:", numNodes_, sceneAllocator));
+        PrintLine(Format("  build:                                    {:8.2f} ms", sceneBuild));
+        PrintLine(Format("  teardown:                                 {:8.2f} ms", sceneTeardown));
+        PrintLine("Build with URHO3D_SMALL_OBJECT_ALLOCATOR toggled to compare scene timings between allocators.");
+    }
+
+    /// Compare octree queries with and without the flattened octree on a large static scene.
+    void BenchmarkCulling()
+    {
+        auto scene = MakeShared<Scene>(context_);
+        auto* octree = scene->CreateComponent<Octree>();
+
+        auto model = MakeShared<Model>(context_);
+        model->SetBoundingBox(BoundingBox(-0.5f, 0.5f));
+
+        SetRandomSeed(1);
+        const float extent = 900.0f;
+        for (unsigned i = 0; i < numDrawables_; ++i)
+        {
+            Node* node = scene->CreateChild(EMPTY_STRING, LOCAL);
+            node->SetPosition(Vector3(Random(-extent, extent), Random(-10.0f, 10.0f), Random(-extent, extent)));
+            node->SetScale(Random(0.5f, 4.0f));
+            node->CreateComponent<StaticModel>(LOCAL)->SetModel(model);
+        }
+
+        FrameInfo frame;
+        octree->Update(frame);
+
+        ea::vector<Frustum> frustums(numQueries_);
+        ea::vector<Ray> rays(numQueries_);
+        for (unsigned i = 0; i < numQueries_; ++i)
+        {
+            const Vector3 position(Random(-extent, extent), Random(0.0f, 20.0f), Random(-extent, extent));
+            const Quaternion rotation(Random(-30.0f, 10.0f), Random(360.0f), 0.0f);
+            frustums[i].Define(60.0f, 16.0f / 9.0f, 1.0f, 0.1f, 300.0f, Matrix3x4(position, rotation, 1.0f));
+            rays[i] = Ray(position, rotation * Vector3::FORWARD);
+        }
+
+        const auto runQueries = [&](bool flatten, unsigned& numResults)
+        {
+            octree->SetFlattenQueries(flatten);
+            numResults = 0;
+
+            ea::vector<Drawable*> drawables;
+            ea::vector<RayQueryResult> rayResults;
+            double frustumTime = M_INFINITY, rayTime = M_INFINITY;
+            for (unsigned iteration = 0; iteration < numIterations_; ++iteration)
+            {
+                HiresTimer timer;
+                for (const Frustum& frustum : frustums)
+                {
+                    FrustumOctreeQuery query(drawables, frustum, DRAWABLE_GEOMETRY);
+                    octree->GetDrawables(query);
+                    numResults += drawables.size();
+                }
+                frustumTime = Min(frustumTime, GetMSec(timer));
+
+                for (const Ray& ray : rays)
+                {
+                    RayOctreeQuery query(rayResults, ray, RAY_AABB, 300.0f, DRAWABLE_GEOMETRY);
+                    octree->Raycast(query);
+                    numResults += rayResults.size();
+                }
+                rayTime = Min(rayTime, GetMSec(timer));
+            }
+            return ea::make_pair(frustumTime, rayTime);
+        };
+
+        unsigned hierarchyResults = 0, flatResults = 0;
+        const auto hierarchy = runQueries(false, hierarchyResults);
+        const auto flat = runQueries(true, flatResults);
+
+        const SIMDLevel simdLevel = GetSIMDLevel();
+        SetSIMDLevel(SIMD_NONE);
+        unsigned scalarResults = 0;
+        const auto flatScalar = runQueries(true, scalarResults);
+        SetSIMDLevel(simdLevel);
+
+        PrintLine(Format("{} static drawables in {} octants, {} queries of each kind, best of {} iterations:",
+            numDrawables_, octree->GetFlatOctree().GetNumOctants(), numQueries_, numIterations_));
+        PrintLine(Format("  octant hierarchy, frustum:                {:8.2f} ms", hierarchy.first));
+        PrintLine(Format("  flattened octree, frustum:                {:8.2f} ms", flat.first));
+        PrintLine(Format("  flattened octree without SIMD, frustum:   {:8.2f} ms", flatScalar.first));
+        PrintLine(Format("  octant hierarchy, ray:                    {:8.2f} ms", hierarchy.second));
+        PrintLine(Format("  flattened octree, ray:                    {:8.2f} ms", flat.second));
+        if (hierarchyResults != flatResults || hierarchyResults != scalarResults)
+            PrintLine(Format("Result mismatch: {} drawables from hierarchy, {} from flattened octree, {} without SIMD",
+                hierarchyResults, flatResults, scalarResults), true);
+    }
+
+    /// Render box occluders to the occlusion buffer and test boxes against it, like View does each frame.
+    void BenchmarkOcclusion()
+    {
+        auto cameraNode = MakeShared<Node>(context_);
+        cameraNode->SetPosition(Vector3(0.0f, 5.0f, -30.0f));
+        cameraNode->LookAt(Vector3::ZERO);
+        auto* camera = cameraNode->CreateComponent<Camera>();
+        camera->SetFarClip(300.0f);
+        camera->SetAspectRatio(16.0f / 9.0f);
+
+        // Box with outward facing triangles
+        static const Vector3 vertices[] = {
+            Vector3(-0.5f, -0.5f, -0.5f), Vector3(0.5f, -0.5f, -0.5f), Vector3(-0.5f, 0.5f, -0.5f), Vector3(0.5f, 0.5f, -0.5f),
+            Vector3(-0.5f, -0.5f, 0.5f), Vector3(0.5f, -0.5f, 0.5f), Vector3(-0.5f, 0.5f, 0.5f), Vector3(0.5f, 0.5f, 0.5f)
+        };
+        static const unsigned short indices[] = {
+            0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4, 2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5
+        };
+        const unsigned numIndices = sizeof(indices) / sizeof(indices[0]);
+
+        SetRandomSeed(1);
+        ea::vector<Matrix3x4> occluders;
+        for (unsigned i = 0; i < numOccluders_; ++i)
+        {
+            const Vector3 position(Random(-60.0f, 60.0f), Random(-5.0f, 5.0f), Random(0.0f, 150.0f));
+            const Vector3 scale(Random(1.0f, 8.0f), Random(1.0f, 8.0f), Random(0.2f, 2.0f));
+            occluders.push_back(Matrix3x4(position, Quaternion(Random(360.0f), Vector3::UP), scale));
+        }
+
+        ea::vector<BoundingBox> occludees;
+        for (unsigned i = 0; i < numOcclusionTests_; ++i)
+        {
+            const Vector3 center(Random(-80.0f, 80.0f), Random(-10.0f, 10.0f), Random(0.0f, 200.0f));
+            occludees.push_back(BoundingBox(center - Vector3::ONE * Random(0.1f, 2.0f), center + Vector3::ONE * Random(0.1f, 2.0f)));
+        }
+
+        PrintLine(Format("{} box occluders, {} occludee tests, {}x{} buffer, best of {} frames:", numOccluders_,
+            numOcclusionTests_, occlusionBufferSize_, RoundToInt(occlusionBufferSize_ / camera->GetAspectRatio()), numFrames_));
+
+        for (bool threaded : { false, true })
+        {
+            auto buffer = MakeShared<OcclusionBuffer>(context_);
+            buffer->SetSize(occlusionBufferSize_, RoundToInt(occlusionBufferSize_ / camera->GetAspectRatio()), threaded);
+            buffer->SetView(camera);
+            buffer->SetMaxTriangles(M_MAX_UNSIGNED);
+
+            double drawTime = M_INFINITY, hierarchyTime = M_INFINITY, testTime = M_INFINITY;
+            unsigned numVisible = 0;
+            for (unsigned frame = 0; frame < numFrames_; ++frame)
+            {
+                HiresTimer timer;
+                buffer->Clear();
+                for (const Matrix3x4& transform : occluders)
+                    buffer->AddTriangles(transform, vertices, sizeof(Vector3), indices, sizeof(unsigned short), 0, numIndices);
+                buffer->DrawTriangles();
+                drawTime = Min(drawTime, GetMSec(timer));
+
+                buffer->BuildDepthHierarchy();
+                hierarchyTime = Min(hierarchyTime, GetMSec(timer));
+
+                numVisible = 0;
+                for (const BoundingBox& box : occludees)
+                    numVisible += buffer->IsVisible(box);
+                testTime = Min(testTime, GetMSec(timer));
+            }
+
+            PrintLine(Format("  {} ({} triangles, {} of {} boxes visible):", buffer->IsThreaded() ? "threaded" : "single thread",
+                buffer->GetNumTriangles(), numVisible, numOcclusionTests_));
+            PrintLine(Format("    draw:                                   {:8.3f} ms", drawTime));
+            PrintLine(Format("    depth hierarchy:                        {:8.3f} ms", hierarchyTime));
+            PrintLine(Format("    occludee tests:                         {:8.3f} ms", testTime));
+        }
+    }
+
+    /// Update a view of a synthetic scene frame by frame and measure its CPU stages. The Renderer runs without the Graphics
+    /// subsystem, so batches get no shaders and nothing is rendered.
+    void BenchmarkRender()
+    {
+        auto* cache = GetSubsystem<ResourceCache>();
+        auto* time = GetSubsystem<Time>();
+        auto* workQueue = GetSubsystem<WorkQueue>();
+        if (!GetSubsystem<Renderer>())
+            context_->RegisterSubsystem(new Renderer(context_));
+
+        auto* staticModel = cache->GetResource<Model>("Models/Box.mdl");
+        auto* animatedModel = cache->GetResource<Model>("Models/Mutant/Mutant.mdl");
+        const ea::string animationName = "Models/Mutant/Mutant_Idle0.ani";
+        if (!staticModel || !animatedModel || !cache->Exists(animationName))
+        {
+            PrintLine("Benchmark models not found, run from the directory containing Data and CoreData", true);
+            return;
+        }
+
+        auto scene = MakeShared<Scene>(context_);
+        auto* octree = scene->CreateComponent<Octree>();
+        auto* zone = scene->CreateComponent<Zone>();
+        zone->SetBoundingBox(BoundingBox(-1000.0f, 1000.0f));
+        zone->SetAmbientColor(Color(0.2f, 0.2f, 0.2f));
+
+        SetRandomSeed(1);
+        const float extent = 100.0f;
+        for (unsigned i = 0; i < numStaticModels_; ++i)
+        {
+            Node* node = scene->CreateChild("Box");
+            node->SetPosition(Vector3(Random(-extent, extent), Random(0.0f, 5.0f), Random(0.0f, 2.0f * extent)));
+            node->SetRotation(Quaternion(Random(360.0f), Vector3::UP));
+            node->CreateComponent<StaticModel>()->SetModel(staticModel);
+        }
+
+        for (unsigned i = 0; i < numLights_; ++i)
+        {
+            Node* node = scene->CreateChild("Light");
+            node->SetPosition(Vector3(Random(-extent, extent), 5.0f, Random(0.0f, 2.0f * extent)));
+            auto* light = node->CreateComponent<Light>();
+            light->SetLightType(LIGHT_POINT);
+            light->SetRange(Random(10.0f, 40.0f));
+        }
+
+        for (unsigned i = 0; i < numAnimatedModels_; ++i)
+        {
+            Node* node = scene->CreateChild("Mutant");
+            node->SetPosition(Vector3(Random(-extent, extent) * 0.5f, 0.0f, Random(0.0f, extent)));
+            node->SetRotation(Quaternion(Random(360.0f), Vector3::UP));
+            node->CreateComponent<AnimatedModel>()->SetModel(animatedModel);
+            node->CreateComponent<AnimationController>()->Play(animationName, 0, true);
+        }
+
+        Node* cameraNode = scene->CreateChild("Camera");
+        cameraNode->SetPosition(Vector3(0.0f, 20.0f, -20.0f));
+        cameraNode->LookAt(Vector3(0.0f, 0.0f, extent));
+        auto* camera = cameraNode->CreateComponent<Camera>();
+        camera->SetFarClip(300.0f);
+
+        auto viewport = MakeShared<Viewport>(context_, scene, camera, IntRect(0, 0, 1920, 1080));
+        auto view = MakeShared<View>(context_);
+        if (!view->Define(nullptr, viewport))
+        {
+            PrintLine("Failed to define the view", true);
+            return;
+        }
+
+        const float timeStep = 1.0f / 60.0f;
+        const unsigned numThreads = workQueue->GetNumThreads() + 1;
+        FrameStatistic sceneUpdate, octreeUpdate, getDrawables, processLights, getBatches, updateGeometries, frameTotal;
+        FrameStatistic heapAllocations, heapBytes, frameAllocatorPeak;
+        ea::vector<double> busyTimes(numThreads);
+
+        // The first frame loads resources and sizes the containers, leave it out of the statistics
+        for (unsigned frameIndex = 0; frameIndex <= numFrames_; ++frameIndex)
+        {
+            // Beginning of the frame publishes the busy times of the worker threads during the previous frame
+            time->BeginFrame(timeStep);
+            if (frameIndex > 1)
+            {
+                for (unsigned i = 0; i < numThreads; ++i)
+                    busyTimes[i] += workQueue->GetBusyTime(i) / 1000.0;
+            }
+
+            const unsigned long long allocationsBefore = numHeapAllocations;
+            const unsigned long long bytesBefore = numHeapBytes;
+            HiresTimer frameTimer;
+            HiresTimer stageTimer;
+
+            scene->Update(timeStep);
+            const double sceneUpdateTime = GetMSec(stageTimer);
+
+            FrameInfo frame;
+            frame.frameNumber_ = time->GetFrameNumber();
+            frame.timeStep_ = timeStep;
+            frame.viewSize_ = view->GetViewSize();
+            frame.camera_ = camera;
+            octree->Update(frame);
+            const double octreeUpdateTime = GetMSec(stageTimer);
+
+            view->Update(frame);
+            view->UpdateGeometries();
+            const double frameTime = GetMSec(frameTimer);
+
+            time->EndFrame();
+            if (frameIndex == 0)
+                continue;
+
+            const ViewStageTimes& stageTimes = view->GetStageTimes();
+            sceneUpdate.Add(sceneUpdateTime);
+            octreeUpdate.Add(octreeUpdateTime);
+            getDrawables.Add(stageTimes.getDrawables_ / 1000.0);
+            processLights.Add(stageTimes.processLights_ / 1000.0);
+            getBatches.Add(stageTimes.getBatches_ / 1000.0);
+            updateGeometries.Add(stageTimes.updateGeometries_ / 1000.0);
+            frameTotal.Add(frameTime);
+            heapAllocations.Add(static_cast<double>(numHeapAllocations - allocationsBefore));
+            heapBytes.Add(static_cast<double>(numHeapBytes - bytesBefore));
+            frameAllocatorPeak.Add(view->GetFrameAllocator().GetPeakSize());
+        }
+
+        time->BeginFrame(timeStep);
+        for (unsigned i = 0; i < numThreads; ++i)
+            busyTimes[i] += workQueue->GetBusyTime(i) / 1000.0;
+        time->EndFrame();
+
+        JSONValue report;
+        report["scene"]["staticModels"] = numStaticModels_;
+        report["scene"]["lights"] = numLights_;
+        report["scene"]["animatedModels"] = numAnimatedModels_;
+        report["frames"] = numFrames_;
+        report["visible"]["geometries"] = static_cast<unsigned>(view->GetGeometries().size());
+        report["visible"]["lights"] = static_cast<unsigned>(view->GetLights().size());
+
+        JSONValue& stages = report["stagesMs"];
+        stages["sceneUpdate"] = sceneUpdate.ToJSON();
+        stages["octreeUpdate"] = octreeUpdate.ToJSON();
+        stages["getDrawables"] = getDrawables.ToJSON();
+        stages["processLights"] = processLights.ToJSON();
+        stages["getBatches"] = getBatches.ToJSON();
+        stages["updateGeometries"] = updateGeometries.ToJSON();
+        stages["total"] = frameTotal.ToJSON();
+
+        JSONValue& allocations = report["allocationsPerFrame"];
+        allocations["heapAllocations"] = heapAllocations.ToJSON();
+        allocations["heapBytes"] = heapBytes.ToJSON();
+        allocations["frameAllocatorPeakBytes"] = frameAllocatorPeak.ToJSON();
+
+        // Work items are executed by the main thread only while it waits for them, so its utilization is not the
+        // fraction of the frame spent working
+        JSONValue threads;
+        for (unsigned i = 0; i < numThreads; ++i)
+        {
+            JSONValue thread;
+            thread["index"] = i;
+            thread["workItemMs"] = busyTimes[i] / numFrames_;
+            thread["utilization"] = frameTotal.total_ > 0.0 ? busyTimes[i] / frameTotal.total_ : 0.0;
+            threads.Push(thread);
+        }
+        report["threads"] = threads;
+
+        auto jsonFile = MakeShared<JSONFile>(context_);
+        jsonFile->GetRoot() = report;
+        if (outputFileName_.empty())
+            PrintLine(jsonFile->ToString("    "));
+        else
+        {
+            File file(context_, outputFileName_, FILE_WRITE);
+            if (!file.IsOpen() || !jsonFile->Save(file, "    "))
+                PrintLine(Format("Failed to write {}", outputFileName_), true);
+        }
+    }
+
+    /// Timings of saving and loading one scene in both binary formats.
+    struct SerializationTimings
+    {
+        double save_{M_INFINITY};
+        double load_{M_INFINITY};
+        double archiveSave_{M_INFINITY};
+        double archiveLoad_{M_INFINITY};
+    };
+
+    /// Save and load the scene with Serializer and BinaryArchive. Return the saved data for comparison.
+    ea::pair<ea::vector<unsigned char>, ea::vector<unsigned char>> MeasureSerialization(Scene* scene, SerializationTimings& timings)
+    {
+        VectorBuffer buffer;
+        VectorBuffer archiveBuffer;
+        for (unsigned i = 0; i < numIterations_; ++i)
+        {
+            auto loadedScene = MakeShared<Scene>(context_);
+            buffer.Clear();
+            archiveBuffer.Clear();
+
+            HiresTimer timer;
+            scene->Save(buffer);
+            timings.save_ = Min(timings.save_, GetMSec(timer));
+
+            MemoryBuffer source(buffer.GetBuffer());
+            timer.Reset();
+            loadedScene->Load(source);
+            timings.load_ = Min(timings.load_, GetMSec(timer));
+
+            BinaryOutputArchive outputArchive(context_, archiveBuffer);
+            timer.Reset();
+            scene->Serialize(outputArchive);
+            timings.archiveSave_ = Min(timings.archiveSave_, GetMSec(timer));
+
+            MemoryBuffer archiveSource(archiveBuffer.GetBuffer());
+            BinaryInputArchive inputArchive(context_, archiveSource);
+            timer.Reset();
+            loadedScene->Serialize(inputArchive);
+            timings.archiveLoad_ = Min(timings.archiveLoad_, GetMSec(timer));
+        }
+        return { buffer.GetBuffer(), archiveBuffer.GetBuffer() };
+    }
+
+    /// Compare binary scene serialization with direct attribute access against the Variant path.
+    void BenchmarkSerialization()
+    {
+        auto scene = MakeShared<Scene>(context_);
+        BuildScene(scene);
+
+        const bool directEnabled = Serializable::GetDirectAttributeSerialization();
+        SerializationTimings direct, variant;
+        Serializable::SetDirectAttributeSerialization(true);
+        const auto directData = MeasureSerialization(scene, direct);
+        Serializable::SetDirectAttributeSerialization(false);
+        const auto variantData = MeasureSerialization(scene, variant);
+        Serializable::SetDirectAttributeSerialization(directEnabled);
+
+        PrintLine(Format("Scene of {} nodes, {} bytes, {} bytes as BinaryArchive, best of {} iterations:",
+            numNodes_, directData.first.size(), directData.second.size(), numIterations_));
+        PrintLine(Format("  save, direct:                             {:8.2f} ms", direct.save_));
+        PrintLine(Format("  save, Variant:                            {:8.2f} ms", variant.save_));
+        PrintLine(Format("  load, direct:                             {:8.2f} ms", direct.load_));
+        PrintLine(Format("  load, Variant:                            {:8.2f} ms", variant.load_));
+        PrintLine(Format("  archive save, direct:                     {:8.2f} ms", direct.archiveSave_));
+        PrintLine(Format("  archive save, Variant:                    {:8.2f} ms", variant.archiveSave_));
+        PrintLine(Format("  archive load, direct:                     {:8.2f} ms", direct.archiveLoad_));
+        PrintLine(Format("  archive load, Variant:                    {:8.2f} ms", variant.archiveLoad_));
+        if (directData != variantData)
+            PrintLine("Saved data differs between the direct and Variant paths", true);
+    }
+
+    /// Build a scene hierarchy with one component per node.
+    void BuildScene(Scene* scene)
+    {
+        ea::vector<Node*> parents{ scene };
+        for (unsigned i = 0; i < numNodes_; ++i)
+        {
+            Node* node = parents[i / 8]->CreateChild(EMPTY_STRING, LOCAL);
+            node->SetPosition(Vector3(static_cast<float>(i), 0.0f, 0.0f));
+            node->CreateComponent<SplinePath>(LOCAL);
+            parents.push_back(node);
+        }
+    }
+
+    /// Number of scene nodes.
+    unsigned numNodes_{100000};
+    /// Number of drawables.
+    unsigned numDrawables_{100000};
+    /// Number of queries.
+    unsigned numQueries_{1000};
+    /// Number of occluders.
+    unsigned numOccluders_{500};
+    /// Number of occludee tests per frame.
+    unsigned numOcclusionTests_{20000};
+    /// Occlusion buffer width.
+    int occlusionBufferSize_{256};
+    /// Number of frames.
+    unsigned numFrames_{100};
+    /// Number of static models.
+    unsigned numStaticModels_{10000};
+    /// Number of lights.
+    unsigned numLights_{16};
+    /// Number of animated models.
+    unsigned numAnimatedModels_{100};
+    /// Report file name.
+    ea::string outputFileName_;
+    /// Number of worker threads.
+    unsigned numWorkers_{Max(GetNumPhysicalCPUs(), 1u) - 1};
+    /// Number of iterations.
+    unsigned numIterations_{5};
+};
+
+URHO3D_DEFINE_APPLICATION_MAIN(BenchmarkApplication);
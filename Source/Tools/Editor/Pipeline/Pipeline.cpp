@@ -703,6 +703,7 @@ static const char* variantNames[] = {
 static const char* predefinedNames[] = {
     "Select Option Name",
     "Enter Custom",
+    EP_ASYNC_SHADER_COMPILATION.c_str(),
     EP_AUTOLOAD_PATHS.c_str(),
     EP_BORDERLESS.c_str(),
     EP_DUMP_SHADERS.c_str(),
@@ -757,6 +758,7 @@ static const char* predefinedNames[] = {
 static VariantType predefinedTypes[] = {
     VAR_NONE,   // Select Option Name
     VAR_NONE,   // Enter Custom
+    VAR_BOOL,   // EP_ASYNC_SHADER_COMPILATION
     VAR_STRING, // EP_AUTOLOAD_PATHS
     VAR_BOOL,   // EP_BORDERLESS
     VAR_BOOL,   // EP_DUMP_SHADERS
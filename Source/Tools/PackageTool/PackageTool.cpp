@@ -24,6 +24,8 @@
 
 #include <Urho3D/Core/Context.h>
 #include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/WorkQueue.h>
 #include <Urho3D/IO/File.h>
 #include <Urho3D/IO/FileSystem.h>
 #include <Urho3D/IO/PackageFile.h>
@@ -36,12 +38,16 @@
 #include <LZ4/lz4.h>
 #include <LZ4/lz4hc.h>
 
+#include <atomic>
+
 #include <Urho3D/DebugNew.h>
 
 
 using namespace Urho3D;
 
 static const unsigned COMPRESSED_BLOCK_SIZE = 32768;
+/// Maximum amount of uncompressed file data read into memory and compressed at once.
+static const unsigned COMPRESSION_BATCH_SIZE = 64 * 1024 * 1024;
 
 struct FileEntry
 {
@@ -49,6 +55,7 @@ struct FileEntry
     unsigned offset_{};
     unsigned size_{};
     unsigned checksum_{};
+    ea::vector<unsigned> blockSizes_;
 };
 
 Context* context_ = nullptr;
@@ -56,9 +63,11 @@ FileSystem* fileSystem_ = nullptr;
 ea::string basePath_;
 ea::vector<FileEntry> entries_;
 unsigned checksum_ = 0;
+int64_t fileListOffset_ = 0;
 bool compress_ = false;
 bool quiet_ = false;
 unsigned blockSize_ = COMPRESSED_BLOCK_SIZE;
+unsigned numThreads_ = 0;
 
 ea::string ignoreExtensions_[] = {
     ".bak",
@@ -69,7 +78,9 @@ int main(int argc, char** argv);
 void Run(const ea::vector<ea::string>& arguments);
 void ProcessFile(const ea::string& fileName, const ea::string& rootDir);
 void WritePackageFile(const ea::string& fileName, const ea::string& rootDir);
+void WriteBatch(File& dest, unsigned firstEntry, unsigned lastEntry, const ea::string& rootDir);
 void WriteHeader(File& dest);
+void VerifyPackageFile(PackageFile* packageFile);
 
 int main(int argc, char** argv)
 {
@@ -97,6 +108,7 @@ void Run(const ea::vector<ea::string>& arguments)
             "\n"
             "Options:\n"
             "-c      Enable package file LZ4 compression\n"
+            "-jN     Use N threads for compression and verification (default: number of logical CPUs)\n"
             "-q      Enable quiet mode\n"
             "\n"
             "Basepath is an optional prefix that will be added to the file entries.\n\n"
@@ -105,6 +117,7 @@ void Run(const ea::vector<ea::string>& arguments)
             "-i      Output package file information\n"
             "-l      Output file names (including their paths) contained in the package\n"
             "-L      Similar to -l but also output compression ratio (compressed package file only)\n"
+            "-v      Verify checksums of all files contained in the package\n"
         );
 
     const ea::string& dirName = arguments[0];
@@ -125,6 +138,9 @@ void Run(const ea::vector<ea::string>& arguments)
                     case 'c':
                         compress_ = true;
                         break;
+                    case 'j':
+                        numThreads_ = ToUInt(arguments[i].substr(2));
+                        break;
                     case 'q':
                         quiet_ = true;
                         break;
@@ -136,6 +152,11 @@ void Run(const ea::vector<ea::string>& arguments)
         }
     }
 
+    // Worker threads for compression and verification. The main thread also participates
+    SharedPtr<WorkQueue> workQueue(new WorkQueue(context_));
+    context_->RegisterSubsystem(workQueue);
+    workQueue->CreateThreads((numThreads_ ? numThreads_ : GetNumLogicalCPUs()) - 1);
+
     if (!isOutputMode)
     {
         if (!quiet_)
@@ -169,7 +190,7 @@ void Run(const ea::vector<ea::string>& arguments)
         {
             unsigned packageTime = fileSystem_->GetLastModifiedTime(packageName);
             SharedPtr<PackageFile> packageFile(new PackageFile(context_, packageName));
-            if (packageFile->GetNumFiles() == fileNames.size())
+            if (packageFile->GetNumFiles() == fileNames.size() && packageFile->GetVersion() == PACKAGE_FORMAT_VERSION)
             {
                 bool filesOutOfDate = false;
                 for (const ea::string& fileName : fileNames)
@@ -206,6 +227,9 @@ void Run(const ea::vector<ea::string>& arguments)
             PrintLine("Package size: " + ea::to_string(packageFile->GetTotalSize()));
             PrintLine("Checksum: " + ea::to_string(packageFile->GetChecksum()));
             PrintLine("Compressed: " + ea::string(packageFile->IsCompressed() ? "yes" : "no"));
+            PrintLine("Format version: " + ea::to_string(packageFile->GetVersion()));
+            if (packageFile->GetBlockSize())
+                PrintLine("Block size: " + ea::to_string(packageFile->GetBlockSize()));
             break;
         case 'L':
             if (!packageFile->IsCompressed())
@@ -221,7 +245,8 @@ void Run(const ea::vector<ea::string>& arguments)
                     ea::string fileEntry(current->first);
                     if (outputCompressionRatio)
                     {
-                        unsigned compressedSize =
+                        // Indexed packages know the stored size of each entry, older ones only allow an estimate from entry offsets
+                        unsigned compressedSize = !current->second.blockOffsets_.empty() ? current->second.blockOffsets_.back() :
                             (i == entries.end() ? packageFile->GetTotalSize() - sizeof(unsigned) : i->second.offset_) -
                             current->second.offset_;
                         fileEntry.append_sprintf("\tin: %u\tout: %u\tratio: %f", current->second.size_, compressedSize,
@@ -231,6 +256,9 @@ void Run(const ea::vector<ea::string>& arguments)
                 }
             }
             break;
+        case 'v':
+            VerifyPackageFile(packageFile);
+            break;
         default:
             ErrorExit("Unrecognized output option");
         }
@@ -261,117 +289,206 @@ void WritePackageFile(const ea::string& fileName, const ea::string& rootDir)
     if (!dest.Open(fileName, FILE_WRITE))
         ErrorExit("Could not open output file " + fileName);
 
-    // Write ID, number of files & placeholder for checksum
+    // Write placeholder header, the file list goes to the end of the package
     WriteHeader(dest);
 
-    for (unsigned i = 0; i < entries_.size(); ++i)
+    // Read, hash and compress files in batches to bound memory use
+    unsigned totalDataSize = 0;
+    for (unsigned first = 0; first < entries_.size();)
     {
-        // Write entry (correct offset is still unknown, will be filled in later)
-        dest.WriteString(basePath_ + entries_[i].name_);
-        dest.WriteUInt(entries_[i].offset_);
-        dest.WriteUInt(entries_[i].size_);
-        dest.WriteUInt(entries_[i].checksum_);
+        unsigned last = first;
+        unsigned batchSize = 0;
+        while (last < entries_.size() && (last == first || batchSize + entries_[last].size_ <= COMPRESSION_BATCH_SIZE))
+            batchSize += entries_[last++].size_;
+
+        WriteBatch(dest, first, last, rootDir);
+        totalDataSize += batchSize;
+        first = last;
     }
 
-    unsigned totalDataSize = 0;
-    unsigned lastOffset;
+    // Package checksum covers the checksums of all entries
+    ea::vector<unsigned> entryChecksums;
+    for (const FileEntry& entry : entries_)
+        entryChecksums.push_back(entry.checksum_);
+    checksum_ = XXHash32(entryChecksums.data(), entryChecksums.size() * sizeof(unsigned));
+
+    fileListOffset_ = dest.GetSize();
+    for (const FileEntry& entry : entries_)
+    {
+        dest.WriteString(basePath_ + entry.name_);
+        dest.WriteUInt(entry.offset_);
+        dest.WriteUInt(entry.size_);
+        dest.WriteUInt(entry.checksum_);
+        for (unsigned blockSize : entry.blockSizes_)
+            dest.WriteVLE(blockSize);
+    }
+
+    // Write package size to the end of file to allow finding it linked to an executable file
+    unsigned currentSize = dest.GetSize();
+    dest.WriteUInt(currentSize + sizeof(unsigned));
+
+    // Write header again with correct file list offset & checksum
+    dest.Seek(0);
+    WriteHeader(dest);
+
+    if (!quiet_)
+    {
+        PrintLine("Number of files: " + ea::to_string(entries_.size()));
+        PrintLine("File data size: " + ea::to_string(totalDataSize));
+        PrintLine("Package size: " + ea::to_string(dest.GetSize()));
+        PrintLine("Checksum: " + ea::to_string(checksum_));
+        PrintLine("Compressed: " + ea::string(compress_ ? "yes" : "no"));
+    }
+}
+
+void WriteBatch(File& dest, unsigned firstEntry, unsigned lastEntry, const ea::string& rootDir)
+{
+    auto* workQueue = context_->GetSubsystem<WorkQueue>();
+    const unsigned numEntries = lastEntry - firstEntry;
 
-    // Write file data, calculate checksums & correct offsets
-    for (unsigned i = 0; i < entries_.size(); ++i)
+    // Read the source files sequentially
+    ea::vector<ea::vector<unsigned char>> buffers(numEntries);
+    for (unsigned i = 0; i < numEntries; ++i)
     {
-        lastOffset = entries_[i].offset_ = dest.GetSize();
-        ea::string fileFullPath = rootDir + "/" + entries_[i].name_;
+        FileEntry& entry = entries_[firstEntry + i];
+        ea::string fileFullPath = rootDir + "/" + entry.name_;
 
         File srcFile(context_, fileFullPath);
         if (!srcFile.IsOpen())
             ErrorExit("Could not open file " + fileFullPath);
 
-        unsigned dataSize = entries_[i].size_;
-        totalDataSize += dataSize;
-        ea::unique_ptr<unsigned char[]> buffer(new unsigned char[dataSize]);
-
-        if (srcFile.Read(&buffer[0], dataSize) != dataSize)
+        buffers[i].resize(entry.size_);
+        if (entry.size_ && srcFile.Read(buffers[i].data(), entry.size_) != entry.size_)
             ErrorExit("Could not read file " + fileFullPath);
-        srcFile.Close();
+    }
 
-        for (unsigned j = 0; j < dataSize; ++j)
-        {
-            checksum_ = SDBMHash(checksum_, buffer[j]);
-            entries_[i].checksum_ = SDBMHash(entries_[i].checksum_, buffer[j]);
-        }
+    workQueue->ParallelFor(numEntries, 1, [&](unsigned fromIndex, unsigned toIndex)
+    {
+        for (unsigned i = fromIndex; i < toIndex; ++i)
+            entries_[firstEntry + i].checksum_ = XXHash32(buffers[i].data(), buffers[i].size());
+    });
 
-        if (!compress_)
+    if (!compress_)
+    {
+        for (unsigned i = 0; i < numEntries; ++i)
         {
+            FileEntry& entry = entries_[firstEntry + i];
+            entry.offset_ = dest.GetSize();
             if (!quiet_)
-                PrintLine(entries_[i].name_ + " size " + ea::to_string(dataSize));
-            dest.Write(&buffer[0], entries_[i].size_);
+                PrintLine(entry.name_ + " size " + ea::to_string(entry.size_));
+            dest.Write(buffers[i].data(), entry.size_);
         }
-        else
-        {
-            ea::unique_ptr<unsigned char[]> compressBuffer(new unsigned char[LZ4_compressBound(blockSize_)]);
-
-            unsigned pos = 0;
+        return;
+    }
 
-            while (pos < dataSize)
-            {
-                unsigned unpackedSize = blockSize_;
-                if (pos + unpackedSize > dataSize)
-                    unpackedSize = dataSize - pos;
+    // Compress all blocks of the batch in parallel, each into its own slot of the output buffer
+    struct Block
+    {
+        unsigned entry_;
+        unsigned offset_;
+        unsigned size_;
+    };
+    ea::vector<Block> blocks;
+    for (unsigned i = 0; i < numEntries; ++i)
+    {
+        for (unsigned pos = 0; pos < entries_[firstEntry + i].size_; pos += blockSize_)
+            blocks.push_back({ i, pos, Min(blockSize_, entries_[firstEntry + i].size_ - pos) });
+    }
 
-                auto packedSize = (unsigned)LZ4_compress_HC((const char*)&buffer[pos], (char*)compressBuffer.get(), unpackedSize, LZ4_compressBound(unpackedSize), 0);
-                if (!packedSize)
-                    ErrorExit("LZ4 compression failed for file " + entries_[i].name_ + " at offset " + ea::to_string(pos));
+    const auto blockCapacity = (unsigned)LZ4_compressBound(blockSize_);
+    ea::vector<unsigned char> compressBuffer(blocks.size() * blockCapacity);
+    ea::vector<unsigned> packedSizes(blocks.size());
+    workQueue->ParallelFor(blocks.size(), 1, [&](unsigned fromIndex, unsigned toIndex)
+    {
+        for (unsigned i = fromIndex; i < toIndex; ++i)
+        {
+            const Block& block = blocks[i];
+            packedSizes[i] = (unsigned)LZ4_compress_HC((const char*)&buffers[block.entry_][block.offset_],
+                (char*)&compressBuffer[i * blockCapacity], block.size_, blockCapacity, LZ4HC_CLEVEL_DEFAULT);
+        }
+    });
 
-                dest.WriteUShort((unsigned short)unpackedSize);
-                dest.WriteUShort((unsigned short)packedSize);
-                dest.Write(compressBuffer.get(), packedSize);
+    // Write blocks in order. Blocks which do not shrink are stored uncompressed
+    unsigned blockIndex = 0;
+    for (unsigned i = 0; i < numEntries; ++i)
+    {
+        FileEntry& entry = entries_[firstEntry + i];
+        entry.offset_ = dest.GetSize();
 
-                pos += unpackedSize;
+        for (; blockIndex < blocks.size() && blocks[blockIndex].entry_ == i; ++blockIndex)
+        {
+            const Block& block = blocks[blockIndex];
+            const unsigned packedSize = packedSizes[blockIndex];
+            if (packedSize && packedSize < block.size_)
+            {
+                dest.Write(&compressBuffer[blockIndex * blockCapacity], packedSize);
+                entry.blockSizes_.push_back(packedSize);
             }
-
-            if (!quiet_)
+            else
             {
-                unsigned totalPackedBytes = dest.GetSize() - lastOffset;
-                ea::string fileEntry(entries_[i].name_);
-                fileEntry.append_sprintf("\tin: %u\tout: %u\tratio: %f", dataSize, totalPackedBytes,
-                    totalPackedBytes ? 1.f * dataSize / totalPackedBytes : 0.f);
-                PrintLine(fileEntry);
+                dest.Write(&buffers[i][block.offset_], block.size_);
+                entry.blockSizes_.push_back(block.size_);
             }
         }
-    }
-
-    // Write package size to the end of file to allow finding it linked to an executable file
-    unsigned currentSize = dest.GetSize();
-    dest.WriteUInt(currentSize + sizeof(unsigned));
-
-    // Write header again with correct offsets & checksums
-    dest.Seek(0);
-    WriteHeader(dest);
 
-    for (unsigned i = 0; i < entries_.size(); ++i)
-    {
-        dest.WriteString(basePath_ + entries_[i].name_);
-        dest.WriteUInt(entries_[i].offset_);
-        dest.WriteUInt(entries_[i].size_);
-        dest.WriteUInt(entries_[i].checksum_);
-    }
-
-    if (!quiet_)
-    {
-        PrintLine("Number of files: " + ea::to_string(entries_.size()));
-        PrintLine("File data size: " + ea::to_string(totalDataSize));
-        PrintLine("Package size: " + ea::to_string(dest.GetSize()));
-        PrintLine("Checksum: " + ea::to_string(checksum_));
-        PrintLine("Compressed: " + ea::string(compress_ ? "yes" : "no"));
+        if (!quiet_)
+        {
+            unsigned totalPackedBytes = dest.GetSize() - entry.offset_;
+            ea::string fileEntry(entry.name_);
+            fileEntry.append_sprintf("\tin: %u\tout: %u\tratio: %f", entry.size_, totalPackedBytes,
+                totalPackedBytes ? 1.f * entry.size_ / totalPackedBytes : 0.f);
+            PrintLine(fileEntry);
+        }
     }
 }
 
 void WriteHeader(File& dest)
 {
     if (!compress_)
-        dest.WriteFileID("UPAK");
+        dest.WriteFileID("RPAK");
     else
-        dest.WriteFileID("ULZ4");
+        dest.WriteFileID("RLZ4");
     dest.WriteUInt(entries_.size());
     dest.WriteUInt(checksum_);
+    dest.WriteUInt(PACKAGE_FORMAT_VERSION);
+    dest.WriteInt64(fileListOffset_);
+    dest.WriteUInt(compress_ ? blockSize_ : 0);
+}
+
+void VerifyPackageFile(PackageFile* packageFile)
+{
+    if (!packageFile->GetNumFiles())
+        ErrorExit("Package is empty or could not be opened");
+
+    const ea::vector<ea::string> entryNames = packageFile->GetEntryNames();
+    const bool useXXHash = packageFile->GetVersion() >= 1;
+    std::atomic<unsigned> numFailed{0};
+
+    context_->GetSubsystem<WorkQueue>()->ParallelFor(entryNames.size(), 1, [&](unsigned fromIndex, unsigned toIndex)
+    {
+        for (unsigned i = fromIndex; i < toIndex; ++i)
+        {
+            File file(context_, packageFile, entryNames[i]);
+            ea::vector<unsigned char> data = file.ReadBinary();
+
+            unsigned checksum = 0;
+            if (useXXHash)
+                checksum = XXHash32(data.data(), data.size());
+            else
+            {
+                for (unsigned char value : data)
+                    checksum = SDBMHash(checksum, value);
+            }
+
+            if (data.size() != file.GetSize() || checksum != file.GetChecksum())
+            {
+                PrintLine("Checksum mismatch: " + entryNames[i], true);
+                ++numFailed;
+            }
+        }
+    });
+
+    if (numFailed)
+        ErrorExit(ea::to_string(numFailed.load()) + " of " + ea::to_string(entryNames.size()) + " files failed verification");
+    PrintLine("Verified " + ea::to_string(entryNames.size()) + " files");
 }
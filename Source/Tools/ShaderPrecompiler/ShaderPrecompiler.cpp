@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+// Command line utility always uses console.
+#define URHO3D_WIN32_CONSOLE
+
+#include <Urho3D/Core/CommandLine.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Engine/Application.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/Graphics/Graphics.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Resource/XMLFile.h>
+
+
+using namespace Urho3D;
+
+/// Compiles all shader combinations listed in a shader precache file, filling the shader cache directory.
+class ShaderPrecompilerApplication : public Application
+{
+    URHO3D_OBJECT(ShaderPrecompilerApplication, Application);
+public:
+    explicit ShaderPrecompilerApplication(Context* context) : Application(context)
+    {
+    }
+
+    void Setup() override
+    {
+        // Compiling requires a graphics context, use a small window
+        engineParameters_[EP_SOUND] = false;
+        engineParameters_[EP_FULL_SCREEN] = false;
+        engineParameters_[EP_WINDOW_WIDTH] = 64;
+        engineParameters_[EP_WINDOW_HEIGHT] = 64;
+        engineParameters_[EP_WINDOW_TITLE] = GetTypeName();
+        engineParameters_[EP_LOG_LEVEL] = LOG_WARNING;
+
+        auto& app = GetCommandLineParser();
+        app.add_option("input", inputFileName_, "Shader precache file written with Graphics::BeginDumpShaders() or the --dump-shaders option.")->required();
+        app.add_option("-c,--cache-dir", cacheDir_, "Shader cache directory, defaults to the engine shader cache directory.");
+    }
+
+    void Start() override
+    {
+        auto* graphics = GetSubsystem<Graphics>();
+        if (!cacheDir_.empty())
+            graphics->SetShaderCacheDir(GetAbsolutePath(cacheDir_));
+        if (!IsAbsolutePath(graphics->GetShaderCacheDir()))
+        {
+            ErrorExit("Shader cache directory must be an absolute path.");
+            return;
+        }
+
+        // Compile synchronously so that every combination is finished before exiting
+        graphics->SetAsyncShaderCompilation(false);
+
+        XMLFile xmlFile(context_);
+        if (!xmlFile.LoadFile(inputFileName_))
+        {
+            ErrorExit(Format("Could not load shader precache file '{}'.", inputFileName_));
+            return;
+        }
+
+        unsigned numCombinations = 0;
+        for (XMLElement shader = xmlFile.GetRoot().GetChild("shader"); shader; shader = shader.GetNext("shader"))
+            ++numCombinations;
+
+        HiresTimer timer;
+        File file(context_, inputFileName_);
+        graphics->PrecacheShaders(file);
+
+        // Program binaries are written by work items of the default priority, wait for all of them before exiting
+        GetSubsystem<WorkQueue>()->Complete(0);
+
+        PrintLine(Format("Compiled {} shader combinations in {:.1f} ms to '{}'.", numCombinations,
+            timer.GetUSec(false) / 1000.0, graphics->GetShaderCacheDir()));
+
+        engine_->Exit();
+    }
+
+private:
+    /// Shader precache file name.
+    ea::string inputFileName_;
+    /// Shader cache directory override.
+    ea::string cacheDir_;
+};
+
+URHO3D_DEFINE_APPLICATION_MAIN(ShaderPrecompilerApplication);
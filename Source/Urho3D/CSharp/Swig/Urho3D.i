@@ -358,6 +358,8 @@ public:
 %interface_custom("%s", "I%s", Urho3D::AbstractFile);
 %include "Urho3D/IO/AbstractFile.h"
 %include "Urho3D/IO/Compression.h"
+%ignore Urho3D::PackageFile::CreateReadRequest;
+%ignore Urho3D::PackageFile::DecompressBlocks;
 %include "Urho3D/IO/File.h"
 %include "Urho3D/IO/Log.h"
 %include "Urho3D/IO/MemoryBuffer.h"
@@ -405,7 +407,9 @@ public:
 
 // These expose iterators of underlying collection. Iterate object through GetObject() instead.
 %ignore Urho3D::BackgroundLoadItem;
-%ignore Urho3D::BackgroundLoader::ThreadFunction;
+%ignore Urho3D::BackgroundLoader::LoadNextResource;
+%ignore Urho3D::ResourceCache::ReadFileAsync;
+%ignore Urho3D::ResourceCache::ReadFilesAsync;
 %rename(GetValueType) Urho3D::PListValue::GetType;
 
 %include "Urho3D/Resource/Resource.h"
@@ -492,6 +496,9 @@ public:
 %ignore Urho3D::PointOctreeQuery::TestDrawables;
 %ignore Urho3D::BoxOctreeQuery::TestDrawables;
 %ignore Urho3D::OctreeQuery::TestDrawables;
+%ignore Urho3D::OctreeQuery::TestOctants;
+%ignore Urho3D::FrustumOctreeQuery::TestOctants;
+%ignore Urho3D::Octree::GetFlatOctree;
 %ignore Urho3D::UpdateDrawablesWork;
 %ignore Urho3D::ProcessLightWork;
 %ignore Urho3D::CheckVisibilityWork;
@@ -526,7 +533,10 @@ public:
 %ignore Urho3D::CustomGeometry::DrawOcclusion;
 %ignore Urho3D::CustomGeometry::MakeCircleGraph;
 %ignore Urho3D::CustomGeometry::ProcessRayQuery;
-%ignore Urho3D::OcclusionBufferData::dataWithSafety_;
+%ignore Urho3D::OcclusionTriangle;
+%ignore Urho3D::OcclusionThreadData;
+%ignore Urho3D::OcclusionBuffer::SetupBatch;
+%ignore Urho3D::OcclusionBuffer::DrawTile;
 %ignore Urho3D::ScenePassInfo::batchQueue_;
 %ignore Urho3D::LightQueryResult;
 %ignore Urho3D::View::GetLightQueues;
@@ -561,6 +571,8 @@ public:
 %include "Urho3D/Graphics/Model.h"
 %include "Urho3D/Graphics/StaticModel.h"
 %include "Urho3D/Graphics/StaticModelGroup.h"
+%ignore Urho3D::CompressedAnimationChannel::times_;
+%ignore Urho3D::CompressedAnimationChannel::values_;
 %include "Urho3D/Graphics/Animation.h"
 %include "Urho3D/Graphics/AnimationState.h"
 %include "Urho3D/Graphics/AnimationController.h"
@@ -635,6 +647,8 @@ public:
 %ignore Urho3D::Network::MakeHttpRequest;
 %ignore Urho3D::PackageDownload;
 %ignore Urho3D::PackageUpload;
+%ignore Urho3D::ReceivedTransformHistory;
+%ignore Urho3D::SentTransformUpdate;
 
 %template(ConnectionVector) eastl::vector<Urho3D::SharedPtr<Urho3D::Connection>>;
 
@@ -647,6 +661,7 @@ public:
 %ignore Urho3D::Network::NewConnectionEstablished;
 %ignore Urho3D::Network::ClientDisconnected;
 %ignore Urho3D::Network::GetConnection;
+%ignore Urho3D::Network::GetInterestGrid;
 %ignore Urho3D::Network::OnServerConnect;
 %ignore Urho3D::Network::HandleIncomingPacket;
 
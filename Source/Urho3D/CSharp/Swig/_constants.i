@@ -7,6 +7,7 @@
 %ignore Urho3D::PROFILER_COLOR_EVENTS;
 %ignore Urho3D::PROFILER_COLOR_RESOURCES;
 %ignore Urho3D::VARIANT_VALUE_SIZE;
+%ignore Urho3D::EP_ASYNC_SHADER_COMPILATION;
 %ignore Urho3D::EP_AUTOLOAD_PATHS;
 %ignore Urho3D::EP_BORDERLESS;
 %ignore Urho3D::EP_DUMP_SHADERS;
@@ -253,8 +254,11 @@
 %ignore Urho3D::MSG_REMOTEEVENT;
 %ignore Urho3D::MSG_REMOTENODEEVENT;
 %ignore Urho3D::MSG_PACKAGEINFO;
+%ignore Urho3D::MSG_NODETRANSFORMUPDATE;
+%ignore Urho3D::MSG_NODETRANSFORMACK;
 %ignore Urho3D::CONTROLS_CONTENT_ID;
 %ignore Urho3D::PACKAGE_FRAGMENT_SIZE;
+%ignore Urho3D::TRANSFORM_HISTORY_SIZE;
 %ignore Urho3D::DEFAULT_FPS;
 %ignore Urho3D::DEFAULT_MAX_NETWORK_ANGULAR_VELOCITY;
 %ignore Urho3D::COLOR_LUT_SIZE;
@@ -23,7 +23,11 @@
 #include "../Precompiled.h"
 
 #include "../Container/Allocator.h"
-#include "../Core/Profiler.h"
+#include "../Core/Mutex.h"
+#include "../Math/MathDefs.h"
+
+#include <cstdlib>
+#include <new>
 
 #if URHO3D_STATIC
 URHO3D_API void* operator new[](size_t size, const char* pName, int flags, unsigned debugFlags, const char* file, int line)
@@ -42,106 +46,250 @@ URHO3D_API void* operator new[](size_t size, size_t alignment, size_t alignmentO
 namespace Urho3D
 {
 
-AllocatorBlock* AllocatorReserveBlock(AllocatorBlock* allocator, unsigned nodeSize, unsigned capacity)
+namespace
 {
-    URHO3D_PROFILE("AllocatorReserveBlock");
 
-    if (!capacity)
-        capacity = 1;
+/// Number of size classes with 16 byte granularity, covering sizes up to 256 bytes.
+const unsigned NUM_FINE_SIZE_CLASSES = 16;
+/// Granularity of the size classes above 256 bytes.
+const unsigned COARSE_SIZE_CLASS_STEP = 64;
+/// Total number of size classes.
+const unsigned NUM_SIZE_CLASSES = NUM_FINE_SIZE_CLASSES
+    + (MAX_SMALL_OBJECT_SIZE - NUM_FINE_SIZE_CLASSES * SMALL_OBJECT_ALIGNMENT) / COARSE_SIZE_CLASS_STEP;
+/// Size of memory chunks reserved for the pools. Chunks are never returned to the system.
+const unsigned CHUNK_SIZE = 64 * 1024;
+/// Preferred amount of memory moved between a thread cache and the shared pool at once.
+const unsigned TRANSFER_BATCH_BYTES = 8 * 1024;
 
-    auto* blockPtr = new unsigned char[sizeof(AllocatorBlock) + capacity * (sizeof(AllocatorNode) + nodeSize)];
-    auto* newBlock = reinterpret_cast<AllocatorBlock*>(blockPtr);
-    newBlock->nodeSize_ = nodeSize;
-    newBlock->capacity_ = capacity;
-    newBlock->free_ = nullptr;
-    newBlock->next_ = nullptr;
+/// Free pool node.
+struct FreeNode
+{
+    /// Next free node.
+    FreeNode* next_;
+};
 
-    if (!allocator)
-        allocator = newBlock;
-    else
+/// Return size class index for an allocation size.
+unsigned GetSizeClass(size_t size)
+{
+    if (size <= NUM_FINE_SIZE_CLASSES * SMALL_OBJECT_ALIGNMENT)
+        return size ? static_cast<unsigned>((size - 1) / SMALL_OBJECT_ALIGNMENT) : 0;
+    return NUM_FINE_SIZE_CLASSES
+        + static_cast<unsigned>((size - NUM_FINE_SIZE_CLASSES * SMALL_OBJECT_ALIGNMENT - 1) / COARSE_SIZE_CLASS_STEP);
+}
+
+/// Return node size of a size class.
+unsigned GetSizeClassNodeSize(unsigned sizeClass)
+{
+    if (sizeClass < NUM_FINE_SIZE_CLASSES)
+        return (sizeClass + 1) * SMALL_OBJECT_ALIGNMENT;
+    return NUM_FINE_SIZE_CLASSES * SMALL_OBJECT_ALIGNMENT + (sizeClass - NUM_FINE_SIZE_CLASSES + 1) * COARSE_SIZE_CLASS_STEP;
+}
+
+/// Return number of nodes moved between a thread cache and the shared pool at once.
+unsigned GetTransferBatchSize(unsigned sizeClass)
+{
+    return Clamp(TRANSFER_BATCH_BYTES / GetSizeClassNodeSize(sizeClass), 4u, 64u);
+}
+
+/// Pool of free nodes of one size class shared between all threads.
+struct SharedPool
+{
+    /// Take up to the specified number of nodes. Reserve a new chunk if there are no free nodes. Return null if out of memory.
+    FreeNode* Take(unsigned sizeClass, unsigned maxCount, unsigned& count)
     {
-        newBlock->next_ = allocator->next_;
-        allocator->next_ = newBlock;
-    }
+        MutexLock<Mutex> lock(mutex_);
+
+        if (!free_ && !ReserveChunk(sizeClass))
+        {
+            count = 0;
+            return nullptr;
+        }
 
-    // Initialize the nodes. Free nodes are always chained to the first (parent) allocator
-    unsigned char* nodePtr = blockPtr + sizeof(AllocatorBlock);
-    auto* firstNewNode = reinterpret_cast<AllocatorNode*>(nodePtr);
+        FreeNode* first = free_;
+        FreeNode* last = free_;
+        count = 1;
+        while (count < maxCount && last->next_)
+        {
+            last = last->next_;
+            ++count;
+        }
+
+        free_ = last->next_;
+        last->next_ = nullptr;
+        return first;
+    }
 
-    for (unsigned i = 0; i < capacity - 1; ++i)
+    /// Return a chain of free nodes.
+    void Put(FreeNode* first, FreeNode* last)
     {
-        auto* newNode = reinterpret_cast<AllocatorNode*>(nodePtr);
-        newNode->next_ = reinterpret_cast<AllocatorNode*>(nodePtr + sizeof(AllocatorNode) + nodeSize);
-        nodePtr += sizeof(AllocatorNode) + nodeSize;
+        MutexLock<Mutex> lock(mutex_);
+        last->next_ = free_;
+        free_ = first;
     }
-    // i == capacity - 1
+
+    /// Reserve a new chunk of memory and split it into free nodes. Return false if out of memory.
+    bool ReserveChunk(unsigned sizeClass)
     {
-        auto* newNode = reinterpret_cast<AllocatorNode*>(nodePtr);
-        newNode->next_ = nullptr;
+        const unsigned nodeSize = GetSizeClassNodeSize(sizeClass);
+
+        // Chunks are never freed, so the alignment padding does not need to be remembered
+        void* chunk = malloc(CHUNK_SIZE + SMALL_OBJECT_ALIGNMENT);
+        if (!chunk)
+            return false;
+
+        auto address = reinterpret_cast<uintptr_t>(chunk);
+        address = (address + SMALL_OBJECT_ALIGNMENT - 1) & ~static_cast<uintptr_t>(SMALL_OBJECT_ALIGNMENT - 1);
+
+        auto* data = reinterpret_cast<unsigned char*>(address);
+        const unsigned numNodes = CHUNK_SIZE / nodeSize;
+        for (unsigned i = numNodes; i > 0; --i)
+        {
+            auto* node = reinterpret_cast<FreeNode*>(data + (i - 1) * nodeSize);
+            node->next_ = free_;
+            free_ = node;
+        }
+
+        return true;
     }
 
-    allocator->free_ = firstNewNode;
+    /// Lock for the free node list.
+    Mutex mutex_;
+    /// First free node.
+    FreeNode* free_{};
+};
 
-    return newBlock;
+/// Return shared pools. These are intentionally never destroyed, as objects may be freed during static destruction.
+SharedPool* GetSharedPools()
+{
+    static auto* pools = new SharedPool[NUM_SIZE_CLASSES];
+    return pools;
 }
 
-AllocatorBlock* AllocatorInitialize(unsigned nodeSize, unsigned initialCapacity)
+/// Per-thread cache of free nodes. Reserving and freeing nodes does not require locking until the cache runs empty or grows too large.
+struct ThreadCache
 {
-    URHO3D_PROFILE("AllocatorInitialize");
+    /// Free node list of one size class.
+    struct FreeList
+    {
+        /// First free node.
+        FreeNode* head_{};
+        /// Number of free nodes.
+        unsigned count_{};
+    };
 
-    AllocatorBlock* block = AllocatorReserveBlock(nullptr, nodeSize, initialCapacity);
-    return block;
-}
+    /// Destruct. Return all cached nodes to the shared pools.
+    ~ThreadCache();
 
-void AllocatorUninitialize(AllocatorBlock* allocator)
-{
-    URHO3D_PROFILE("AllocatorUninitialize");
+    /// Reserve a node. Return null if out of memory.
+    void* Reserve(unsigned sizeClass)
+    {
+        FreeList& list = lists_[sizeClass];
+        if (!list.head_)
+        {
+            list.head_ = GetSharedPools()[sizeClass].Take(sizeClass, GetTransferBatchSize(sizeClass), list.count_);
+            if (!list.head_)
+                return nullptr;
+        }
+
+        FreeNode* node = list.head_;
+        list.head_ = node->next_;
+        --list.count_;
+        return node;
+    }
 
-    while (allocator)
+    /// Free a node. It is cached by the calling thread regardless of which thread reserved it.
+    void Free(void* ptr, unsigned sizeClass)
     {
-        AllocatorBlock* next = allocator->next_;
-        delete[] reinterpret_cast<unsigned char*>(allocator);
-        allocator = next;
+        FreeList& list = lists_[sizeClass];
+        auto* node = static_cast<FreeNode*>(ptr);
+        node->next_ = list.head_;
+        list.head_ = node;
+        ++list.count_;
+
+        // Give a batch back to the shared pool when this thread mostly frees objects reserved by other threads
+        const unsigned batchSize = GetTransferBatchSize(sizeClass);
+        if (list.count_ >= 2 * batchSize)
+            Release(sizeClass, batchSize);
     }
-}
 
-void* AllocatorReserve(AllocatorBlock* allocator)
+    /// Return nodes to the shared pool.
+    void Release(unsigned sizeClass, unsigned count)
+    {
+        FreeList& list = lists_[sizeClass];
+        if (!list.head_ || !count)
+            return;
+
+        FreeNode* first = list.head_;
+        FreeNode* last = first;
+        --list.count_;
+        while (--count && last->next_)
+        {
+            last = last->next_;
+            --list.count_;
+        }
+
+        list.head_ = last->next_;
+        GetSharedPools()[sizeClass].Put(first, last);
+    }
+
+    /// Free node lists by size class.
+    FreeList lists_[NUM_SIZE_CLASSES];
+};
+
+/// Thread cache of the current thread.
+thread_local ThreadCache threadCache;
+/// Whether the thread cache of the current thread is already destroyed on thread exit.
+thread_local bool threadCacheDestroyed = false;
+
+ThreadCache::~ThreadCache()
 {
-    if (!allocator)
-        return nullptr;
+    for (unsigned sizeClass = 0; sizeClass < NUM_SIZE_CLASSES; ++sizeClass)
+        Release(sizeClass, lists_[sizeClass].count_);
+    threadCacheDestroyed = true;
+}
 
-    URHO3D_PROFILE("AllocatorReserve");
+}
+
+void* SmallObjectReserve(size_t size)
+{
+    if (size > MAX_SMALL_OBJECT_SIZE)
+        return ::operator new(size);
 
-    if (!allocator->free_)
+    const unsigned sizeClass = GetSizeClass(size);
+    void* ptr = nullptr;
+    if (!threadCacheDestroyed)
+        ptr = threadCache.Reserve(sizeClass);
+    else
     {
-        // Free nodes have been exhausted. Allocate a new larger block
-        unsigned newCapacity = (allocator->capacity_ + 1) >> 1u;
-        AllocatorReserveBlock(allocator, allocator->nodeSize_, newCapacity);
-        allocator->capacity_ += newCapacity;
+        unsigned count = 0;
+        ptr = GetSharedPools()[sizeClass].Take(sizeClass, 1, count);
     }
 
-    // We should have new free node(s) chained
-    AllocatorNode* freeNode = allocator->free_;
-    void* ptr = (reinterpret_cast<unsigned char*>(freeNode)) + sizeof(AllocatorNode);
-    allocator->free_ = freeNode->next_;
-    freeNode->next_ = nullptr;
-
+    // Fail like the global operator new
+    if (!ptr)
+        throw std::bad_alloc();
     return ptr;
 }
 
-void AllocatorFree(AllocatorBlock* allocator, void* ptr)
+void SmallObjectFree(void* ptr, size_t size)
 {
-    if (!allocator || !ptr)
+    if (!ptr)
         return;
 
-    URHO3D_PROFILE("AllocatorFree");
-
-    auto* dataPtr = static_cast<unsigned char*>(ptr);
-    auto* node = reinterpret_cast<AllocatorNode*>(dataPtr - sizeof(AllocatorNode));
+    if (size > MAX_SMALL_OBJECT_SIZE)
+    {
+        ::operator delete(ptr);
+        return;
+    }
 
-    // Chain the node back to free nodes
-    node->next_ = allocator->free_;
-    allocator->free_ = node;
+    const unsigned sizeClass = GetSizeClass(size);
+    if (!threadCacheDestroyed)
+        threadCache.Free(ptr, sizeClass);
+    else
+    {
+        auto* node = static_cast<FreeNode*>(ptr);
+        GetSharedPools()[sizeClass].Put(node, node);
+    }
 }
 
 }
@@ -29,95 +29,63 @@
 #include <cstddef>
 #include <EASTL/utility.h>
 
-
 namespace Urho3D
 {
 
-struct AllocatorBlock;
-struct AllocatorNode;
-
-/// %Allocator memory block.
-struct AllocatorBlock
-{
-    /// Size of a node.
-    unsigned nodeSize_;
-    /// Number of nodes in this block.
-    unsigned capacity_;
-    /// First free node.
-    AllocatorNode* free_;
-    /// Next allocator block.
-    AllocatorBlock* next_;
-    /// Nodes follow.
-};
+/// Alignment of memory returned by the small object allocator.
+static const unsigned SMALL_OBJECT_ALIGNMENT = 16;
+/// Largest size served from the small object pools. Larger requests fall back to the global operator new.
+static const unsigned MAX_SMALL_OBJECT_SIZE = 1024;
 
-/// %Allocator node.
-struct AllocatorNode
-{
-    /// Next free node.
-    AllocatorNode* next_;
-    /// Data follows.
-};
+/// Reserve memory for an object of the specified size from the size class pools. Throw std::bad_alloc if out of memory, like the global operator new. Thread-safe.
+URHO3D_API void* SmallObjectReserve(size_t size);
+/// Free memory reserved by SmallObjectReserve(). The size must match the reserved size. Thread-safe, may be called from any thread.
+URHO3D_API void SmallObjectFree(void* ptr, size_t size);
 
-/// Initialize a fixed-size allocator with the node size and initial capacity.
-URHO3D_API AllocatorBlock* AllocatorInitialize(unsigned nodeSize, unsigned initialCapacity = 1);
-/// Uninitialize a fixed-size allocator. Frees all blocks in the chain.
-URHO3D_API void AllocatorUninitialize(AllocatorBlock* allocator);
-/// Reserve a node. Creates a new block if necessary.
-URHO3D_API void* AllocatorReserve(AllocatorBlock* allocator);
-/// Free a node. Does not free any blocks.
-URHO3D_API void AllocatorFree(AllocatorBlock* allocator, void* ptr);
-
-/// %Allocator template class. Allocates objects of a specific class.
+/// %Allocator template class. Allocates objects of a specific class from the small object pools.
 template <class T> class Allocator : private NonCopyable
 {
-public:
-    /// Construct.
-    explicit Allocator(unsigned initialCapacity = 0) :
-        allocator_(nullptr)
-    {
-        if (initialCapacity)
-            allocator_ = AllocatorInitialize((unsigned)sizeof(T), initialCapacity);
-    }
+    static_assert(alignof(T) <= SMALL_OBJECT_ALIGNMENT, "Type alignment is not supported by the small object allocator");
 
-    /// Destruct.
-    ~Allocator()
-    {
-        AllocatorUninitialize(allocator_);
-    }
-
-    /// Reserve and default-construct an object.
+public:
+    /// Reserve and construct an object.
     template<typename... Args>
     T* Reserve(Args&&... args)
     {
-        if (!allocator_)
-            allocator_ = AllocatorInitialize((unsigned)sizeof(T));
-        auto* newObject = static_cast<T*>(AllocatorReserve(allocator_));
+        auto* newObject = static_cast<T*>(SmallObjectReserve(sizeof(T)));
         new(newObject) T(ea::forward<Args>(args)...);
 
         return newObject;
     }
 
-    /// Reserve and copy-construct an object.
-    T* Reserve(const T& object)
-    {
-        if (!allocator_)
-            allocator_ = AllocatorInitialize((unsigned)sizeof(T));
-        auto* newObject = static_cast<T*>(AllocatorReserve(allocator_));
-        new(newObject) T(object);
-
-        return newObject;
-    }
-
     /// Destruct and free an object.
     void Free(T* object)
     {
         (object)->~T();
-        AllocatorFree(allocator_, object);
+        SmallObjectFree(object, sizeof(T));
     }
-
-private:
-    /// Allocator block.
-    AllocatorBlock* allocator_;
 };
 
 }
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+// Overloads for the new operator redefined in DebugNew.h. Memory of an object whose constructor throws is not returned to the pools
+#   define URHO3D_SMALL_OBJECT_DEBUG_NEW \
+        static void* operator new(size_t size, int, const char*, int) { return Urho3D::SmallObjectReserve(size); } \
+        static void operator delete(void*, int, const char*, int) noexcept { }
+#else
+#   define URHO3D_SMALL_OBJECT_DEBUG_NEW
+#endif
+
+#if URHO3D_SMALL_OBJECT_ALLOCATOR
+/// Make the class and its subclasses allocate instances from the small object pools.
+#   define URHO3D_SMALL_OBJECT_ALLOCATED() \
+    public: \
+        static void* operator new(size_t size) { return Urho3D::SmallObjectReserve(size); } \
+        static void* operator new(size_t, void* ptr) noexcept { return ptr; } \
+        static void operator delete(void* ptr, size_t size) noexcept { Urho3D::SmallObjectFree(ptr, size); } \
+        static void operator delete(void*, void*) noexcept { } \
+        URHO3D_SMALL_OBJECT_DEBUG_NEW
+#else
+#   define URHO3D_SMALL_OBJECT_ALLOCATED()
+#endif
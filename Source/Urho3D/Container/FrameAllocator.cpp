@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Container/FrameAllocator.h"
+#include "../Math/MathDefs.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+FrameAllocator::FrameAllocator(unsigned initialCapacity)
+{
+    AllocateBlock(initialCapacity);
+}
+
+FrameAllocator::~FrameAllocator() = default;
+
+void* FrameAllocator::Allocate(unsigned size, unsigned alignment)
+{
+    for (;;)
+    {
+        Block& block = blocks_[currentBlock_];
+        const auto address = reinterpret_cast<uintptr_t>(block.data_.get()) + currentOffset_;
+        const unsigned padding = static_cast<unsigned>((alignment - address % alignment) % alignment);
+        if (currentOffset_ + padding + size <= block.size_)
+        {
+            currentOffset_ += padding + size;
+            usedSize_ += padding + size;
+            return reinterpret_cast<void*>(address + padding);
+        }
+
+        // Move to the next block, allocate one if there is none large enough
+        if (currentBlock_ + 1 >= blocks_.size() || blocks_[currentBlock_ + 1].size_ < size + alignment)
+            AllocateBlock(Max(size + alignment, block.size_ * 2));
+        ++currentBlock_;
+        currentOffset_ = 0;
+    }
+}
+
+void FrameAllocator::Reset()
+{
+    peakSize_ = usedSize_;
+    usedSize_ = 0;
+    currentBlock_ = 0;
+    currentOffset_ = 0;
+
+    // Merge blocks so that the next frame of the same size fits into one
+    if (blocks_.size() > 1)
+    {
+        const unsigned capacity = GetCapacity();
+        blocks_.clear();
+        AllocateBlock(capacity);
+    }
+}
+
+unsigned FrameAllocator::GetCapacity() const
+{
+    unsigned capacity = 0;
+    for (const Block& block : blocks_)
+        capacity += block.size_;
+    return capacity;
+}
+
+void FrameAllocator::AllocateBlock(unsigned size)
+{
+    Block block;
+    block.size_ = Max(size, 1u);
+    block.data_ = ea::unique_ptr<unsigned char[]>(new unsigned char[block.size_]);
+
+    // Keep the blocks after the current one in order, they are used in sequence
+    const unsigned index = blocks_.empty() ? 0 : currentBlock_ + 1;
+    blocks_.insert(blocks_.begin() + index, ea::move(block));
+}
+
+}
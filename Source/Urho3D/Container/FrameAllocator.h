@@ -0,0 +1,150 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Core/NonCopyable.h"
+
+#include <Urho3D/Urho3D.h>
+
+#include <EASTL/allocator.h>
+#include <EASTL/unique_ptr.h>
+#include <EASTL/vector.h>
+
+#include <cstddef>
+
+namespace Urho3D
+{
+
+/// Linear allocator for data that lives no longer than a frame. Allocation bumps a pointer, individual frees are no-op
+/// and all memory is released at once by Reset(). Not thread-safe, use one allocator per thread.
+class URHO3D_API FrameAllocator : private NonCopyable
+{
+public:
+    /// Construct with initial capacity in bytes.
+    explicit FrameAllocator(unsigned initialCapacity = 64 * 1024);
+    /// Destruct.
+    ~FrameAllocator();
+
+    /// Allocate memory block. Never returns null.
+    void* Allocate(unsigned size, unsigned alignment = alignof(std::max_align_t));
+    /// Release all allocations. If the frame needed more than one memory block, they are merged into one block large enough for the whole frame.
+    void Reset();
+
+    /// Return number of bytes allocated since the last reset.
+    unsigned GetUsedSize() const { return usedSize_; }
+    /// Return number of bytes allocated during the last frame, i.e. between the last two resets.
+    unsigned GetPeakSize() const { return peakSize_; }
+    /// Return total size of memory blocks.
+    unsigned GetCapacity() const;
+
+private:
+    /// Memory block.
+    struct Block
+    {
+        /// Data.
+        ea::unique_ptr<unsigned char[]> data_;
+        /// Size of data.
+        unsigned size_{};
+    };
+
+    /// Allocate new block of at least given size.
+    void AllocateBlock(unsigned size);
+
+    /// Memory blocks.
+    ea::vector<Block> blocks_;
+    /// Index of the block used for allocation.
+    unsigned currentBlock_{};
+    /// Offset of free memory in current block.
+    unsigned currentOffset_{};
+    /// Number of bytes allocated since the last reset.
+    unsigned usedSize_{};
+    /// Number of bytes allocated during the last frame.
+    unsigned peakSize_{};
+};
+
+/// EASTL allocator that takes memory from a FrameAllocator. Falls back to the default EASTL allocator if no frame allocator is set.
+/// Containers using it must be cleared before the frame allocator is reset.
+class URHO3D_API FrameAllocatorAdapter
+{
+public:
+    /// Construct with EASTL container name, which is ignored. Uses default allocator.
+    explicit FrameAllocatorAdapter(const char* = nullptr) {}
+    /// Construct with frame allocator.
+    explicit FrameAllocatorAdapter(FrameAllocator* allocator) : allocator_(allocator) {}
+    /// Construct from another adapter.
+    FrameAllocatorAdapter(const FrameAllocatorAdapter& other) = default;
+    /// Construct from another adapter with EASTL container name, which is ignored.
+    FrameAllocatorAdapter(const FrameAllocatorAdapter& other, const char*) : allocator_(other.allocator_) {}
+    /// Assign.
+    FrameAllocatorAdapter& operator =(const FrameAllocatorAdapter& other) = default;
+
+    /// Allocate memory.
+    void* allocate(size_t n, int flags = 0)
+    {
+        if (allocator_)
+            return allocator_->Allocate(static_cast<unsigned>(n));
+        return ea::GetDefaultAllocator()->allocate(n, flags);
+    }
+
+    /// Allocate aligned memory.
+    void* allocate(size_t n, size_t alignment, size_t offset, int flags = 0)
+    {
+        if (allocator_ && offset == 0)
+            return allocator_->Allocate(static_cast<unsigned>(n), static_cast<unsigned>(alignment));
+        return ea::GetDefaultAllocator()->allocate(n, alignment, offset, flags);
+    }
+
+    /// Free memory. Memory of frame allocator is released only on reset.
+    void deallocate(void* p, size_t n)
+    {
+        if (!allocator_)
+            ea::GetDefaultAllocator()->deallocate(p, n);
+    }
+
+    /// Return EASTL container name.
+    const char* get_name() const { return "FrameAllocatorAdapter"; }
+    /// Set EASTL container name. Ignored.
+    void set_name(const char*) {}
+
+    /// Return frame allocator.
+    FrameAllocator* GetFrameAllocator() const { return allocator_; }
+
+private:
+    /// Frame allocator.
+    FrameAllocator* allocator_{};
+};
+
+/// Compare adapters. Adapters are equal if they allocate from the same source.
+inline bool operator ==(const FrameAllocatorAdapter& lhs, const FrameAllocatorAdapter& rhs)
+{
+    return lhs.GetFrameAllocator() == rhs.GetFrameAllocator();
+}
+
+/// Compare adapters. Adapters are equal if they allocate from the same source.
+inline bool operator !=(const FrameAllocatorAdapter& lhs, const FrameAllocatorAdapter& rhs)
+{
+    return lhs.GetFrameAllocator() != rhs.GetFrameAllocator();
+}
+
+}
@@ -26,6 +26,7 @@
 
 #include <EASTL/internal/thread_support.h>
 
+#include "../Container/Allocator.h"
 #include "../Container/RefCounted.h"
 #include "../Core/Macros.h"
 #if URHO3D_CSHARP
@@ -37,7 +38,11 @@ namespace Urho3D
 
 RefCount* RefCount::Allocate()
 {
+#if URHO3D_SMALL_OBJECT_ALLOCATOR
+    void* const memory = SmallObjectReserve(sizeof(RefCount));
+#else
     void* const memory = EASTLAlloc(*ea::get_default_allocator((Allocator*)nullptr), sizeof(RefCount));
+#endif
     assert(memory != nullptr);
     return ::new(memory) RefCount();
 }
@@ -45,7 +50,11 @@ RefCount* RefCount::Allocate()
 void RefCount::Free(RefCount* instance)
 {
     instance->~RefCount();
+#if URHO3D_SMALL_OBJECT_ALLOCATOR
+    SmallObjectFree(instance, sizeof(RefCount));
+#else
     EASTLFree(*ea::get_default_allocator((Allocator*)nullptr), instance, sizeof(RefCount));
+#endif
 }
 
 RefCounted::RefCounted()
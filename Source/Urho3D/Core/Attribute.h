@@ -56,7 +56,10 @@ enum AttributeMode
 };
 URHO3D_FLAGSET(AttributeMode, AttributeModeFlags);
 
+class Archive;
+class Deserializer;
 class Serializable;
+class Serializer;
 
 /// Abstract base class for invoking attribute accessors.
 class URHO3D_API AttributeAccessor : public RefCounted
@@ -68,6 +71,16 @@ public:
     virtual void Get(const Serializable* ptr, Variant& dest) const = 0;
     /// Set the attribute.
     virtual void Set(Serializable* ptr, const Variant& src) = 0;
+#ifndef SWIG
+    /// Return whether the attribute can be written and read directly as its own type, without a Variant.
+    virtual bool IsDirect() const { return false; }
+    /// Write the attribute directly to a stream in the same format as Serializer::WriteVariantData. Only supported if IsDirect() is true.
+    virtual bool Write(const Serializable* ptr, Serializer& dest) const { return false; }
+    /// Read the attribute directly from a stream. Only supported if IsDirect() is true.
+    virtual bool Read(Serializable* ptr, Deserializer& source) { return false; }
+    /// Serialize the attribute directly to or from an archive in the same format as SerializeVariantValue. Only supported if IsDirect() is true.
+    virtual bool Serialize(Serializable* ptr, Archive& archive, const char* name) { return false; }
+#endif
 };
 
 /// Description of an automatically serializable variable.
@@ -30,9 +30,22 @@
 #include "../Core/WorkQueue.h"
 #include "../IO/Log.h"
 
+#include <EASTL/deque.h>
+
+#include <thread>
+
 namespace Urho3D
 {
 
+/// Index of the worker thread running on this thread, or M_MAX_UNSIGNED if not a worker thread.
+static thread_local unsigned currentWorkerIndex = M_MAX_UNSIGNED;
+
+/// Return index of the calling thread: 0 for the main thread, worker index for worker threads and M_MAX_UNSIGNED for other threads.
+static unsigned GetCurrentThreadIndex()
+{
+    return Thread::IsMainThread() ? 0 : currentWorkerIndex;
+}
+
 /// Worker thread managed by the work queue.
 class WorkerThread : public Thread, public RefCounted
 {
@@ -50,6 +63,7 @@ public:
         URHO3D_PROFILE_THREAD(Format("WorkerThread {}", (uint64_t)GetCurrentThreadID()).c_str());
         // Init FPU state first
         InitFPU();
+        currentWorkerIndex = index_;
         owner_->ProcessItems(index_);
     }
 
@@ -63,8 +77,72 @@ private:
     unsigned index_;
 };
 
+/// Prioritized work item queue owned by one thread. Other threads lock it only when stealing work.
+struct WorkerQueue
+{
+    /// Construct.
+    explicit WorkerQueue(unsigned index) :
+        depthPlotName_(Format("WorkQueue depth {}", index)),
+        stealPlotName_(Format("WorkQueue steals {}", index))
+    {
+    }
+
+    /// Items sorted by priority, highest first.
+    ea::deque<WorkItem*> items_;
+    /// Mutex for the items.
+    Mutex mutex_;
+    /// Number of items in the queue, readable without locking.
+    std::atomic<unsigned> depth_{};
+    /// Number of items the owner thread has stolen from other queues since the frame start.
+    std::atomic<unsigned> numStolen_{};
+    /// Number of items the owner thread has stolen during the last frame.
+    unsigned lastFrameStolen_{};
+    /// Microseconds the owner thread has spent executing items since the frame start.
+    std::atomic<long long> busyTime_{};
+    /// Microseconds the owner thread spent executing items during the last frame.
+    long long lastFrameBusyTime_{};
+    /// Profiler plot name for the queue depth.
+    ea::string depthPlotName_;
+    /// Profiler plot name for the steal count.
+    ea::string stealPlotName_;
+};
+
+/// Number of ranges per thread that parallel loops aim for. More ranges balance load better at the cost of more synchronization.
+static const unsigned PARALLEL_RANGES_PER_THREAD = 4;
+/// Maximum number of ranges of a parallel loop started outside the work queue threads. Each range is a separate work item.
+static const unsigned MAX_BACKGROUND_PARALLEL_RANGES = 4096;
+
+/// State of the parallel loop shared between participating threads.
+struct ParallelForState
+{
+    /// Claim and process ranges until all elements are claimed, or at most the specified number of ranges.
+    void Run(unsigned threadIndex, unsigned maxRanges = M_MAX_UNSIGNED)
+    {
+        for (unsigned i = 0; i < maxRanges; ++i)
+        {
+            const unsigned fromIndex = nextIndex_.fetch_add(grainSize_, std::memory_order_relaxed);
+            if (fromIndex >= count_)
+                break;
+            function_(callback_, fromIndex, Min(fromIndex + grainSize_, count_), threadIndex);
+        }
+    }
+
+    /// Number of elements.
+    unsigned count_{};
+    /// Number of elements per range.
+    unsigned grainSize_{};
+    /// First element of the next unclaimed range.
+    std::atomic<unsigned> nextIndex_{};
+    /// User callback.
+    const void* callback_{};
+    /// Range function.
+    void (*function_)(const void* callback, unsigned fromIndex, unsigned toIndex, unsigned threadIndex){};
+};
+
 WorkQueue::WorkQueue(Context* context) :
     Object(context),
+    numQueuedItems_(0),
+    nextQueue_(0),
     shutDown_(false),
     pausing_(false),
     paused_(false),
@@ -73,6 +151,9 @@ WorkQueue::WorkQueue(Context* context) :
     lastSize_(0),
     maxNonThreadedWorkMs_(5)
 {
+    // Queue of the main thread
+    queues_.push_back(ea::make_unique<WorkerQueue>(0));
+
     SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(WorkQueue, HandleBeginFrame));
 }
 
@@ -97,6 +178,10 @@ void WorkQueue::CreateThreads(unsigned numThreads)
     // Start threads in paused mode
     Pause();
 
+    // Create all queues before any thread starts stealing from them
+    for (unsigned i = 0; i < numThreads; ++i)
+        queues_.push_back(ea::make_unique<WorkerQueue>(i + 1));
+
     for (unsigned i = 0; i < numThreads; ++i)
     {
         SharedPtr<WorkerThread> thread(new WorkerThread(this, i + 1));
@@ -127,6 +212,16 @@ SharedPtr<WorkItem> WorkQueue::GetFreeItem()
 }
 
 void WorkQueue::AddWorkItem(const SharedPtr<WorkItem>& item)
+{
+    AddWorkItem(item, {});
+}
+
+SharedPtr<WorkItem> WorkQueue::AddWorkItem(std::function<void()> workFunction, unsigned priority)
+{
+    return AddWorkItem(std::move(workFunction), {}, priority);
+}
+
+void WorkQueue::AddWorkItem(const SharedPtr<WorkItem>& item, const ea::vector<SharedPtr<WorkItem> >& dependencies)
 {
     if (!item)
     {
@@ -141,46 +236,46 @@ void WorkQueue::AddWorkItem(const SharedPtr<WorkItem>& item)
     // Clear completed flag in case item is reused
     workItems_.push_back(item);
     item->completed_ = false;
+    item->continuationsTaken_ = false;
 
-    // Make sure worker threads' list is safe to modify
-    if (threads_.size() && !paused_)
-        queueMutex_.Acquire();
-
-    // Find position for new item
-    if (queue_.empty())
-        queue_.push_back(item.Get());
-    else
+    // Hold one extra dependency while registering, so the item is not queued by a dependency completing in the meantime
+    item->numPendingDependencies_ = 1;
+    for (const SharedPtr<WorkItem>& dependency : dependencies)
     {
-        bool inserted = false;
+        if (!dependency)
+            continue;
+
+        // Purged items are reset and would never complete again
+        assert(ea::find(workItems_.begin(), workItems_.end(), dependency) != workItems_.end());
 
-        for (auto i = queue_.begin(); i != queue_.end(); ++i)
+        MutexLock lock(dependency->continuationMutex_);
+        if (!dependency->continuationsTaken_)
         {
-            if ((*i)->priority_ <= item->priority_)
-            {
-                queue_.insert(i, item.Get());
-                inserted = true;
-                break;
-            }
+            dependency->continuations_.push_back(item.Get());
+            ++item->numPendingDependencies_;
         }
-
-        if (!inserted)
-            queue_.push_back(item.Get());
     }
 
-    if (threads_.size())
+    if (--item->numPendingDependencies_ == 0)
     {
-        queueMutex_.Release();
-        paused_ = false;
+        // Distribute items between worker queues, idle workers will steal the rest
+        if (threads_.size())
+            nextQueue_ = nextQueue_ % threads_.size() + 1;
+        PushToQueue(item.Get(), nextQueue_);
     }
+
+    if (threads_.size())
+        Resume();
 }
 
-SharedPtr<WorkItem> WorkQueue::AddWorkItem(std::function<void()> workFunction, unsigned priority)
+SharedPtr<WorkItem> WorkQueue::AddWorkItem(std::function<void()> workFunction,
+    const ea::vector<SharedPtr<WorkItem> >& dependencies, unsigned priority)
 {
     SharedPtr<WorkItem> item = GetFreeItem();
     item->workLambda_ = std::move(workFunction);
     item->workFunction_ = [](const WorkItem* item, unsigned) { item->workLambda_(); };
     item->priority_ = priority;
-    AddWorkItem(item);
+    AddWorkItem(item, dependencies);
     return item;
 }
 
@@ -189,16 +284,12 @@ bool WorkQueue::RemoveWorkItem(SharedPtr<WorkItem> item)
     if (!item)
         return false;
 
-    MutexLock lock(queueMutex_);
-
     // Can only remove successfully if the item was not yet taken by threads for execution
-    auto i = ea::find(queue_.begin(), queue_.end(), item.Get());
-    if (i != queue_.end())
+    if (RemoveFromQueues(item.Get()))
     {
         auto j = ea::find(workItems_.begin(), workItems_.end(), item);
         if (j != workItems_.end())
         {
-            queue_.erase(i);
             ReturnToPool(item);
             workItems_.erase(j);
             return true;
@@ -210,18 +301,15 @@ bool WorkQueue::RemoveWorkItem(SharedPtr<WorkItem> item)
 
 unsigned WorkQueue::RemoveWorkItems(const ea::vector<SharedPtr<WorkItem> >& items)
 {
-    MutexLock lock(queueMutex_);
     unsigned removed = 0;
 
     for (auto i = items.begin(); i != items.end(); ++i)
     {
-        auto j = ea::find(queue_.begin(), queue_.end(), i->Get());
-        if (j != queue_.end())
+        if (*i && RemoveFromQueues(i->Get()))
         {
             auto k = ea::find(workItems_.begin(), workItems_.end(), *i);
             if (k != workItems_.end())
             {
-                queue_.erase(j);
                 ReturnToPool(*k);
                 workItems_.erase(k);
                 ++removed;
@@ -238,7 +326,7 @@ void WorkQueue::Pause()
     {
         pausing_ = true;
 
-        queueMutex_.Acquire();
+        pauseMutex_.Acquire();
         paused_ = true;
 
         pausing_ = false;
@@ -249,7 +337,7 @@ void WorkQueue::Resume()
 {
     if (paused_)
     {
-        queueMutex_.Release();
+        pauseMutex_.Release();
         paused_ = false;
     }
 }
@@ -263,44 +351,24 @@ void WorkQueue::Complete(unsigned priority)
     {
         Resume();
 
-        // Take work items also in the main thread until queue empty or no high-priority items anymore
-        while (!queue_.empty())
+        // Take work items also in the main thread until no high-priority items remain and threaded work is complete
+        for (;;)
         {
-            queueMutex_.Acquire();
-            if (!queue_.empty() && queue_.front()->priority_ >= priority)
-            {
-                WorkItem* item = queue_.front();
-                queue_.pop_front();
-                queueMutex_.Release();
-                item->workFunction_(item, 0);
-                item->completed_ = true;
-            }
-            else
-            {
-                queueMutex_.Release();
+            if (WorkItem* item = PopFromQueues(0, priority))
+                ExecuteItem(item, 0);
+            else if (IsCompleted(priority))
                 break;
-            }
-        }
-
-        // Wait for threaded work to complete
-        while (!IsCompleted(priority))
-        {
         }
 
         // If no work at all remaining, pause worker threads by leaving the mutex locked
-        if (queue_.empty())
+        if (AreQueuesEmpty())
             Pause();
     }
     else
     {
         // No worker threads: ensure all high-priority items are completed in the main thread
-        while (!queue_.empty() && queue_.front()->priority_ >= priority)
-        {
-            WorkItem* item = queue_.front();
-            queue_.pop_front();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
-        }
+        while (WorkItem* item = PopFromQueues(0, priority))
+            ExecuteItem(item, 0);
     }
 
     PurgeCompleted(priority);
@@ -330,6 +398,115 @@ bool WorkQueue::IsCompleted(unsigned priority) const
     return true;
 }
 
+unsigned WorkQueue::GetParallelGrainSize(unsigned count, unsigned minGrainSize) const
+{
+    // Without worker threads the whole loop is processed as one range
+    if (threads_.empty())
+        return Max(count, 1u);
+
+    // Loops from other threads are split finer, as each range is queued separately
+    if (GetCurrentThreadIndex() == M_MAX_UNSIGNED)
+        return Max(Max(minGrainSize, 1u), (count + MAX_BACKGROUND_PARALLEL_RANGES - 1) / MAX_BACKGROUND_PARALLEL_RANGES);
+
+    const unsigned numRanges = (threads_.size() + 1) * PARALLEL_RANGES_PER_THREAD;
+    return Max(Max(minGrainSize, 1u), count / numRanges);
+}
+
+void WorkQueue::ParallelForInternal(unsigned count, unsigned minGrainSize, const void* callback, ParallelForFunction function)
+{
+    if (count == 0)
+        return;
+
+    const unsigned grainSize = GetParallelGrainSize(count, minGrainSize);
+    const unsigned numRanges = (count + grainSize - 1) / grainSize;
+
+    const unsigned threadIndex = GetCurrentThreadIndex();
+
+    // Nothing to share, process the loop in place
+    if (numRanges <= 1)
+    {
+        function(callback, 0, count, threadIndex);
+        return;
+    }
+
+    ParallelForState state;
+    state.count_ = count;
+    state.grainSize_ = grainSize;
+    state.callback_ = callback;
+    state.function_ = function;
+
+    // The item pool and pausing may be accessed only from the main thread. Loops from the main thread and the worker
+    // threads are frame work: their helpers get the highest priority and claim ranges until the loop is exhausted.
+    // Loops from other threads, such as a light baking thread, get one lowest priority helper per range instead, so
+    // that the workers interleave them with frame work and the main thread never executes them
+    const bool isMainThread = threadIndex == 0;
+    const bool isBackground = threadIndex == M_MAX_UNSIGNED;
+    const unsigned numHelpers = isBackground ? numRanges - 1 : Min(static_cast<unsigned>(threads_.size()), numRanges - 1);
+    ea::vector<SharedPtr<WorkItem> > helpers(numHelpers);
+    for (unsigned i = 0; i < numHelpers; ++i)
+    {
+        SharedPtr<WorkItem> item = isMainThread ? GetFreeItem() : MakeShared<WorkItem>();
+        if (isBackground)
+        {
+            item->workFunction_ = [](const WorkItem* item, unsigned threadIndex)
+            {
+                static_cast<ParallelForState*>(item->aux_)->Run(threadIndex, 1);
+            };
+        }
+        else
+        {
+            item->workFunction_ = [](const WorkItem* item, unsigned threadIndex)
+            {
+                static_cast<ParallelForState*>(item->aux_)->Run(threadIndex);
+            };
+        }
+        item->aux_ = &state;
+        item->priority_ = isBackground ? 0 : M_MAX_UNSIGNED;
+        item->completed_ = false;
+        item->continuationsTaken_ = false;
+        PushToQueue(item.Get(), i % threads_.size() + 1);
+        helpers[i] = item;
+    }
+
+    if (isMainThread)
+        Resume();
+
+    state.Run(threadIndex);
+
+    // Helpers must not outlive the loop state: cancel the ones that have not started and wait for the rest. The started
+    // ones only finish their current range, so yield instead of executing other items: those could reenter per-thread
+    // data of the same thread index that the caller is still using
+    for (SharedPtr<WorkItem>& item : helpers)
+    {
+        if (!item->completed_.load(std::memory_order_acquire) && !RemoveFromQueues(item.Get()))
+        {
+            while (!item->completed_.load(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+
+        if (isMainThread)
+            ReturnToPool(item);
+    }
+
+    if (isMainThread && !completing_ && AreQueuesEmpty())
+        Pause();
+}
+
+unsigned WorkQueue::GetQueueDepth(unsigned threadIndex) const
+{
+    return threadIndex < queues_.size() ? queues_[threadIndex]->depth_.load() : 0;
+}
+
+unsigned WorkQueue::GetNumStolenItems(unsigned threadIndex) const
+{
+    return threadIndex < queues_.size() ? queues_[threadIndex]->lastFrameStolen_ : 0;
+}
+
+long long WorkQueue::GetBusyTime(unsigned threadIndex) const
+{
+    return threadIndex < queues_.size() ? queues_[threadIndex]->lastFrameBusyTime_ : 0;
+}
+
 void WorkQueue::ProcessItems(unsigned threadIndex)
 {
     bool wasActive = false;
@@ -343,28 +520,112 @@ void WorkQueue::ProcessItems(unsigned threadIndex)
             Time::Sleep(0);
         else
         {
-            queueMutex_.Acquire();
-            if (!queue_.empty())
+            if (WorkItem* item = PopFromQueues(threadIndex, 0))
             {
                 wasActive = true;
-
-                WorkItem* item = queue_.front();
-                queue_.pop_front();
-                queueMutex_.Release();
-                item->workFunction_(item, threadIndex);
-                item->completed_ = true;
+                ExecuteItem(item, threadIndex);
             }
             else
             {
                 wasActive = false;
 
-                queueMutex_.Release();
+                // Block here while the main thread holds the pause mutex
+                pauseMutex_.Acquire();
+                pauseMutex_.Release();
                 Time::Sleep(0);
             }
         }
     }
 }
 
+void WorkQueue::PushToQueue(WorkItem* item, unsigned threadIndex)
+{
+    WorkerQueue& queue = *queues_[threadIndex];
+    MutexLock lock(queue.mutex_);
+
+    // Find position for new item
+    auto i = ea::find_if(queue.items_.begin(), queue.items_.end(),
+        [item](const WorkItem* other) { return other->priority_ <= item->priority_; });
+    queue.items_.insert(i, item);
+
+    ++queue.depth_;
+    ++numQueuedItems_;
+}
+
+WorkItem* WorkQueue::PopFromQueues(unsigned threadIndex, unsigned priority)
+{
+    const unsigned numQueues = queues_.size();
+    for (unsigned i = 0; i < numQueues; ++i)
+    {
+        // Start from own queue, then try to steal from the following ones
+        WorkerQueue& queue = *queues_[(threadIndex + i) % numQueues];
+        if (queue.depth_ == 0)
+            continue;
+
+        MutexLock lock(queue.mutex_);
+        if (!queue.items_.empty() && queue.items_.front()->priority_ >= priority)
+        {
+            WorkItem* item = queue.items_.front();
+            queue.items_.pop_front();
+
+            --queue.depth_;
+            --numQueuedItems_;
+            if (i != 0)
+                ++queues_[threadIndex]->numStolen_;
+            return item;
+        }
+    }
+
+    return nullptr;
+}
+
+void WorkQueue::ExecuteItem(WorkItem* item, unsigned threadIndex)
+{
+    HiresTimer timer;
+    item->workFunction_(item, threadIndex);
+    queues_[threadIndex]->busyTime_ += timer.GetUSec(false);
+
+    ea::vector<WorkItem*> continuations;
+    {
+        MutexLock lock(item->continuationMutex_);
+        item->continuationsTaken_ = true;
+        continuations.swap(item->continuations_);
+    }
+
+    // Last access to the item: a waiting thread may return it to the pool or destroy it as soon as it is completed
+    item->completed_.store(true, std::memory_order_release);
+
+    // Run continuations on the same thread while the data is hot, other threads may steal them
+    for (WorkItem* continuation : continuations)
+    {
+        if (--continuation->numPendingDependencies_ == 0)
+            PushToQueue(continuation, threadIndex);
+    }
+}
+
+bool WorkQueue::RemoveFromQueues(WorkItem* item)
+{
+    for (auto& queue : queues_)
+    {
+        MutexLock lock(queue->mutex_);
+        auto i = ea::find(queue->items_.begin(), queue->items_.end(), item);
+        if (i != queue->items_.end())
+        {
+            // Dependent items would never be started
+            MutexLock continuationLock(item->continuationMutex_);
+            if (!item->continuations_.empty())
+                return false;
+
+            queue->items_.erase(i);
+            --queue->depth_;
+            --numQueuedItems_;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void WorkQueue::PurgeCompleted(unsigned priority)
 {
     // Purge completed work items and send completion events. Do not signal items lower than priority threshold,
@@ -419,6 +680,9 @@ void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
         item->priority_ = M_MAX_UNSIGNED;
         item->sendEvent_ = false;
         item->completed_ = false;
+        item->continuationsTaken_ = false;
+        item->numPendingDependencies_ = 0;
+        item->continuations_.clear();
 
         poolItems_.push_back(item);
     }
@@ -426,22 +690,34 @@ void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
 
 void WorkQueue::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
 {
+    // Wake the worker threads for items queued by other threads while they were paused, such as parallel loop ranges
+    if (!threads_.empty() && !AreQueuesEmpty())
+        Resume();
+
     // If no worker threads, complete low-priority work here
-    if (threads_.empty() && !queue_.empty())
+    if (threads_.empty() && !AreQueuesEmpty())
     {
         URHO3D_PROFILE("CompleteWorkNonthreaded");
 
         HiresTimer timer;
 
-        while (!queue_.empty() && timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000LL)
+        while (timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000LL)
         {
-            WorkItem* item = queue_.front();
-            queue_.pop_front();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
+            WorkItem* item = PopFromQueues(0, 0);
+            if (!item)
+                break;
+            ExecuteItem(item, 0);
         }
     }
 
+    for (auto& queue : queues_)
+    {
+        queue->lastFrameStolen_ = queue->numStolen_.exchange(0);
+        queue->lastFrameBusyTime_ = queue->busyTime_.exchange(0);
+        URHO3D_PROFILE_VALUE(queue->depthPlotName_.c_str(), static_cast<int64_t>(queue->depth_.load()));
+        URHO3D_PROFILE_VALUE(queue->stealPlotName_.c_str(), static_cast<int64_t>(queue->lastFrameStolen_));
+    }
+
     // Complete and signal items down to the lowest priority
     PurgeCompleted(0);
     PurgePool();
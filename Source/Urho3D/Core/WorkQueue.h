@@ -23,13 +23,13 @@
 #pragma once
 
 #include <EASTL/list.h>
+#include <EASTL/unique_ptr.h>
 #include <atomic>
+#include <type_traits>
 
 #include "../Core/Mutex.h"
 #include "../Core/Object.h"
 
-#include <atomic>
-
 namespace Urho3D
 {
 
@@ -40,10 +40,13 @@ URHO3D_EVENT(E_WORKITEMCOMPLETED, WorkItemCompleted)
 }
 
 class WorkerThread;
+struct WorkerQueue;
 
 /// Work queue item.
 struct WorkItem : public RefCounted
 {
+    URHO3D_SMALL_OBJECT_ALLOCATED();
+
     friend class WorkQueue;
 
 public:
@@ -66,6 +69,14 @@ private:
     bool pooled_{};
     /// Work function. Called without any parameters.
     std::function<void()> workLambda_;
+    /// Number of dependencies that are not completed yet. Item is queued for execution when it reaches zero.
+    std::atomic<unsigned> numPendingDependencies_{};
+    /// Items which depend on this item. Queued by the thread that completes this item.
+    ea::vector<WorkItem*> continuations_;
+    /// Whether the completing thread has taken the continuations. Later dependent items must not wait for this item.
+    bool continuationsTaken_{};
+    /// Mutex for the continuations of this item.
+    Mutex continuationMutex_;
 };
 
 /// Work queue subsystem for multithreading.
@@ -89,7 +100,11 @@ public:
     void AddWorkItem(const SharedPtr<WorkItem>& item);
     /// Add a work item and resume worker threads.
     SharedPtr<WorkItem> AddWorkItem(std::function<void()> workFunction, unsigned priority = 0);
-    /// Remove a work item before it has started executing. Return true if successfully removed.
+    /// Add a work item which is executed only after all dependencies are completed. Dependencies must be added to the queue and not purged yet.
+    void AddWorkItem(const SharedPtr<WorkItem>& item, const ea::vector<SharedPtr<WorkItem> >& dependencies);
+    /// Add a work item which is executed only after all dependencies are completed. Dependencies must be added to the queue and not purged yet.
+    SharedPtr<WorkItem> AddWorkItem(std::function<void()> workFunction, const ea::vector<SharedPtr<WorkItem> >& dependencies, unsigned priority = 0);
+    /// Remove a work item before it has started executing. Items with dependent items can not be removed. Return true if successfully removed.
     bool RemoveWorkItem(SharedPtr<WorkItem> item);
     /// Remove a number of work items before they have started executing. Return the number of items successfully removed.
     unsigned RemoveWorkItems(const ea::vector<SharedPtr<WorkItem> >& items);
@@ -100,6 +115,43 @@ public:
     /// Finish all queued work which has at least the specified priority. Main thread will also execute priority work. Pause worker threads if no more work remains.
     void Complete(unsigned priority);
 
+    /// Call callback(fromIndex, toIndex, threadIndex) or callback(fromIndex, toIndex) for consecutive ranges covering [0, count) from all threads and wait until finished.
+    /// Ranges are claimed dynamically and contain at least minGrainSize elements. May be called from any thread.
+    /// Thread index is that of the executing thread (0 = main thread). Threads not owned by the work queue may only call the two-argument form.
+    /// Their loops are split into finer ranges queued at the lowest priority, so that they do not delay frame work.
+    template <class T> void ParallelFor(unsigned count, unsigned minGrainSize, const T& callback)
+    {
+        ParallelForInternal(count, minGrainSize, &callback,
+            [](const void* callback, unsigned fromIndex, unsigned toIndex, unsigned threadIndex)
+        {
+            const T& function = *static_cast<const T*>(callback);
+            if constexpr (std::is_invocable_v<const T&, unsigned, unsigned, unsigned>)
+            {
+                assert(threadIndex != M_MAX_UNSIGNED);
+                function(fromIndex, toIndex, threadIndex);
+            }
+            else
+                function(fromIndex, toIndex);
+        });
+    }
+
+    /// Evaluate map(fromIndex, toIndex) for consecutive ranges covering [0, count) from all threads and combine the results with reduce(lhs, rhs), starting from identity.
+    /// Results are combined in index order on the calling thread, so the result does not depend on scheduling.
+    template <class T, class U, class V> T ParallelReduce(unsigned count, unsigned minGrainSize, const T& identity, const U& map, const V& reduce)
+    {
+        const unsigned grainSize = GetParallelGrainSize(count, minGrainSize);
+        ea::vector<T> partialResults((count + grainSize - 1) / grainSize, identity);
+        ParallelFor(count, grainSize, [&](unsigned fromIndex, unsigned toIndex)
+        {
+            partialResults[fromIndex / grainSize] = map(fromIndex, toIndex);
+        });
+
+        T result = identity;
+        for (const T& partialResult : partialResults)
+            result = reduce(result, partialResult);
+        return result;
+    }
+
     /// Set the pool telerance before it starts deleting pool items.
     void SetTolerance(int tolerance) { tolerance_ = tolerance; }
 
@@ -115,6 +167,15 @@ public:
     bool IsCompleted(unsigned priority) const;
     /// Return whether the queue is currently completing work in the main thread.
     bool IsCompleting() const { return completing_; }
+    /// Return number of items waiting in the queue of the thread (0 = main thread).
+    unsigned GetQueueDepth(unsigned threadIndex) const;
+    /// Return number of items the thread (0 = main thread) has taken from other threads' queues during the last frame.
+    unsigned GetNumStolenItems(unsigned threadIndex) const;
+    /// Return microseconds the thread (0 = main thread) spent executing work items during the last frame.
+    long long GetBusyTime(unsigned threadIndex) const;
+
+    /// Return the range size used by parallel loops for given number of elements and minimal range size.
+    unsigned GetParallelGrainSize(unsigned count, unsigned minGrainSize) const;
 
     /// Return the pool tolerance.
     int GetTolerance() const { return tolerance_; }
@@ -123,8 +184,22 @@ public:
     int GetNonThreadedWorkMs() const { return maxNonThreadedWorkMs_; }
 
 private:
+    /// Parallel loop range function. Called with the user callback, range of elements and thread index.
+    using ParallelForFunction = void(*)(const void* callback, unsigned fromIndex, unsigned toIndex, unsigned threadIndex);
+    /// Execute parallel loop.
+    void ParallelForInternal(unsigned count, unsigned minGrainSize, const void* callback, ParallelForFunction function);
     /// Process work items until shut down. Called by the worker threads.
     void ProcessItems(unsigned threadIndex);
+    /// Insert item into the queue of the thread according to priority.
+    void PushToQueue(WorkItem* item, unsigned threadIndex);
+    /// Take an item with at least the specified priority, first from the queue of the thread and then from other queues. Return null if none.
+    WorkItem* PopFromQueues(unsigned threadIndex, unsigned priority);
+    /// Execute item, mark it completed and queue its continuations to the thread.
+    void ExecuteItem(WorkItem* item, unsigned threadIndex);
+    /// Remove item from whichever queue contains it. Return true if found.
+    bool RemoveFromQueues(WorkItem* item);
+    /// Return whether all thread queues are empty.
+    bool AreQueuesEmpty() const { return numQueuedItems_ == 0; }
     /// Purge completed work items which have at least the specified priority, and send completion events as necessary.
     void PurgeCompleted(unsigned priority);
     /// Purge the pool to reduce allocation where its unneeded.
@@ -140,15 +215,19 @@ private:
     ea::list<SharedPtr<WorkItem> > poolItems_;
     /// Work item collection. Accessed only by the main thread.
     ea::list<SharedPtr<WorkItem> > workItems_;
-    /// Work item prioritized queue for worker threads. Pointers are guaranteed to be valid (point to workItems).
-    ea::list<WorkItem*> queue_;
-    /// Worker queue mutex.
-    Mutex queueMutex_;
+    /// Prioritized work item queues, one per thread (0 = main thread). Threads steal from other queues when their own is empty. Pointers are guaranteed to be valid (point to workItems).
+    ea::vector<ea::unique_ptr<WorkerQueue> > queues_;
+    /// Total number of items in all queues.
+    std::atomic<unsigned> numQueuedItems_;
+    /// Index of the queue that receives the next item submitted from the main thread.
+    unsigned nextQueue_;
+    /// Pause mutex. Held by the main thread while the worker threads are paused.
+    Mutex pauseMutex_;
     /// Shutting down flag.
     std::atomic<bool> shutDown_;
-    /// Pausing flag. Indicates the worker threads should not contend for the queue mutex.
+    /// Pausing flag. Indicates the worker threads should not contend for the pause mutex.
     std::atomic<bool> pausing_;
-    /// Paused flag. Indicates the queue mutex being locked to prevent worker threads using up CPU time.
+    /// Paused flag. Indicates the pause mutex being locked to prevent worker threads using up CPU time.
     bool paused_;
     /// Completing work in the main thread flag.
     bool completing_;
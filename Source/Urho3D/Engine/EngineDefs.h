@@ -30,6 +30,7 @@ namespace Urho3D
 {
 
 // Engine parameters
+static const ea::string EP_ASYNC_SHADER_COMPILATION = "AsyncShaderCompilation";
 static const ea::string EP_AUTOLOAD_PATHS = "AutoloadPaths";
 static const ea::string EP_BORDERLESS = "Borderless";
 static const ea::string EP_DUMP_SHADERS = "DumpShaders";
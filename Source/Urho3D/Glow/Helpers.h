@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Core/Context.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/Material.h"
 #include "../Graphics/RenderPath.h"
 #include "../Graphics/StaticModel.h"
@@ -34,31 +35,30 @@
 
 #include <EASTL/string.h>
 
-#include <future>
-
 namespace Urho3D
 {
 
-/// Parallel loop.
+/// Minimum number of elements per range of the parallel loops used for baking.
+static const unsigned MIN_BAKE_ELEMENTS_PER_RANGE = 64;
+
+/// Parallel loop on the engine worker threads. The work queue chooses the ranges: when called from a baking thread they
+/// are small and queued at the lowest priority, so that the worker threads keep up with frame work. Without a context
+/// or work queue the loop runs on the calling thread. The number of tasks is kept for compatibility and is not used.
 template <class T>
-void ParallelFor(unsigned count, unsigned numTasks, const T& callback)
+void ParallelFor(Context* context, unsigned count, unsigned numTasks, const T& callback)
 {
-    // Post async tasks
-    ea::vector<std::future<void>> tasks;
-    const unsigned chunkSize = (count + numTasks - 1) / numTasks;
-    for (unsigned i = 0; i < numTasks; ++i)
-    {
-        tasks.push_back(std::async([&, i]()
-        {
-            const unsigned fromIndex = i * chunkSize;
-            const unsigned toIndex = ea::min(fromIndex + chunkSize, count);
-            callback(fromIndex, toIndex);
-        }));
-    }
+    WorkQueue* workQueue = context ? context->GetWorkQueue() : nullptr;
+    if (workQueue)
+        workQueue->ParallelFor(count, MIN_BAKE_ELEMENTS_PER_RANGE, callback);
+    else if (count)
+        callback(0, count);
+}
 
-    // Wait for async tasks
-    for (auto& task : tasks)
-        task.wait();
+/// Loop on the calling thread.
+template <class T>
+void ParallelFor(unsigned count, unsigned numTasks, const T& callback)
+{
+    ParallelFor(nullptr, count, numTasks, callback);
 }
 
 /// Load render path.
@@ -258,7 +258,7 @@ struct IncrementalLightBaker::Impl
                 LightmapChartBakedDirect bakedDirect{ geometryBuffer.lightmapSize_ };
 
                 // Bake emission
-                BakeEmissionLight(bakedDirect, geometryBuffer,
+                BakeEmissionLight(context_, bakedDirect, geometryBuffer,
                     settings_.emissionTracing_, settings_.properties_.emissionBrightness_);
 
                 // Bake direct lights for charts
@@ -335,13 +335,13 @@ struct IncrementalLightBaker::Impl
 
                 if (settings_.directFilter_.kernelRadius_ > 0)
                 {
-                    FilterDirectLight(*bakedDirect, directFilterBuffer,
+                    FilterDirectLight(context_, *bakedDirect, directFilterBuffer,
                         geometryBuffer, settings_.directFilter_, settings_.directChartTracing_.numTasks_);
                 }
 
                 if (settings_.indirectFilter_.kernelRadius_ > 0)
                 {
-                    FilterIndirectLight(bakedIndirect, indirectFilterBuffer,
+                    FilterIndirectLight(context_, bakedIndirect, indirectFilterBuffer,
                         geometryBuffer, settings_.indirectFilter_, settings_.indirectChartTracing_.numTasks_);
                 }
 
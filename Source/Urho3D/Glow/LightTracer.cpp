@@ -30,8 +30,6 @@
 #include <embree3/rtcore.h>
 #include <embree3/rtcore_ray.h>
 
-#include <future>
-
 using namespace embree3;
 
 namespace Urho3D
@@ -545,7 +543,7 @@ void TraceDirectLight(T sharedKernel, U sharedGenerator,
     RTCScene scene = raytracerScene.GetEmbreeScene();
     const ea::vector<RaytracerGeometry>& raytracerGeometries = raytracerScene.GetGeometries();
 
-    ParallelFor(sharedKernel.GetNumElements(), settings.numTasks_,
+    ParallelFor(raytracerScene.GetContext(), sharedKernel.GetNumElements(), settings.numTasks_,
         [&](unsigned fromIndex, unsigned toIndex)
     {
         auto kernel = sharedKernel;
@@ -783,7 +781,7 @@ void TraceIndirectLight(T sharedKernel, const ea::vector<const LightmapChartBake
 {
     assert(settings.maxBounces_ <= IndirectLightTracingSettings::MaxBounces);
 
-    ParallelFor(sharedKernel.GetNumElements(), settings.numTasks_,
+    ParallelFor(raytracerScene.GetContext(), sharedKernel.GetNumElements(), settings.numTasks_,
         [&](unsigned fromIndex, unsigned toIndex)
     {
         T kernel = sharedKernel;
@@ -920,7 +918,7 @@ void PreprocessGeometryBuffer(LightmapChartGeometryBuffer& geometryBuffer,
 {
     RTCScene scene = raytracerScene.GetEmbreeScene();
     const ea::vector<RaytracerGeometry>& raytracerGeometries = raytracerScene.GetGeometries();
-    ParallelFor(geometryBuffer.positions_.size(), settings.numTasks_,
+    ParallelFor(raytracerScene.GetContext(), geometryBuffer.positions_.size(), settings.numTasks_,
         [&](unsigned fromIndex, unsigned toIndex)
     {
         RTCRayHit rayHit;
@@ -1010,7 +1008,14 @@ void PreprocessGeometryBuffer(LightmapChartGeometryBuffer& geometryBuffer,
 void BakeEmissionLight(LightmapChartBakedDirect& bakedDirect, const LightmapChartGeometryBuffer& geometryBuffer,
     const EmissionLightTracingSettings& settings, float indirectBrightnessMultiplier)
 {
-    ParallelFor(bakedDirect.directLight_.size(), settings.numTasks_,
+    BakeEmissionLight(nullptr, bakedDirect, geometryBuffer, settings, indirectBrightnessMultiplier);
+}
+
+void BakeEmissionLight(Context* context,
+    LightmapChartBakedDirect& bakedDirect, const LightmapChartGeometryBuffer& geometryBuffer,
+    const EmissionLightTracingSettings& settings, float indirectBrightnessMultiplier)
+{
+    ParallelFor(context, bakedDirect.directLight_.size(), settings.numTasks_,
         [&](unsigned fromIndex, unsigned toIndex)
     {
         for (unsigned i = fromIndex; i < toIndex; ++i)
@@ -114,10 +114,15 @@ struct LightmapChartBakedIndirect
     ea::vector<Vector4> light_;
 };
 
-/// Accumulate emission light.
+/// Accumulate emission light on the calling thread.
 URHO3D_API void BakeEmissionLight(LightmapChartBakedDirect& bakedDirect, const LightmapChartGeometryBuffer& geometryBuffer,
     const EmissionLightTracingSettings& settings, float indirectBrightnessMultiplier);
 
+/// Accumulate emission light on the engine worker threads.
+URHO3D_API void BakeEmissionLight(Context* context,
+    LightmapChartBakedDirect& bakedDirect, const LightmapChartGeometryBuffer& geometryBuffer,
+    const EmissionLightTracingSettings& settings, float indirectBrightnessMultiplier);
+
 /// Accumulate direct light for charts.
 URHO3D_API void BakeDirectLightForCharts(LightmapChartBakedDirect& bakedDirect, const LightmapChartGeometryBuffer& geometryBuffer,
     const RaytracerScene& raytracerScene, const ea::vector<unsigned>& geometryBufferToRaytracer,
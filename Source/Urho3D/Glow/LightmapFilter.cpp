@@ -78,12 +78,12 @@ float CalculateEdgeWeight(
 
 /// Apply Gauss filter edge stopping function to array.
 template <class T>
-void FilterArray(const ea::vector<T>& input, ea::vector<T>& output,
+void FilterArray(Context* context, const ea::vector<T>& input, ea::vector<T>& output,
     const LightmapChartGeometryBuffer& geometryBuffer,
     const EdgeStoppingGaussFilterParameters& params, unsigned numTasks)
 {
     const ea::span<const float> kernelWeights = GetKernel(params.kernelRadius_);
-    ParallelFor(input.size(), numTasks,
+    ParallelFor(context, input.size(), numTasks,
         [&](unsigned fromIndex, unsigned toIndex)
     {
         for (unsigned index = fromIndex; index < toIndex; ++index)
@@ -144,13 +144,27 @@ void FilterArray(const ea::vector<T>& input, ea::vector<T>& output,
 void FilterDirectLight(const LightmapChartBakedDirect& bakedDirect, ea::vector<Vector3>& outputBuffer,
     const LightmapChartGeometryBuffer& geometryBuffer, const EdgeStoppingGaussFilterParameters& params, unsigned numTasks)
 {
-    FilterArray(bakedDirect.directLight_, outputBuffer, geometryBuffer, params, numTasks);
+    FilterArray(nullptr, bakedDirect.directLight_, outputBuffer, geometryBuffer, params, numTasks);
+}
+
+void FilterDirectLight(Context* context,
+    const LightmapChartBakedDirect& bakedDirect, ea::vector<Vector3>& outputBuffer,
+    const LightmapChartGeometryBuffer& geometryBuffer, const EdgeStoppingGaussFilterParameters& params, unsigned numTasks)
+{
+    FilterArray(context, bakedDirect.directLight_, outputBuffer, geometryBuffer, params, numTasks);
 }
 
 void FilterIndirectLight(const LightmapChartBakedIndirect& bakedIndirect, ea::vector<Vector4>& outputBuffer,
     const LightmapChartGeometryBuffer& geometryBuffer, const EdgeStoppingGaussFilterParameters& params, unsigned numTasks)
 {
-    FilterArray(bakedIndirect.light_, outputBuffer, geometryBuffer, params, numTasks);
+    FilterArray(nullptr, bakedIndirect.light_, outputBuffer, geometryBuffer, params, numTasks);
+}
+
+void FilterIndirectLight(Context* context,
+    const LightmapChartBakedIndirect& bakedIndirect, ea::vector<Vector4>& outputBuffer,
+    const LightmapChartGeometryBuffer& geometryBuffer, const EdgeStoppingGaussFilterParameters& params, unsigned numTasks)
+{
+    FilterArray(context, bakedIndirect.light_, outputBuffer, geometryBuffer, params, numTasks);
 }
 
 }
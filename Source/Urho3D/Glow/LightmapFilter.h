@@ -32,12 +32,22 @@
 namespace Urho3D
 {
 
-/// Filter direct light.
+/// Filter direct light on the calling thread.
 URHO3D_API void FilterDirectLight(const LightmapChartBakedDirect& bakedDirect, ea::vector<Vector3>& outputBuffer,
     const LightmapChartGeometryBuffer& geometryBuffer, const EdgeStoppingGaussFilterParameters& params, unsigned numTasks);
 
-/// Filter indirect light.
+/// Filter direct light on the engine worker threads.
+URHO3D_API void FilterDirectLight(Context* context,
+    const LightmapChartBakedDirect& bakedDirect, ea::vector<Vector3>& outputBuffer,
+    const LightmapChartGeometryBuffer& geometryBuffer, const EdgeStoppingGaussFilterParameters& params, unsigned numTasks);
+
+/// Filter indirect light on the calling thread.
 URHO3D_API void FilterIndirectLight(const LightmapChartBakedIndirect& bakedIndirect, ea::vector<Vector4>& outputBuffer,
     const LightmapChartGeometryBuffer& geometryBuffer, const EdgeStoppingGaussFilterParameters& params, unsigned numTasks);
 
+/// Filter indirect light on the engine worker threads.
+URHO3D_API void FilterIndirectLight(Context* context,
+    const LightmapChartBakedIndirect& bakedIndirect, ea::vector<Vector4>& outputBuffer,
+    const LightmapChartGeometryBuffer& geometryBuffer, const EdgeStoppingGaussFilterParameters& params, unsigned numTasks);
+
 }
@@ -46,8 +46,6 @@
 
 #include <EASTL/sort.h>
 
-#include <future>
-
 namespace Urho3D
 {
 
@@ -331,25 +329,20 @@ LightmapGeometryBakingScenesArray GenerateLightmapGeometryBakingScenes(
             usedModels.insert(staticModel->GetModel());
     }
 
-    // Schedule model seams collecting
-    ea::vector<std::future<ea::pair<Model*, LightmapSeamVector>>> collectSeamsTasks;
-    for (Model* model : usedModels)
+    // Collect model seams on the worker threads
+    const ea::vector<Model*> seamModels(usedModels.begin(), usedModels.end());
+    ea::vector<LightmapSeamVector> modelSeams(seamModels.size());
+    const unsigned uvChannel = settings.uvChannel_;
+    context->GetWorkQueue()->ParallelFor(seamModels.size(), 1, [&](unsigned fromIndex, unsigned toIndex)
     {
-        const unsigned uvChannel = settings.uvChannel_;
-        collectSeamsTasks.push_back(std::async([model, uvChannel]()
-        {
-            LightmapSeamVector modelSeams = CollectModelSeams(model, uvChannel);
-            return ea::make_pair(model, ea::move(modelSeams));
-        }));
-    }
+        for (unsigned i = fromIndex; i < toIndex; ++i)
+            modelSeams[i] = CollectModelSeams(seamModels[i], uvChannel);
+    });
 
     // Cache model seams
     ea::hash_map<Model*, LightmapSeamVector> modelSeamsCache;
-    for (auto& task : collectSeamsTasks)
-    {
-        auto result = task.get();
-        modelSeamsCache.emplace(result.first, ea::move(result.second));
-    }
+    for (unsigned i = 0; i < seamModels.size(); ++i)
+        modelSeamsCache.emplace(seamModels[i], ea::move(modelSeams[i]));
 
     // Zero ID is reserved for invalid texels
     GeometryIDToObjectMappingVector mapping;
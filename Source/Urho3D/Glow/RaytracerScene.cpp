@@ -32,8 +32,6 @@
 #include <embree3/rtcore.h>
 #include <embree3/rtcore_ray.h>
 
-#include <future>
-
 using namespace embree3;
 
 namespace Urho3D
@@ -473,49 +471,54 @@ SharedPtr<RaytracerScene> CreateRaytracingScene(Context* context, const ea::vect
         }
     }
 
-    // Start model parsing
-    ea::vector<std::future<ModelModelViewPair>> modelParseTasks;
-    for (const auto& item : modelsToParse)
-        modelParseTasks.push_back(std::async(ParseModelForRaytracer, item.first, item.second, lightmapUVChannel));
+    // Parse models on the worker threads
+    WorkQueue* workQueue = context->GetWorkQueue();
+    const ea::vector<ea::pair<Model*, bool>> modelParseItems(modelsToParse.begin(), modelsToParse.end());
+    ea::vector<ModelModelViewPair> parsedModels(modelParseItems.size());
+    workQueue->ParallelFor(modelParseItems.size(), 1, [&](unsigned fromIndex, unsigned toIndex)
+    {
+        for (unsigned i = fromIndex; i < toIndex; ++i)
+            parsedModels[i] = ParseModelForRaytracer(modelParseItems[i].first, modelParseItems[i].second, lightmapUVChannel);
+    });
 
-    // Finish model parsing
     ea::unordered_map<Model*, SharedPtr<ModelView>> parsedModelCache;
-    for (auto& task : modelParseTasks)
-    {
-        const ModelModelViewPair& parsedModel = task.get();
+    for (const ModelModelViewPair& parsedModel : parsedModels)
         parsedModelCache.emplace(parsedModel.model_, parsedModel.parsedModel_);
-    }
 
     // Prepare Embree scene
     const RTCDevice device = rtcNewDevice("");
     const RTCScene scene = rtcNewScene(device);
     rtcSetSceneFlags(scene, RTC_SCENE_FLAG_CONTEXT_FILTER_FUNCTION);
 
-    ea::vector<std::future<ea::vector<RaytracerGeometry>>> createRaytracerGeometriesTasks;
-    for (unsigned objectIndex = 0; objectIndex < geometries.size(); ++objectIndex)
+    // Create Embree geometries on the worker threads
+    ea::vector<ea::vector<RaytracerGeometry>> raytracerGeometries(geometries.size());
+    workQueue->ParallelFor(geometries.size(), 1, [&](unsigned fromIndex, unsigned toIndex)
     {
-        Component* geometry = geometries[objectIndex];
-        if (auto staticModel = dynamic_cast<StaticModel*>(geometry))
+        for (unsigned objectIndex = fromIndex; objectIndex < toIndex; ++objectIndex)
         {
-            if (ModelView* parsedModel = parsedModelCache[staticModel->GetModel()])
+            Component* geometry = geometries[objectIndex];
+            if (auto staticModel = dynamic_cast<StaticModel*>(geometry))
             {
-                createRaytracerGeometriesTasks.push_back(std::async(CreateRaytracerGeometriesForStaticModel,
-                    device, parsedModel, staticModel, objectIndex, lightmapUVChannel));
+                const auto iter = parsedModelCache.find(staticModel->GetModel());
+                if (iter != parsedModelCache.end() && iter->second)
+                {
+                    raytracerGeometries[objectIndex] = CreateRaytracerGeometriesForStaticModel(
+                        device, iter->second, staticModel, objectIndex, lightmapUVChannel);
+                }
+            }
+            else if (auto terrain = dynamic_cast<Terrain*>(geometry))
+            {
+                raytracerGeometries[objectIndex] = CreateRaytracerGeometriesForTerrain(
+                    device, terrain, objectIndex, lightmapUVChannel);
             }
         }
-        else if (auto terrain = dynamic_cast<Terrain*>(geometry))
-        {
-            createRaytracerGeometriesTasks.push_back(std::async(CreateRaytracerGeometriesForTerrain,
-                device, terrain, objectIndex, lightmapUVChannel));
-        }
-    }
+    });
 
     // Collect and attach Embree geometries
     ea::hash_map<ea::string, SharedPtr<Image>> diffuseImages;
     ea::vector<RaytracerGeometry> geometryIndex;
-    for (auto& task : createRaytracerGeometriesTasks)
+    for (const ea::vector<RaytracerGeometry>& raytracerGeometryArray : raytracerGeometries)
     {
-        const ea::vector<RaytracerGeometry> raytracerGeometryArray = task.get();
         for (const RaytracerGeometry& raytracerGeometry : raytracerGeometryArray)
         {
             const unsigned geomID = rtcAttachGeometry(scene, raytracerGeometry.embreeGeometry_);
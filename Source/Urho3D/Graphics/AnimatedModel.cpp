@@ -26,6 +26,7 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
 #include "../Graphics/AnimatedModel.h"
 #include "../Graphics/Animation.h"
 #include "../Graphics/AnimationState.h"
@@ -77,6 +78,8 @@ AnimatedModel::AnimatedModel(Context* context) :
     animationLodBias_(1.0f),
     animationLodTimer_(-1.0f),
     animationLodDistance_(0.0f),
+    animationMaxDistance_(0.0f),
+    animationDistance_(0.0f),
     updateInvisible_(false),
     animationDirty_(false),
     animationOrderDirty_(false),
@@ -131,6 +134,7 @@ void AnimatedModel::RegisterObject(Context* context)
         .SetMetadata(AttributeMetadata::P_VECTOR_STRUCT_ELEMENTS, animationStatesStructureElementNames);
     URHO3D_ACCESSOR_ATTRIBUTE("Morphs", GetMorphsAttr, SetMorphsAttr, ea::vector<unsigned char>, Variant::emptyBuffer,
         AM_DEFAULT | AM_NOEDIT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Animation Max Distance", GetAnimationMaxDistance, SetAnimationMaxDistance, float, 0.0f, AM_DEFAULT);
 }
 
 bool AnimatedModel::Serialize(Archive& archive)
@@ -265,6 +269,7 @@ void AnimatedModel::Update(const FrameInfo& frame)
             return;
         float scale = GetWorldBoundingBox().Size().DotProduct(DOT_SCALE);
         animationLodDistance_ = frame.camera_->GetLodDistance(distance, scale, lodBias_);
+        animationDistance_ = distance;
     }
 
     if (animationDirty_ || animationOrderDirty_)
@@ -295,14 +300,18 @@ void AnimatedModel::UpdateBatches(const FrameInfo& frame)
     float scale = transformedBoundingBox.Size().DotProduct(DOT_SCALE);
     float newLodDistance = frame.camera_->GetLodDistance(distance_, scale, lodBias_);
 
-    // If model is rendered from several views, use the minimum LOD distance for animation LOD
+    // If model is rendered from several views, use the minimum distances for animation LOD
     if (frame.frameNumber_ != animationLodFrameNumber_)
     {
         animationLodDistance_ = newLodDistance;
+        animationDistance_ = distance_;
         animationLodFrameNumber_ = frame.frameNumber_;
     }
     else
+    {
         animationLodDistance_ = Min(animationLodDistance_, newLodDistance);
+        animationDistance_ = Min(animationDistance_, distance_);
+    }
 
     if (newLodDistance != lodDistance_)
     {
@@ -327,11 +336,23 @@ void AnimatedModel::UpdateGeometry(const FrameInfo& frame)
         UpdateMorphs();
 }
 
+void AnimatedModel::CommitGeometry(const FrameInfo& frame)
+{
+    if (commitPending_)
+    {
+        if (modelAnimator_)
+            modelAnimator_->Commit();
+        commitPending_ = false;
+    }
+}
+
 UpdateGeometryType AnimatedModel::GetUpdateGeometryType()
 {
-    if (morphsDirty_ || forceAnimationUpdate_ || (skinningDirty_ && softwareSkinning_))
+    // Animation update marks nodes dirty and must happen on the main thread. Skinning and morphs are applied on a
+    // worker thread, the resulting vertex data is uploaded in CommitGeometry()
+    if (forceAnimationUpdate_)
         return UPDATE_MAIN_THREAD;
-    else if (skinningDirty_)
+    else if (skinningDirty_ || morphsDirty_)
         return UPDATE_WORKER_THREAD;
     else
         return UPDATE_NONE;
@@ -564,6 +585,12 @@ void AnimatedModel::SetAnimationLodBias(float bias)
     MarkNetworkUpdate();
 }
 
+void AnimatedModel::SetAnimationMaxDistance(float distance)
+{
+    animationMaxDistance_ = Max(distance, 0.0f);
+    MarkNetworkUpdate();
+}
+
 void AnimatedModel::SetUpdateInvisible(bool enable)
 {
     updateInvisible_ = enable;
@@ -822,6 +849,7 @@ void AnimatedModel::SetSkeleton(const Skeleton& skeleton, bool createBones)
     }
 
     assignBonesPending_ = !createBones;
+    boneTransformsDirty_ = true;
 }
 
 void AnimatedModel::SetModelAttr(const ResourceRef& value)
@@ -939,19 +967,22 @@ void AnimatedModel::UpdateBoneBoundingBox()
         boneBoundingBox_.Clear();
         Matrix3x4 inverseNodeTransform = node_->GetWorldTransform().Inverse();
 
+        if (boneTransformsDirty_)
+            UpdateBoneTransforms();
+
         const ea::vector<Bone>& bones = skeleton_.GetBones();
-        for (auto i = bones.begin(); i != bones.end(); ++i)
+        for (unsigned i = 0; i < bones.size(); ++i)
         {
-            Node* boneNode = i->node_;
-            if (!boneNode)
+            const Bone& bone = bones[i];
+            if (!bone.node_)
                 continue;
 
             // Use hitbox if available. If not, use only half of the sphere radius
             /// \todo The sphere radius should be multiplied with bone scale
-            if (i->collisionMask_ & BONECOLLISION_BOX)
-                boneBoundingBox_.Merge(i->boundingBox_.Transformed(inverseNodeTransform * boneNode->GetWorldTransform()));
-            else if (i->collisionMask_ & BONECOLLISION_SPHERE)
-                boneBoundingBox_.Merge(Sphere(inverseNodeTransform * boneNode->GetWorldPosition(), i->radius_ * 0.5f));
+            if (bone.collisionMask_ & BONECOLLISION_BOX)
+                boneBoundingBox_.Merge(bone.boundingBox_.Transformed(inverseNodeTransform * boneTransforms_[i]));
+            else if (bone.collisionMask_ & BONECOLLISION_SPHERE)
+                boneBoundingBox_.Merge(Sphere(inverseNodeTransform * boneTransforms_[i].Translation(), bone.radius_ * 0.5f));
         }
     }
 
@@ -978,6 +1009,7 @@ void AnimatedModel::OnMarkedDirty(Node* node)
     if (skeleton_.GetNumBones())
     {
         skinningDirty_ = true;
+        boneTransformsDirty_ = true;
         // Bone bounding box doesn't need to be marked dirty when only the base scene node moves
         if (node != node_)
             boneBoundingBoxDirty_ = true;
@@ -1024,6 +1056,7 @@ void AnimatedModel::AssignBoneNodes()
         }
         i->node_ = boneNode;
     }
+    boneTransformsDirty_ = true;
 
     // If no bones found, this may be a prefab where the bone information was left out.
     // In that case reassign the skeleton now if possible
@@ -1181,11 +1214,16 @@ void AnimatedModel::SetGeometryBoneMappings()
 
 void AnimatedModel::UpdateAnimation(const FrameInfo& frame)
 {
-    // If using animation LOD, accumulate time and see if it is time to update
-    if (animationLodBias_ > 0.0f && animationLodDistance_ > 0.0f)
+    // Perform the first update always regardless of LOD timer and distance. The timer is also reset to request an update
+    // when the model comes into view
+    if (animationLodTimer_ >= 0.0f)
     {
-        // Perform the first update always regardless of LOD timer
-        if (animationLodTimer_ >= 0.0f)
+        // Keep the last pose while farther than the animation max distance
+        if (animationMaxDistance_ > 0.0f && animationDistance_ > animationMaxDistance_)
+            return;
+
+        // If using animation LOD, accumulate time and see if it is time to update
+        if (animationLodBias_ > 0.0f && animationLodDistance_ > 0.0f)
         {
             animationLodTimer_ += animationLodBias_ * frame.timeStep_ * ANIMATION_LOD_BASESCALE;
             if (animationLodTimer_ >= animationLodDistance_)
@@ -1193,9 +1231,9 @@ void AnimatedModel::UpdateAnimation(const FrameInfo& frame)
             else
                 return;
         }
-        else
-            animationLodTimer_ = 0.0f;
     }
+    else
+        animationLodTimer_ = 0.0f;
 
     ApplyAnimation();
 }
@@ -1228,13 +1266,48 @@ void AnimatedModel::ApplyAnimation()
     animationDirty_ = false;
 }
 
-void AnimatedModel::UpdateSkinning()
+void AnimatedModel::UpdateBoneTransforms()
 {
-    // Note: the model's world transform will be baked in the skin matrices
     const ea::vector<Bone>& bones = skeleton_.GetBones();
+    const ea::vector<unsigned>& boneOrder = skeleton_.GetBoneOrder();
+    const ea::vector<unsigned>& boneParents = skeleton_.GetBoneParents();
     // Use model's world transform in case a bone is missing
     const Matrix3x4& worldTransform = node_->GetWorldTransform();
 
+    // Visit the bones parents first. A dirty bone node whose scene parent is the node of its parent bone gets its world
+    // transform from the already calculated parent bone transform, without walking up the scene hierarchy
+    const bool hasBoneOrder = boneOrder.size() == bones.size() && boneParents.size() == bones.size();
+    boneTransforms_.resize(bones.size());
+    for (unsigned i = 0; i < bones.size(); ++i)
+    {
+        const unsigned boneIndex = hasBoneOrder ? boneOrder[i] : i;
+        Node* boneNode = bones[boneIndex].node_;
+        if (!boneNode)
+        {
+            boneTransforms_[boneIndex] = worldTransform;
+            continue;
+        }
+
+        const unsigned parentIndex = hasBoneOrder ? boneParents[boneIndex] : M_MAX_UNSIGNED;
+        Node* parentNode = boneNode->GetParent();
+        if (boneNode->IsDirty() && parentIndex != M_MAX_UNSIGNED && parentNode && parentNode == bones[parentIndex].node_ &&
+            parentNode != boneNode->GetScene())
+            boneTransforms_[boneIndex] = boneTransforms_[parentIndex] * boneNode->GetTransform();
+        else
+            boneTransforms_[boneIndex] = boneNode->GetWorldTransform();
+    }
+
+    boneTransformsDirty_ = false;
+}
+
+void AnimatedModel::UpdateSkinning()
+{
+    // Note: the model's world transform will be baked in the skin matrices
+    const ea::vector<Bone>& bones = skeleton_.GetBones();
+
+    if (boneTransformsDirty_)
+        UpdateBoneTransforms();
+
     // Skinning with global matrices only
     if (!geometrySkinMatrices_.size())
     {
@@ -1242,9 +1315,9 @@ void AnimatedModel::UpdateSkinning()
         {
             const Bone& bone = bones[i];
             if (bone.node_)
-                skinMatrices_[i] = bone.node_->GetWorldTransform() * bone.offsetMatrix_;
+                skinMatrices_[i] = boneTransforms_[i] * bone.offsetMatrix_;
             else
-                skinMatrices_[i] = worldTransform;
+                skinMatrices_[i] = boneTransforms_[i];
         }
     }
     // Skinning with per-geometry matrices
@@ -1254,9 +1327,9 @@ void AnimatedModel::UpdateSkinning()
         {
             const Bone& bone = bones[i];
             if (bone.node_)
-                skinMatrices_[i] = bone.node_->GetWorldTransform() * bone.offsetMatrix_;
+                skinMatrices_[i] = boneTransforms_[i] * bone.offsetMatrix_;
             else
-                skinMatrices_[i] = worldTransform;
+                skinMatrices_[i] = boneTransforms_[i];
 
             // Copy the skin matrix to per-geometry matrices as needed
             for (unsigned j = 0; j < geometrySkinMatrixPtrs_[i].size(); ++j)
@@ -1283,7 +1356,12 @@ void AnimatedModel::UpdateMorphs()
         modelAnimator_->ApplyMorphs(morphs_);
         if (softwareSkinning_)
             modelAnimator_->ApplySkinning(skinMatrices_);
-        modelAnimator_->Commit();
+
+        // Vertex data can only be uploaded on the main thread, otherwise defer to CommitGeometry()
+        if (Thread::IsMainThread())
+            modelAnimator_->Commit();
+        else
+            commitPending_ = true;
     }
 
     morphsDirty_ = false;
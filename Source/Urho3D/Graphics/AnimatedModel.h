@@ -47,6 +47,8 @@ public:
     ~AnimatedModel() override;
     /// Register object factory. Drawable must be registered first.
     static void RegisterObject(Context* context);
+    /// Return whether binary load and save may access typed attributes directly. True for this class, but not for subclasses.
+    bool IsDirectAttributeAccessAllowed() const override { return IsExactType<AnimatedModel>(); }
 
     /// Serialize from/to archive. Return true if successful.
     bool Serialize(Archive& archive) override;
@@ -67,6 +69,8 @@ public:
     void UpdateBatches(const FrameInfo& frame) override;
     /// Prepare geometry for rendering. Called from a worker thread if possible (no GPU update).
     void UpdateGeometry(const FrameInfo& frame) override;
+    /// Upload vertex data prepared by a worker thread geometry update. Called from the main thread.
+    void CommitGeometry(const FrameInfo& frame) override;
     /// Return whether a geometry update is necessary, and if it can happen in a worker thread.
     UpdateGeometryType GetUpdateGeometryType() override;
     /// Visualize the component as debug geometry.
@@ -90,6 +94,8 @@ public:
     void RemoveAllAnimationStates();
     /// Set animation LOD bias.
     void SetAnimationLodBias(float bias);
+    /// Set distance from the camera beyond which animation is not updated and the last pose is kept. 0 = unlimited (default).
+    void SetAnimationMaxDistance(float distance);
     /// Set whether to update animation and the bounding box when not visible. Recommended to enable for physically controlled models like ragdolls.
     void SetUpdateInvisible(bool enable);
     /// Set vertex morph weight by index.
@@ -124,6 +130,9 @@ public:
     /// Return animation LOD bias.
     float GetAnimationLodBias() const { return animationLodBias_; }
 
+    /// Return distance from the camera beyond which animation is not updated.
+    float GetAnimationMaxDistance() const { return animationMaxDistance_; }
+
     /// Return whether to update animation when not visible.
     bool GetUpdateInvisible() const { return updateInvisible_; }
 
@@ -201,6 +210,8 @@ private:
     void CloneGeometries();
     /// Recalculate animations. Called from Update().
     void UpdateAnimation(const FrameInfo& frame);
+    /// Recalculate bone world transforms in hierarchy order.
+    void UpdateBoneTransforms();
     /// Recalculate skinning.
     void UpdateSkinning();
     /// Reapply all vertex morphs.
@@ -218,6 +229,8 @@ private:
     ea::vector<SharedPtr<AnimationState> > animationStates_;
     /// Skinning matrices.
     ea::vector<Matrix3x4> skinMatrices_;
+    /// Bone world transforms.
+    ea::vector<Matrix3x4> boneTransforms_;
     /// Mapping of subgeometry bone indices, used if more bones than skinning shader can manage.
     ea::vector<ea::vector<unsigned> > geometryBoneMappings_;
     /// Subgeometry skinning matrices, used if more bones than skinning shader can manage.
@@ -236,6 +249,10 @@ private:
     float animationLodTimer_;
     /// Animation LOD distance, the minimum of all LOD view distances last frame.
     float animationLodDistance_;
+    /// Distance from the camera beyond which animation is not updated.
+    float animationMaxDistance_;
+    /// Distance from the camera, the minimum of all view distances last frame.
+    float animationDistance_;
     /// Update animation when invisible flag.
     bool updateInvisible_;
     /// Animation dirty flag.
@@ -248,6 +265,10 @@ private:
     bool skinningDirty_;
     /// Bone bounding box dirty flag.
     bool boneBoundingBoxDirty_;
+    /// Bone world transforms dirty flag.
+    bool boneTransformsDirty_{true};
+    /// Vertex data upload pending flag.
+    bool commitPending_{};
     /// Software skinning flag.
     bool softwareSkinning_{};
     /// Number of bones used for software skinning.
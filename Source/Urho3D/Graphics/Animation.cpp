@@ -50,6 +50,310 @@ inline bool CompareKeyFrames(const AnimationKeyFrame& lhs, const AnimationKeyFra
     return lhs.time_ < rhs.time_;
 }
 
+namespace
+{
+
+/// Quantize key time over the animation length.
+unsigned short QuantizeTime(float time, float length)
+{
+    if (length <= 0.0f)
+        return 0;
+    return static_cast<unsigned short>(Clamp(RoundToInt(time / length * COMPRESSED_TIME_RANGE), 0, (int)COMPRESSED_TIME_RANGE));
+}
+
+/// Return indices of the keys to keep. The first and last keys are always kept, a key in between is removed if canInterpolate(from, to, key) holds for it.
+template <class T> ea::vector<unsigned> ReduceKeys(unsigned numKeys, const T& canInterpolate)
+{
+    ea::vector<unsigned> keys;
+    if (!numKeys)
+        return keys;
+
+    keys.push_back(0);
+    unsigned from = 0;
+    for (unsigned to = from + 2; to < numKeys; ++to)
+    {
+        for (unsigned key = from + 1; key < to; ++key)
+        {
+            if (!canInterpolate(from, to, key))
+            {
+                from = to - 1;
+                keys.push_back(from);
+                break;
+            }
+        }
+    }
+
+    if (numKeys > 1)
+        keys.push_back(numKeys - 1);
+    return keys;
+}
+
+/// Return interpolation factor of a key between two other keys.
+float GetKeyFactor(const ea::vector<unsigned short>& times, unsigned from, unsigned to, unsigned key)
+{
+    const int interval = times[to] - times[from];
+    return interval > 0 ? static_cast<float>(times[key] - times[from]) / interval : 1.0f;
+}
+
+/// Quantize position or scale values over their bounding box and remove redundant keys.
+void CompressVectorChannel(CompressedAnimationChannel& dest, const ea::vector<unsigned short>& times,
+    const ea::vector<Vector3>& values, float tolerance)
+{
+    dest.times_.clear();
+    dest.values_.clear();
+    if (values.empty())
+        return;
+
+    Vector3 minValue = values[0];
+    Vector3 maxValue = values[0];
+    for (const Vector3& value : values)
+    {
+        minValue = VectorMin(minValue, value);
+        maxValue = VectorMax(maxValue, value);
+    }
+
+    dest.offset_ = minValue;
+    dest.step_ = (maxValue - minValue) / static_cast<float>(COMPRESSED_VECTOR_RANGE);
+
+    ea::vector<unsigned short> quantized(values.size() * 3);
+    ea::vector<Vector3> decoded(values.size());
+    for (unsigned i = 0; i < values.size(); ++i)
+    {
+        for (unsigned j = 0; j < 3; ++j)
+        {
+            const float step = dest.step_.Data()[j];
+            const float steps = step > 0.0f ? (values[i].Data()[j] - minValue.Data()[j]) / step : 0.0f;
+            quantized[i * 3 + j] = static_cast<unsigned short>(Clamp(RoundToInt(steps), 0, (int)COMPRESSED_VECTOR_RANGE));
+        }
+        decoded[i] = minValue + Vector3(quantized[i * 3], quantized[i * 3 + 1], quantized[i * 3 + 2]) * dest.step_;
+    }
+
+    ea::vector<unsigned> keys;
+    bool isConstant = true;
+    for (const Vector3& value : values)
+        isConstant = isConstant && (value - decoded[0]).Length() <= tolerance;
+
+    if (isConstant)
+        keys.push_back(0);
+    else
+    {
+        keys = ReduceKeys(values.size(), [&](unsigned from, unsigned to, unsigned key)
+        {
+            const Vector3 value = decoded[from].Lerp(decoded[to], GetKeyFactor(times, from, to, key));
+            return (value - values[key]).Length() <= tolerance;
+        });
+    }
+
+    for (unsigned key : keys)
+    {
+        dest.times_.push_back(times[key]);
+        dest.values_.insert(dest.values_.end(), &quantized[key * 3], &quantized[key * 3] + 3);
+    }
+}
+
+/// Quantize the three smallest components of a normalized rotation.
+void EncodeRotation(const Quaternion& rotation, unsigned short* dest)
+{
+    const float* components = rotation.Data();
+
+    unsigned largest = 0;
+    for (unsigned i = 1; i < 4; ++i)
+    {
+        if (Abs(components[i]) > Abs(components[largest]))
+            largest = i;
+    }
+
+    // q and -q are the same rotation, so the largest component can be made positive and left out
+    const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+    unsigned index = 0;
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        const float value = (components[i] * sign + COMPRESSED_ROTATION_MAX) / (2.0f * COMPRESSED_ROTATION_MAX);
+        dest[index++] = static_cast<unsigned short>(Clamp(RoundToInt(value * COMPRESSED_ROTATION_RANGE), 0, (int)COMPRESSED_ROTATION_RANGE));
+    }
+
+    dest[0] |= (largest & 1u) << 15u;
+    dest[1] |= (largest >> 1u) << 15u;
+}
+
+/// Return angle between two normalized rotations in degrees. Unlike the arc cosine of the dot product, this is precise for small angles.
+float GetRotationError(const Quaternion& lhs, const Quaternion& rhs)
+{
+    // Distance between the two quaternions on the unit sphere is 2 * sin(angle / 4)
+    const Quaternion delta = lhs.DotProduct(rhs) < 0.0f ? lhs + rhs : lhs - rhs;
+    return 4.0f * Asin(sqrtf(delta.DotProduct(delta)) * 0.5f);
+}
+
+/// Insert keys between rotations that are too far apart for normalized lerp to follow spherical lerp within tolerance.
+void SubdivideRotationKeys(ea::vector<unsigned short>& times, ea::vector<Quaternion>& values, float tolerance)
+{
+    ea::vector<unsigned short> subdividedTimes;
+    ea::vector<Quaternion> subdividedValues;
+    for (unsigned i = 0; i < values.size(); ++i)
+    {
+        subdividedTimes.push_back(times[i]);
+        subdividedValues.push_back(values[i]);
+        if (i + 1 == values.size())
+            break;
+
+        // Normalized lerp deviates the most from spherical lerp around a quarter of the interval
+        const unsigned interval = times[i + 1] - times[i];
+        unsigned numSegments = 1;
+        while (numSegments < interval)
+        {
+            const float segment = 1.0f / numSegments;
+            const Quaternion end = values[i].Slerp(values[i + 1], segment);
+            const Quaternion expected = values[i].Slerp(values[i + 1], segment * 0.25f);
+            if (GetRotationError(values[i].Nlerp(end, 0.25f, true), expected) <= tolerance)
+                break;
+            numSegments *= 2;
+        }
+        numSegments = Min(numSegments, Max(interval, 1u));
+
+        for (unsigned j = 1; j < numSegments; ++j)
+        {
+            const float factor = static_cast<float>(j) / numSegments;
+            subdividedTimes.push_back(static_cast<unsigned short>(times[i] + RoundToInt(interval * factor)));
+            subdividedValues.push_back(values[i].Slerp(values[i + 1], factor));
+        }
+    }
+
+    times.swap(subdividedTimes);
+    values.swap(subdividedValues);
+}
+
+/// Quantize rotation values and remove redundant keys.
+void CompressRotationChannel(CompressedAnimationChannel& dest, ea::vector<unsigned short> times,
+    ea::vector<Quaternion> values, float tolerance)
+{
+    dest.times_.clear();
+    dest.values_.clear();
+    dest.offset_ = Vector3::ZERO;
+    dest.step_ = Vector3::ZERO;
+    if (values.empty())
+        return;
+
+    for (Quaternion& value : values)
+        value.Normalize();
+    SubdivideRotationKeys(times, values, tolerance);
+
+    const ea::vector<Quaternion>& normalized = values;
+    ea::vector<Quaternion> decoded(values.size());
+    dest.values_.resize(values.size() * 3);
+    for (unsigned i = 0; i < values.size(); ++i)
+    {
+        EncodeRotation(normalized[i], &dest.values_[i * 3]);
+        decoded[i] = dest.GetRotation(i);
+    }
+
+    ea::vector<unsigned> keys;
+    bool isConstant = true;
+    for (const Quaternion& value : normalized)
+        isConstant = isConstant && GetRotationError(value, decoded[0]) <= tolerance;
+
+    if (isConstant)
+        keys.push_back(0);
+    else
+    {
+        // Also compare halfway between keys, otherwise keys added by subdivision would be removed again
+        const auto isWithinTolerance = [&](unsigned from, unsigned to, unsigned key, unsigned nextKey)
+        {
+            const float factor = (GetKeyFactor(times, from, to, key) + GetKeyFactor(times, from, to, nextKey)) * 0.5f;
+            const Quaternion expected = normalized[key].Nlerp(normalized[nextKey], 0.5f, true);
+            return GetRotationError(decoded[from].Nlerp(decoded[to], factor, true), expected) <= tolerance;
+        };
+
+        keys = ReduceKeys(values.size(), [&](unsigned from, unsigned to, unsigned key)
+        {
+            const Quaternion value = decoded[from].Nlerp(decoded[to], GetKeyFactor(times, from, to, key), true);
+            return GetRotationError(value, normalized[key]) <= tolerance && isWithinTolerance(from, to, key - 1, key)
+                && (key + 1 < to || isWithinTolerance(from, to, key, to));
+        });
+    }
+
+    ea::vector<unsigned short> quantized;
+    quantized.swap(dest.values_);
+    for (unsigned key : keys)
+    {
+        dest.times_.push_back(times[key]);
+        dest.values_.insert(dest.values_.end(), &quantized[key * 3], &quantized[key * 3] + 3);
+    }
+}
+
+/// Read compressed channel.
+void ReadCompressedChannel(Deserializer& source, CompressedAnimationChannel& channel, bool hasRange)
+{
+    const unsigned numKeys = source.ReadVLE();
+    channel.times_.resize(numKeys);
+    source.Read(channel.times_.data(), numKeys * sizeof(unsigned short));
+    if (hasRange)
+    {
+        channel.offset_ = source.ReadVector3();
+        channel.step_ = source.ReadVector3();
+    }
+    channel.values_.resize(numKeys * 3);
+    source.Read(channel.values_.data(), numKeys * 3 * sizeof(unsigned short));
+}
+
+/// Write compressed channel.
+void WriteCompressedChannel(Serializer& dest, const CompressedAnimationChannel& channel, bool hasRange)
+{
+    dest.WriteVLE(channel.times_.size());
+    dest.Write(channel.times_.data(), channel.times_.size() * sizeof(unsigned short));
+    if (hasRange)
+    {
+        dest.WriteVector3(channel.offset_);
+        dest.WriteVector3(channel.step_);
+    }
+    dest.Write(channel.values_.data(), channel.values_.size() * sizeof(unsigned short));
+}
+
+}
+
+Vector3 CompressedAnimationChannel::GetVector(unsigned index) const
+{
+    const unsigned short* key = &values_[index * 3];
+    return offset_ + Vector3(key[0], key[1], key[2]) * step_;
+}
+
+Quaternion CompressedAnimationChannel::GetRotation(unsigned index) const
+{
+    const unsigned short* key = &values_[index * 3];
+    const unsigned largest = (key[0] >> 15u) | ((key[1] >> 15u) << 1u);
+
+    float smallest[3];
+    float sumSquares = 0.0f;
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        smallest[i] = (key[i] & 0x7fffu) * (2.0f * COMPRESSED_ROTATION_MAX / COMPRESSED_ROTATION_RANGE) - COMPRESSED_ROTATION_MAX;
+        sumSquares += smallest[i] * smallest[i];
+    }
+
+    float components[4];
+    for (unsigned i = 0, j = 0; i < 4; ++i)
+        components[i] = i == largest ? sqrtf(Max(1.0f - sumSquares, 0.0f)) : smallest[j++];
+    return Quaternion(components[0], components[1], components[2], components[3]);
+}
+
+unsigned CompressedAnimationChannel::GetKeyIndex(float time, unsigned index) const
+{
+    const unsigned numKeys = times_.size();
+    if (index >= numKeys)
+        index = numKeys ? numKeys - 1 : 0;
+
+    // Check for being too far ahead
+    while (index && time < times_[index])
+        --index;
+
+    // Check for being too far behind
+    while (index + 1 < numKeys && time >= times_[index + 1])
+        ++index;
+
+    return index;
+}
+
 void AnimationTrack::SetKeyFrame(unsigned index, const AnimationKeyFrame& keyFrame)
 {
     if (index < keyFrames_.size())
@@ -112,6 +416,36 @@ bool AnimationTrack::GetKeyFrameIndex(float time, unsigned& index) const
     return true;
 }
 
+void AnimationTrack::Compress(float length, const AnimationCompressionSettings& settings)
+{
+    // Quantize key times. Keys sharing a time are kept, as they define a discontinuity
+    ea::vector<unsigned short> times;
+    ea::vector<Vector3> positions;
+    ea::vector<Quaternion> rotations;
+    ea::vector<Vector3> scales;
+    for (const AnimationKeyFrame& keyFrame : keyFrames_)
+    {
+        const unsigned short time = QuantizeTime(keyFrame.time_, length);
+        if (!times.empty() && time < times.back())
+            continue;
+
+        times.push_back(time);
+        positions.push_back(keyFrame.position_);
+        rotations.push_back(keyFrame.rotation_);
+        scales.push_back(keyFrame.scale_);
+    }
+
+    if (channelMask_ & CHANNEL_POSITION)
+        CompressVectorChannel(compressedPosition_, times, positions, settings.positionTolerance_);
+    if (channelMask_ & CHANNEL_ROTATION)
+        CompressRotationChannel(compressedRotation_, times, rotations, settings.rotationTolerance_);
+    if (channelMask_ & CHANNEL_SCALE)
+        CompressVectorChannel(compressedScale_, times, scales, settings.scaleTolerance_);
+
+    ea::vector<AnimationKeyFrame>().swap(keyFrames_);
+    compressed_ = true;
+}
+
 Animation::Animation(Context* context) :
     ResourceWithMetadata(context),
     length_(0.f)
@@ -127,10 +461,10 @@ void Animation::RegisterObject(Context* context)
 
 bool Animation::BeginLoad(Deserializer& source)
 {
-    unsigned memoryUse = sizeof(Animation);
-
     // Check ID
-    if (source.ReadFileID() != "UANI")
+    const ea::string fileID = source.ReadFileID();
+    const bool compressedFormat = fileID == "UANC";
+    if (fileID != "UANI" && !compressedFormat)
     {
         URHO3D_LOGERROR(source.GetName() + " is not a valid animation file");
         return false;
@@ -143,7 +477,6 @@ bool Animation::BeginLoad(Deserializer& source)
     tracks_.clear();
 
     unsigned tracks = source.ReadUInt();
-    memoryUse += tracks * sizeof(AnimationTrack);
 
     // Read tracks
     for (unsigned i = 0; i < tracks; ++i)
@@ -151,9 +484,20 @@ bool Animation::BeginLoad(Deserializer& source)
         AnimationTrack* newTrack = CreateTrack(source.ReadString());
         newTrack->channelMask_ = AnimationChannelFlags(source.ReadUByte());
 
+        if (compressedFormat && source.ReadBool())
+        {
+            newTrack->compressed_ = true;
+            if (newTrack->channelMask_ & CHANNEL_POSITION)
+                ReadCompressedChannel(source, newTrack->compressedPosition_, true);
+            if (newTrack->channelMask_ & CHANNEL_ROTATION)
+                ReadCompressedChannel(source, newTrack->compressedRotation_, false);
+            if (newTrack->channelMask_ & CHANNEL_SCALE)
+                ReadCompressedChannel(source, newTrack->compressedScale_, true);
+            continue;
+        }
+
         unsigned keyFrames = source.ReadUInt();
         newTrack->keyFrames_.resize(keyFrames);
-        memoryUse += keyFrames * sizeof(AnimationKeyFrame);
 
         // Read keyframes of the track
         for (unsigned j = 0; j < keyFrames; ++j)
@@ -187,8 +531,7 @@ bool Animation::BeginLoad(Deserializer& source)
 
         LoadMetadataFromXML(rootElem);
 
-        memoryUse += triggers_.size() * sizeof(AnimationTriggerPoint);
-        SetMemoryUse(memoryUse);
+        UpdateMemoryUse();
         return true;
     }
 
@@ -218,19 +561,19 @@ bool Animation::BeginLoad(Deserializer& source)
         const JSONArray& metadataArray = rootVal.Get("metadata").GetArray();
         LoadMetadataFromJSON(metadataArray);
 
-        memoryUse += triggers_.size() * sizeof(AnimationTriggerPoint);
-        SetMemoryUse(memoryUse);
+        UpdateMemoryUse();
         return true;
     }
 
-    SetMemoryUse(memoryUse);
+    UpdateMemoryUse();
     return true;
 }
 
 bool Animation::Save(Serializer& dest) const
 {
     // Write ID, name and length
-    dest.WriteFileID("UANI");
+    const bool compressedFormat = IsCompressed();
+    dest.WriteFileID(compressedFormat ? "UANC" : "UANI");
     dest.WriteString(animationName_);
     dest.WriteFloat(length_);
 
@@ -241,6 +584,22 @@ bool Animation::Save(Serializer& dest) const
         const AnimationTrack& track = i->second;
         dest.WriteString(track.name_);
         dest.WriteUByte(track.channelMask_);
+
+        if (compressedFormat)
+        {
+            dest.WriteBool(track.compressed_);
+            if (track.compressed_)
+            {
+                if (track.channelMask_ & CHANNEL_POSITION)
+                    WriteCompressedChannel(dest, track.compressedPosition_, true);
+                if (track.channelMask_ & CHANNEL_ROTATION)
+                    WriteCompressedChannel(dest, track.compressedRotation_, false);
+                if (track.channelMask_ & CHANNEL_SCALE)
+                    WriteCompressedChannel(dest, track.compressedScale_, true);
+                continue;
+            }
+        }
+
         dest.WriteUInt(track.keyFrames_.size());
 
         // Write keyframes of the track
@@ -372,6 +731,28 @@ void Animation::SetNumTriggers(unsigned num)
     triggers_.resize(num);
 }
 
+void Animation::Compress(const AnimationCompressionSettings& settings)
+{
+    for (auto i = tracks_.begin(); i != tracks_.end(); ++i)
+    {
+        if (!i->second.compressed_)
+            i->second.Compress(length_, settings);
+    }
+
+    UpdateMemoryUse();
+}
+
+bool Animation::IsCompressed() const
+{
+    for (auto i = tracks_.begin(); i != tracks_.end(); ++i)
+    {
+        if (i->second.compressed_)
+            return true;
+    }
+
+    return false;
+}
+
 SharedPtr<Animation> Animation::Clone(const ea::string& cloneName) const
 {
     SharedPtr<Animation> ret(context_->CreateObject<Animation>());
@@ -431,4 +812,18 @@ void Animation::SetTracks(const ea::vector<AnimationTrack>& tracks)
     }
 }
 
+void Animation::UpdateMemoryUse()
+{
+    unsigned memoryUse = sizeof(Animation);
+    for (auto i = tracks_.begin(); i != tracks_.end(); ++i)
+    {
+        const AnimationTrack& track = i->second;
+        memoryUse += sizeof(AnimationTrack) + track.keyFrames_.size() * sizeof(AnimationKeyFrame);
+        memoryUse += track.compressedPosition_.GetMemoryUse() + track.compressedRotation_.GetMemoryUse() +
+            track.compressedScale_.GetMemoryUse();
+    }
+    memoryUse += triggers_.size() * sizeof(AnimationTriggerPoint);
+    SetMemoryUse(memoryUse);
+}
+
 }
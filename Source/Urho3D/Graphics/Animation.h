@@ -42,6 +42,50 @@ enum AnimationChannel : unsigned char
 };
 URHO3D_FLAGSET(AnimationChannel, AnimationChannelFlags);
 
+/// Number of quantization steps of compressed key times over the animation length.
+static const unsigned COMPRESSED_TIME_RANGE = 65535;
+/// Number of quantization steps of compressed position and scale components.
+static const unsigned COMPRESSED_VECTOR_RANGE = 65535;
+/// Number of quantization steps of the three smallest compressed rotation components.
+static const unsigned COMPRESSED_ROTATION_RANGE = 32767;
+/// Largest absolute value of the three smallest components of a normalized quaternion.
+static const float COMPRESSED_ROTATION_MAX = 0.707106781f;
+
+/// %Animation compression settings. Keys that can be linearly interpolated from their neighbours within the tolerances are removed.
+struct AnimationCompressionSettings
+{
+    /// Maximum position error.
+    float positionTolerance_{ 0.0005f };
+    /// Maximum rotation error in degrees.
+    float rotationTolerance_{ 0.05f };
+    /// Maximum scale error.
+    float scaleTolerance_{ 0.0005f };
+};
+
+/// Quantized and key-reduced data of a single animation track channel.
+struct URHO3D_API CompressedAnimationChannel
+{
+    /// Return number of keys.
+    unsigned GetNumKeys() const { return times_.size(); }
+    /// Return decoded position or scale key.
+    Vector3 GetVector(unsigned index) const;
+    /// Return decoded rotation key.
+    Quaternion GetRotation(unsigned index) const;
+    /// Return key index based on quantized time and previous index.
+    unsigned GetKeyIndex(float time, unsigned index) const;
+    /// Return memory use in bytes.
+    unsigned GetMemoryUse() const { return (times_.size() + values_.size()) * sizeof(unsigned short); }
+
+    /// Key times quantized over the animation length.
+    ea::vector<unsigned short> times_;
+    /// Quantized values, three per key. Rotations store the three smallest components, with the index of the largest one in the top bits of the first two.
+    ea::vector<unsigned short> values_;
+    /// Value of the lowest quantization step (position and scale only).
+    Vector3 offset_;
+    /// Size of a quantization step (position and scale only).
+    Vector3 step_;
+};
+
 /// Skeletal animation keyframe.
 struct AnimationKeyFrame
 {
@@ -99,6 +143,11 @@ struct URHO3D_API AnimationTrack
     unsigned GetNumKeyFrames() const { return keyFrames_.size(); }
     /// Return keyframe index based on time and previous index. Return false if animation is empty.
     bool GetKeyFrameIndex(float time, unsigned& index) const;
+    /// Quantize and key-reduce the keyframes, then release them. Only the compressed channels are used for playback afterwards.
+    void Compress(float length, const AnimationCompressionSettings& settings);
+
+    /// Return whether the track is compressed.
+    bool IsCompressed() const { return compressed_; }
 
     /// Bone or scene node name.
     ea::string name_;
@@ -108,6 +157,14 @@ struct URHO3D_API AnimationTrack
     AnimationChannelFlags channelMask_{};
     /// Keyframes.
     ea::vector<AnimationKeyFrame> keyFrames_;
+    /// Compressed flag.
+    bool compressed_{};
+    /// Compressed position channel.
+    CompressedAnimationChannel compressedPosition_;
+    /// Compressed rotation channel.
+    CompressedAnimationChannel compressedRotation_;
+    /// Compressed scale channel.
+    CompressedAnimationChannel compressedScale_;
 
     /// Instance equality operator.
     bool operator ==(const AnimationTrack& rhs) const
@@ -189,6 +246,8 @@ public:
     void RemoveAllTriggers();
     /// Resize trigger point vector.
     void SetNumTriggers(unsigned num);
+    /// Compress all tracks. Keyframes are released and the animation is saved in compressed format afterwards. This is unsafe if the animation is currently used in playback.
+    void Compress(const AnimationCompressionSettings& settings = AnimationCompressionSettings());
     /// Clone the animation.
     SharedPtr<Animation> Clone(const ea::string& cloneName = EMPTY_STRING) const;
 
@@ -201,6 +260,9 @@ public:
     /// Return animation length.
     float GetLength() const { return length_; }
 
+    /// Return whether any track is compressed.
+    bool IsCompressed() const;
+
     /// Return all animation tracks.
     const ea::unordered_map<StringHash, AnimationTrack>& GetTracks() const { return tracks_; }
 
@@ -227,6 +289,9 @@ public:
     /// Set all animation tracks.
     void SetTracks(const ea::vector<AnimationTrack>& tracks);
 private:
+    /// Recalculate memory use from tracks and triggers.
+    void UpdateMemoryUse();
+
     /// Animation name.
     ea::string animationName_;
     /// Animation name hash.
@@ -0,0 +1,354 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Graphics/Animation.h"
+#include "../Graphics/AnimationSampler.h"
+
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Streams of gathered keys.
+enum SamplerStream
+{
+    STREAM_KEY = 0,
+    STREAM_NEXT_KEY = 3,
+    STREAM_FACTOR = 6,
+    STREAM_OFFSET = 7,
+    STREAM_STEP = 10,
+    NUM_STREAMS = 13
+};
+
+/// Channel indices.
+enum SamplerChannel
+{
+    POSITION_INDEX = 0,
+    ROTATION_INDEX,
+    SCALE_INDEX
+};
+
+/// Return compressed channel of track by index.
+const CompressedAnimationChannel& GetChannel(const AnimationTrack& track, unsigned channelIndex)
+{
+    switch (channelIndex)
+    {
+    case POSITION_INDEX: return track.compressedPosition_;
+    case ROTATION_INDEX: return track.compressedRotation_;
+    default: return track.compressedScale_;
+    }
+}
+
+/// Find the keys to interpolate between at quantized time and the interpolation factor.
+void FindKeys(const CompressedAnimationChannel& channel, float time, bool looped, unsigned& key, unsigned& nextKey, float& factor)
+{
+    const unsigned numKeys = channel.GetNumKeys();
+    key = channel.GetKeyIndex(time, key);
+    nextKey = key + 1;
+    factor = 0.0f;
+
+    // Check if next key to interpolate to is valid, or if wrapping is needed (looping animation only)
+    float interval;
+    if (nextKey >= numKeys)
+    {
+        if (!looped || numKeys == 1)
+        {
+            nextKey = key;
+            return;
+        }
+
+        nextKey = 0;
+        interval = static_cast<float>(COMPRESSED_TIME_RANGE - channel.times_[key] + channel.times_[0]);
+    }
+    else
+        interval = static_cast<float>(channel.times_[nextKey] - channel.times_[key]);
+
+    factor = interval > 0.0f ? Clamp((time - channel.times_[key]) / interval, 0.0f, 1.0f) : 1.0f;
+}
+
+/// Decode and normalized-lerp a single rotation from the streams.
+Quaternion InterpolateRotation(const float* key, const float* nextKey, int largest, int nextLargest, float factor)
+{
+    const auto decode = [](const float* smallest, int largest)
+    {
+        float values[3];
+        float sumSquares = 0.0f;
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            values[i] = smallest[i] * (2.0f * COMPRESSED_ROTATION_MAX / COMPRESSED_ROTATION_RANGE) - COMPRESSED_ROTATION_MAX;
+            sumSquares += values[i] * values[i];
+        }
+
+        float components[4];
+        for (int i = 0, j = 0; i < 4; ++i)
+            components[i] = i == largest ? sqrtf(Max(1.0f - sumSquares, 0.0f)) : values[j++];
+        return Quaternion(components[0], components[1], components[2], components[3]);
+    };
+
+    return decode(key, largest).Nlerp(decode(nextKey, nextLargest), factor, true);
+}
+
+#ifdef URHO3D_SSE
+/// Select lhs where mask is set and rhs elsewhere.
+inline __m128 Select(__m128 mask, __m128 lhs, __m128 rhs)
+{
+    return _mm_or_ps(_mm_and_ps(mask, lhs), _mm_andnot_ps(mask, rhs));
+}
+
+/// Decode four rotations from their three smallest components and the index of the largest one.
+inline void DecodeRotations(const float* a, const float* b, const float* c, const int* largest, __m128* result)
+{
+    const __m128 scale = _mm_set1_ps(2.0f * COMPRESSED_ROTATION_MAX / COMPRESSED_ROTATION_RANGE);
+    const __m128 bias = _mm_set1_ps(COMPRESSED_ROTATION_MAX);
+    const __m128 x = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(a), scale), bias);
+    const __m128 y = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(b), scale), bias);
+    const __m128 z = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(c), scale), bias);
+
+    const __m128 sumSquares = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+    const __m128 w = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(1.0f), sumSquares), _mm_setzero_ps()));
+
+    const __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(largest));
+    const __m128 is0 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(0)));
+    const __m128 is1 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(1)));
+    const __m128 is2 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(2)));
+    const __m128 is3 = _mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(3)));
+
+    // Components before the largest one are stored in order, the ones after it are shifted down by one
+    result[0] = Select(is0, w, x);
+    result[1] = Select(is1, w, Select(_mm_or_ps(is2, is3), y, x));
+    result[2] = Select(is2, w, Select(is3, z, y));
+    result[3] = Select(is3, w, z);
+}
+#endif
+
+}
+
+void AnimationSampler::SetTracks(const ea::vector<const AnimationTrack*>& tracks)
+{
+    static const AnimationChannel channels[] = { CHANNEL_POSITION, CHANNEL_ROTATION, CHANNEL_SCALE };
+
+    numTracks_ = tracks.size();
+    positions_.clear();
+    positions_.resize(numTracks_, Vector3::ZERO);
+    rotations_.clear();
+    rotations_.resize(numTracks_, Quaternion::IDENTITY);
+    scales_.clear();
+    scales_.resize(numTracks_, Vector3::ONE);
+
+    for (unsigned channelIndex = 0; channelIndex < 3; ++channelIndex)
+    {
+        lanes_[channelIndex].clear();
+        for (unsigned i = 0; i < numTracks_; ++i)
+        {
+            const AnimationTrack* track = tracks[i];
+            if (!track || !track->compressed_ || !(track->channelMask_ & channels[channelIndex]))
+                continue;
+
+            // Constant channels do not need to be sampled again
+            const CompressedAnimationChannel& channel = GetChannel(*track, channelIndex);
+            if (channel.GetNumKeys() > 1)
+                lanes_[channelIndex].push_back(Lane{ i, &channel, 0 });
+            else if (channel.GetNumKeys() == 1)
+            {
+                if (channelIndex == POSITION_INDEX)
+                    positions_[i] = channel.GetVector(0);
+                else if (channelIndex == ROTATION_INDEX)
+                    rotations_[i] = channel.GetRotation(0);
+                else
+                    scales_[i] = channel.GetVector(0);
+            }
+        }
+    }
+}
+
+void AnimationSampler::Sample(float time, float length, bool looped)
+{
+    const float keyTime = length > 0.0f ? time / length * COMPRESSED_TIME_RANGE : 0.0f;
+    SampleVectorChannel(POSITION_INDEX, keyTime, looped, positions_);
+    SampleRotationChannel(keyTime, looped);
+    SampleVectorChannel(SCALE_INDEX, keyTime, looped, scales_);
+}
+
+unsigned AnimationSampler::GatherKeys(unsigned channelIndex, float time, bool looped)
+{
+    ea::vector<Lane>& lanes = lanes_[channelIndex];
+    const unsigned numLanes = lanes.size();
+    const bool isRotation = channelIndex == ROTATION_INDEX;
+    streams_.resize(numLanes * NUM_STREAMS);
+    largestComponents_.resize(isRotation ? numLanes * 2 : 0);
+
+    float* streams = streams_.data();
+    for (unsigned lane = 0; lane < numLanes; ++lane)
+    {
+        const CompressedAnimationChannel& channel = *lanes[lane].channel_;
+        unsigned& key = lanes[lane].key_;
+        unsigned nextKey;
+        float factor;
+        FindKeys(channel, time, looped, key, nextKey, factor);
+
+        const unsigned short* keyValue = &channel.values_[key * 3];
+        const unsigned short* nextKeyValue = &channel.values_[nextKey * 3];
+        const unsigned short mask = isRotation ? 0x7fffu : 0xffffu;
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            streams[(STREAM_KEY + i) * numLanes + lane] = keyValue[i] & mask;
+            streams[(STREAM_NEXT_KEY + i) * numLanes + lane] = nextKeyValue[i] & mask;
+        }
+        streams[STREAM_FACTOR * numLanes + lane] = factor;
+
+        if (isRotation)
+        {
+            largestComponents_[lane] = (keyValue[0] >> 15u) | ((keyValue[1] >> 15u) << 1u);
+            largestComponents_[numLanes + lane] = (nextKeyValue[0] >> 15u) | ((nextKeyValue[1] >> 15u) << 1u);
+        }
+        else
+        {
+            for (unsigned i = 0; i < 3; ++i)
+            {
+                streams[(STREAM_OFFSET + i) * numLanes + lane] = channel.offset_.Data()[i];
+                streams[(STREAM_STEP + i) * numLanes + lane] = channel.step_.Data()[i];
+            }
+        }
+    }
+
+    return numLanes;
+}
+
+void AnimationSampler::SampleVectorChannel(unsigned channelIndex, float time, bool looped, ea::vector<Vector3>& dest)
+{
+    const unsigned numLanes = GatherKeys(channelIndex, time, looped);
+    const ea::vector<Lane>& lanes = lanes_[channelIndex];
+    const float* streams = streams_.data();
+    const float* keys[3];
+    const float* nextKeys[3];
+    const float* offsets[3];
+    const float* steps[3];
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        keys[i] = streams + (STREAM_KEY + i) * numLanes;
+        nextKeys[i] = streams + (STREAM_NEXT_KEY + i) * numLanes;
+        offsets[i] = streams + (STREAM_OFFSET + i) * numLanes;
+        steps[i] = streams + (STREAM_STEP + i) * numLanes;
+    }
+    const float* factors = streams + STREAM_FACTOR * numLanes;
+
+    // Interpolate in quantized space, then dequantize
+    unsigned lane = 0;
+#ifdef URHO3D_SSE
+    for (; lane + 4 <= numLanes; lane += 4)
+    {
+        const __m128 factor = _mm_loadu_ps(factors + lane);
+        float result[3][4];
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            const __m128 key = _mm_loadu_ps(keys[i] + lane);
+            const __m128 nextKey = _mm_loadu_ps(nextKeys[i] + lane);
+            const __m128 value = _mm_add_ps(key, _mm_mul_ps(_mm_sub_ps(nextKey, key), factor));
+            _mm_storeu_ps(result[i], _mm_add_ps(_mm_loadu_ps(offsets[i] + lane), _mm_mul_ps(value, _mm_loadu_ps(steps[i] + lane))));
+        }
+
+        for (unsigned j = 0; j < 4; ++j)
+            dest[lanes[lane + j].track_] = Vector3(result[0][j], result[1][j], result[2][j]);
+    }
+#endif
+    for (; lane < numLanes; ++lane)
+    {
+        float result[3];
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            const float value = Lerp(keys[i][lane], nextKeys[i][lane], factors[lane]);
+            result[i] = offsets[i][lane] + value * steps[i][lane];
+        }
+        dest[lanes[lane].track_] = Vector3(result);
+    }
+}
+
+void AnimationSampler::SampleRotationChannel(float time, bool looped)
+{
+    const unsigned numLanes = GatherKeys(ROTATION_INDEX, time, looped);
+    const ea::vector<Lane>& lanes = lanes_[ROTATION_INDEX];
+    const float* streams = streams_.data();
+    const float* keys[3];
+    const float* nextKeys[3];
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        keys[i] = streams + (STREAM_KEY + i) * numLanes;
+        nextKeys[i] = streams + (STREAM_NEXT_KEY + i) * numLanes;
+    }
+    const float* factors = streams + STREAM_FACTOR * numLanes;
+    const int* largest = largestComponents_.data();
+    const int* nextLargest = largest + numLanes;
+
+    unsigned lane = 0;
+#ifdef URHO3D_SSE
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    for (; lane + 4 <= numLanes; lane += 4)
+    {
+        __m128 key[4];
+        __m128 nextKey[4];
+        DecodeRotations(keys[0] + lane, keys[1] + lane, keys[2] + lane, largest + lane, key);
+        DecodeRotations(nextKeys[0] + lane, nextKeys[1] + lane, nextKeys[2] + lane, nextLargest + lane, nextKey);
+
+        // Take the shortest path by flipping the next key if the rotations are in opposite hemispheres
+        __m128 dot = _mm_mul_ps(key[0], nextKey[0]);
+        for (unsigned i = 1; i < 4; ++i)
+            dot = _mm_add_ps(dot, _mm_mul_ps(key[i], nextKey[i]));
+        const __m128 sign = _mm_and_ps(dot, signMask);
+
+        const __m128 factor = _mm_loadu_ps(factors + lane);
+        __m128 result[4];
+        __m128 lengthSquared = _mm_setzero_ps();
+        for (unsigned i = 0; i < 4; ++i)
+        {
+            const __m128 next = _mm_xor_ps(nextKey[i], sign);
+            result[i] = _mm_add_ps(key[i], _mm_mul_ps(_mm_sub_ps(next, key[i]), factor));
+            lengthSquared = _mm_add_ps(lengthSquared, _mm_mul_ps(result[i], result[i]));
+        }
+
+        const __m128 invLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(lengthSquared));
+        float components[4][4];
+        for (unsigned i = 0; i < 4; ++i)
+            _mm_storeu_ps(components[i], _mm_mul_ps(result[i], invLength));
+
+        for (unsigned j = 0; j < 4; ++j)
+            rotations_[lanes[lane + j].track_] = Quaternion(components[0][j], components[1][j], components[2][j], components[3][j]);
+    }
+#endif
+    for (; lane < numLanes; ++lane)
+    {
+        const float key[3] = { keys[0][lane], keys[1][lane], keys[2][lane] };
+        const float nextKey[3] = { nextKeys[0][lane], nextKeys[1][lane], nextKeys[2][lane] };
+        rotations_[lanes[lane].track_] = InterpolateRotation(key, nextKey, largest[lane], nextLargest[lane], factors[lane]);
+    }
+}
+
+}
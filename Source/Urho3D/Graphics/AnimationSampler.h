@@ -0,0 +1,92 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Math/Quaternion.h"
+#include "../Math/Vector3.h"
+
+#include <EASTL/vector.h>
+
+namespace Urho3D
+{
+
+struct AnimationTrack;
+struct CompressedAnimationChannel;
+
+/// Samples the compressed tracks of an animation for a whole skeleton at once. Keys are looked up per track, then decoded and interpolated for four tracks at a time using SIMD.
+class URHO3D_API AnimationSampler
+{
+public:
+    /// Set tracks to sample. Null and uncompressed tracks are skipped. Constant channels are decoded immediately.
+    void SetTracks(const ea::vector<const AnimationTrack*>& tracks);
+    /// Sample all compressed tracks at time.
+    void Sample(float time, float length, bool looped);
+
+    /// Return number of tracks.
+    unsigned GetNumTracks() const { return numTracks_; }
+    /// Return sampled position of track.
+    const Vector3& GetPosition(unsigned index) const { return positions_[index]; }
+    /// Return sampled rotation of track.
+    const Quaternion& GetRotation(unsigned index) const { return rotations_[index]; }
+    /// Return sampled scale of track.
+    const Vector3& GetScale(unsigned index) const { return scales_[index]; }
+
+private:
+    /// Animated channel of a track.
+    struct Lane
+    {
+        /// Track index.
+        unsigned track_;
+        /// Channel.
+        const CompressedAnimationChannel* channel_;
+        /// Last key index.
+        unsigned key_;
+    };
+
+    /// Gather keys of a channel into the streams. Return number of gathered tracks.
+    unsigned GatherKeys(unsigned channelIndex, float time, bool looped);
+    /// Interpolate position or scale channel of all tracks.
+    void SampleVectorChannel(unsigned channelIndex, float time, bool looped, ea::vector<Vector3>& dest);
+    /// Interpolate rotation channel of all tracks.
+    void SampleRotationChannel(float time, bool looped);
+
+    /// Number of tracks.
+    unsigned numTracks_{};
+    /// Animated position, rotation and scale channels.
+    ea::vector<Lane> lanes_[3];
+    /// Gathered keys and interpolation factors, one stream per value.
+    ea::vector<float> streams_;
+    /// Gathered indices of the largest rotation components.
+    ea::vector<int> largestComponents_;
+    /// Sampled positions.
+    ea::vector<Vector3> positions_;
+    /// Sampled rotations.
+    ea::vector<Quaternion> rotations_;
+    /// Sampled scales.
+    ea::vector<Vector3> scales_;
+};
+
+}
@@ -74,6 +74,7 @@ AnimationState::AnimationState(Node* node, Animation* animation) :
         {
             const ea::unordered_map<StringHash, AnimationTrack>& tracks = animation_->GetTracks();
             stateTracks_.clear();
+            samplerDirty_ = true;
 
             for (auto i = tracks.begin(); i !=
                 tracks.end(); ++i)
@@ -125,6 +126,7 @@ void AnimationState::SetStartBone(Bone* startBone)
 
     const ea::unordered_map<StringHash, AnimationTrack>& tracks = animation_->GetTracks();
     stateTracks_.clear();
+    samplerDirty_ = true;
 
     if (!startBone->node_)
         return;
@@ -455,81 +457,116 @@ void AnimationState::Apply()
 
 void AnimationState::ApplyToModel()
 {
-    for (auto i = stateTracks_.begin(); i != stateTracks_.end(); ++i)
+    SampleCompressedTracks();
+
+    for (unsigned i = 0; i < stateTracks_.size(); ++i)
     {
-        AnimationStateTrack& stateTrack = *i;
+        AnimationStateTrack& stateTrack = stateTracks_[i];
         float finalWeight = weight_ * stateTrack.weight_;
 
         // Do not apply if zero effective weight or the bone has animation disabled
         if (Equals(finalWeight, 0.0f) || !stateTrack.bone_->animated_)
             continue;
 
-        ApplyTrack(stateTrack, finalWeight, true);
+        ApplyTrack(stateTrack, i, finalWeight, true);
     }
 }
 
 void AnimationState::ApplyToNodes()
 {
+    SampleCompressedTracks();
+
     // When applying to a node hierarchy, can only use full weight (nothing to blend to)
-    for (auto i = stateTracks_.begin(); i != stateTracks_.end(); ++i)
-        ApplyTrack(*i, 1.0f, false);
+    for (unsigned i = 0; i < stateTracks_.size(); ++i)
+        ApplyTrack(stateTracks_[i], i, 1.0f, false);
+}
+
+void AnimationState::SampleCompressedTracks()
+{
+    if (samplerDirty_)
+    {
+        ea::vector<const AnimationTrack*> tracks;
+        for (const AnimationStateTrack& stateTrack : stateTracks_)
+            tracks.push_back(stateTrack.track_);
+        sampler_.SetTracks(tracks);
+        samplerDirty_ = false;
+    }
+
+    sampler_.Sample(time_, animation_->GetLength(), looped_);
 }
 
-void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, bool silent)
+void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, unsigned index, float weight, bool silent)
 {
     const AnimationTrack* track = stateTrack.track_;
     Node* node = stateTrack.node_;
 
-    if (track->keyFrames_.empty() || !node)
+    if (!node)
         return;
 
-    unsigned& frame = stateTrack.keyFrame_;
-    track->GetKeyFrameIndex(time_, frame);
-
-    // Check if next frame to interpolate to is valid, or if wrapping is needed (looping animation only)
-    unsigned nextFrame = frame + 1;
-    bool interpolate = true;
-    if (nextFrame >= track->keyFrames_.size())
-    {
-        if (!looped_)
-        {
-            nextFrame = frame;
-            interpolate = false;
-        }
-        else
-            nextFrame = 0;
-    }
-
-    const AnimationKeyFrame* keyFrame = &track->keyFrames_[frame];
     const AnimationChannelFlags channelMask = track->channelMask_;
 
     Vector3 newPosition;
     Quaternion newRotation;
     Vector3 newScale;
 
-    if (interpolate)
+    if (track->compressed_)
     {
-        const AnimationKeyFrame* nextKeyFrame = &track->keyFrames_[nextFrame];
-        float timeInterval = nextKeyFrame->time_ - keyFrame->time_;
-        if (timeInterval < 0.0f)
-            timeInterval += animation_->GetLength();
-        float t = timeInterval > 0.0f ? (time_ - keyFrame->time_) / timeInterval : 1.0f;
+        if (!track->compressedPosition_.GetNumKeys() && !track->compressedRotation_.GetNumKeys() &&
+            !track->compressedScale_.GetNumKeys())
+            return;
 
-        if (channelMask & CHANNEL_POSITION)
-            newPosition = keyFrame->position_.Lerp(nextKeyFrame->position_, t);
-        if (channelMask & CHANNEL_ROTATION)
-            newRotation = keyFrame->rotation_.Slerp(nextKeyFrame->rotation_, t);
-        if (channelMask & CHANNEL_SCALE)
-            newScale = keyFrame->scale_.Lerp(nextKeyFrame->scale_, t);
+        newPosition = sampler_.GetPosition(index);
+        newRotation = sampler_.GetRotation(index);
+        newScale = sampler_.GetScale(index);
     }
     else
     {
-        if (channelMask & CHANNEL_POSITION)
-            newPosition = keyFrame->position_;
-        if (channelMask & CHANNEL_ROTATION)
-            newRotation = keyFrame->rotation_;
-        if (channelMask & CHANNEL_SCALE)
-            newScale = keyFrame->scale_;
+        if (track->keyFrames_.empty())
+            return;
+
+        unsigned& frame = stateTrack.keyFrame_;
+        track->GetKeyFrameIndex(time_, frame);
+
+        // Check if next frame to interpolate to is valid, or if wrapping is needed (looping animation only)
+        unsigned nextFrame = frame + 1;
+        bool interpolate = true;
+        if (nextFrame >= track->keyFrames_.size())
+        {
+            if (!looped_)
+            {
+                nextFrame = frame;
+                interpolate = false;
+            }
+            else
+                nextFrame = 0;
+        }
+
+        const AnimationKeyFrame* keyFrame = &track->keyFrames_[frame];
+
+        if (interpolate)
+        {
+            const AnimationKeyFrame* nextKeyFrame = &track->keyFrames_[nextFrame];
+            float timeInterval = nextKeyFrame->time_ - keyFrame->time_;
+            if (timeInterval < 0.0f)
+                timeInterval += animation_->GetLength();
+            float t = timeInterval > 0.0f ? (time_ - keyFrame->time_) / timeInterval : 1.0f;
+
+            if (channelMask & CHANNEL_POSITION)
+                newPosition = keyFrame->position_.Lerp(nextKeyFrame->position_, t);
+            if (channelMask & CHANNEL_ROTATION)
+                newRotation = keyFrame->rotation_.Slerp(nextKeyFrame->rotation_, t);
+            if (channelMask & CHANNEL_SCALE)
+                newScale = keyFrame->scale_.Lerp(nextKeyFrame->scale_, t);
+        }
+        else
+        {
+            if (channelMask & CHANNEL_POSITION)
+                newPosition = keyFrame->position_;
+            if (channelMask & CHANNEL_ROTATION)
+                newRotation = keyFrame->rotation_;
+            if (channelMask & CHANNEL_SCALE)
+                newScale = keyFrame->scale_;
+        }
     }
 
     if (blendingMode_ == ABM_ADDITIVE) // not ABM_LERP
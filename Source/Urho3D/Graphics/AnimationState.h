@@ -27,6 +27,7 @@
 #include <EASTL/unordered_map.h>
 
 #include "../Container/Ptr.h"
+#include "../Graphics/AnimationSampler.h"
 #include "../Math/StringHash.h"
 
 namespace Urho3D
@@ -167,8 +168,10 @@ private:
     void ApplyToModel();
     /// Apply animation to a scene node hierarchy.
     void ApplyToNodes();
+    /// Sample compressed tracks of all bones at the current time position.
+    void SampleCompressedTracks();
     /// Apply track.
-    void ApplyTrack(AnimationStateTrack& stateTrack, float weight, bool silent);
+    void ApplyTrack(AnimationStateTrack& stateTrack, unsigned index, float weight, bool silent);
 
     /// Animated model (model mode).
     WeakPtr<AnimatedModel> model_;
@@ -180,6 +183,10 @@ private:
     Bone* startBone_;
     /// Per-track data.
     ea::vector<AnimationStateTrack> stateTracks_;
+    /// Batch sampler of compressed tracks.
+    AnimationSampler sampler_;
+    /// Sampler tracks need to be reassigned flag.
+    bool samplerDirty_{ true };
     /// Looped flag.
     bool looped_;
     /// Blending weight.
@@ -25,6 +25,7 @@
 #include <EASTL/sort.h>
 
 #include "../Core/Context.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/Camera.h"
 #include "../Graphics/Geometry.h"
 #include "../Graphics/Graphics.h"
@@ -43,44 +44,119 @@
 namespace Urho3D
 {
 
-inline bool CompareBatchesState(const Batch* lhs, const Batch* rhs)
-{
-    if (lhs->renderOrder_ != rhs->renderOrder_)
-        return lhs->renderOrder_ < rhs->renderOrder_;
-    else if (lhs->sortKey_ != rhs->sortKey_)
-        return lhs->sortKey_ < rhs->sortKey_;
-    else
-        return lhs->distance_ < rhs->distance_;
-}
+/// Minimum number of draw calls per thread for sorting in parallel.
+static const unsigned MIN_PARALLEL_SORT_ITEMS = 16384;
 
-inline bool CompareBatchesFrontToBack(const Batch* lhs, const Batch* rhs)
+inline bool CompareInstancesFrontToBack(const InstanceData& lhs, const InstanceData& rhs)
 {
-    if (lhs->renderOrder_ != rhs->renderOrder_)
-        return lhs->renderOrder_ < rhs->renderOrder_;
-    else if (lhs->distance_ != rhs->distance_)
-        return lhs->distance_ < rhs->distance_;
-    else
-        return lhs->sortKey_ < rhs->sortKey_;
+    return lhs.distance_ < rhs.distance_;
 }
 
-inline bool CompareBatchesBackToFront(const Batch* lhs, const Batch* rhs)
+/// Return unsigned integer bits that sort in the same order as the float value.
+inline unsigned GetSortableFloatBits(float value)
 {
-    if (lhs->renderOrder_ != rhs->renderOrder_)
-        return lhs->renderOrder_ < rhs->renderOrder_;
-    else if (lhs->distance_ != rhs->distance_)
-        return lhs->distance_ > rhs->distance_;
-    else
-        return lhs->sortKey_ < rhs->sortKey_;
+    unsigned bits;
+    memcpy(&bits, &value, sizeof bits);
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
 }
 
-inline bool CompareInstancesFrontToBack(const InstanceData& lhs, const InstanceData& rhs)
+/// Sort items by the full 64-bit key with a stable LSD radix sort, one byte per pass. Passes over a byte that is equal in all
+/// keys are skipped. Large arrays are split into chunks that are counted and scattered in parallel if a work queue is given.
+static void RadixSort(ea::vector<BatchSortItem>& items, ea::vector<BatchSortItem>& scratch, WorkQueue* workQueue)
 {
-    return lhs.distance_ < rhs.distance_;
+    const unsigned count = items.size();
+    if (count <= 1)
+        return;
+
+    unsigned histograms[8][256] = {};
+    for (const BatchSortItem& item : items)
+    {
+        for (unsigned pass = 0; pass < 8; ++pass)
+            ++histograms[pass][(item.key_ >> (pass * 8)) & 0xffu];
+    }
+
+    const unsigned maxChunks = workQueue ? workQueue->GetNumThreads() + 1 : 1;
+    const unsigned numChunks = Clamp(count / MIN_PARALLEL_SORT_ITEMS, 1u, maxChunks);
+    const unsigned chunkSize = (count + numChunks - 1) / numChunks;
+    ea::vector<unsigned> chunkOffsets;
+
+    scratch.resize(count);
+    BatchSortItem* source = items.data();
+    BatchSortItem* dest = scratch.data();
+
+    for (unsigned pass = 0; pass < 8; ++pass)
+    {
+        const unsigned shift = pass * 8;
+        const unsigned* histogram = histograms[pass];
+        if (histogram[(source[0].key_ >> shift) & 0xffu] == count)
+            continue;
+
+        if (numChunks == 1)
+        {
+            unsigned offsets[256];
+            unsigned offset = 0;
+            for (unsigned digit = 0; digit < 256; ++digit)
+            {
+                offsets[digit] = offset;
+                offset += histogram[digit];
+            }
+
+            for (unsigned i = 0; i < count; ++i)
+                dest[offsets[(source[i].key_ >> shift) & 0xffu]++] = source[i];
+        }
+        else
+        {
+            // Count the digits of each chunk, then assign output ranges in digit-major, chunk-minor order to keep the sort stable
+            chunkOffsets.clear();
+            chunkOffsets.resize(numChunks * 256, 0);
+            workQueue->ParallelFor(numChunks, 1, [&](unsigned fromChunk, unsigned toChunk)
+            {
+                for (unsigned chunk = fromChunk; chunk < toChunk; ++chunk)
+                {
+                    unsigned* chunkHistogram = &chunkOffsets[chunk * 256];
+                    const unsigned end = Min((chunk + 1) * chunkSize, count);
+                    for (unsigned i = chunk * chunkSize; i < end; ++i)
+                        ++chunkHistogram[(source[i].key_ >> shift) & 0xffu];
+                }
+            });
+
+            unsigned offset = 0;
+            for (unsigned digit = 0; digit < 256; ++digit)
+            {
+                for (unsigned chunk = 0; chunk < numChunks; ++chunk)
+                {
+                    const unsigned chunkCount = chunkOffsets[chunk * 256 + digit];
+                    chunkOffsets[chunk * 256 + digit] = offset;
+                    offset += chunkCount;
+                }
+            }
+
+            workQueue->ParallelFor(numChunks, 1, [&](unsigned fromChunk, unsigned toChunk)
+            {
+                for (unsigned chunk = fromChunk; chunk < toChunk; ++chunk)
+                {
+                    unsigned* offsets = &chunkOffsets[chunk * 256];
+                    const unsigned end = Min((chunk + 1) * chunkSize, count);
+                    for (unsigned i = chunk * chunkSize; i < end; ++i)
+                        dest[offsets[(source[i].key_ >> shift) & 0xffu]++] = source[i];
+                }
+            });
+        }
+
+        ea::swap(source, dest);
+    }
+
+    if (source != items.data())
+        items.swap(scratch);
 }
 
-inline bool CompareBatchGroupOrder(const BatchGroup* lhs, const BatchGroup* rhs)
+/// Reorder pointers to the order of sorted items. The item keys are overwritten.
+template <class T> void ApplySortOrder(ea::vector<T>& pointers, ea::vector<BatchSortItem>& items)
 {
-    return lhs->renderOrder_ < rhs->renderOrder_;
+    for (BatchSortItem& item : items)
+        item.key_ = reinterpret_cast<uintptr_t>(pointers[item.index_]);
+    for (unsigned i = 0; i < pointers.size(); ++i)
+        pointers[i] = reinterpret_cast<T>(items[i].key_);
 }
 
 void CalculateShadowMatrix(Matrix4& dest, LightBatchQueue* queue, unsigned split, Renderer* renderer)
@@ -193,11 +269,39 @@ void Batch::CalculateSortKey()
                (((unsigned long long)materialID) << 16u) | geometryID;
 }
 
-void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool allowDepthWrite) const
+bool BatchStateCache::NeedStateUpdate(const Batch& batch, Camera* camera, bool allowDepthWrite)
+{
+    const unsigned lightmapIndex = batch.lightmapScaleOffset_ ? batch.lightmapIndex_ : M_MAX_UNSIGNED;
+    if (valid_ && batch.vertexShader_ == vertexShader_ && batch.pixelShader_ == pixelShader_ && batch.pass_ == pass_ &&
+        batch.material_ == material_ && batch.zone_ == zone_ && batch.lightQueue_ == lightQueue_ && camera == camera_ &&
+        lightmapIndex == lightmapIndex_ && allowDepthWrite == allowDepthWrite_)
+    {
+        ++numStateChangesAvoided_;
+        return false;
+    }
+
+    vertexShader_ = batch.vertexShader_;
+    pixelShader_ = batch.pixelShader_;
+    pass_ = batch.pass_;
+    material_ = batch.material_;
+    zone_ = batch.zone_;
+    lightQueue_ = batch.lightQueue_;
+    camera_ = camera;
+    lightmapIndex_ = lightmapIndex;
+    allowDepthWrite_ = allowDepthWrite;
+    valid_ = true;
+    ++numStateChanges_;
+    return true;
+}
+
+void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool allowDepthWrite, BatchStateCache* stateCache) const
 {
     if (!vertexShader_ || !pixelShader_)
         return;
 
+    // Shaders, render states and textures of consecutive batches with the same state are left as they are
+    const bool setState = !stateCache || stateCache->NeedStateUpdate(*this, camera, allowDepthWrite);
+
     Graphics* graphics = view->GetContext()->GetGraphics();
     Renderer* renderer = view->GetContext()->GetRenderer();
     Node* cameraNode = camera ? camera->GetNode() : nullptr;
@@ -205,10 +309,11 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
     Texture2D* shadowMap = lightQueue_ ? lightQueue_->shadowMap_ : nullptr;
 
     // Set shaders first. The available shader parameters and their register/uniform positions depend on the currently set shaders
-    graphics->SetShaders(vertexShader_, pixelShader_);
+    if (setState)
+        graphics->SetShaders(vertexShader_, pixelShader_);
 
     // Set pass / material-specific renderstates
-    if (pass_ && material_)
+    if (setState && pass_ && material_)
     {
         BlendMode blend = pass_->GetBlendMode();
         // Turn additive blending into subtract if the light is negative
@@ -607,6 +712,10 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
         }
     }
 
+    // The remaining textures and material parameters depend only on the state of the batch
+    if (!setState)
+        return;
+
     // Set zone texture if necessary
 #ifndef GL_ES_VERSION_2_0
     if (zone_ && graphics->HasTextureUnit(TU_ZONE))
@@ -668,11 +777,11 @@ void Batch::Prepare(View* view, Camera* camera, bool setModelTransform, bool all
     }
 }
 
-void Batch::Draw(View* view, Camera* camera, bool allowDepthWrite) const
+void Batch::Draw(View* view, Camera* camera, bool allowDepthWrite, BatchStateCache* stateCache) const
 {
     if (!geometry_->IsEmpty())
     {
-        Prepare(view, camera, true, allowDepthWrite);
+        Prepare(view, camera, true, allowDepthWrite, stateCache);
         geometry_->Draw(view->GetContext()->GetGraphics());
     }
 }
@@ -707,7 +816,7 @@ void BatchGroup::SetInstancingData(void* lockedData, unsigned stride, unsigned&
     freeIndex += instances_.size();
 }
 
-void BatchGroup::Draw(View* view, Camera* camera, bool allowDepthWrite) const
+void BatchGroup::Draw(View* view, Camera* camera, bool allowDepthWrite, BatchStateCache* stateCache) const
 {
     Graphics* graphics = view->GetContext()->GetGraphics();
     Renderer* renderer = view->GetContext()->GetRenderer();
@@ -718,7 +827,7 @@ void BatchGroup::Draw(View* view, Camera* camera, bool allowDepthWrite) const
         VertexBuffer* instanceBuffer = renderer->GetInstancingBuffer();
         if (!instanceBuffer || geometryType_ != GEOM_INSTANCED || startIndex_ == M_MAX_UNSIGNED)
         {
-            Batch::Prepare(view, camera, false, allowDepthWrite);
+            Batch::Prepare(view, camera, false, allowDepthWrite, stateCache);
 
             graphics->SetIndexBuffer(geometry_->GetIndexBuffer());
             graphics->SetVertexBuffers(geometry_->GetVertexBuffers());
@@ -737,7 +846,7 @@ void BatchGroup::Draw(View* view, Camera* camera, bool allowDepthWrite) const
         }
         else
         {
-            Batch::Prepare(view, camera, false, allowDepthWrite);
+            Batch::Prepare(view, camera, false, allowDepthWrite, stateCache);
 
             // Get the geometry vertex buffers, then add the instancing stream buffer
             // Hack: use a const_cast to avoid dynamic allocation of new temp vectors
@@ -762,40 +871,55 @@ unsigned BatchGroupKey::ToHash() const
                       (size_t)material_ / sizeof(Material) + (size_t)geometry_ / sizeof(Geometry)) + renderOrder_;
 }
 
-void BatchQueue::Clear(int maxSortedInstances)
+void BatchQueue::Clear(int maxSortedInstances, FrameAllocator* frameAllocator)
 {
     batches_.clear();
     sortedBatches_.clear();
-    batchGroups_.clear();
+    // Release the buckets as well, as they may belong to the previous frame allocator
+    batchGroups_.clear(true);
+    batchGroups_.set_allocator(FrameAllocatorAdapter(frameAllocator));
     maxSortedInstances_ = (unsigned)maxSortedInstances;
 }
 
-void BatchQueue::SortBackToFront()
+void BatchQueue::SortBackToFront(WorkQueue* workQueue)
 {
+    // Sort by render order, then far to near by distance quantized to 24 bits, then by shader and material
+    sortItems_.resize(batches_.size());
     sortedBatches_.resize(batches_.size());
-
     for (unsigned i = 0; i < batches_.size(); ++i)
+    {
+        const Batch& batch = batches_[i];
+        const unsigned long long depth = (~GetSortableFloatBits(batch.distance_)) >> 8u;
+        const unsigned long long state = ((batch.sortKey_ >> 32u) & 0xffff0000u) | ((batch.sortKey_ >> 16u) & 0xffffu);
+        sortItems_[i].key_ = (((unsigned long long)batch.renderOrder_) << 56u) | (depth << 32u) | state;
+        sortItems_[i].index_ = i;
         sortedBatches_[i] = &batches_[i];
+    }
+    RadixSort(sortItems_, sortScratch_, workQueue);
+    ApplySortOrder(sortedBatches_, sortItems_);
 
-    ea::quick_sort(sortedBatches_.begin(), sortedBatches_.end(), CompareBatchesBackToFront);
-
+    sortItems_.resize(batchGroups_.size());
     sortedBatchGroups_.resize(batchGroups_.size());
 
     unsigned index = 0;
     for (auto i = batchGroups_.begin(); i != batchGroups_.end(); ++i)
+    {
+        sortItems_[index].key_ = i->second.renderOrder_;
+        sortItems_[index].index_ = index;
         sortedBatchGroups_[index++] = &i->second;
-
-    ea::quick_sort(sortedBatchGroups_.begin(), sortedBatchGroups_.end(), CompareBatchGroupOrder);
+    }
+    RadixSort(sortItems_, sortScratch_, nullptr);
+    ApplySortOrder(sortedBatchGroups_, sortItems_);
 }
 
-void BatchQueue::SortFrontToBack()
+void BatchQueue::SortFrontToBack(WorkQueue* workQueue)
 {
     sortedBatches_.clear();
 
     for (unsigned i = 0; i < batches_.size(); ++i)
         sortedBatches_.push_back(&batches_[i]);
 
-    SortFrontToBack2Pass(sortedBatches_);
+    SortFrontToBack2Pass(sortedBatches_, workQueue);
 
     // Sort each group front to back
     for (auto i = batchGroups_.begin(); i != batchGroups_.end(); ++i)
@@ -826,23 +950,35 @@ void BatchQueue::SortFrontToBack()
     SortFrontToBack2Pass(sortedBatchGroups_);
 }
 
-template <class T> void BatchQueue::SortFrontToBack2Pass(ea::vector<T>& batches)
+template <class T> void BatchQueue::SortFrontToBack2Pass(ea::vector<T>& batches, WorkQueue* workQueue)
 {
+    // The radix sort is stable, so each sort keeps the order of the previous one for equal keys. First sort by distance
+    sortItems_.resize(batches.size());
+    for (unsigned i = 0; i < batches.size(); ++i)
+    {
+        sortItems_[i].key_ = (((unsigned long long)batches[i]->renderOrder_) << 32u) | GetSortableFloatBits(batches[i]->distance_);
+        sortItems_[i].index_ = i;
+    }
+    RadixSort(sortItems_, sortScratch_, workQueue);
+
     // Mobile devices likely use a tiled deferred approach, with which front-to-back sorting is irrelevant. The 2-pass
     // method is also time consuming, so just sort with state having priority
 #ifdef GL_ES_VERSION_2_0
-    ea::quick_sort(batches.begin(), batches.end(), CompareBatchesState);
+    for (BatchSortItem& item : sortItems_)
+        item.key_ = batches[item.index_]->sortKey_;
+    RadixSort(sortItems_, sortScratch_, workQueue);
+    for (BatchSortItem& item : sortItems_)
+        item.key_ = batches[item.index_]->renderOrder_;
+    RadixSort(sortItems_, sortScratch_, workQueue);
 #else
-    // For desktop, first sort by distance and remap shader/material/geometry IDs in the sort key
-    ea::quick_sort(batches.begin(), batches.end(), CompareBatchesFrontToBack);
-
+    // For desktop, remap shader/material/geometry IDs in the sort key in the order of distance
     unsigned freeShaderID = 0;
-    unsigned short freeMaterialID = 0;
-    unsigned short freeGeometryID = 0;
+    unsigned freeMaterialID = 0;
+    unsigned freeGeometryID = 0;
 
-    for (auto i = batches.begin(); i != batches.end(); ++i)
+    for (auto i = sortItems_.begin(); i != sortItems_.end(); ++i)
     {
-        Batch* batch = *i;
+        Batch* batch = batches[i->index_];
 
         auto shaderID = (unsigned)(batch->sortKey_ >> 32u);
         auto j = shaderRemapping_.find(shaderID);
@@ -854,7 +990,7 @@ template <class T> void BatchQueue::SortFrontToBack2Pass(ea::vector<T>& batches)
             ++freeShaderID;
         }
 
-        auto materialID = (unsigned short)((batch->sortKey_ & 0xffff0000) >> 16u);
+        auto materialID = (unsigned)((batch->sortKey_ & 0xffff0000) >> 16u);
         auto k = materialRemapping_.find(materialID);
         if (k != materialRemapping_.end())
             materialID = k->second;
@@ -864,7 +1000,7 @@ template <class T> void BatchQueue::SortFrontToBack2Pass(ea::vector<T>& batches)
             ++freeMaterialID;
         }
 
-        auto geometryID = (unsigned short)(batch->sortKey_ & 0xffffu);
+        auto geometryID = (unsigned)(batch->sortKey_ & 0xffffu);
         auto l = geometryRemapping_.find(geometryID);
         if (l != geometryRemapping_.end())
             geometryID = l->second;
@@ -874,7 +1010,12 @@ template <class T> void BatchQueue::SortFrontToBack2Pass(ea::vector<T>& batches)
             ++freeGeometryID;
         }
 
-        batch->sortKey_ = (((unsigned long long)shaderID) << 32u) | (((unsigned long long)materialID) << 16u) | geometryID;
+        // Pack render order, base flag and the remapped IDs into 8, 1, 17, 19 and 19 bits. IDs that do not fit are clamped
+        const unsigned long long baseFlag = shaderID >> 31u;
+        batch->sortKey_ = (((unsigned long long)batch->renderOrder_) << 56u) | (baseFlag << 55u) |
+            (((unsigned long long)Min(shaderID & 0x7fffffffu, 0x1ffffu)) << 38u) |
+            (((unsigned long long)Min(materialID, 0x7ffffu)) << 19u) | Min(geometryID, 0x7ffffu);
+        i->key_ = batch->sortKey_;
     }
 
     shaderRemapping_.clear();
@@ -882,8 +1023,10 @@ template <class T> void BatchQueue::SortFrontToBack2Pass(ea::vector<T>& batches)
     geometryRemapping_.clear();
 
     // Finally sort again with the rewritten ID's
-    ea::quick_sort(batches.begin(), batches.end(), CompareBatchesState);
+    RadixSort(sortItems_, sortScratch_, workQueue);
 #endif
+
+    ApplySortOrder(batches, sortItems_);
 }
 
 void BatchQueue::SetInstancingData(void* lockedData, unsigned stride, unsigned& freeIndex)
@@ -907,6 +1050,9 @@ void BatchQueue::Draw(View* view, Camera* camera, bool markToStencil, bool using
             graphics->SetStencilTest(false);
     }
 
+    // Only the batches of this queue change the state in between, so it is safe to skip setting the same state again
+    BatchStateCache stateCache;
+
     // Instanced
     for (auto i = sortedBatchGroups_.begin(); i != sortedBatchGroups_.end(); ++i)
     {
@@ -914,7 +1060,7 @@ void BatchQueue::Draw(View* view, Camera* camera, bool markToStencil, bool using
         if (markToStencil)
             graphics->SetStencilTest(true, CMP_ALWAYS, OP_REF, OP_KEEP, OP_KEEP, group->lightMask_);
 
-        group->Draw(view, camera, allowDepthWrite);
+        group->Draw(view, camera, allowDepthWrite, &stateCache);
     }
     // Non-instanced
     for (auto i = sortedBatches_.begin(); i != sortedBatches_.end(); ++i)
@@ -931,8 +1077,10 @@ void BatchQueue::Draw(View* view, Camera* camera, bool markToStencil, bool using
                 graphics->SetScissorTest(false);
         }
 
-        batch->Draw(view, camera, allowDepthWrite);
+        batch->Draw(view, camera, allowDepthWrite, &stateCache);
     }
+
+    renderer->AddStateChanges(stateCache.numStateChanges_, stateCache.numStateChangesAvoided_);
 }
 
 unsigned BatchQueue::GetNumInstances() const
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Container/FrameAllocator.h"
 #include "../Container/Ptr.h"
 #include "../Graphics/Drawable.h"
 #include "../Graphics/Material.h"
@@ -44,10 +45,13 @@ class Material;
 class Matrix3x4;
 class Pass;
 class ShaderVariation;
+class Technique;
 class Texture2D;
 class VertexBuffer;
 class View;
+class WorkQueue;
 class Zone;
+struct BatchStateCache;
 struct LightBatchQueue;
 
 /// Per-instance shader parameters.
@@ -87,10 +91,10 @@ struct Batch
 
     /// Calculate state sorting key, which consists of base pass flag, light, pass and geometry.
     void CalculateSortKey();
-    /// Prepare for rendering.
-    void Prepare(View* view, Camera* camera, bool setModelTransform, bool allowDepthWrite) const;
+    /// Prepare for rendering. If a state cache is given, shaders, render states, textures and material parameters are only set when they differ from the previous batch.
+    void Prepare(View* view, Camera* camera, bool setModelTransform, bool allowDepthWrite, BatchStateCache* stateCache = nullptr) const;
     /// Prepare and draw.
-    void Draw(View* view, Camera* camera, bool allowDepthWrite) const;
+    void Draw(View* view, Camera* camera, bool allowDepthWrite, BatchStateCache* stateCache = nullptr) const;
 
     /// State sorting key.
     unsigned long long sortKey_{};
@@ -132,6 +136,40 @@ struct Batch
     unsigned lightmapIndex_{};
 };
 
+/// State of the previously prepared batch, to skip setting the same state again for consecutive batches. Does not access Graphics.
+struct URHO3D_API BatchStateCache
+{
+    /// Return whether the shaders, render states, textures or material of a batch differ from the previous batch, and remember them.
+    bool NeedStateUpdate(const Batch& batch, Camera* camera, bool allowDepthWrite);
+    /// Forget the previous batch, for example when other code has changed the rendering state.
+    void Reset() { valid_ = false; }
+
+    /// Vertex shader of the previous batch.
+    ShaderVariation* vertexShader_{};
+    /// Pixel shader of the previous batch.
+    ShaderVariation* pixelShader_{};
+    /// Pass of the previous batch.
+    Pass* pass_{};
+    /// Material of the previous batch.
+    Material* material_{};
+    /// Zone of the previous batch.
+    Zone* zone_{};
+    /// Light queue of the previous batch.
+    LightBatchQueue* lightQueue_{};
+    /// Camera of the previous batch.
+    Camera* camera_{};
+    /// Lightmap index of the previous batch, or M_MAX_UNSIGNED if it was not lightmapped.
+    unsigned lightmapIndex_{};
+    /// Depth write flag of the previous batch.
+    bool allowDepthWrite_{};
+    /// Whether the previous batch is valid.
+    bool valid_{};
+    /// Number of batches that needed their state set.
+    unsigned numStateChanges_{};
+    /// Number of batches that reused the state of the previous batch.
+    unsigned numStateChangesAvoided_{};
+};
+
 /// Data for one geometry instance.
 struct InstanceData
 {
@@ -195,12 +233,14 @@ struct BatchGroup : public Batch
     /// Pre-set the instance data. Buffer must be big enough to hold all data.
     void SetInstancingData(void* lockedData, unsigned stride, unsigned& freeIndex);
     /// Prepare and draw.
-    void Draw(View* view, Camera* camera, bool allowDepthWrite) const;
+    void Draw(View* view, Camera* camera, bool allowDepthWrite, BatchStateCache* stateCache = nullptr) const;
 
     /// Instance data.
-    ea::vector<InstanceData> instances_;
+    ea::vector<InstanceData, FrameAllocatorAdapter> instances_;
     /// Instance stream start index, or M_MAX_UNSIGNED if transforms not pre-set.
     unsigned startIndex_;
+    /// Technique of the batches. Needed to choose instancing shaders when groups collected in worker threads are merged.
+    Technique* technique_{};
 };
 
 /// Instanced draw call grouping key.
@@ -251,18 +291,27 @@ struct BatchGroupKey
     unsigned ToHash() const;
 };
 
+/// Draw call sort key and index for radix sorting.
+struct BatchSortItem
+{
+    /// Sort key.
+    unsigned long long key_;
+    /// Index of the draw call.
+    unsigned index_;
+};
+
 /// Queue that contains both instanced and non-instanced draw calls.
 struct BatchQueue
 {
 public:
-    /// Clear for new frame by clearing all groups and batches.
-    void Clear(int maxSortedInstances);
-    /// Sort non-instanced draw calls back to front.
-    void SortBackToFront();
-    /// Sort instanced and non-instanced draw calls front to back.
-    void SortFrontToBack();
+    /// Clear for new frame by clearing all groups and batches. Batch groups of the new frame are allocated from the frame allocator if specified.
+    void Clear(int maxSortedInstances, FrameAllocator* frameAllocator = nullptr);
+    /// Sort non-instanced draw calls back to front. Large queues are sorted in parallel if a work queue is given.
+    void SortBackToFront(WorkQueue* workQueue = nullptr);
+    /// Sort instanced and non-instanced draw calls front to back. Large queues are sorted in parallel if a work queue is given.
+    void SortFrontToBack(WorkQueue* workQueue = nullptr);
     /// Sort batches front to back while also maintaining state sorting.
-    template <class T> void SortFrontToBack2Pass(ea::vector<T>& batches);
+    template <class T> void SortFrontToBack2Pass(ea::vector<T>& batches, WorkQueue* workQueue = nullptr);
     /// Pre-set instance data of all groups. The vertex buffer must be big enough to hold all data.
     void SetInstancingData(void* lockedData, unsigned stride, unsigned& freeIndex);
     /// Draw.
@@ -274,13 +323,17 @@ public:
     bool IsEmpty() const { return batches_.empty() && batchGroups_.empty(); }
 
     /// Instanced draw calls.
-    ea::unordered_map<BatchGroupKey, BatchGroup> batchGroups_;
+    ea::unordered_map<BatchGroupKey, BatchGroup, ea::hash<BatchGroupKey>, ea::equal_to<BatchGroupKey>, FrameAllocatorAdapter> batchGroups_;
     /// Shader remapping table for 2-pass state and distance sort.
     ea::unordered_map<unsigned, unsigned> shaderRemapping_;
     /// Material remapping table for 2-pass state and distance sort.
-    ea::unordered_map<unsigned short, unsigned short> materialRemapping_;
+    ea::unordered_map<unsigned, unsigned> materialRemapping_;
     /// Geometry remapping table for 2-pass state and distance sort.
-    ea::unordered_map<unsigned short, unsigned short> geometryRemapping_;
+    ea::unordered_map<unsigned, unsigned> geometryRemapping_;
+    /// Sort keys of the draw calls being sorted.
+    ea::vector<BatchSortItem> sortItems_;
+    /// Radix sort scratch buffer.
+    ea::vector<BatchSortItem> sortScratch_;
 
     /// Unsorted non-instanced draw calls.
     ea::vector<Batch> batches_;
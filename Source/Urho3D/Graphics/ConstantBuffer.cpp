@@ -53,6 +53,10 @@ void ConstantBuffer::SetParameter(unsigned offset, unsigned size, const void* da
     if (offset + size > size_)
         return; // Would overflow the buffer
 
+    // Setting the same data again, for example after the parameter sources have been cleared for a new frame, does not need an upload
+    if (!memcmp(shadowData_.get() + offset, data, size))
+        return;
+
     memcpy(shadowData_.get() + offset, data, size);
     dirty_ = true;
 }
@@ -67,13 +71,14 @@ void ConstantBuffer::SetVector3ArrayParameter(unsigned offset, unsigned rows, co
 
     while (rows--)
     {
-        *dest++ = *src++;
-        *dest++ = *src++;
-        *dest++ = *src++;
-        ++dest; // Skip over the w coordinate
+        if (memcmp(dest, src, 3 * sizeof(float)) != 0)
+        {
+            memcpy(dest, src, 3 * sizeof(float));
+            dirty_ = true;
+        }
+        dest += 4; // Skip over the w coordinate
+        src += 3;
     }
-
-    dirty_ = true;
 }
 
 }
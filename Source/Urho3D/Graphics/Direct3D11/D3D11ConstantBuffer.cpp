@@ -74,7 +74,12 @@ bool ConstantBuffer::SetSize(unsigned size)
         bufferDesc.CPUAccessFlags = 0;
         bufferDesc.Usage = D3D11_USAGE_DEFAULT;
 
-        HRESULT hr = graphics_->GetImpl()->GetDevice()->CreateBuffer(&bufferDesc, 0, (ID3D11Buffer**)&object_.ptr_);
+        // Initialize with the zeroed shadow data, so that SetParameter() can skip values matching the shadow
+        D3D11_SUBRESOURCE_DATA initialData;
+        memset(&initialData, 0, sizeof initialData);
+        initialData.pSysMem = shadowData_.get();
+
+        HRESULT hr = graphics_->GetImpl()->GetDevice()->CreateBuffer(&bufferDesc, &initialData, (ID3D11Buffer**)&object_.ptr_);
         if (FAILED(hr))
         {
             URHO3D_SAFE_RELEASE(object_.ptr_);
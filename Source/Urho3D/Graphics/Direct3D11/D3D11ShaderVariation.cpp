@@ -154,6 +154,21 @@ void ShaderVariation::Release()
     elementHash_ = 0;
 }
 
+bool ShaderVariation::BeginCreate()
+{
+    return Create();
+}
+
+bool ShaderVariation::EndCreate()
+{
+    return object_.ptr_ != nullptr;
+}
+
+ea::string ShaderVariation::GetCompilerSourceCode() const
+{
+    return EMPTY_STRING;
+}
+
 void ShaderVariation::SetDefines(const ea::string& defines)
 {
     defines_ = defines;
@@ -2064,6 +2064,11 @@ void Graphics::OnWindowMoved()
     SendEvent(E_WINDOWPOS, eventData);
 }
 
+unsigned Graphics::GetNumPendingShaderPrograms() const
+{
+    return 0;
+}
+
 void Graphics::CleanupShaderPrograms(ShaderVariation* variation)
 {
     for (auto i = impl_->shaderPrograms_.begin(); i != impl_->shaderPrograms_.end();)
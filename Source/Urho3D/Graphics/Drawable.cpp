@@ -23,6 +23,7 @@
 
 #include "../Precompiled.h"
 
+#include <EASTL/fixed_vector.h>
 #include <EASTL/sort.h>
 
 #include "../Core/Context.h"
@@ -348,12 +349,18 @@ void Drawable::LimitVertexLights(bool removeConvertedLights)
     if (vertexLights_.size() <= MAX_VERTEX_LIGHTS)
         return;
 
+    // Called from worker threads during batch collection, so sort by keys computed here instead of the light's shared
+    // sort value
     const BoundingBox& box = GetWorldBoundingBox();
-    for (unsigned i = 0; i < vertexLights_.size(); ++i)
-        vertexLights_[i]->SetIntensitySortValue(box);
+    ea::fixed_vector<ea::pair<float, Light*>, 2 * MAX_VERTEX_LIGHTS> sortedLights;
+    for (Light* light : vertexLights_)
+        sortedLights.emplace_back(light->GetIntensitySortValue(box), light);
 
-    ea::quick_sort(vertexLights_.begin(), vertexLights_.end(), CompareDrawables);
+    ea::quick_sort(sortedLights.begin(), sortedLights.end(),
+        [](const ea::pair<float, Light*>& lhs, const ea::pair<float, Light*>& rhs) { return lhs.first < rhs.first; });
     vertexLights_.resize(MAX_VERTEX_LIGHTS);
+    for (unsigned i = 0; i < MAX_VERTEX_LIGHTS; ++i)
+        vertexLights_[i] = sortedLights[i].second;
 }
 
 void Drawable::OnNodeSet(Node* node)
@@ -0,0 +1,161 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Graphics/FlatOctree.h"
+#include "../Graphics/Octree.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+void FlatOctree::Build(const Octant* root)
+{
+    octants_.clear();
+    firstChild_.clear();
+    numChildren_.clear();
+    centerX_.clear();
+    centerY_.clear();
+    centerZ_.clear();
+    halfSizeX_.clear();
+    halfSizeY_.clear();
+    halfSizeZ_.clear();
+
+    // Breadth-first order keeps the children of each octant together, in the same order as in the hierarchy
+    octants_.push_back(root);
+    for (unsigned i = 0; i < octants_.size(); ++i)
+    {
+        const Octant* octant = octants_[i];
+        firstChild_.push_back(octants_.size());
+        for (Octant* child : octant->children_)
+        {
+            if (child)
+                octants_.push_back(child);
+        }
+        numChildren_.push_back(octants_.size() - firstChild_.back());
+
+        const BoundingBox& box = octant->cullingBox_;
+        const Vector3 center = box.Center();
+        const Vector3 halfSize = box.HalfSize();
+        centerX_.push_back(center.x_);
+        centerY_.push_back(center.y_);
+        centerZ_.push_back(center.z_);
+        halfSizeX_.push_back(halfSize.x_);
+        halfSizeY_.push_back(halfSize.y_);
+        halfSizeZ_.push_back(halfSize.z_);
+    }
+
+    boxes_.centerX_ = centerX_.data();
+    boxes_.centerY_ = centerY_.data();
+    boxes_.centerZ_ = centerZ_.data();
+    boxes_.halfSizeX_ = halfSizeX_.data();
+    boxes_.halfSizeY_ = halfSizeY_.data();
+    boxes_.halfSizeZ_ = halfSizeZ_.data();
+    dirty_ = false;
+}
+
+void FlatOctree::GetDrawables(OctreeQuery& query) const
+{
+    assert(!dirty_);
+    GetDrawablesInternal(query, 0, false);
+}
+
+void FlatOctree::GetDrawables(RayOctreeQuery& query) const
+{
+    assert(!dirty_);
+    if (GetHitDistance(query.ray_, 0) < query.maxDistance_)
+        GetDrawablesInternal(query, 0);
+}
+
+void FlatOctree::GetDrawablesOnly(RayOctreeQuery& query, ea::vector<Drawable*>& drawables) const
+{
+    assert(!dirty_);
+    if (GetHitDistance(query.ray_, 0) < query.maxDistance_)
+        GetDrawablesOnlyInternal(query, 0, drawables);
+}
+
+void FlatOctree::GetDrawablesInternal(OctreeQuery& query, unsigned index, bool inside) const
+{
+    const ea::vector<Drawable*>& octantDrawables = octants_[index]->drawables_;
+    if (octantDrawables.size())
+    {
+        auto** start = const_cast<Drawable**>(&octantDrawables[0]);
+        Drawable** end = start + octantDrawables.size();
+        query.TestDrawables(start, end, inside);
+    }
+
+    const unsigned first = firstChild_[index];
+    const unsigned count = numChildren_[index];
+    if (!count)
+        return;
+
+    // Test all children at once, then descend into those not fully outside
+    Intersection results[NUM_OCTANTS];
+    query.TestOctants(boxes_, first, count, inside, results);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (results[i] != OUTSIDE)
+            GetDrawablesInternal(query, first + i, inside || results[i] == INSIDE);
+    }
+}
+
+void FlatOctree::GetDrawablesInternal(RayOctreeQuery& query, unsigned index) const
+{
+    const ea::vector<Drawable*>& octantDrawables = octants_[index]->drawables_;
+    for (Drawable* drawable : octantDrawables)
+    {
+        if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+            drawable->ProcessRayQuery(query, query.result_);
+    }
+
+    const unsigned first = firstChild_[index];
+    const unsigned count = numChildren_[index];
+    for (unsigned i = first; i < first + count; ++i)
+    {
+        if (GetHitDistance(query.ray_, i) < query.maxDistance_)
+            GetDrawablesInternal(query, i);
+    }
+}
+
+void FlatOctree::GetDrawablesOnlyInternal(RayOctreeQuery& query, unsigned index, ea::vector<Drawable*>& drawables) const
+{
+    const ea::vector<Drawable*>& octantDrawables = octants_[index]->drawables_;
+    for (Drawable* drawable : octantDrawables)
+    {
+        if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
+            drawables.push_back(drawable);
+    }
+
+    const unsigned first = firstChild_[index];
+    const unsigned count = numChildren_[index];
+    for (unsigned i = first; i < first + count; ++i)
+    {
+        if (GetHitDistance(query.ray_, i) < query.maxDistance_)
+            GetDrawablesOnlyInternal(query, i, drawables);
+    }
+}
+
+}
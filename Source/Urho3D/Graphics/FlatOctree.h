@@ -0,0 +1,92 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Graphics/OctreeQuery.h"
+
+namespace Urho3D
+{
+
+class Octant;
+
+/// Flattened copy of the octant hierarchy used for fast queries. Culling boxes are stored as arrays and the children
+/// of each octant are stored next to each other, so that all children can be tested against a frustum at once.
+/// Drawables are read from the octants, so the copy only needs a rebuild when octants are created or deleted.
+class URHO3D_API FlatOctree
+{
+public:
+    /// Rebuild from the octant hierarchy.
+    void Build(const Octant* root);
+    /// Mark the octant hierarchy changed. Queries must not be made until the next rebuild.
+    void MarkDirty() { dirty_ = true; }
+
+    /// Return drawable objects by a query.
+    void GetDrawables(OctreeQuery& query) const;
+    /// Return drawable objects by a ray query.
+    void GetDrawables(RayOctreeQuery& query) const;
+    /// Return drawable objects only for a threaded ray query.
+    void GetDrawablesOnly(RayOctreeQuery& query, ea::vector<Drawable*>& drawables) const;
+
+    /// Return whether needs a rebuild.
+    bool IsDirty() const { return dirty_; }
+    /// Return number of octants.
+    unsigned GetNumOctants() const { return octants_.size(); }
+
+private:
+    /// Return drawable objects by a query, called internally.
+    void GetDrawablesInternal(OctreeQuery& query, unsigned index, bool inside) const;
+    /// Return drawable objects by a ray query, called internally.
+    void GetDrawablesInternal(RayOctreeQuery& query, unsigned index) const;
+    /// Return drawable objects only for a threaded ray query, called internally.
+    void GetDrawablesOnlyInternal(RayOctreeQuery& query, unsigned index, ea::vector<Drawable*>& drawables) const;
+    /// Return ray distance to octant culling box.
+    float GetHitDistance(const Ray& ray, unsigned index) const { return ray.HitDistance(boxes_.GetBoundingBox(index)); }
+
+    /// Octants in breadth-first order.
+    ea::vector<const Octant*> octants_;
+    /// Index of first child octant.
+    ea::vector<unsigned> firstChild_;
+    /// Number of child octants.
+    ea::vector<unsigned> numChildren_;
+    /// Culling box center X coordinates.
+    ea::vector<float> centerX_;
+    /// Culling box center Y coordinates.
+    ea::vector<float> centerY_;
+    /// Culling box center Z coordinates.
+    ea::vector<float> centerZ_;
+    /// Culling box half size X coordinates.
+    ea::vector<float> halfSizeX_;
+    /// Culling box half size Y coordinates.
+    ea::vector<float> halfSizeY_;
+    /// Culling box half size Z coordinates.
+    ea::vector<float> halfSizeZ_;
+    /// Culling boxes as arrays.
+    BoundingBoxArrays boxes_;
+    /// Rebuild needed flag.
+    bool dirty_{true};
+};
+
+}
@@ -318,8 +318,10 @@ public:
     void EndDumpShaders();
     /// Precache shader variations from an XML file generated with BeginDumpShaders().
     void PrecacheShaders(Deserializer& source);
-    /// Set shader cache directory, Direct3D only. This can either be an absolute path or a path within the resource system.
+    /// Set shader cache directory. On Direct3D this can either be an absolute path or a path within the resource system. On OpenGL it must be an absolute path and is used for the program binary cache.
     void SetShaderCacheDir(const ea::string& path);
+    /// Set whether to compile shader programs asynchronously. While a program is compiling, a ready program with the same vertex shader is used as a fallback if one exists, otherwise the draw is skipped. Without ARB_parallel_shader_compile the link result is checked a few frames after starting, which still blocks the main thread if the driver has not finished, at most one program per frame beyond the time budget. OpenGL only.
+    void SetAsyncShaderCompilation(bool enable) { asyncShaderCompilation_ = enable; }
     /// Set global shader defines.
     void SetGlobalShaderDefines(const ea::string& globalShaderDefines);
 
@@ -569,9 +571,15 @@ public:
     /// Return whether a custom clipping plane is in use.
     bool GetUseClipPlane() const { return useClipPlane_; }
 
-    /// Return shader cache directory, Direct3D only.
+    /// Return shader cache directory.
     const ea::string& GetShaderCacheDir() const { return shaderCacheDir_; }
 
+    /// Return whether shader programs are compiled asynchronously.
+    bool GetAsyncShaderCompilation() const { return asyncShaderCompilation_; }
+
+    /// Return number of shader programs still compiling asynchronously.
+    unsigned GetNumPendingShaderPrograms() const;
+
     /// Return global shader defines.
     const ea::string& GetGlobalShaderDefines() const { return globalShaderDefines_; }
 
@@ -719,6 +727,8 @@ private:
     bool CheckFramebuffer();
     /// Set vertex attrib divisor. No-op if unsupported. Used only on OpenGL.
     void SetVertexAttribDivisor(unsigned location, unsigned divisor);
+    /// Advance asynchronously compiling shader programs within a time budget. Called by EndFrame(). Used only on OpenGL.
+    void UpdatePendingShaderPrograms();
     /// Release/clear GPU objects and optionally close the window. Used only on OpenGL.
     void Release(bool clearGPUObjects, bool closeWindow);
 
@@ -869,8 +879,10 @@ private:
     const void* shaderParameterSources_[MAX_SHADER_PARAMETER_GROUPS]{};
     /// Base directory for shaders.
     ea::string shaderPath_;
-    /// Cache directory for Direct3D binary shaders.
+    /// Cache directory for Direct3D binary shaders and OpenGL program binaries.
     ea::string shaderCacheDir_;
+    /// Asynchronous shader program compilation flag.
+    bool asyncShaderCompilation_{};
     /// File extension for shaders.
     ea::string shaderExtension_;
     /// Last used shader in shader variation query.
@@ -588,13 +588,17 @@ void Light::SetIntensitySortValue(float distance)
 }
 
 void Light::SetIntensitySortValue(const BoundingBox& box)
+{
+    sortValue_ = GetIntensitySortValue(box);
+}
+
+float Light::GetIntensitySortValue(const BoundingBox& box) const
 {
     // When sorting lights for object's maximum light cap, give priority based on attenuation and intensity
     switch (lightType_)
     {
     case LIGHT_DIRECTIONAL:
-        sortValue_ = 1.0f / GetIntensityDivisor();
-        break;
+        return 1.0f / GetIntensityDivisor();
 
     case LIGHT_SPOT:
         {
@@ -620,9 +624,8 @@ void Light::SetIntensitySortValue(const BoundingBox& box)
             float spotFactor = Min(spotAngle / maxAngle, 1.0f);
             // We do not know the actual range attenuation ramp, so take only spot attenuation into account
             float att = Max(1.0f - spotFactor * spotFactor, M_EPSILON);
-            sortValue_ = 1.0f / GetIntensityDivisor(att);
+            return 1.0f / GetIntensityDivisor(att);
         }
-        break;
 
     case LIGHT_POINT:
         {
@@ -633,10 +636,11 @@ void Light::SetIntensitySortValue(const BoundingBox& box)
             float distance = lightRay.HitDistance(box);
             float normDistance = distance / range_;
             float att = Max(1.0f - normDistance * normDistance, M_EPSILON);
-            sortValue_ = 1.0f / GetIntensityDivisor(att);
+            return 1.0f / GetIntensityDivisor(att);
         }
-        break;
     }
+
+    return 0.0f;
 }
 
 void Light::SetLightQueue(LightBatchQueue* queue)
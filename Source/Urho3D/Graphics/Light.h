@@ -185,6 +185,8 @@ public:
     ~Light() override;
     /// Register object factory. Drawable must be registered first.
     static void RegisterObject(Context* context);
+    /// Return whether binary load and save may access typed attributes directly. True for this class, but not for subclasses.
+    bool IsDirectAttributeAccessAllowed() const override { return IsExactType<Light>(); }
 
     /// Process octree raycast. May be called from a worker thread.
     void ProcessRayQuery(const RayOctreeQuery& query, ea::vector<RayQueryResult>& results) override;
@@ -346,6 +348,8 @@ public:
     void SetIntensitySortValue(float distance);
     /// Set sort value based on overall intensity over a bounding box.
     void SetIntensitySortValue(const BoundingBox& box);
+    /// Return sort value based on overall intensity over a bounding box without storing it. Safe to call from worker threads.
+    float GetIntensitySortValue(const BoundingBox& box) const;
     /// Set light queue used for this light. Called by View.
     void SetLightQueue(LightBatchQueue* queue);
     /// Return light volume model transform.
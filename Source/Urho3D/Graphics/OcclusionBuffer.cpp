@@ -29,6 +29,10 @@
 #include "../Graphics/OcclusionBuffer.h"
 #include "../IO/Log.h"
 
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -45,13 +49,28 @@ enum ClipMask : unsigned
 };
 URHO3D_FLAGSET(ClipMask, ClipMaskFlags);
 
-void DrawOcclusionBatchWork(const WorkItem* item, unsigned threadIndex)
+#ifdef URHO3D_SSE
+namespace
+{
+
+/// Return the smallest of 4 floats.
+inline float HorizontalMin(__m128 value)
+{
+    value = _mm_min_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)));
+    value = _mm_min_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(value);
+}
+
+/// Return the largest of 4 floats.
+inline float HorizontalMax(__m128 value)
 {
-    URHO3D_PROFILE("DrawOcclusionBatchWork");
-    auto* buffer = reinterpret_cast<OcclusionBuffer*>(item->aux_);
-    OcclusionBatch& batch = *reinterpret_cast<OcclusionBatch*>(item->start_);
-    buffer->DrawBatch(batch, threadIndex);
+    value = _mm_max_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)));
+    value = _mm_max_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(value);
+}
+
 }
+#endif
 
 OcclusionBuffer::OcclusionBuffer(Context* context) :
     Object(context)
@@ -71,7 +90,8 @@ bool OcclusionBuffer::SetSize(int width, int height, bool threaded)
     if (height & 1u)
         ++height;
 
-    if (width == width_ && height == height_)
+    const unsigned numThreads = threaded ? GetSubsystem<WorkQueue>()->GetNumThreads() + 1 : 1;
+    if (width == width_ && height == height_ && numThreads == threadData_.size())
         return true;
 
     if (width <= 0 || height <= 0)
@@ -85,20 +105,21 @@ bool OcclusionBuffer::SetSize(int width, int height, bool threaded)
 
     width_ = width;
     height_ = height;
+    numTiles_ = (unsigned)((height_ + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT);
 
-    // Build work buffers for threading
-    unsigned numThreadBuffers = threaded ? GetSubsystem<WorkQueue>()->GetNumThreads() + 1 : 1;
-    buffers_.resize(numThreadBuffers);
-    for (unsigned i = 0; i < numThreadBuffers; ++i)
-    {
-        // Reserve extra memory in case 3D clipping is not exact
-        OcclusionBufferData& buffer = buffers_[i];
-        buffer.dataWithSafety_ = new int[width * (height + 2) + 2];
-        buffer.data_ = buffer.dataWithSafety_.get() + width + 1;
-        buffer.used_ = false;
-    }
+    // Reserve extra memory in case 3D clipping is not exact
+    dataWithSafety_ = new int[width * (height + 2) + 2];
+    data_ = dataWithSafety_.get() + width + 1;
+
+    // Build triangle setup data for threading
+    threaded_ = numThreads > 1;
+    threadData_.clear();
+    threadData_.resize(numThreads);
+    for (OcclusionThreadData& data : threadData_)
+        data.bins_.resize(numTiles_);
 
     mipBuffers_.clear();
+    mipSizes_.clear();
 
     // Build buffers for mip levels
     for (;;)
@@ -107,13 +128,15 @@ bool OcclusionBuffer::SetSize(int width, int height, bool threaded)
         height = (height + 1) / 2;
 
         mipBuffers_.push_back(ea::shared_array<DepthValue>(new DepthValue[width * height]));
+        mipSizes_.emplace_back(width, height);
 
         if (width <= OCCLUSION_MIN_SIZE && height <= OCCLUSION_MIN_SIZE)
             break;
     }
 
     URHO3D_LOGDEBUG("Set occlusion buffer size " + ea::to_string(width_) + "x" + ea::to_string(height_) + " with " +
-             ea::to_string(mipBuffers_.size()) + " mip levels and " + ea::to_string(numThreadBuffers) + " thread buffers");
+             ea::to_string(mipBuffers_.size()) + " mip levels, " + ea::to_string(numTiles_) + " tiles and " +
+             ea::to_string(numThreads) + " threads");
 
     CalculateViewport();
     return true;
@@ -159,12 +182,7 @@ void OcclusionBuffer::Reset()
 void OcclusionBuffer::Clear()
 {
     Reset();
-
-    // Only clear the main thread buffer. Rest are cleared on-demand when drawing the first batch
-    ClearBuffer(0);
-    for (unsigned i = 1; i < buffers_.size(); ++i)
-        buffers_[i].used_ = false;
-
+    ClearBuffer();
     depthHierarchyDirty_ = true;
 }
 
@@ -206,131 +224,86 @@ bool OcclusionBuffer::AddTriangles(const Matrix3x4& model, const void* vertexDat
 
 void OcclusionBuffer::DrawTriangles()
 {
-    if (buffers_.size() == 1)
+    if (!data_)
+    {
+        batches_.clear();
+        return;
+    }
+
+    for (OcclusionThreadData& data : threadData_)
     {
-        // Not threaded
-        for (auto i = batches_.begin(); i != batches_.end(); ++i)
-            DrawBatch(*i, 0);
+        data.triangles_.clear();
+        data.numTriangles_ = 0;
+        for (ea::vector<unsigned>& bin : data.bins_)
+            bin.clear();
+    }
 
-        depthHierarchyDirty_ = true;
+    if (!threaded_)
+    {
+        for (const OcclusionBatch& batch : batches_)
+            SetupBatch(batch, 0);
+        for (unsigned i = 0; i < numTiles_; ++i)
+            DrawTile(i);
     }
-    else if (buffers_.size() > 1)
+    else
     {
-        // Threaded
+        // Set up triangles by batch, then rasterize by tile so that threads never write to the same pixels
         auto* queue = GetSubsystem<WorkQueue>();
 
-        for (auto i = batches_.begin(); i != batches_.end(); ++i)
+        queue->ParallelFor(batches_.size(), 1, [this](unsigned fromIndex, unsigned toIndex, unsigned threadIndex)
         {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = DrawOcclusionBatchWork;
-            item->aux_ = this;
-            item->start_ = &(*i);
-            queue->AddWorkItem(item);
-        }
+            URHO3D_PROFILE("SetupOcclusionBatchWork");
+            for (unsigned i = fromIndex; i < toIndex; ++i)
+                SetupBatch(batches_[i], threadIndex);
+        });
 
-        queue->Complete(M_MAX_UNSIGNED);
-
-        MergeBuffers();
-        depthHierarchyDirty_ = true;
+        queue->ParallelFor(numTiles_, 1, [this](unsigned fromIndex, unsigned toIndex)
+        {
+            URHO3D_PROFILE("DrawOcclusionTileWork");
+            for (unsigned i = fromIndex; i < toIndex; ++i)
+                DrawTile(i);
+        });
     }
 
+    for (const OcclusionThreadData& data : threadData_)
+        numTriangles_ += data.numTriangles_;
+
+    depthHierarchyDirty_ = true;
     batches_.clear();
 }
 
 void OcclusionBuffer::BuildDepthHierarchy()
 {
-    if (buffers_.empty() || !depthHierarchyDirty_)
+    if (!data_ || !depthHierarchyDirty_)
         return;
 
     URHO3D_PROFILE("BuildDepthHierarchy");
 
-    // Build the first mip level from the pixel-level data
-    int width = (width_ + 1) / 2;
-    int height = (height_ + 1) / 2;
-    if (mipBuffers_.size())
+    // Build the mip levels that only depend on the rows of one tile by tile
+    const unsigned numTileLevels = Min(OCCLUSION_TILE_MIP_LEVELS, mipBuffers_.size());
+    const auto buildTileLevels = [this, numTileLevels](unsigned fromIndex, unsigned toIndex)
     {
-        for (int y = 0; y < height; ++y)
+        for (unsigned i = fromIndex; i < toIndex; ++i)
         {
-            int* src = buffers_[0].data_ + (y * 2) * width_;
-            DepthValue* dest = mipBuffers_[0].get() + y * width;
-            DepthValue* end = dest + width;
-
-            if (y * 2 + 1 < height_)
+            const int tileTop = i * OCCLUSION_TILE_HEIGHT;
+            const int tileBottom = Min(tileTop + OCCLUSION_TILE_HEIGHT, height_);
+            for (unsigned level = 0; level < numTileLevels; ++level)
             {
-                int* src2 = src + width_;
-                while (dest < end)
-                {
-                    int minUpper = Min(src[0], src[1]);
-                    int minLower = Min(src2[0], src2[1]);
-                    dest->min_ = Min(minUpper, minLower);
-                    int maxUpper = Max(src[0], src[1]);
-                    int maxLower = Max(src2[0], src2[1]);
-                    dest->max_ = Max(maxUpper, maxLower);
-
-                    src += 2;
-                    src2 += 2;
-                    ++dest;
-                }
-            }
-            else
-            {
-                while (dest < end)
-                {
-                    dest->min_ = Min(src[0], src[1]);
-                    dest->max_ = Max(src[0], src[1]);
-
-                    src += 2;
-                    ++dest;
-                }
+                const int shift = level + 1;
+                const int endY = Min((tileBottom + (1 << shift) - 1) >> shift, mipSizes_[level].y_);
+                BuildDepthLevel(level, tileTop >> shift, endY);
             }
         }
-    }
-
-    // Build the rest of the mip levels
-    for (unsigned i = 1; i < mipBuffers_.size(); ++i)
-    {
-        int prevWidth = width;
-        int prevHeight = height;
-        width = (width + 1) / 2;
-        height = (height + 1) / 2;
-
-        for (int y = 0; y < height; ++y)
-        {
-            DepthValue* src = mipBuffers_[i - 1].get() + (y * 2) * prevWidth;
-            DepthValue* dest = mipBuffers_[i].get() + y * width;
-            DepthValue* end = dest + width;
-
-            if (y * 2 + 1 < prevHeight)
-            {
-                DepthValue* src2 = src + prevWidth;
-                while (dest < end)
-                {
-                    int minUpper = Min(src[0].min_, src[1].min_);
-                    int minLower = Min(src2[0].min_, src2[1].min_);
-                    dest->min_ = Min(minUpper, minLower);
-                    int maxUpper = Max(src[0].max_, src[1].max_);
-                    int maxLower = Max(src2[0].max_, src2[1].max_);
-                    dest->max_ = Max(maxUpper, maxLower);
+    };
 
-                    src += 2;
-                    src2 += 2;
-                    ++dest;
-                }
-            }
-            else
-            {
-                while (dest < end)
-                {
-                    dest->min_ = Min(src[0].min_, src[1].min_);
-                    dest->max_ = Max(src[0].max_, src[1].max_);
+    if (threaded_)
+        GetSubsystem<WorkQueue>()->ParallelFor(numTiles_, 1, buildTileLevels);
+    else
+        buildTileLevels(0, numTiles_);
 
-                    src += 2;
-                    ++dest;
-                }
-            }
-        }
-    }
+    // Build the rest of the mip levels
+    for (unsigned level = numTileLevels; level < mipBuffers_.size(); ++level)
+        BuildDepthLevel(level, 0, mipSizes_[level].y_);
 
     depthHierarchyDirty_ = false;
 }
@@ -342,9 +315,59 @@ void OcclusionBuffer::ResetUseTimer()
 
 bool OcclusionBuffer::IsVisible(const BoundingBox& worldSpaceBox) const
 {
-    if (buffers_.empty())
+    if (!data_)
         return true;
 
+    float minX, maxX, minY, maxY, minZ;
+
+#ifdef URHO3D_SSE
+    // Transform corners to projection space and then to screen space, first the 4 corners at minimum Z, then at maximum Z
+    const __m128 cornerX = _mm_setr_ps(worldSpaceBox.min_.x_, worldSpaceBox.max_.x_, worldSpaceBox.min_.x_, worldSpaceBox.max_.x_);
+    const __m128 cornerY = _mm_setr_ps(worldSpaceBox.min_.y_, worldSpaceBox.min_.y_, worldSpaceBox.max_.y_, worldSpaceBox.max_.y_);
+    const float cornerZ[] = { worldSpaceBox.min_.z_, worldSpaceBox.max_.z_ };
+    __m128 minProjectedX = _mm_set1_ps(M_INFINITY);
+    __m128 maxProjectedX = _mm_set1_ps(-M_INFINITY);
+    __m128 minProjectedY = _mm_set1_ps(M_INFINITY);
+    __m128 maxProjectedY = _mm_set1_ps(-M_INFINITY);
+    __m128 minProjectedZ = _mm_set1_ps(M_INFINITY);
+
+    for (float z : cornerZ)
+    {
+        const auto transformRow = [&](float m0, float m1, float m2, float m3)
+        {
+            return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m0), cornerX), _mm_mul_ps(_mm_set1_ps(m1), cornerY)),
+                _mm_set1_ps(m2 * z + m3));
+        };
+
+        const __m128 x = transformRow(viewProj_.m00_, viewProj_.m01_, viewProj_.m02_, viewProj_.m03_);
+        const __m128 y = transformRow(viewProj_.m10_, viewProj_.m11_, viewProj_.m12_, viewProj_.m13_);
+        // Apply a far clip relative bias
+        const __m128 depth = _mm_sub_ps(transformRow(viewProj_.m20_, viewProj_.m21_, viewProj_.m22_, viewProj_.m23_),
+            _mm_set1_ps(OCCLUSION_RELATIVE_BIAS));
+        const __m128 w = transformRow(viewProj_.m30_, viewProj_.m31_, viewProj_.m32_, viewProj_.m33_);
+
+        // If any of the corners cross the near plane, assume visible
+        if (_mm_movemask_ps(_mm_cmple_ps(depth, _mm_setzero_ps())))
+            return true;
+
+        const __m128 invW = _mm_div_ps(_mm_set1_ps(1.0f), w);
+        const __m128 projectedX = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(invW, x), _mm_set1_ps(scaleX_)), _mm_set1_ps(offsetX_));
+        const __m128 projectedY = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(invW, y), _mm_set1_ps(scaleY_)), _mm_set1_ps(offsetY_));
+        const __m128 projectedZ = _mm_mul_ps(_mm_mul_ps(invW, depth), _mm_set1_ps(OCCLUSION_Z_SCALE));
+
+        minProjectedX = _mm_min_ps(minProjectedX, projectedX);
+        maxProjectedX = _mm_max_ps(maxProjectedX, projectedX);
+        minProjectedY = _mm_min_ps(minProjectedY, projectedY);
+        maxProjectedY = _mm_max_ps(maxProjectedY, projectedY);
+        minProjectedZ = _mm_min_ps(minProjectedZ, projectedZ);
+    }
+
+    minX = HorizontalMin(minProjectedX);
+    maxX = HorizontalMax(maxProjectedX);
+    minY = HorizontalMin(minProjectedY);
+    maxY = HorizontalMax(maxProjectedY);
+    minZ = HorizontalMin(minProjectedZ);
+#else
     // Transform corners to projection space
     Vector4 vertices[8];
     vertices[0] = ModelTransform(viewProj_, worldSpaceBox.min_);
@@ -361,8 +384,6 @@ bool OcclusionBuffer::IsVisible(const BoundingBox& worldSpaceBox) const
         vertice.z_ -= OCCLUSION_RELATIVE_BIAS;
 
     // Transform to screen space. If any of the corners cross the near plane, assume visible
-    float minX, maxX, minY, maxY, minZ;
-
     if (vertices[0].z_ <= 0.0f)
         return true;
 
@@ -385,6 +406,7 @@ bool OcclusionBuffer::IsVisible(const BoundingBox& worldSpaceBox) const
         if (projected.y_ > maxY) maxY = projected.y_;
         if (projected.z_ < minZ) minZ = projected.z_;
     }
+#endif
 
     // Expand the bounding box 1 pixel in each direction to be conservative and correct rasterization offset
     IntRect rect((int)(minX - 1.5f), (int)(minY - 1.5f), RoundToInt(maxX), RoundToInt(maxY));
@@ -444,12 +466,25 @@ bool OcclusionBuffer::IsVisible(const BoundingBox& worldSpaceBox) const
     }
 
     // If no conclusive result, finally check the pixel-level data
-    int* row = buffers_[0].data_ + rect.top_ * width_;
-    int* endRow = buffers_[0].data_ + rect.bottom_ * width_;
+    int* row = data_ + rect.top_ * width_;
+    int* endRow = data_ + rect.bottom_ * width_;
+#ifdef URHO3D_SSE
+    const __m128i depth = _mm_set1_epi32(z);
+#endif
     while (row <= endRow)
     {
         int* src = row + rect.left_;
         int* end = row + rect.right_;
+#ifdef URHO3D_SSE
+        // Test 4 pixels at once, visible if any is not closer than the box
+        while (src + 3 <= end)
+        {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            if (_mm_movemask_epi8(_mm_cmpgt_epi32(depth, pixels)) != 0xffff)
+                return true;
+            src += 4;
+        }
+#endif
         while (src <= end)
         {
             if (z <= *src)
@@ -468,17 +503,27 @@ unsigned OcclusionBuffer::GetUseTimer()
 }
 
 
-void OcclusionBuffer::DrawBatch(const OcclusionBatch& batch, unsigned threadIndex)
+void OcclusionBuffer::SetupBatch(const OcclusionBatch& batch, unsigned threadIndex)
 {
-    // If buffer not yet used, clear it
-    if (threadIndex > 0 && !buffers_[threadIndex].used_)
-    {
-        ClearBuffer(threadIndex);
-        buffers_[threadIndex].used_ = true;
-    }
-
     Matrix4 modelViewProj = viewProj_ * batch.model_;
 
+#ifdef URHO3D_SSE
+    // Transform all four components of a vertex at once using the matrix columns
+    const __m128 column0 = _mm_setr_ps(modelViewProj.m00_, modelViewProj.m10_, modelViewProj.m20_, modelViewProj.m30_);
+    const __m128 column1 = _mm_setr_ps(modelViewProj.m01_, modelViewProj.m11_, modelViewProj.m21_, modelViewProj.m31_);
+    const __m128 column2 = _mm_setr_ps(modelViewProj.m02_, modelViewProj.m12_, modelViewProj.m22_, modelViewProj.m32_);
+    const __m128 column3 = _mm_setr_ps(modelViewProj.m03_, modelViewProj.m13_, modelViewProj.m23_, modelViewProj.m33_);
+    const auto transformVertex = [&](const Vector3& vertex, Vector4& result)
+    {
+        const __m128 transformed = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(vertex.x_)), _mm_mul_ps(column1, _mm_set1_ps(vertex.y_))),
+            _mm_add_ps(_mm_mul_ps(column2, _mm_set1_ps(vertex.z_)), column3));
+        _mm_storeu_ps(&result.x_, transformed);
+    };
+#else
+    const auto transformVertex = [&](const Vector3& vertex, Vector4& result) { result = ModelTransform(modelViewProj, vertex); };
+#endif
+
     // Theoretical max. amount of vertices if each of the 6 clipping planes doubles the triangle count
     Vector4 vertices[64 * 3];
 
@@ -493,10 +538,10 @@ void OcclusionBuffer::DrawBatch(const OcclusionBatch& batch, unsigned threadInde
             const Vector3& v1 = *((const Vector3*)(&srcData[(index + 1) * batch.vertexSize_]));
             const Vector3& v2 = *((const Vector3*)(&srcData[(index + 2) * batch.vertexSize_]));
 
-            vertices[0] = ModelTransform(modelViewProj, v0);
-            vertices[1] = ModelTransform(modelViewProj, v1);
-            vertices[2] = ModelTransform(modelViewProj, v2);
-            DrawTriangle(vertices, threadIndex);
+            transformVertex(v0, vertices[0]);
+            transformVertex(v1, vertices[1]);
+            transformVertex(v2, vertices[2]);
+            SetupTriangle(vertices, threadIndex);
 
             index += 3;
         }
@@ -517,10 +562,10 @@ void OcclusionBuffer::DrawBatch(const OcclusionBatch& batch, unsigned threadInde
                 const Vector3& v1 = *((const Vector3*)(&srcData[indices[1] * batch.vertexSize_]));
                 const Vector3& v2 = *((const Vector3*)(&srcData[indices[2] * batch.vertexSize_]));
 
-                vertices[0] = ModelTransform(modelViewProj, v0);
-                vertices[1] = ModelTransform(modelViewProj, v1);
-                vertices[2] = ModelTransform(modelViewProj, v2);
-                DrawTriangle(vertices, threadIndex);
+                transformVertex(v0, vertices[0]);
+                transformVertex(v1, vertices[1]);
+                transformVertex(v2, vertices[2]);
+                SetupTriangle(vertices, threadIndex);
 
                 indices += 3;
             }
@@ -536,10 +581,10 @@ void OcclusionBuffer::DrawBatch(const OcclusionBatch& batch, unsigned threadInde
                 const Vector3& v1 = *((const Vector3*)(&srcData[indices[1] * batch.vertexSize_]));
                 const Vector3& v2 = *((const Vector3*)(&srcData[indices[2] * batch.vertexSize_]));
 
-                vertices[0] = ModelTransform(modelViewProj, v0);
-                vertices[1] = ModelTransform(modelViewProj, v1);
-                vertices[2] = ModelTransform(modelViewProj, v2);
-                DrawTriangle(vertices, threadIndex);
+                transformVertex(v0, vertices[0]);
+                transformVertex(v1, vertices[1]);
+                transformVertex(v2, vertices[2]);
+                SetupTriangle(vertices, threadIndex);
 
                 indices += 3;
             }
@@ -547,6 +592,21 @@ void OcclusionBuffer::DrawBatch(const OcclusionBatch& batch, unsigned threadInde
     }
 }
 
+void OcclusionBuffer::DrawTile(unsigned tileIndex)
+{
+    const int clipTop = tileIndex * OCCLUSION_TILE_HEIGHT;
+    const int clipBottom = Min(clipTop + OCCLUSION_TILE_HEIGHT, height_);
+
+    for (const OcclusionThreadData& data : threadData_)
+    {
+        for (unsigned index : data.bins_[tileIndex])
+        {
+            const OcclusionTriangle& triangle = data.triangles_[index];
+            DrawTriangle2D(triangle.vertices_, triangle.clockwise_, clipTop, clipBottom);
+        }
+    }
+}
+
 inline Vector4 OcclusionBuffer::ModelTransform(const Matrix4& transform, const Vector3& vertex) const
 {
     return Vector4(
@@ -593,7 +653,7 @@ void OcclusionBuffer::CalculateViewport()
     projOffsetScaleY_ = projection_.m11_ * scaleY_;
 }
 
-void OcclusionBuffer::DrawTriangle(Vector4* vertices, unsigned threadIndex)
+void OcclusionBuffer::SetupTriangle(Vector4* vertices, unsigned threadIndex)
 {
     ClipMaskFlags clipMask{};
     ClipMaskFlags andClipMask{};
@@ -640,7 +700,7 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices, unsigned threadIndex)
         bool clockwise = SignedArea(projected[0], projected[1], projected[2]) < 0.0f;
         if (cullMode_ == CULL_NONE || (cullMode_ == CULL_CCW && clockwise) || (cullMode_ == CULL_CW && !clockwise))
         {
-            DrawTriangle2D(projected, clockwise, threadIndex);
+            BinTriangle2D(projected, clockwise, threadIndex);
             drawOk = true;
         }
     }
@@ -678,7 +738,7 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices, unsigned threadIndex)
                 bool clockwise = SignedArea(projected[0], projected[1], projected[2]) < 0.0f;
                 if (cullMode_ == CULL_NONE || (cullMode_ == CULL_CCW && clockwise) || (cullMode_ == CULL_CW && !clockwise))
                 {
-                    DrawTriangle2D(projected, clockwise, threadIndex);
+                    BinTriangle2D(projected, clockwise, threadIndex);
                     drawOk = true;
                 }
             }
@@ -686,7 +746,7 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices, unsigned threadIndex)
     }
 
     if (drawOk)
-        ++numTriangles_;
+        ++threadData_[threadIndex].numTriangles_;
 }
 
 void OcclusionBuffer::ClipVertices(const Vector4& plane, Vector4* vertices, bool* triangles, unsigned& numTriangles)
@@ -809,6 +869,13 @@ struct Edge
         invZStep_ = RoundToInt(slope * gradients.dInvZdX_ + gradients.dInvZdY_);
     }
 
+    /// Advance by a number of rows.
+    void Step(int rows)
+    {
+        x_ += xStep_ * rows;
+        invZ_ += invZStep_ * rows;
+    }
+
     /// X coordinate.
     int x_;
     /// X coordinate step.
@@ -819,7 +886,70 @@ struct Edge
     int invZStep_;
 };
 
-void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise, unsigned threadIndex)
+/// Draw the rows of a triangle half between two edges, limited to a range of rows. Depth is interpolated from the left edge.
+/// Both edges are advanced to the end of the half.
+inline void DrawSpans(int* bufferData, int width, int dInvZdX, Edge& left, Edge& right, int startY, int endY, int clipTop,
+    int clipBottom)
+{
+    const int firstY = Max(startY, clipTop);
+    const int lastY = Min(endY, clipBottom);
+    if (firstY >= lastY)
+    {
+        left.Step(endY - startY);
+        right.Step(endY - startY);
+        return;
+    }
+
+    left.Step(firstY - startY);
+    right.Step(firstY - startY);
+
+    int* row = bufferData + firstY * width;
+    int* endRow = bufferData + lastY * width;
+    while (row < endRow)
+    {
+        int invZ = left.invZ_;
+        int* dest = row + (left.x_ >> 16u);
+        int* end = row + (right.x_ >> 16u);
+        while (dest < end)
+        {
+            if (invZ < *dest)
+                *dest = invZ;
+            invZ += dInvZdX;
+            ++dest;
+        }
+
+        left.Step(1);
+        right.Step(1);
+        row += width;
+    }
+
+    left.Step(endY - lastY);
+    right.Step(endY - lastY);
+}
+
+void OcclusionBuffer::BinTriangle2D(const Vector3* vertices, bool clockwise, unsigned threadIndex)
+{
+    // Rows are rounded the same way as in DrawTriangle2D()
+    const auto topY = (int)Min(Min(vertices[0].y_, vertices[1].y_), vertices[2].y_);
+    const auto bottomY = (int)Max(Max(vertices[0].y_, vertices[1].y_), vertices[2].y_);
+    if (topY == bottomY || bottomY <= 0 || topY >= height_)
+        return;
+
+    OcclusionThreadData& data = threadData_[threadIndex];
+    const unsigned index = data.triangles_.size();
+    OcclusionTriangle& triangle = data.triangles_.push_back();
+    triangle.vertices_[0] = vertices[0];
+    triangle.vertices_[1] = vertices[1];
+    triangle.vertices_[2] = vertices[2];
+    triangle.clockwise_ = clockwise;
+
+    const int firstTile = Max(topY, 0) / OCCLUSION_TILE_HEIGHT;
+    const int lastTile = (Min(bottomY, height_) - 1) / OCCLUSION_TILE_HEIGHT;
+    for (int i = firstTile; i <= lastTile; ++i)
+        data.bins_[i].push_back(index);
+}
+
+void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise, int clipTop, int clipBottom)
 {
     int top, middle, bottom;
     bool middleIsRight;
@@ -896,60 +1026,20 @@ void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise, un
     Gradients gradients(vertices);
     Edge topToBottom(gradients, vertices[top], vertices[bottom], topY);
 
-    int* bufferData = buffers_[threadIndex].data_;
-
     if (middleIsRight)
     {
         // Top half
         if (!topDegenerate)
         {
             Edge topToMiddle(gradients, vertices[top], vertices[middle], topY);
-            int* row = bufferData + topY * width_;
-            int* endRow = bufferData + middleY * width_;
-            while (row < endRow)
-            {
-                int invZ = topToBottom.invZ_;
-                int* dest = row + (topToBottom.x_ >> 16u);
-                int* end = row + (topToMiddle.x_ >> 16u);
-                while (dest < end)
-                {
-                    if (invZ < *dest)
-                        *dest = invZ;
-                    invZ += gradients.dInvZdXInt_;
-                    ++dest;
-                }
-
-                topToBottom.x_ += topToBottom.xStep_;
-                topToBottom.invZ_ += topToBottom.invZStep_;
-                topToMiddle.x_ += topToMiddle.xStep_;
-                row += width_;
-            }
+            DrawSpans(data_, width_, gradients.dInvZdXInt_, topToBottom, topToMiddle, topY, middleY, clipTop, clipBottom);
         }
 
         // Bottom half
         if (!bottomDegenerate)
         {
             Edge middleToBottom(gradients, vertices[middle], vertices[bottom], middleY);
-            int* row = bufferData + middleY * width_;
-            int* endRow = bufferData + bottomY * width_;
-            while (row < endRow)
-            {
-                int invZ = topToBottom.invZ_;
-                int* dest = row + (topToBottom.x_ >> 16u);
-                int* end = row + (middleToBottom.x_ >> 16u);
-                while (dest < end)
-                {
-                    if (invZ < *dest)
-                        *dest = invZ;
-                    invZ += gradients.dInvZdXInt_;
-                    ++dest;
-                }
-
-                topToBottom.x_ += topToBottom.xStep_;
-                topToBottom.invZ_ += topToBottom.invZStep_;
-                middleToBottom.x_ += middleToBottom.xStep_;
-                row += width_;
-            }
+            DrawSpans(data_, width_, gradients.dInvZdXInt_, topToBottom, middleToBottom, middleY, bottomY, clipTop, clipBottom);
         }
     }
     else
@@ -958,86 +1048,107 @@ void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise, un
         if (!topDegenerate)
         {
             Edge topToMiddle(gradients, vertices[top], vertices[middle], topY);
-            int* row = bufferData + topY * width_;
-            int* endRow = bufferData + middleY * width_;
-            while (row < endRow)
-            {
-                int invZ = topToMiddle.invZ_;
-                int* dest = row + (topToMiddle.x_ >> 16u);
-                int* end = row + (topToBottom.x_ >> 16u);
-                while (dest < end)
-                {
-                    if (invZ < *dest)
-                        *dest = invZ;
-                    invZ += gradients.dInvZdXInt_;
-                    ++dest;
-                }
-
-                topToMiddle.x_ += topToMiddle.xStep_;
-                topToMiddle.invZ_ += topToMiddle.invZStep_;
-                topToBottom.x_ += topToBottom.xStep_;
-                row += width_;
-            }
+            DrawSpans(data_, width_, gradients.dInvZdXInt_, topToMiddle, topToBottom, topY, middleY, clipTop, clipBottom);
         }
 
         // Bottom half
         if (!bottomDegenerate)
         {
             Edge middleToBottom(gradients, vertices[middle], vertices[bottom], middleY);
-            int* row = bufferData + middleY * width_;
-            int* endRow = bufferData + bottomY * width_;
-            while (row < endRow)
+            DrawSpans(data_, width_, gradients.dInvZdXInt_, middleToBottom, topToBottom, middleY, bottomY, clipTop, clipBottom);
+        }
+    }
+}
+
+void OcclusionBuffer::BuildDepthLevel(unsigned level, int startY, int endY)
+{
+    const int width = mipSizes_[level].x_;
+
+    if (level == 0)
+    {
+        // Build the first mip level from the pixel-level data
+        for (int y = startY; y < endY; ++y)
+        {
+            int* src = data_ + (y * 2) * width_;
+            DepthValue* dest = mipBuffers_[0].get() + y * width;
+            DepthValue* end = dest + width;
+
+            if (y * 2 + 1 < height_)
             {
-                int invZ = middleToBottom.invZ_;
-                int* dest = row + (middleToBottom.x_ >> 16u);
-                int* end = row + (topToBottom.x_ >> 16u);
+                int* src2 = src + width_;
                 while (dest < end)
                 {
-                    if (invZ < *dest)
-                        *dest = invZ;
-                    invZ += gradients.dInvZdXInt_;
+                    int minUpper = Min(src[0], src[1]);
+                    int minLower = Min(src2[0], src2[1]);
+                    dest->min_ = Min(minUpper, minLower);
+                    int maxUpper = Max(src[0], src[1]);
+                    int maxLower = Max(src2[0], src2[1]);
+                    dest->max_ = Max(maxUpper, maxLower);
+
+                    src += 2;
+                    src2 += 2;
                     ++dest;
                 }
+            }
+            else
+            {
+                while (dest < end)
+                {
+                    dest->min_ = Min(src[0], src[1]);
+                    dest->max_ = Max(src[0], src[1]);
 
-                middleToBottom.x_ += middleToBottom.xStep_;
-                middleToBottom.invZ_ += middleToBottom.invZStep_;
-                topToBottom.x_ += topToBottom.xStep_;
-                row += width_;
+                    src += 2;
+                    ++dest;
+                }
             }
         }
     }
-}
+    else
+    {
+        const int prevWidth = mipSizes_[level - 1].x_;
+        const int prevHeight = mipSizes_[level - 1].y_;
 
-void OcclusionBuffer::MergeBuffers()
-{
-    URHO3D_PROFILE("MergeBuffers");
+        for (int y = startY; y < endY; ++y)
+        {
+            DepthValue* src = mipBuffers_[level - 1].get() + (y * 2) * prevWidth;
+            DepthValue* dest = mipBuffers_[level].get() + y * width;
+            DepthValue* end = dest + width;
 
-    for (unsigned i = 1; i < buffers_.size(); ++i)
-    {
-        if (!buffers_[i].used_)
-            continue;
+            if (y * 2 + 1 < prevHeight)
+            {
+                DepthValue* src2 = src + prevWidth;
+                while (dest < end)
+                {
+                    int minUpper = Min(src[0].min_, src[1].min_);
+                    int minLower = Min(src2[0].min_, src2[1].min_);
+                    dest->min_ = Min(minUpper, minLower);
+                    int maxUpper = Max(src[0].max_, src[1].max_);
+                    int maxLower = Max(src2[0].max_, src2[1].max_);
+                    dest->max_ = Max(maxUpper, maxLower);
 
-        int* src = buffers_[i].data_;
-        int* dest = buffers_[0].data_;
-        int count = width_ * height_;
+                    src += 2;
+                    src2 += 2;
+                    ++dest;
+                }
+            }
+            else
+            {
+                while (dest < end)
+                {
+                    dest->min_ = Min(src[0].min_, src[1].min_);
+                    dest->max_ = Max(src[0].max_, src[1].max_);
 
-        while (count--)
-        {
-            // If thread buffer's depth value is closer, overwrite the original
-            if (*src < *dest)
-                *dest = *src;
-            ++src;
-            ++dest;
+                    src += 2;
+                    ++dest;
+                }
+            }
         }
     }
 }
 
-void OcclusionBuffer::ClearBuffer(unsigned threadIndex)
+void OcclusionBuffer::ClearBuffer()
 {
-    if (threadIndex >= buffers_.size())
-        return;
-
-    int* dest = buffers_[threadIndex].data_;
+    int* dest = data_;
     int count = width_ * height_;
     auto fillValue = (int)OCCLUSION_Z_SCALE;
 
@@ -30,6 +30,7 @@
 #include "../Core/Timer.h"
 #include "../Graphics/GraphicsDefs.h"
 #include "../Math/Frustum.h"
+#include "../Math/Vector2.h"
 
 namespace Urho3D
 {
@@ -51,15 +52,24 @@ struct DepthValue
     int max_;
 };
 
-/// Per-thread occlusion buffer data.
-struct OcclusionBufferData
+/// Screen-space triangle waiting for rasterization.
+struct OcclusionTriangle
 {
-    /// Full buffer data with safety padding.
-    ea::shared_array<int> dataWithSafety_;
-    /// Buffer data.
-    int* data_;
-    /// Use flag.
-    bool used_;
+    /// Vertices in viewport coordinates.
+    Vector3 vertices_[3];
+    /// Clockwise winding flag.
+    bool clockwise_;
+};
+
+/// Per-thread occlusion triangle setup data.
+struct OcclusionThreadData
+{
+    /// Triangles set up by the thread.
+    ea::vector<OcclusionTriangle> triangles_;
+    /// Triangle indices for each tile.
+    ea::vector<ea::vector<unsigned> > bins_;
+    /// Number of triangles that passed clipping and culling.
+    unsigned numTriangles_{};
 };
 
 /// Stored occlusion render job.
@@ -87,6 +97,8 @@ static const float OCCLUSION_RELATIVE_BIAS = 0.00001f;
 static const int OCCLUSION_FIXED_BIAS = 16;
 static const float OCCLUSION_X_SCALE = 65536.0f;
 static const float OCCLUSION_Z_SCALE = 16777216.0f;
+static const int OCCLUSION_TILE_HEIGHT = 16;
+static const unsigned OCCLUSION_TILE_MIP_LEVELS = 4;
 
 /// Software renderer for occlusion.
 class URHO3D_API OcclusionBuffer : public Object
@@ -102,7 +114,7 @@ public:
     /// Register object with the engine.
     static void RegisterObject(Context* context);
 
-    /// Set occlusion buffer size and whether to reserve multiple buffers for threading optimization.
+    /// Set occlusion buffer size and whether to use worker threads for triangle setup and rasterization.
     bool SetSize(int width, int height, bool threaded);
     /// Set camera view to render from.
     void SetView(Camera* camera);
@@ -119,15 +131,15 @@ public:
     /// Submit a triangle mesh to the buffer using indexed geometry. Return true if did not overflow the allowed triangle count.
     bool AddTriangles(const Matrix3x4& model, const void* vertexData, unsigned vertexSize, const void* indexData, unsigned indexSize,
         unsigned indexStart, unsigned indexCount);
-    /// Draw submitted batches. Uses worker threads if enabled during SetSize().
+    /// Draw submitted batches. Triangles are set up and binned to tiles by batch, then rasterized by tile. Uses worker threads if enabled during SetSize().
     void DrawTriangles();
-    /// Build reduced size mip levels.
+    /// Build reduced size mip levels. The levels that fit inside a tile are built by tile, using worker threads if enabled.
     void BuildDepthHierarchy();
     /// Reset last used timer.
     void ResetUseTimer();
 
     /// Return highest level depth values.
-    int* GetBuffer() const { return buffers_.size() ? buffers_[0].data_ : nullptr; }
+    int* GetBuffer() const { return data_; }
 
     /// Return view transform matrix.
     const Matrix3x4& GetView() const { return view_; }
@@ -151,15 +163,17 @@ public:
     CullMode GetCullMode() const { return cullMode_; }
 
     /// Return whether is using threads to speed up rendering.
-    bool IsThreaded() const { return buffers_.size() > 1; }
+    bool IsThreaded() const { return threaded_; }
 
     /// Test a bounding box for visibility. For best performance, build depth hierarchy first.
     bool IsVisible(const BoundingBox& worldSpaceBox) const;
     /// Return time since last use in milliseconds.
     unsigned GetUseTimer();
 
-    /// Draw a batch. Called internally.
-    void DrawBatch(const OcclusionBatch& batch, unsigned threadIndex);
+    /// Set up and bin the triangles of a batch. Called internally.
+    void SetupBatch(const OcclusionBatch& batch, unsigned threadIndex);
+    /// Rasterize the binned triangles of a tile. Called internally.
+    void DrawTile(unsigned tileIndex);
 
 private:
     /// Apply modelview transform to vertex.
@@ -172,33 +186,45 @@ private:
     inline float SignedArea(const Vector3& v0, const Vector3& v1, const Vector3& v2) const;
     /// Calculate viewport transform.
     void CalculateViewport();
-    /// Draw a triangle.
-    void DrawTriangle(Vector4* vertices, unsigned threadIndex);
+    /// Clip, project and bin a triangle.
+    void SetupTriangle(Vector4* vertices, unsigned threadIndex);
     /// Clip vertices against a plane.
     void ClipVertices(const Vector4& plane, Vector4* vertices, bool* triangles, unsigned& numTriangles);
-    /// Draw a clipped triangle.
-    void DrawTriangle2D(const Vector3* vertices, bool clockwise, unsigned threadIndex);
-    /// Clear a thread work buffer.
-    void ClearBuffer(unsigned threadIndex);
-    /// Merge thread work buffers into the first buffer.
-    void MergeBuffers();
-
-    /// Highest-level buffer data per thread.
-    ea::vector<OcclusionBufferData> buffers_;
+    /// Add a clipped and projected triangle to the bins of the tiles it covers.
+    void BinTriangle2D(const Vector3* vertices, bool clockwise, unsigned threadIndex);
+    /// Draw a clipped triangle, limited to a range of rows.
+    void DrawTriangle2D(const Vector3* vertices, bool clockwise, int clipTop, int clipBottom);
+    /// Build rows of a mip level from the previous level.
+    void BuildDepthLevel(unsigned level, int startY, int endY);
+    /// Clear the buffer.
+    void ClearBuffer();
+
+    /// Full buffer data with safety padding.
+    ea::shared_array<int> dataWithSafety_;
+    /// Highest-level buffer data.
+    int* data_{};
+    /// Triangle setup data per thread.
+    ea::vector<OcclusionThreadData> threadData_;
     /// Reduced size depth buffers.
     ea::vector<ea::shared_array<DepthValue> > mipBuffers_;
+    /// Reduced size depth buffer dimensions.
+    ea::vector<IntVector2> mipSizes_;
     /// Submitted render jobs.
     ea::vector<OcclusionBatch> batches_;
     /// Buffer width.
     int width_{};
     /// Buffer height.
     int height_{};
+    /// Number of tiles, each covering OCCLUSION_TILE_HEIGHT rows.
+    unsigned numTiles_{};
     /// Number of rendered triangles.
     unsigned numTriangles_{};
     /// Maximum number of triangles.
     unsigned maxTriangles_{OCCLUSION_DEFAULT_MAX_TRIANGLES};
     /// Culling mode.
     CullMode cullMode_{CULL_CCW};
+    /// Use worker threads flag.
+    bool threaded_{};
     /// Depth hierarchy needs update flag.
     bool depthHierarchyDirty_{true};
     /// Culling reverse flag.
@@ -150,22 +150,6 @@ static const int DEFAULT_OCTREE_LEVELS = 8;
 
 extern const char* SUBSYSTEM_CATEGORY;
 
-void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
-{
-    URHO3D_PROFILE("UpdateDrawablesWork");
-    const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
-    auto** start = reinterpret_cast<Drawable**>(item->start_);
-    auto** end = reinterpret_cast<Drawable**>(item->end_);
-
-    while (start != end)
-    {
-        Drawable* drawable = *start;
-        if (drawable)
-            drawable->Update(frame);
-        ++start;
-    }
-}
-
 inline bool CompareRayQueryResults(const RayQueryResult& lhs, const RayQueryResult& rhs)
 {
     return lhs.distance_ < rhs.distance_;
@@ -224,14 +208,21 @@ Octant* Octant::GetOrCreateChild(unsigned index)
         newMax.z_ = oldCenter.z_;
 
     children_[index] = new Octant(BoundingBox(newMin, newMax), level_ + 1, this, root_, index);
+    if (root_)
+        root_->flatOctree_.MarkDirty();
     return children_[index];
 }
 
 void Octant::DeleteChild(unsigned index)
 {
     assert(index < NUM_OCTANTS);
+    if (!children_[index])
+        return;
+
     delete children_[index];
     children_[index] = nullptr;
+    if (root_)
+        root_->flatOctree_.MarkDirty();
 }
 
 void Octant::InsertDrawable(Drawable* drawable)
@@ -462,6 +453,7 @@ void Octree::SetSize(const BoundingBox& box, unsigned numLevels)
     Initialize(box);
     numDrawables_ = drawables_.size();
     numLevels_ = Max(numLevels, 1U);
+    flatOctree_.MarkDirty();
 }
 
 void Octree::Update(const FrameInfo& frame)
@@ -472,6 +464,10 @@ void Octree::Update(const FrameInfo& frame)
         return;
     }
 
+    // Update world transforms of moved nodes in one batch before drawables access them
+    if (Scene* scene = GetScene())
+        scene->UpdateTransforms();
+
     // Let drawables update themselves before reinsertion. This can be used for animation
     if (!drawableUpdates_.empty())
     {
@@ -483,30 +479,17 @@ void Octree::Update(const FrameInfo& frame)
         auto* queue = GetSubsystem<WorkQueue>();
         scene->BeginThreadedUpdate();
 
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = Max((int)(drawableUpdates_.size() / numWorkItems), 1);
-
-        auto start = drawableUpdates_.begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
+        queue->ParallelFor(drawableUpdates_.size(), MIN_DRAWABLES_PER_RANGE, [&](unsigned fromIndex, unsigned toIndex)
         {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = UpdateDrawablesWork;
-            item->aux_ = const_cast<FrameInfo*>(&frame);
-
-            auto end = drawableUpdates_.end();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-
-            start = end;
-        }
+            URHO3D_PROFILE("UpdateDrawablesWork");
+            for (unsigned i = fromIndex; i < toIndex; ++i)
+            {
+                Drawable* drawable = drawableUpdates_[i];
+                if (drawable)
+                    drawable->Update(frame);
+            }
+        });
 
-        queue->Complete(M_MAX_UNSIGNED);
         scene->EndThreadedUpdate();
     }
 
@@ -576,6 +559,12 @@ void Octree::Update(const FrameInfo& frame)
     }
 
     drawableUpdates_.clear();
+
+    if (flattenQueries_ && flatOctree_.IsDirty())
+    {
+        URHO3D_PROFILE("FlattenOctree");
+        flatOctree_.Build(this);
+    }
 }
 
 void Octree::AddManualDrawable(Drawable* drawable)
@@ -596,10 +585,20 @@ void Octree::RemoveManualDrawable(Drawable* drawable)
         octant->RemoveDrawable(drawable);
 }
 
+void Octree::SetFlattenQueries(bool enable)
+{
+    flattenQueries_ = enable;
+    if (flattenQueries_ && flatOctree_.IsDirty())
+        flatOctree_.Build(this);
+}
+
 void Octree::GetDrawables(OctreeQuery& query) const
 {
     query.result_.clear();
-    GetDrawablesInternal(query, false);
+    if (IsFlatOctreeUsable())
+        flatOctree_.GetDrawables(query);
+    else
+        GetDrawablesInternal(query, false);
 }
 
 void Octree::Raycast(RayOctreeQuery& query) const
@@ -607,7 +606,10 @@ void Octree::Raycast(RayOctreeQuery& query) const
     URHO3D_PROFILE("Raycast");
 
     query.result_.clear();
-    GetDrawablesInternal(query);
+    if (IsFlatOctreeUsable())
+        flatOctree_.GetDrawables(query);
+    else
+        GetDrawablesInternal(query);
     ea::quick_sort(query.result_.begin(), query.result_.end(), CompareRayQueryResults);
 }
 
@@ -617,7 +619,10 @@ void Octree::RaycastSingle(RayOctreeQuery& query) const
 
     query.result_.clear();
     rayQueryDrawables_.clear();
-    GetDrawablesOnlyInternal(query, rayQueryDrawables_);
+    if (IsFlatOctreeUsable())
+        flatOctree_.GetDrawablesOnly(query, rayQueryDrawables_);
+    else
+        GetDrawablesOnlyInternal(query, rayQueryDrawables_);
 
     // Sort by increasing hit distance to AABB
     for (auto i = rayQueryDrawables_.begin(); i != rayQueryDrawables_.end(); ++i)
@@ -24,6 +24,7 @@
 
 #include "../Core/Mutex.h"
 #include "../Graphics/Drawable.h"
+#include "../Graphics/FlatOctree.h"
 #include "../Graphics/OctreeQuery.h"
 
 namespace Urho3D
@@ -39,6 +40,8 @@ static const unsigned ROOT_INDEX = M_MAX_UNSIGNED;
 /// %Octree octant.
 class URHO3D_API Octant
 {
+    friend class FlatOctree;
+
 public:
     /// Construct.
     Octant(const BoundingBox& box, unsigned level, Octant* parent, Octree* root, unsigned index = ROOT_INDEX);
@@ -163,6 +166,7 @@ protected:
 class URHO3D_API Octree : public Component, public Octant
 {
     URHO3D_OBJECT(Octree, Component);
+    friend class Octant;
 
 public:
     /// Construct.
@@ -183,6 +187,8 @@ public:
     void AddManualDrawable(Drawable* drawable);
     /// Remove a manually added drawable.
     void RemoveManualDrawable(Drawable* drawable);
+    /// Set whether to answer queries from a flattened copy of the octree with batched SIMD culling. Enabled by default.
+    void SetFlattenQueries(bool enable);
 
     /// Return drawable objects by a query.
     void GetDrawables(OctreeQuery& query) const;
@@ -198,6 +204,10 @@ public:
 
     /// Return subdivision levels.
     unsigned GetNumLevels() const { return numLevels_; }
+    /// Return whether queries use a flattened copy of the octree.
+    bool GetFlattenQueries() const { return flattenQueries_; }
+    /// Return flattened copy of the octree.
+    const FlatOctree& GetFlatOctree() const { return flatOctree_; }
 
     /// Mark drawable object as requiring an update and a reinsertion.
     void QueueUpdate(Drawable* drawable);
@@ -211,6 +221,8 @@ private:
     void HandleRenderUpdate(StringHash eventType, VariantMap& eventData);
     /// Update octree size.
     void UpdateOctreeSize() { SetSize(worldBoundingBox_, numLevels_); }
+    /// Return whether the flattened copy of the octree is up to date and can be used for queries.
+    bool IsFlatOctreeUsable() const { return flattenQueries_ && !flatOctree_.IsDirty(); }
 
     /// Drawable objects that require update.
     ea::vector<Drawable*> drawableUpdates_;
@@ -220,8 +232,12 @@ private:
     Mutex octreeMutex_;
     /// Ray query temporary list of drawables.
     mutable ea::vector<Drawable*> rayQueryDrawables_;
+    /// Flattened copy of the octree. Rebuilt on update when octants have been created or deleted.
+    FlatOctree flatOctree_;
     /// Subdivision level.
     unsigned numLevels_;
+    /// Use flattened copy of the octree for queries flag.
+    bool flattenQueries_{true};
 };
 
 }
@@ -24,11 +24,19 @@
 
 #include "../Graphics/OctreeQuery.h"
 
+#include <typeinfo>
+
 #include "../DebugNew.h"
 
 namespace Urho3D
 {
 
+void OctreeQuery::TestOctants(const BoundingBoxArrays& boxes, unsigned start, unsigned count, bool inside, Intersection* results)
+{
+    for (unsigned i = 0; i < count; ++i)
+        results[i] = TestOctant(boxes.GetBoundingBox(start + i), inside);
+}
+
 Intersection PointOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
     if (inside)
@@ -103,6 +111,28 @@ Intersection FrustumOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
         return frustum_.IsInside(box);
 }
 
+void FrustumOctreeQuery::TestOctants(const BoundingBoxArrays& boxes, unsigned start, unsigned count, bool inside,
+    Intersection* results)
+{
+    // Subclasses may override TestOctant(), which the batched test would bypass
+    if (typeid(*this) == typeid(FrustumOctreeQuery))
+        TestOctantsInFrustum(boxes, start, count, inside, results);
+    else
+        OctreeQuery::TestOctants(boxes, start, count, inside, results);
+}
+
+void FrustumOctreeQuery::TestOctantsInFrustum(const BoundingBoxArrays& boxes, unsigned start, unsigned count, bool inside,
+    Intersection* results)
+{
+    if (inside)
+    {
+        for (unsigned i = 0; i < count; ++i)
+            results[i] = INSIDE;
+    }
+    else
+        IsInside(frustum_, boxes, start, count, results);
+}
+
 void FrustumOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool inside)
 {
     while (start != end)
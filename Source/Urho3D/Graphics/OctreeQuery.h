@@ -28,6 +28,7 @@
 #include "../Graphics/Drawable.h"
 #include "../Math/BoundingBox.h"
 #include "../Math/Frustum.h"
+#include "../Math/MathKernels.h"
 #include "../Math/Ray.h"
 #include "../Math/Sphere.h"
 
@@ -52,8 +53,10 @@ public:
     /// Destruct.
     virtual ~OctreeQuery() = default;
 
-    /// Intersection test for an octant.
+    /// Intersection test for an octant. Used when traversing the octant hierarchy.
     virtual Intersection TestOctant(const BoundingBox& box, bool inside) = 0;
+    /// Intersection test for a range of sibling octants. Used instead of TestOctant() by flattened octree queries, so subclasses that change the octant test must override both. Calls TestOctant() for each octant by default.
+    virtual void TestOctants(const BoundingBoxArrays& boxes, unsigned start, unsigned count, bool inside, Intersection* results);
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside) = 0;
 
@@ -142,11 +145,17 @@ public:
 
     /// Intersection test for an octant.
     Intersection TestOctant(const BoundingBox& box, bool inside) override;
+    /// Intersection test for a range of sibling octants. Uses SIMD instructions for this class, subclasses call TestOctant() for each octant unless they override this function.
+    void TestOctants(const BoundingBoxArrays& boxes, unsigned start, unsigned count, bool inside, Intersection* results) override;
     /// Intersection test for drawables.
     void TestDrawables(Drawable** start, Drawable** end, bool inside) override;
 
     /// Frustum.
     Frustum frustum_;
+
+protected:
+    /// Frustum intersection test for a range of sibling octants using SIMD instructions. For subclasses that keep the frustum octant test or refine its results.
+    void TestOctantsInFrustum(const BoundingBoxArrays& boxes, unsigned start, unsigned count, bool inside, Intersection* results);
 };
 
 /// General octree query result. Used for Lua bindings only.
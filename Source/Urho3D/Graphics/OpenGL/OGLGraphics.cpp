@@ -240,6 +240,9 @@ static const unsigned glElementComponents[] =
     4
 };
 
+/// Time budget per frame for finishing asynchronously compiled shader programs.
+static const long long MAX_SHADER_COMPILE_USEC_PER_FRAME = 4000;
+
 #ifdef GL_ES_VERSION_2_0
 static unsigned glesDepthStencilFormat = GL_DEPTH_COMPONENT16;
 static unsigned glesReadableDepthFormat = GL_DEPTH_COMPONENT;
@@ -644,6 +647,9 @@ void Graphics::EndFrame()
     // Clean up too large scratch buffers
     CleanupScratchBuffers();
 
+    // Advance asynchronously compiling shader programs
+    UpdatePendingShaderPrograms();
+
     // If using an external window, check it for size changes, and reset screen mode if necessary
     if (externalWindow_)
     {
@@ -1036,44 +1042,11 @@ void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
     if (vs == vertexShader_ && ps == pixelShader_)
         return;
 
-    // Compile the shaders now if not yet compiled. If already attempted, do not retry
-    if (vs && !vs->GetGPUObjectName())
-    {
-        if (vs->GetCompilerOutput().empty())
-        {
-            URHO3D_PROFILE("CompileVertexShader");
-
-            bool success = vs->Create();
-            if (success)
-                URHO3D_LOGDEBUG("Compiled vertex shader " + vs->GetFullName());
-            else
-            {
-                URHO3D_LOGERROR("Failed to compile vertex shader " + vs->GetFullName() + ":\n" + vs->GetCompilerOutput());
-                vs = nullptr;
-            }
-        }
-        else
-            vs = nullptr;
-    }
-
-    if (ps && !ps->GetGPUObjectName())
-    {
-        if (ps->GetCompilerOutput().empty())
-        {
-            URHO3D_PROFILE("CompilePixelShader");
-
-            bool success = ps->Create();
-            if (success)
-                URHO3D_LOGDEBUG("Compiled pixel shader " + ps->GetFullName());
-            else
-            {
-                URHO3D_LOGERROR("Failed to compile pixel shader " + ps->GetFullName() + ":\n" + ps->GetCompilerOutput());
-                ps = nullptr;
-            }
-        }
-        else
-            ps = nullptr;
-    }
+    // Do not retry shaders which have already failed to compile
+    if (vs && !vs->GetGPUObjectName() && !vs->GetCompilerOutput().empty())
+        vs = nullptr;
+    if (ps && !ps->GetGPUObjectName() && !ps->GetCompilerOutput().empty())
+        ps = nullptr;
 
     if (!vs || !ps)
     {
@@ -1089,43 +1062,56 @@ void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
 
         ea::pair<ShaderVariation*, ShaderVariation*> combination(vs, ps);
         auto i = impl_->shaderPrograms_.find(combination);
+        ShaderProgram* program = nullptr;
 
         if (i != impl_->shaderPrograms_.end())
-        {
-            // Use the existing linked program
-            if (i->second->GetGPUObjectName())
-            {
-                glUseProgram(i->second->GetGPUObjectName());
-                impl_->shaderProgram_ = i->second;
-            }
-            else
-            {
-                glUseProgram(0);
-                impl_->shaderProgram_ = nullptr;
-            }
-        }
+            program = i->second;
         else
         {
-            // Link a new combination
-            URHO3D_PROFILE("LinkShaders");
-
             SharedPtr<ShaderProgram> newProgram(new ShaderProgram(this, vs, ps));
-            if (newProgram->Link())
+            impl_->shaderPrograms_[combination] = newProgram;
+            program = newProgram;
+
+            if (asyncShaderCompilation_)
             {
-                URHO3D_LOGDEBUG("Linked vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName());
-                // Note: Link() calls glUseProgram() to set the texture sampler uniforms,
-                // so it is not necessary to call it again
-                impl_->shaderProgram_ = newProgram;
+                // Finished by UpdatePendingShaderPrograms() in a later frame
+                newProgram->BeginLink();
+                impl_->pendingShaderPrograms_.push_back(newProgram);
             }
             else
             {
-                URHO3D_LOGERROR("Failed to link vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName() + ":\n" +
-                         newProgram->GetLinkerOutput());
-                glUseProgram(0);
-                impl_->shaderProgram_ = nullptr;
+                // Link a new combination. The shaders are compiled now unless found in the program binary cache
+                URHO3D_PROFILE("LinkShaders");
+
+                if (newProgram->Link())
+                {
+                    URHO3D_LOGDEBUG("Linked vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName());
+                    impl_->fallbackShaderPrograms_[vs] = newProgram;
+                }
+                else
+                {
+                    URHO3D_LOGERROR("Failed to link vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName() + ":\n" +
+                             newProgram->GetLinkerOutput());
+                }
             }
+        }
 
-            impl_->shaderPrograms_[combination] = newProgram;
+        // While compiling asynchronously, use a ready program with the same vertex shader, so that the vertex inputs match
+        if (program->IsLinkPending())
+        {
+            auto j = impl_->fallbackShaderPrograms_.find(vs);
+            program = j != impl_->fallbackShaderPrograms_.end() ? j->second.Get() : nullptr;
+        }
+
+        if (program && program->GetGPUObjectName())
+        {
+            glUseProgram(program->GetGPUObjectName());
+            impl_->shaderProgram_ = program;
+        }
+        else
+        {
+            glUseProgram(0);
+            impl_->shaderProgram_ = nullptr;
         }
     }
 
@@ -2352,10 +2338,86 @@ void Graphics::CleanupShaderPrograms(ShaderVariation* variation)
             ++i;
     }
 
+    for (auto i = impl_->pendingShaderPrograms_.begin(); i != impl_->pendingShaderPrograms_.end();)
+    {
+        if ((*i)->GetVertexShader() == variation || (*i)->GetPixelShader() == variation)
+            i = impl_->pendingShaderPrograms_.erase(i);
+        else
+            ++i;
+    }
+
+    for (auto i = impl_->fallbackShaderPrograms_.begin(); i != impl_->fallbackShaderPrograms_.end();)
+    {
+        if (i->first == variation || i->second->GetPixelShader() == variation)
+            i = impl_->fallbackShaderPrograms_.erase(i);
+        else
+            ++i;
+    }
+
     if (vertexShader_ == variation || pixelShader_ == variation)
         impl_->shaderProgram_ = nullptr;
 }
 
+unsigned Graphics::GetNumPendingShaderPrograms() const
+{
+    return impl_->pendingShaderPrograms_.size();
+}
+
+void Graphics::UpdatePendingShaderPrograms()
+{
+    if (impl_->pendingShaderPrograms_.empty())
+        return;
+
+    URHO3D_PROFILE("UpdatePendingShaderPrograms");
+
+    // Always finish at least one program to guarantee progress, then stop when over the time budget
+    HiresTimer timer;
+    bool finishedAny = false;
+
+    for (auto i = impl_->pendingShaderPrograms_.begin(); i != impl_->pendingShaderPrograms_.end();)
+    {
+        if (finishedAny && timer.GetUSec(false) >= MAX_SHADER_COMPILE_USEC_PER_FRAME)
+            break;
+
+        ShaderProgram* program = *i;
+        if (!program->UpdateLink())
+        {
+            ++i;
+            continue;
+        }
+
+        finishedAny = true;
+        ShaderVariation* vs = program->GetVertexShader();
+        ShaderVariation* ps = program->GetPixelShader();
+        if (vs && ps)
+        {
+            if (program->GetGPUObjectName())
+            {
+                URHO3D_LOGDEBUG("Linked vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName());
+                impl_->fallbackShaderPrograms_[vs] = program;
+            }
+            else
+            {
+                URHO3D_LOGERROR("Failed to link vertex shader " + vs->GetFullName() + " and pixel shader " + ps->GetFullName() + ":\n" +
+                         program->GetLinkerOutput());
+            }
+
+            // Force the finished program to be looked up again if its combination is in use with a fallback
+            if (vs == vertexShader_ && ps == pixelShader_)
+            {
+                vertexShader_ = nullptr;
+                pixelShader_ = nullptr;
+            }
+        }
+
+        i = impl_->pendingShaderPrograms_.erase(i);
+    }
+
+    // Examining a linked program binds it, so restore the program in use
+    if (finishedAny)
+        glUseProgram(impl_->shaderProgram_ ? impl_->shaderProgram_->GetGPUObjectName() : 0);
+}
+
 ConstantBuffer* Graphics::GetOrCreateConstantBuffer(ShaderType /*type*/,  unsigned index, unsigned size)
 {
     // Note: shaderType parameter is not used on OpenGL, instead binding index should already use the PS range
@@ -2384,6 +2446,8 @@ void Graphics::Release(bool clearGPUObjects, bool closeWindow)
         {
             // Shutting down: release all GPU objects that still exist
             // Shader programs are also GPU objects; clear them first to avoid list modification during iteration
+            impl_->pendingShaderPrograms_.clear();
+            impl_->fallbackShaderPrograms_.clear();
             impl_->shaderPrograms_.clear();
 
             for (auto i = gpuObjects_.begin(); i != gpuObjects_.end(); ++i)
@@ -2398,6 +2462,8 @@ void Graphics::Release(bool clearGPUObjects, bool closeWindow)
 
             // In this case clear shader programs last so that they do not attempt to delete their OpenGL program
             // from a context that may no longer exist
+            impl_->pendingShaderPrograms_.clear();
+            impl_->fallbackShaderPrograms_.clear();
             impl_->shaderPrograms_.clear();
 
             SendEvent(E_DEVICELOST);
@@ -2832,6 +2898,18 @@ void Graphics::CheckFeatureSupport()
     if (numSupportedRTs >= 4)
         deferredSupport_ = true;
 
+    // Check for program binary retrieval for the program binary cache, and for compiling shaders on driver threads.
+    // Check the function pointers to work around GLEW failing to check extensions from a GL3 context
+    int numProgramBinaryFormats = 0;
+    if (glGetProgramBinary != nullptr && glProgramBinary != nullptr && glProgramParameteri != nullptr)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numProgramBinaryFormats);
+    impl_->programBinarySupport_ = numProgramBinaryFormats > 0;
+    impl_->parallelShaderCompileSupport_ = glMaxShaderCompilerThreadsARB != nullptr;
+    if (impl_->parallelShaderCompileSupport_)
+        glMaxShaderCompilerThreadsARB(0xffffffffu);
+    impl_->driverVersion_ = ea::string((const char*)glGetString(GL_VENDOR)) + " " + (const char*)glGetString(GL_RENDERER) +
+        " " + (const char*)glGetString(GL_VERSION);
+
 #if defined(__APPLE__) && !defined(IOS) && !defined(TVOS)
     // On macOS check for an Intel driver and use shadow map RGBA dummy color textures, because mixing
     // depth-only FBO rendering and backbuffer rendering will bug, resulting in a black screen in full
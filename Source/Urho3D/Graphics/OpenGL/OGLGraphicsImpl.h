@@ -117,6 +117,12 @@ public:
 
     /// Return the GL Context.
     const SDL_GLContext& GetGLContext() { return context_; }
+    /// Return driver vendor, renderer and version.
+    const ea::string& GetDriverVersion() const { return driverVersion_; }
+    /// Return whether program binaries can be retrieved and loaded.
+    bool GetProgramBinarySupport() const { return programBinarySupport_; }
+    /// Return whether the driver compiles shaders on its own threads.
+    bool GetParallelShaderCompileSupport() const { return parallelShaderCompileSupport_; }
 
 private:
     /// SDL OpenGL context.
@@ -163,12 +169,22 @@ private:
     ShaderProgram* shaderProgram_{};
     /// Linked shader programs.
     ShaderProgramMap shaderPrograms_;
+    /// Shader programs being compiled asynchronously.
+    ea::vector<SharedPtr<ShaderProgram> > pendingShaderPrograms_;
+    /// Most recently linked shader program for each vertex shader. Used as a fallback while compiling asynchronously.
+    ea::unordered_map<ShaderVariation*, SharedPtr<ShaderProgram> > fallbackShaderPrograms_;
+    /// Driver vendor, renderer and version. Used to key the program binary cache.
+    ea::string driverVersion_;
     /// Need FBO commit flag.
     bool fboDirty_{};
     /// Need vertex attribute pointer update flag.
     bool vertexBuffersDirty_{};
     /// sRGB write mode flag.
     bool sRGBWrite_{};
+    /// Program binary retrieval support flag.
+    bool programBinarySupport_{};
+    /// Parallel shader compile support flag.
+    bool parallelShaderCompileSupport_{};
 };
 
 }
@@ -22,11 +22,15 @@
 
 #include "../../Precompiled.h"
 
+#include "../../Core/Context.h"
+#include "../../Core/WorkQueue.h"
 #include "../../Graphics/ConstantBuffer.h"
 #include "../../Graphics/Graphics.h"
 #include "../../Graphics/GraphicsImpl.h"
 #include "../../Graphics/ShaderProgram.h"
 #include "../../Graphics/ShaderVariation.h"
+#include "../../IO/File.h"
+#include "../../IO/FileSystem.h"
 #include "../../IO/Log.h"
 
 #include "../../DebugNew.h"
@@ -44,6 +48,11 @@ static const char* shaderParameterGroups[] = {
     "custom"
 };
 
+/// Program binary cache file identifier.
+static const char* PROGRAM_BINARY_ID = "UPGB";
+/// Link updates to wait before checking the link result when the driver can not be polled. Many drivers link on their own threads anyway, so this hides most of the stall.
+static const unsigned COMPILE_DEFER_FRAMES = 3;
+
 static unsigned NumberPostfix(const ea::string& str)
 {
     for (unsigned i = 0; i < str.length(); ++i)
@@ -55,6 +64,70 @@ static unsigned NumberPostfix(const ea::string& str)
     return M_MAX_UNSIGNED;
 }
 
+/// Accumulate a string into a 64-bit FNV-1a hash.
+static unsigned long long HashSourceCode(unsigned long long hash, const ea::string& str)
+{
+    for (char c : str)
+    {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/// Read a program binary from the cache. Safe to call from worker threads.
+static bool LoadProgramBinary(Context* context, const ea::string& fileName, ShaderProgramBinary& binary)
+{
+    FileSystem* fileSystem = context->GetSubsystem<FileSystem>();
+    if (!fileSystem || !fileSystem->FileExists(fileName))
+        return false;
+
+    File file(context, fileName);
+    if (!file.IsOpen() || file.ReadFileID() != PROGRAM_BINARY_ID)
+        return false;
+
+    binary.format_ = file.ReadUInt();
+    const unsigned size = file.ReadUInt();
+    if (!size || size > file.GetSize() - file.GetPosition())
+        return false;
+
+    binary.data_.resize(size);
+    if (file.Read(binary.data_.data(), size) != size)
+    {
+        binary.data_.clear();
+        return false;
+    }
+
+    return true;
+}
+
+/// Write a program binary to the cache. Safe to call from worker threads.
+static void SaveProgramBinary(Context* context, const ea::string& fileName, const ShaderProgramBinary& binary)
+{
+    File file(context, fileName, FILE_WRITE);
+    if (!file.IsOpen())
+        return;
+
+    file.WriteFileID(PROGRAM_BINARY_ID);
+    file.WriteUInt(binary.format_);
+    file.WriteUInt(binary.data_.size());
+    file.Write(binary.data_.data(), binary.data_.size());
+}
+
+/// Check the result of a shader compile and log it.
+static bool EndCreateShader(ShaderVariation* shader)
+{
+    const char* typeName = shader->GetShaderType() == VS ? "vertex" : "pixel";
+    if (!shader->EndCreate())
+    {
+        URHO3D_LOGERROR(ea::string("Failed to compile ") + typeName + " shader " + shader->GetFullName() + ":\n" +
+            shader->GetCompilerOutput());
+        return false;
+    }
+
+    return true;
+}
+
 unsigned ShaderProgram::globalFrameNumber = 0;
 const void* ShaderProgram::globalParameterSources[MAX_SHADER_PARAMETER_GROUPS];
 
@@ -111,15 +184,183 @@ void ShaderProgram::Release()
         for (unsigned i = 0; i < MAX_SHADER_PARAMETER_GROUPS; ++i)
             constantBuffers_[i].Reset();
     }
+
+    linkState_ = LINK_IDLE;
+    binary_.Reset();
+    compileDeferFrames_ = 0;
 }
 
 bool ShaderProgram::Link()
 {
     Release();
 
-    if (!vertexShader_ || !pixelShader_ || !vertexShader_->GetGPUObjectName() || !pixelShader_->GetGPUObjectName())
+    if (!vertexShader_ || !pixelShader_)
+        return false;
+
+    binaryFileName_ = GetBinaryFileName();
+    if (!binaryFileName_.empty())
+    {
+        ShaderProgramBinary binary;
+        if (LoadProgramBinary(graphics_->GetContext(), binaryFileName_, binary) && LinkBinary(binary))
+            return true;
+    }
+
+    return BeginCompile() && EndCompile();
+}
+
+void ShaderProgram::BeginLink()
+{
+    Release();
+
+    if (!vertexShader_ || !pixelShader_)
+        return;
+
+    binaryFileName_ = GetBinaryFileName();
+    auto* workQueue = graphics_->GetSubsystem<WorkQueue>();
+    if (!binaryFileName_.empty() && workQueue)
+    {
+        // Read the cached binary on a worker thread. The binary is shared with the work item so that releasing the program
+        // while the read is in progress is safe. Completion is signaled through the binary, as the work item is returned
+        // to the work queue pool once completed and must not be polled afterwards
+        Context* context = graphics_->GetContext();
+        ea::string fileName = binaryFileName_;
+        SharedPtr<ShaderProgramBinary> binary(new ShaderProgramBinary());
+        workQueue->AddWorkItem([context, fileName, binary]()
+        {
+            LoadProgramBinary(context, fileName, *binary);
+            binary->loaded_.store(true, std::memory_order_release);
+        });
+        binary_ = binary;
+        linkState_ = LINK_LOADING_BINARY;
+    }
+    else
+        linkState_ = LINK_COMPILE;
+}
+
+bool ShaderProgram::UpdateLink()
+{
+    if (linkState_ == LINK_LOADING_BINARY)
+    {
+        if (!binary_->loaded_.load(std::memory_order_acquire))
+            return false;
+
+        SharedPtr<ShaderProgramBinary> binary = binary_;
+        binary_.Reset();
+
+        if (!binary->data_.empty() && vertexShader_ && pixelShader_ && LinkBinary(*binary))
+        {
+            linkState_ = LINK_IDLE;
+            return true;
+        }
+
+        linkState_ = LINK_COMPILE;
+    }
+
+    if (linkState_ == LINK_COMPILE)
+    {
+        if (!vertexShader_ || !pixelShader_ || !BeginCompile())
+        {
+            Release();
+            return true;
+        }
+
+        linkState_ = LINK_COMPILING;
+        compileDeferFrames_ = 0;
+    }
+
+    if (linkState_ == LINK_COMPILING)
+    {
+#ifndef GL_ES_VERSION_2_0
+        // When the driver compiles on its own threads, poll without blocking
+        if (graphics_->GetImpl()->GetParallelShaderCompileSupport())
+        {
+            int completed = 0;
+            glGetProgramiv(object_.name_, GL_COMPLETION_STATUS_ARB, &completed);
+            if (!completed)
+                return false;
+        }
+        else
+#endif
+        {
+            // Otherwise checking the result blocks until the driver has finished, so give it a few frames first
+            if (compileDeferFrames_++ < COMPILE_DEFER_FRAMES)
+                return false;
+        }
+
+        linkState_ = LINK_IDLE;
+        if (!vertexShader_ || !pixelShader_)
+            Release();
+        else
+            EndCompile();
+    }
+
+    return true;
+}
+
+ea::string ShaderProgram::GetBinaryFileName() const
+{
+    // The cache directory must be absolute, as programs do not belong to any single resource directory
+    const ea::string& cacheDir = graphics_->GetShaderCacheDir();
+    if (!graphics_->GetImpl()->GetProgramBinarySupport() || !IsAbsolutePath(cacheDir))
+        return EMPTY_STRING;
+
+    const ea::string vsSourceCode = vertexShader_->GetCompilerSourceCode();
+    const ea::string psSourceCode = pixelShader_->GetCompilerSourceCode();
+    if (vsSourceCode.empty() || psSourceCode.empty())
+        return EMPTY_STRING;
+
+    // Key by the driver and the full source code including defines, so that any change invalidates the binary
+    unsigned long long hash = 14695981039346656037ull;
+    hash = HashSourceCode(hash, graphics_->GetImpl()->GetDriverVersion());
+    hash = HashSourceCode(hash, vsSourceCode);
+    hash = HashSourceCode(hash, psSourceCode);
+
+    return cacheDir + "GLSL/" + ToStringHex((unsigned)(hash >> 32u)) + ToStringHex((unsigned)hash) + ".bin";
+}
+
+bool ShaderProgram::LinkBinary(const ShaderProgramBinary& binary)
+{
+#ifndef GL_ES_VERSION_2_0
+    object_.name_ = glCreateProgram();
+    if (!object_.name_)
         return false;
 
+    glProgramBinary(object_.name_, binary.format_, binary.data_.data(), binary.data_.size());
+
+    // The driver rejects binaries from a different driver version, in which case compile from source instead
+    int linked;
+    glGetProgramiv(object_.name_, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        glDeleteProgram(object_.name_);
+        object_.name_ = 0;
+        return false;
+    }
+
+    URHO3D_LOGDEBUG("Loaded vertex shader " + vertexShader_->GetFullName() + " and pixel shader " +
+        pixelShader_->GetFullName() + " from program binary cache");
+
+    linkerOutput_.clear();
+    Inspect();
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ShaderProgram::BeginCompile()
+{
+    // Compile the shaders now if not yet compiled. If already attempted, do not retry
+    ShaderVariation* shaders[] = { vertexShader_, pixelShader_ };
+    for (ShaderVariation* shader : shaders)
+    {
+        if (!shader->GetGPUObjectName() && (!shader->GetCompilerOutput().empty() || !shader->BeginCreate()))
+        {
+            linkerOutput_ = "Could not compile " + shader->GetFullName();
+            return false;
+        }
+    }
+
     object_.name_ = glCreateProgram();
     if (!object_.name_)
     {
@@ -127,10 +368,31 @@ bool ShaderProgram::Link()
         return false;
     }
 
+#ifndef GL_ES_VERSION_2_0
+    if (!binaryFileName_.empty())
+        glProgramParameteri(object_.name_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+
     glAttachShader(object_.name_, vertexShader_->GetGPUObjectName());
     glAttachShader(object_.name_, pixelShader_->GetGPUObjectName());
     glLinkProgram(object_.name_);
 
+    return true;
+}
+
+bool ShaderProgram::EndCompile()
+{
+    // Check both shaders to log all compile errors
+    const bool vsCompiled = EndCreateShader(vertexShader_);
+    const bool psCompiled = EndCreateShader(pixelShader_);
+    if (!vsCompiled || !psCompiled)
+    {
+        glDeleteProgram(object_.name_);
+        object_.name_ = 0;
+        linkerOutput_ = "Could not compile shaders";
+        return false;
+    }
+
     int linked, length;
     glGetProgramiv(object_.name_, GL_LINK_STATUS, &linked);
     if (!linked)
@@ -141,13 +403,43 @@ bool ShaderProgram::Link()
         glGetProgramInfoLog(object_.name_, length, &outLength, &linkerOutput_[0]);
         glDeleteProgram(object_.name_);
         object_.name_ = 0;
+        return false;
     }
-    else
-        linkerOutput_.clear();
 
-    if (!object_.name_)
-        return false;
+    linkerOutput_.clear();
 
+#ifndef GL_ES_VERSION_2_0
+    // Store the binary before the uniform block bindings are changed, write the file on a worker thread
+    int binaryLength = 0;
+    if (!binaryFileName_.empty())
+        glGetProgramiv(object_.name_, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    if (binaryLength > 0)
+    {
+        SharedPtr<ShaderProgramBinary> binary(new ShaderProgramBinary());
+        binary->data_.resize((unsigned)binaryLength);
+        GLenum format = 0;
+        glGetProgramBinary(object_.name_, binaryLength, nullptr, &format, binary->data_.data());
+        binary->format_ = format;
+
+        auto* fileSystem = graphics_->GetSubsystem<FileSystem>();
+        if (fileSystem && fileSystem->CreateDirsRecursive(GetPath(binaryFileName_)))
+        {
+            Context* context = graphics_->GetContext();
+            ea::string fileName = binaryFileName_;
+            if (auto* workQueue = graphics_->GetSubsystem<WorkQueue>())
+                workQueue->AddWorkItem([context, fileName, binary]() { SaveProgramBinary(context, fileName, *binary); });
+            else
+                SaveProgramBinary(context, fileName, *binary);
+        }
+    }
+#endif
+
+    Inspect();
+    return true;
+}
+
+void ShaderProgram::Inspect()
+{
     const int MAX_NAME_LENGTH = 256;
     char nameBuffer[MAX_NAME_LENGTH];
     int attributeCount, uniformCount, elementCount, nameLength;
@@ -316,8 +608,6 @@ bool ShaderProgram::Link()
     // Rehash the parameter & vertex attributes maps to ensure minimal load factor
     vertexAttributes_.rehash(Max(2, NextPowerOfTwo(vertexAttributes_.size())));
     shaderParameters_.rehash(Max(2, NextPowerOfTwo(shaderParameters_.size())));
-
-    return true;
 }
 
 ShaderVariation* ShaderProgram::GetVertexShader() const
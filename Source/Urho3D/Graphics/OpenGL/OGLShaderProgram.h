@@ -24,6 +24,8 @@
 
 #include <EASTL/unordered_map.h>
 
+#include <atomic>
+
 #include "../../Container/RefCounted.h"
 #include "../../Graphics/GPUObject.h"
 #include "../../Graphics/GraphicsDefs.h"
@@ -35,6 +37,17 @@ namespace Urho3D
 class ConstantBuffer;
 class Graphics;
 
+/// Linked shader program binary as returned by the driver. Stored in the program binary cache.
+struct ShaderProgramBinary : public RefCounted
+{
+    /// Driver-specific binary format.
+    unsigned format_{};
+    /// Binary data.
+    ea::vector<unsigned char> data_;
+    /// Set by the worker thread when reading from the cache has finished, successfully or not.
+    std::atomic<bool> loaded_{};
+};
+
 /// Linked shader program on the GPU.
 class URHO3D_API ShaderProgram : public RefCounted, public GPUObject
 {
@@ -49,8 +62,14 @@ public:
     /// Release shader program.
     void Release() override;
 
-    /// Link the shaders and examine the uniforms and samplers used. Return true if successful.
+    /// Link the shaders and examine the uniforms and samplers used. Compile the shaders first unless the program is found in the program binary cache. Return true if successful.
     bool Link();
+    /// Begin linking asynchronously. The program binary cache is read on a worker thread, and compilation is deferred to UpdateLink().
+    void BeginLink();
+    /// Advance an asynchronous link. Return true when finished, after which the program is either linked or has failed.
+    bool UpdateLink();
+    /// Return whether an asynchronous link is in progress.
+    bool IsLinkPending() const { return linkState_ != LINK_IDLE; }
 
     /// Return the vertex shader.
     ShaderVariation* GetVertexShader() const;
@@ -88,6 +107,26 @@ public:
     static void ClearGlobalParameterSource(ShaderParameterGroup group);
 
 private:
+    /// Asynchronous link state.
+    enum LinkState
+    {
+        LINK_IDLE = 0,
+        LINK_LOADING_BINARY,
+        LINK_COMPILE,
+        LINK_COMPILING
+    };
+
+    /// Return the program binary cache file name, or empty if the program binary cache is not available.
+    ea::string GetBinaryFileName() const;
+    /// Create the program from a cached binary. Return true if successful.
+    bool LinkBinary(const ShaderProgramBinary& binary);
+    /// Compile the shaders if necessary and issue the link command. Return false if the shaders could not be compiled.
+    bool BeginCompile();
+    /// Check the compile and link results, store the program binary and examine the program. Return true if successful.
+    bool EndCompile();
+    /// Examine the vertex attributes, uniforms and samplers of the linked program.
+    void Inspect();
+
     /// Vertex shader.
     WeakPtr<ShaderVariation> vertexShader_;
     /// Pixel shader.
@@ -108,6 +147,14 @@ private:
     ea::string linkerOutput_;
     /// Shader parameter source framenumber.
     unsigned frameNumber_{};
+    /// Asynchronous link state.
+    LinkState linkState_{LINK_IDLE};
+    /// Program binary cache file name.
+    ea::string binaryFileName_;
+    /// Program binary being read by a worker thread.
+    SharedPtr<ShaderProgramBinary> binary_;
+    /// Number of link updates spent waiting for the driver without parallel compile support.
+    unsigned compileDeferFrames_{};
 
     /// Global shader parameter source framenumber.
     static unsigned globalFrameNumber;
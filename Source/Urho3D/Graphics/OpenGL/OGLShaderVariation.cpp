@@ -59,37 +59,44 @@ void ShaderVariation::OnDeviceLost()
 
 void ShaderVariation::Release()
 {
-    if (object_.name_)
-    {
-        if (!graphics_)
-            return;
+    if (!graphics_)
+        return;
 
-        if (!graphics_->IsDeviceLost())
+    if (!graphics_->IsDeviceLost())
+    {
+        if (type_ == VS)
         {
-            if (type_ == VS)
-            {
-                if (graphics_->GetVertexShader() == this)
-                    graphics_->SetShaders(nullptr, nullptr);
-            }
-            else
-            {
-                if (graphics_->GetPixelShader() == this)
-                    graphics_->SetShaders(nullptr, nullptr);
-            }
-
-            glDeleteShader(object_.name_);
+            if (graphics_->GetVertexShader() == this)
+                graphics_->SetShaders(nullptr, nullptr);
+        }
+        else
+        {
+            if (graphics_->GetPixelShader() == this)
+                graphics_->SetShaders(nullptr, nullptr);
         }
 
-        object_.name_ = 0;
-        graphics_->CleanupShaderPrograms(this);
+        if (object_.name_)
+            glDeleteShader(object_.name_);
     }
 
+    object_.name_ = 0;
+    compilePending_ = false;
+    // Programs loaded from the program binary cache do not require a shader object, so clean up regardless
+    graphics_->CleanupShaderPrograms(this);
+
     compilerOutput_.clear();
 }
 
 bool ShaderVariation::Create()
 {
-    Release();
+    return BeginCreate() && EndCreate();
+}
+
+bool ShaderVariation::BeginCreate()
+{
+    if (object_.name_)
+        Release();
+    compilerOutput_.clear();
 
     if (!owner_)
     {
@@ -104,6 +111,46 @@ bool ShaderVariation::Create()
         return false;
     }
 
+    const ea::string shaderCode = GetCompilerSourceCode();
+    const char* shaderCStr = shaderCode.c_str();
+    glShaderSource(object_.name_, 1, &shaderCStr, nullptr);
+    glCompileShader(object_.name_);
+
+    compilePending_ = true;
+    return true;
+}
+
+bool ShaderVariation::EndCreate()
+{
+    if (!object_.name_)
+        return false;
+    if (!compilePending_)
+        return true;
+
+    compilePending_ = false;
+
+    int compiled, length;
+    glGetShaderiv(object_.name_, GL_COMPILE_STATUS, &compiled);
+    if (!compiled)
+    {
+        glGetShaderiv(object_.name_, GL_INFO_LOG_LENGTH, &length);
+        compilerOutput_.resize((unsigned) length);
+        int outLength;
+        glGetShaderInfoLog(object_.name_, length, &outLength, &compilerOutput_[0]);
+        glDeleteShader(object_.name_);
+        object_.name_ = 0;
+    }
+    else
+        compilerOutput_.clear();
+
+    return object_.name_ != 0;
+}
+
+ea::string ShaderVariation::GetCompilerSourceCode() const
+{
+    if (!owner_)
+        return EMPTY_STRING;
+
     const ea::string& originalShaderCode = owner_->GetSourceCode(type_);
     ea::string shaderCode;
 
@@ -180,25 +227,7 @@ bool ShaderVariation::Create()
     else
         shaderCode += originalShaderCode;
 
-    const char* shaderCStr = shaderCode.c_str();
-    glShaderSource(object_.name_, 1, &shaderCStr, nullptr);
-    glCompileShader(object_.name_);
-
-    int compiled, length;
-    glGetShaderiv(object_.name_, GL_COMPILE_STATUS, &compiled);
-    if (!compiled)
-    {
-        glGetShaderiv(object_.name_, GL_INFO_LOG_LENGTH, &length);
-        compilerOutput_.resize((unsigned) length);
-        int outLength;
-        glGetShaderInfoLog(object_.name_, length, &outLength, &compilerOutput_[0]);
-        glDeleteShader(object_.name_);
-        object_.name_ = 0;
-    }
-    else
-        compilerOutput_.clear();
-
-    return object_.name_ != 0;
+    return shaderCode;
 }
 
 void ShaderVariation::SetDefines(const ea::string& defines)
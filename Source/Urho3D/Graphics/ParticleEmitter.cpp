@@ -24,6 +24,7 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/DrawableEvents.h"
 #include "../Graphics/ParticleEffect.h"
 #include "../Graphics/ParticleEmitter.h"
@@ -40,9 +41,40 @@ namespace Urho3D
 extern const char* GEOMETRY_CATEGORY;
 extern const char* faceCameraModeNames[];
 static const unsigned MAX_PARTICLES_IN_FRAME = 100;
+static const unsigned MIN_PARTICLES_PER_RANGE = 256;
 
 extern const char* autoRemoveModeNames[];
 
+void ParticleEmitter::ParticleData::Resize(unsigned num)
+{
+    velocityX_.resize(num);
+    velocityY_.resize(num);
+    velocityZ_.resize(num);
+    directionX_.resize(num);
+    directionY_.resize(num);
+    directionZ_.resize(num);
+    size_.resize(num);
+    timer_.resize(num);
+    timeToLive_.resize(num);
+    scale_.resize(num);
+    rotationSpeed_.resize(num);
+    colorIndex_.resize(num);
+    texIndex_.resize(num);
+}
+
+ParticleArrays ParticleEmitter::ParticleData::GetArrays()
+{
+    ParticleArrays arrays;
+    arrays.velocityX_ = velocityX_.data();
+    arrays.velocityY_ = velocityY_.data();
+    arrays.velocityZ_ = velocityZ_.data();
+    arrays.scale_ = scale_.data();
+    arrays.directionX_ = directionX_.data();
+    arrays.directionY_ = directionY_.data();
+    arrays.directionZ_ = directionZ_.data();
+    return arrays;
+}
+
 ParticleEmitter::ParticleEmitter(Context* context) :
     BillboardSet(context),
     periodTimer_(0.0f),
@@ -108,8 +140,8 @@ void ParticleEmitter::Update(const FrameInfo& frame)
         return;
 
     // If there is an amount mismatch between particles and billboards, correct it
-    if (particles_.size() != billboards_.size())
-        SetNumBillboards(particles_.size());
+    if (GetNumParticles() != billboards_.size())
+        SetNumBillboards(GetNumParticles());
 
     bool needCommit = false;
 
@@ -166,92 +198,30 @@ void ParticleEmitter::Update(const FrameInfo& frame)
     }
 
     // Update existing particles
-    Vector3 relativeConstantForce = node_->GetWorldRotation().Inverse() * effect_->GetConstantForce();
-    // If billboards are not relative, apply scaling to the position update
-    Vector3 scaleVector = Vector3::ONE;
-    if (scaled_ && !relative_)
-        scaleVector = node_->GetWorldScale();
-
-    for (unsigned i = 0; i < particles_.size(); ++i)
+    const unsigned activeRange = GetActiveParticleRange();
+    if (activeRange)
     {
-        Particle& particle = particles_[i];
-        Billboard& billboard = billboards_[i];
-
-        if (billboard.enabled_)
+        needCommit = true;
+
+        ParticleUpdateParams params;
+        params.timeStep_ = lastTimeStep_;
+        params.constantForce_ = relative_ ? node_->GetWorldRotation().Inverse() * effect_->GetConstantForce() :
+            effect_->GetConstantForce();
+        params.dampingForce_ = effect_->GetDampingForce();
+        params.sizeAdd_ = effect_->GetSizeAdd();
+        params.sizeMul_ = effect_->GetSizeMul();
+
+        // If billboards are not relative, apply scaling to the position update
+        Vector3 scaleVector = Vector3::ONE;
+        if (scaled_ && !relative_)
+            scaleVector = node_->GetWorldScale();
+
+        // Emitters are already updated in parallel by the octree, additionally split large emitters between threads.
+        // ParallelFor may be nested on worker threads: ranges that no other thread has started are run here
+        GetSubsystem<WorkQueue>()->ParallelFor(activeRange, MIN_PARTICLES_PER_RANGE, [&](unsigned fromIndex, unsigned toIndex)
         {
-            needCommit = true;
-
-            // Time to live
-            if (particle.timer_ >= particle.timeToLive_)
-            {
-                billboard.enabled_ = false;
-                continue;
-            }
-            particle.timer_ += lastTimeStep_;
-
-            // Velocity & position
-            const Vector3& constantForce = effect_->GetConstantForce();
-            if (constantForce != Vector3::ZERO)
-            {
-                if (relative_)
-                    particle.velocity_ += lastTimeStep_ * relativeConstantForce;
-                else
-                    particle.velocity_ += lastTimeStep_ * constantForce;
-            }
-
-            float dampingForce = effect_->GetDampingForce();
-            if (dampingForce != 0.0f)
-            {
-                Vector3 force = -dampingForce * particle.velocity_;
-                particle.velocity_ += lastTimeStep_ * force;
-            }
-            billboard.position_ += lastTimeStep_ * particle.velocity_ * scaleVector;
-            billboard.direction_ = particle.velocity_.Normalized();
-
-            // Rotation
-            billboard.rotation_ += lastTimeStep_ * particle.rotationSpeed_;
-
-            // Scaling
-            float sizeAdd = effect_->GetSizeAdd();
-            float sizeMul = effect_->GetSizeMul();
-            if (sizeAdd != 0.0f || sizeMul != 1.0f)
-            {
-                particle.scale_ += lastTimeStep_ * sizeAdd;
-                if (particle.scale_ < 0.0f)
-                    particle.scale_ = 0.0f;
-                if (sizeMul != 1.0f)
-                    particle.scale_ *= (lastTimeStep_ * (sizeMul - 1.0f)) + 1.0f;
-                billboard.size_ = particle.size_ * particle.scale_;
-            }
-
-            // Color interpolation
-            unsigned& index = particle.colorIndex_;
-            const ea::vector<ColorFrame>& colorFrames_ = effect_->GetColorFrames();
-            if (index < colorFrames_.size())
-            {
-                if (index < colorFrames_.size() - 1)
-                {
-                    if (particle.timer_ >= colorFrames_[index + 1].time_)
-                        ++index;
-                }
-                if (index < colorFrames_.size() - 1)
-                    billboard.color_ = colorFrames_[index].Interpolate(colorFrames_[index + 1], particle.timer_);
-                else
-                    billboard.color_ = colorFrames_[index].color_;
-            }
-
-            // Texture animation
-            unsigned& texIndex = particle.texIndex_;
-            const ea::vector<TextureFrame>& textureFrames_ = effect_->GetTextureFrames();
-            if (textureFrames_.size() && texIndex < textureFrames_.size() - 1)
-            {
-                if (particle.timer_ >= textureFrames_[texIndex + 1].time_)
-                {
-                    billboard.uv_ = textureFrames_[texIndex + 1].uv_;
-                    ++texIndex;
-                }
-            }
-        }
+            UpdateParticleRange(params, scaleVector, fromIndex, toIndex);
+        });
     }
 
     if (needCommit)
@@ -286,7 +256,7 @@ void ParticleEmitter::SetNumParticles(unsigned num)
     if (num > M_MAX_INT)
         num = 0;
 
-    particles_.resize(num);
+    particles_.Resize(num);
     SetNumBillboards(num);
 }
 
@@ -371,40 +341,45 @@ void ParticleEmitter::SetParticlesAttr(const VariantVector& value)
     unsigned index = 0;
     SetNumParticles(index < value.size() ? value[index++].GetUInt() : 0);
 
-    for (auto i = particles_.begin(); i != particles_.end() && index < value.size(); ++i)
+    const unsigned numParticles = GetNumParticles();
+    for (unsigned i = 0; i < numParticles && index < value.size(); ++i)
     {
-        i->velocity_ = value[index++].GetVector3();
-        i->size_ = value[index++].GetVector2();
-        i->timer_ = value[index++].GetFloat();
-        i->timeToLive_ = value[index++].GetFloat();
-        i->scale_ = value[index++].GetFloat();
-        i->rotationSpeed_ = value[index++].GetFloat();
-        i->colorIndex_ = (unsigned)value[index++].GetInt();
-        i->texIndex_ = (unsigned)value[index++].GetInt();
+        const Vector3 velocity = value[index++].GetVector3();
+        particles_.velocityX_[i] = velocity.x_;
+        particles_.velocityY_[i] = velocity.y_;
+        particles_.velocityZ_[i] = velocity.z_;
+        particles_.size_[i] = value[index++].GetVector2();
+        particles_.timer_[i] = value[index++].GetFloat();
+        particles_.timeToLive_[i] = value[index++].GetFloat();
+        particles_.scale_[i] = value[index++].GetFloat();
+        particles_.rotationSpeed_[i] = value[index++].GetFloat();
+        particles_.colorIndex_[i] = (unsigned)value[index++].GetInt();
+        particles_.texIndex_[i] = (unsigned)value[index++].GetInt();
     }
 }
 
 VariantVector ParticleEmitter::GetParticlesAttr() const
 {
+    const unsigned numParticles = GetNumParticles();
     VariantVector ret;
     if (!serializeParticles_)
     {
-        ret.push_back((int)particles_.size());
+        ret.push_back((int)numParticles);
         return ret;
     }
 
-    ret.reserve(particles_.size() * 8 + 1);
-    ret.push_back((int)particles_.size());
-    for (auto i = particles_.begin(); i != particles_.end(); ++i)
+    ret.reserve(numParticles * 8 + 1);
+    ret.push_back((int)numParticles);
+    for (unsigned i = 0; i < numParticles; ++i)
     {
-        ret.push_back(i->velocity_);
-        ret.push_back(i->size_);
-        ret.push_back(i->timer_);
-        ret.push_back(i->timeToLive_);
-        ret.push_back(i->scale_);
-        ret.push_back(i->rotationSpeed_);
-        ret.push_back(i->colorIndex_);
-        ret.push_back(i->texIndex_);
+        ret.push_back(Vector3(particles_.velocityX_[i], particles_.velocityY_[i], particles_.velocityZ_[i]));
+        ret.push_back(particles_.size_[i]);
+        ret.push_back(particles_.timer_[i]);
+        ret.push_back(particles_.timeToLive_[i]);
+        ret.push_back(particles_.scale_[i]);
+        ret.push_back(particles_.rotationSpeed_[i]);
+        ret.push_back(particles_.colorIndex_[i]);
+        ret.push_back(particles_.texIndex_[i]);
     }
     return ret;
 }
@@ -450,8 +425,7 @@ bool ParticleEmitter::EmitNewParticle()
     unsigned index = GetFreeParticle();
     if (index == M_MAX_UNSIGNED)
         return false;
-    assert(index < particles_.size());
-    Particle& particle = particles_[index];
+    assert(index < GetNumParticles());
     Billboard& billboard = billboards_[index];
 
     Vector3 startDir;
@@ -513,17 +487,18 @@ bool ParticleEmitter::EmitNewParticle()
         break;
     }
 
-    particle.size_ = effect_->GetRandomSize();
-    particle.timer_ = 0.0f;
-    particle.timeToLive_ = effect_->GetRandomTimeToLive();
-    particle.scale_ = 1.0f;
-    particle.rotationSpeed_ = effect_->GetRandomRotationSpeed();
-    particle.colorIndex_ = 0;
-    particle.texIndex_ = 0;
+    const Vector2 size = effect_->GetRandomSize();
+    particles_.size_[index] = size;
+    particles_.timer_[index] = 0.0f;
+    particles_.timeToLive_[index] = effect_->GetRandomTimeToLive();
+    particles_.scale_[index] = 1.0f;
+    particles_.rotationSpeed_[index] = effect_->GetRandomRotationSpeed();
+    particles_.colorIndex_[index] = 0;
+    particles_.texIndex_[index] = 0;
 
     if (faceCameraMode_ == FC_DIRECTION)
     {
-        startPos += startDir * particle.size_.y_;
+        startPos += startDir * size.y_;
     }
 
     if (!relative_)
@@ -532,10 +507,13 @@ bool ParticleEmitter::EmitNewParticle()
         startDir = node_->GetWorldRotation() * startDir;
     };
 
-    particle.velocity_ = effect_->GetRandomVelocity() * startDir;
+    const Vector3 velocity = effect_->GetRandomVelocity() * startDir;
+    particles_.velocityX_[index] = velocity.x_;
+    particles_.velocityY_[index] = velocity.y_;
+    particles_.velocityZ_[index] = velocity.z_;
 
     billboard.position_ = startPos;
-    billboard.size_ = particles_[index].size_;
+    billboard.size_ = size;
     const ea::vector<TextureFrame>& textureFrames_ = effect_->GetTextureFrames();
     billboard.uv_ = textureFrames_.size() ? textureFrames_[0].uv_ : Rect::POSITIVE;
     billboard.rotation_ = effect_->GetRandomRotation();
@@ -558,6 +536,90 @@ unsigned ParticleEmitter::GetFreeParticle() const
     return M_MAX_UNSIGNED;
 }
 
+unsigned ParticleEmitter::GetActiveParticleRange() const
+{
+    unsigned range = billboards_.size();
+    while (range && !billboards_[range - 1].enabled_)
+        --range;
+
+    return range;
+}
+
+void ParticleEmitter::UpdateParticleRange(const ParticleUpdateParams& params, const Vector3& scaleVector, unsigned start, unsigned end)
+{
+    // Velocity, size scaling and direction of each run of enabled particles at once. Disabled particles are skipped,
+    // as their velocity and scale would grow without bound until reemitted
+    const ParticleArrays arrays = particles_.GetArrays();
+    for (unsigned i = start; i < end;)
+    {
+        while (i < end && !billboards_[i].enabled_)
+            ++i;
+        unsigned runEnd = i;
+        while (runEnd < end && billboards_[runEnd].enabled_)
+            ++runEnd;
+        if (runEnd > i)
+            UpdateParticles(params, arrays, i, runEnd - i);
+        i = runEnd;
+    }
+
+    const float timeStep = params.timeStep_;
+    const bool updateSize = params.sizeAdd_ != 0.0f || params.sizeMul_ != 1.0f;
+    const ea::vector<ColorFrame>& colorFrames = effect_->GetColorFrames();
+    const ea::vector<TextureFrame>& textureFrames = effect_->GetTextureFrames();
+
+    for (unsigned i = start; i < end; ++i)
+    {
+        Billboard& billboard = billboards_[i];
+        if (!billboard.enabled_)
+            continue;
+
+        // Time to live
+        float& timer = particles_.timer_[i];
+        if (timer >= particles_.timeToLive_[i])
+        {
+            billboard.enabled_ = false;
+            continue;
+        }
+        timer += timeStep;
+
+        // Position & rotation
+        const Vector3 velocity(particles_.velocityX_[i], particles_.velocityY_[i], particles_.velocityZ_[i]);
+        billboard.position_ += timeStep * velocity * scaleVector;
+        billboard.direction_ = Vector3(particles_.directionX_[i], particles_.directionY_[i], particles_.directionZ_[i]);
+        billboard.rotation_ += timeStep * particles_.rotationSpeed_[i];
+
+        // Scaling
+        if (updateSize)
+            billboard.size_ = particles_.size_[i] * particles_.scale_[i];
+
+        // Color interpolation
+        unsigned& index = particles_.colorIndex_[i];
+        if (index < colorFrames.size())
+        {
+            if (index < colorFrames.size() - 1)
+            {
+                if (timer >= colorFrames[index + 1].time_)
+                    ++index;
+            }
+            if (index < colorFrames.size() - 1)
+                billboard.color_ = colorFrames[index].Interpolate(colorFrames[index + 1], timer);
+            else
+                billboard.color_ = colorFrames[index].color_;
+        }
+
+        // Texture animation
+        unsigned& texIndex = particles_.texIndex_[i];
+        if (textureFrames.size() && texIndex < textureFrames.size() - 1)
+        {
+            if (timer >= textureFrames[texIndex + 1].time_)
+            {
+                billboard.uv_ = textureFrames[texIndex + 1].uv_;
+                ++texIndex;
+            }
+        }
+    }
+}
+
 bool ParticleEmitter::CheckActiveParticles() const
 {
     for (unsigned i = 0; i < billboards_.size(); ++i)
@@ -23,33 +23,13 @@
 #pragma once
 
 #include "../Graphics/BillboardSet.h"
+#include "../Math/MathKernels.h"
 
 namespace Urho3D
 {
 
 class ParticleEffect;
 
-/// One particle in the particle system.
-struct Particle
-{
-    /// Velocity.
-    Vector3 velocity_;
-    /// Original billboard size.
-    Vector2 size_;
-    /// Time elapsed from creation.
-    float timer_;
-    /// Lifetime.
-    float timeToLive_;
-    /// Size scaling value.
-    float scale_;
-    /// Rotation speed.
-    float rotationSpeed_;
-    /// Current color animation index.
-    unsigned colorIndex_;
-    /// Current texture animation index.
-    unsigned texIndex_;
-};
-
 /// %Particle emitter component.
 class URHO3D_API ParticleEmitter : public BillboardSet
 {
@@ -91,7 +71,7 @@ public:
     ParticleEffect* GetEffect() const;
 
     /// Return maximum number of particles.
-    unsigned GetNumParticles() const { return particles_.size(); }
+    unsigned GetNumParticles() const { return particles_.timer_.size(); }
 
     /// Return whether is currently emitting.
     bool IsEmitting() const { return emitting_; }
@@ -125,6 +105,46 @@ protected:
     bool CheckActiveParticles() const;
 
 private:
+    /// Particle state stored as separate arrays, indexed like the billboards.
+    struct ParticleData
+    {
+        /// Resize all arrays.
+        void Resize(unsigned num);
+        /// Return arrays updated by the particle kernel.
+        ParticleArrays GetArrays();
+
+        /// Velocity X coordinates.
+        ea::vector<float> velocityX_;
+        /// Velocity Y coordinates.
+        ea::vector<float> velocityY_;
+        /// Velocity Z coordinates.
+        ea::vector<float> velocityZ_;
+        /// Normalized velocity X coordinates.
+        ea::vector<float> directionX_;
+        /// Normalized velocity Y coordinates.
+        ea::vector<float> directionY_;
+        /// Normalized velocity Z coordinates.
+        ea::vector<float> directionZ_;
+        /// Original billboard sizes.
+        ea::vector<Vector2> size_;
+        /// Times elapsed from creation.
+        ea::vector<float> timer_;
+        /// Lifetimes.
+        ea::vector<float> timeToLive_;
+        /// Size scaling values.
+        ea::vector<float> scale_;
+        /// Rotation speeds.
+        ea::vector<float> rotationSpeed_;
+        /// Current color animation indices.
+        ea::vector<unsigned> colorIndex_;
+        /// Current texture animation indices.
+        ea::vector<unsigned> texIndex_;
+    };
+
+    /// Update a range of enabled particles and their billboards.
+    void UpdateParticleRange(const ParticleUpdateParams& params, const Vector3& scaleVector, unsigned start, unsigned end);
+    /// Return one past the highest enabled particle index.
+    unsigned GetActiveParticleRange() const;
     /// Handle scene post-update event.
     void HandleScenePostUpdate(StringHash eventType, VariantMap& eventData);
     /// Handle live reload of the particle effect.
@@ -133,7 +153,7 @@ private:
     /// Particle effect.
     SharedPtr<ParticleEffect> effect_;
     /// Particles.
-    ea::vector<Particle> particles_;
+    ParticleData particles_;
     /// Active/inactive period timer.
     float periodTimer_;
     /// New particle emission timer.
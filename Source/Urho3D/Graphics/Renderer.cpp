@@ -763,6 +763,8 @@ void Renderer::Render()
 
     graphics_->SetDefaultTextureFilterMode(textureFilterMode_);
     graphics_->SetDefaultTextureAnisotropy((unsigned)textureAnisotropy_);
+    numStateChanges_ = 0;
+    numStateChangesAvoided_ = 0;
 
     // If no views that render to the backbuffer, clear the screen so that e.g. the UI is not rendered on top of previous frame
     bool hasBackbufferViews = false;
@@ -899,6 +901,10 @@ Geometry* Renderer::GetQuadGeometry()
 
 Texture2D* Renderer::GetShadowMap(Light* light, Camera* camera, unsigned viewWidth, unsigned viewHeight)
 {
+    // Shadow maps can not be created without the Graphics subsystem
+    if (!graphics_)
+        return nullptr;
+
     LightType type = light->GetLightType();
     const FocusParameters& parameters = light->GetShadowFocus();
     float size = (float)shadowMapSize_ * light->GetShadowResolution();
@@ -1327,9 +1333,10 @@ void Renderer::SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows,
         }
     }
 
-    // Log error if shaders could not be assigned, but only once per technique
-    if (!batch.vertexShader_ || !batch.pixelShader_)
+    // Log error if shaders could not be assigned, but only once per technique. Without the Graphics subsystem there are none
+    if (graphics_ && (!batch.vertexShader_ || !batch.pixelShader_))
     {
+        MutexLock lock(shaderErrorMutex_);
         if (!shaderErrorDisplayed_.contains(tech))
         {
             shaderErrorDisplayed_.insert(tech);
@@ -1338,9 +1345,22 @@ void Renderer::SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows,
     }
 }
 
+bool Renderer::HasPassShaders(Pass* pass, const BatchQueue& queue) const
+{
+    if (pass->GetShadersLoadedFrameNumber() != shadersChangedFrameNumber_)
+        return false;
+
+    return queue.hasExtraDefines_ ? pass->HasShaders(queue.vsExtraDefinesHash_, queue.psExtraDefinesHash_) :
+        pass->HasShaders(StringHash::ZERO, StringHash::ZERO);
+}
+
 void Renderer::SetLightVolumeBatchShaders(Batch& batch, Camera* camera, const ea::string& vsName, const ea::string& psName, const ea::string& vsDefines,
     const ea::string& psDefines)
 {
+    // Light volumes are only rendered, there is nothing to set up without the Graphics subsystem
+    if (!graphics_)
+        return;
+
     assert(deferredLightPSVariations_.size());
 
     unsigned vsi = DLVS_NONE;
@@ -1570,7 +1590,7 @@ void Renderer::UpdateQueuedViewport(unsigned index)
     {
         frame_.camera_ = viewport->GetCamera();
         frame_.viewSize_ = viewRect.Size();
-        if (frame_.viewSize_ == IntVector2::ZERO)
+        if (frame_.viewSize_ == IntVector2::ZERO && graphics_)
             frame_.viewSize_ = IntVector2(graphics_->GetWidth(), graphics_->GetHeight());
         octree->Update(frame_);
         updatedOctrees_.insert(octree);
@@ -1646,17 +1666,21 @@ void Renderer::Initialize()
     auto* graphics = GetSubsystem<Graphics>();
     auto* cache = GetSubsystem<ResourceCache>();
 
-    if (!graphics || !graphics->IsInitialized() || !cache)
+    // Without the Graphics subsystem (headless mode) initialize the CPU-side state only. Views can then be defined and
+    // updated, but not rendered
+    if ((graphics && !graphics->IsInitialized()) || !cache)
         return;
 
     URHO3D_PROFILE("InitRenderer");
 
     graphics_ = graphics;
-    graphics_->SetGlobalShaderDefines(globalShaderDefinesString_);
-
-    hardwareSkinningSupported_ = graphics_->GetMaxVertexShaderUniforms() >= 256;
+    if (graphics_)
+    {
+        graphics_->SetGlobalShaderDefines(globalShaderDefinesString_);
+        hardwareSkinningSupported_ = graphics_->GetMaxVertexShaderUniforms() >= 256;
+    }
 
-    if (!graphics_->GetShadowMapFormat())
+    if (!graphics_ || !graphics_->GetShadowMapFormat())
         drawShadows_ = false;
     // Validate the shadow quality level
     SetShadowQuality(shadowQuality_);
@@ -1709,6 +1733,12 @@ void Renderer::LoadPassShaders(Pass* pass, ea::vector<SharedPtr<ShaderVariation>
 {
     URHO3D_PROFILE("LoadPassShaders");
 
+    // Without the Graphics subsystem the variations are left empty, but the tables are still filled for batch setup
+    const auto getShader = [this](ShaderType type, const ea::string& name, const ea::string& defines) -> ShaderVariation*
+    {
+        return graphics_ ? graphics_->GetShader(type, name, defines) : nullptr;
+    };
+
     // Forget all the old shaders
     vertexShaders.clear();
     pixelShaders.clear();
@@ -1753,7 +1783,7 @@ void Renderer::LoadPassShaders(Pass* pass, ea::vector<SharedPtr<ShaderVariation>
             unsigned g = j / MAX_LIGHT_VS_VARIATIONS;
             unsigned l = j % MAX_LIGHT_VS_VARIATIONS;
 
-            vertexShaders[j] = graphics_->GetShader(VS, pass->GetVertexShader(),
+            vertexShaders[j] = getShader(VS, pass->GetVertexShader(),
                 vsDefines + lightVSVariations[l] + geometryVSVariations[g]);
         }
         for (unsigned j = 0; j < MAX_LIGHT_PS_VARIATIONS * 2; ++j)
@@ -1763,12 +1793,12 @@ void Renderer::LoadPassShaders(Pass* pass, ea::vector<SharedPtr<ShaderVariation>
 
             if (l & LPS_SHADOW)
             {
-                pixelShaders[j] = graphics_->GetShader(PS, pass->GetPixelShader(),
+                pixelShaders[j] = getShader(PS, pass->GetPixelShader(),
                     psDefines + lightPSVariations[l] + GetShadowVariations() +
                     heightFogVariations[h]);
             }
             else
-                pixelShaders[j] = graphics_->GetShader(PS, pass->GetPixelShader(),
+                pixelShaders[j] = getShader(PS, pass->GetPixelShader(),
                     psDefines + lightPSVariations[l] + heightFogVariations[h]);
         }
     }
@@ -1782,7 +1812,7 @@ void Renderer::LoadPassShaders(Pass* pass, ea::vector<SharedPtr<ShaderVariation>
             {
                 unsigned g = j / MAX_VERTEXLIGHT_VS_VARIATIONS;
                 unsigned l = j % MAX_VERTEXLIGHT_VS_VARIATIONS;
-                vertexShaders[j] = graphics_->GetShader(VS, pass->GetVertexShader(),
+                vertexShaders[j] = getShader(VS, pass->GetVertexShader(),
                     vsDefines + vertexLightVSVariations[l] + geometryVSVariations[g]);
             }
         }
@@ -1791,7 +1821,7 @@ void Renderer::LoadPassShaders(Pass* pass, ea::vector<SharedPtr<ShaderVariation>
             vertexShaders.resize(MAX_GEOMETRYTYPES);
             for (unsigned j = 0; j < MAX_GEOMETRYTYPES; ++j)
             {
-                vertexShaders[j] = graphics_->GetShader(VS, pass->GetVertexShader(),
+                vertexShaders[j] = getShader(VS, pass->GetVertexShader(),
                     vsDefines + geometryVSVariations[j]);
             }
         }
@@ -1800,7 +1830,7 @@ void Renderer::LoadPassShaders(Pass* pass, ea::vector<SharedPtr<ShaderVariation>
         for (unsigned j = 0; j < 2; ++j)
         {
             pixelShaders[j] =
-                graphics_->GetShader(PS, pass->GetPixelShader(), psDefines + heightFogVariations[j]);
+                getShader(PS, pass->GetPixelShader(), psDefines + heightFogVariations[j]);
         }
     }
 
@@ -1880,7 +1910,7 @@ void Renderer::CreateGeometries()
     pointLightGeometry_->SetDrawRange(TRIANGLE_LIST, 0, plib->GetIndexCount());
 
 #if !defined(URHO3D_OPENGL) || !defined(GL_ES_VERSION_2_0)
-    if (graphics_->GetShadowMapFormat())
+    if (graphics_ && graphics_->GetShadowMapFormat())
     {
         faceSelectCubeMap_ = context_->CreateObject<TextureCube>();
         faceSelectCubeMap_->SetNumLevels(1);
@@ -1948,7 +1978,7 @@ void Renderer::SetIndirectionTextureData()
 void Renderer::CreateInstancingBuffer()
 {
     // Do not create buffer if instancing not supported
-    if (!graphics_->GetInstancingSupport())
+    if (!graphics_ || !graphics_->GetInstancingSupport())
     {
         instancingBuffer_.Reset();
         dynamicInstancing_ = false;
@@ -1986,7 +2016,7 @@ ea::string Renderer::GetShadowVariations() const
         #ifdef URHO3D_OPENGL
             return "SIMPLE_SHADOW ";
         #else
-            if (graphics_->GetHardwareShadowSupport())
+            if (graphics_ && graphics_->GetHardwareShadowSupport())
                 return "SIMPLE_SHADOW ";
             else
                 return "SIMPLE_SHADOW SHADOWCMP ";
@@ -1997,7 +2027,7 @@ ea::string Renderer::GetShadowVariations() const
         #ifdef URHO3D_OPENGL
             return "PCF_SHADOW ";
         #else
-            if (graphics_->GetHardwareShadowSupport())
+            if (graphics_ && graphics_->GetHardwareShadowSupport())
                 return "PCF_SHADOW ";
             else
                 return "PCF_SHADOW SHADOWCMP ";
@@ -375,6 +375,12 @@ public:
     /// Return number of batches rendered.
     unsigned GetNumBatches() const { return numBatches_; }
 
+    /// Return number of batches that set their shaders, render states, textures and material during the last frame.
+    unsigned GetNumStateChanges() const { return numStateChanges_; }
+
+    /// Return number of batches that reused the shaders, render states, textures and material of the previous batch during the last frame.
+    unsigned GetNumStateChangesAvoided() const { return numStateChangesAvoided_; }
+
     /// Return number of geometries rendered.
     unsigned GetNumGeometries(bool allViews = false) const;
     /// Return number of lights rendered.
@@ -438,8 +444,16 @@ public:
     void StorePreparedView(View* view, Camera* camera);
     /// Return a prepared view if exists for the specified camera. Used to avoid duplicate view preparation CPU work.
     View* GetPreparedView(Camera* camera);
+    /// Add batch state statistics of a rendered batch queue.
+    void AddStateChanges(unsigned numChanges, unsigned numAvoided)
+    {
+        numStateChanges_ += numChanges;
+        numStateChangesAvoided_ += numAvoided;
+    }
     /// Choose shaders for a forward rendering batch. The related batch queue is provided in case it has extra shader compilation defines.
     void SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows, const BatchQueue& queue);
+    /// Return whether the shaders of a pass are loaded for a batch queue. If true, SetBatchShaders may be called for the pass from worker threads.
+    bool HasPassShaders(Pass* pass, const BatchQueue& queue) const;
     /// Choose shaders for a deferred light volume batch.
     void SetLightVolumeBatchShaders
         (Batch& batch, Camera* camera, const ea::string& vsName, const ea::string& psName, const ea::string& vsDefines, const ea::string& psDefines);
@@ -555,6 +569,8 @@ private:
     ea::hash_set<Octree*> updatedOctrees_;
     /// Techniques for which missing shader error has been displayed.
     ea::hash_set<Technique*> shaderErrorDisplayed_;
+    /// Mutex for the missing shader error check, which may happen in worker threads.
+    Mutex shaderErrorMutex_;
     /// Mutex for shadow camera allocation.
     Mutex rendererMutex_;
     /// Current variation names for deferred light volume shaders.
@@ -611,6 +627,10 @@ private:
     unsigned numPrimitives_{};
     /// Number of batches (3D geometry only).
     unsigned numBatches_{};
+    /// Number of batch state changes.
+    unsigned numStateChanges_{};
+    /// Number of batch state changes avoided.
+    unsigned numStateChangesAvoided_{};
     /// Frame number on which shaders last changed.
     unsigned shadersChangedFrameNumber_{M_MAX_UNSIGNED};
     /// Current stencil value for light optimization.
@@ -93,6 +93,10 @@ public:
 
     /// Compile the shader. Return true if successful.
     bool Create();
+    /// Start compiling the shader without waiting for the result. Return false if the compile could not be started. On APIs other than OpenGL this compiles immediately.
+    bool BeginCreate();
+    /// Finish a compile started with BeginCreate(). Return true if successful.
+    bool EndCreate();
     /// Set name.
     void SetName(const ea::string& name);
     /// Set defines.
@@ -131,6 +135,9 @@ public:
     /// Return compile error/warning string.
     const ea::string& GetCompilerOutput() const { return compilerOutput_; }
 
+    /// Return the full source code passed to the compiler, including the generated defines. Used only on OpenGL, empty on other APIs.
+    ea::string GetCompilerSourceCode() const;
+
     /// Return constant buffer data sizes.
     const unsigned* GetConstantBufferSizes() const { return &constantBufferSizes_[0]; }
 
@@ -174,6 +181,8 @@ private:
     ea::string definesClipPlane_;
     /// Shader compile error string.
     ea::string compilerOutput_;
+    /// Whether a compile started with BeginCreate() has not been checked yet. Used only on OpenGL.
+    bool compilePending_{};
 };
 
 }
@@ -22,6 +22,8 @@
 
 #include "../Precompiled.h"
 
+#include <EASTL/sort.h>
+
 #include "../Graphics/Skeleton.h"
 #include "../IO/Log.h"
 
@@ -71,6 +73,7 @@ bool Skeleton::Load(Deserializer& source)
         bones_.push_back(newBone);
     }
 
+    UpdateBoneOrder();
     return true;
 }
 
@@ -110,6 +113,8 @@ void Skeleton::Define(const Skeleton& src)
     for (auto i = bones_.begin(); i != bones_.end(); ++i)
         i->node_.Reset();
     rootBoneIndex_ = src.rootBoneIndex_;
+    // Rebuild rather than copy in case the source bones were modified directly
+    UpdateBoneOrder();
 }
 
 void Skeleton::SetRootBoneIndex(unsigned index)
@@ -124,6 +129,42 @@ void Skeleton::ClearBones()
 {
     bones_.clear();
     rootBoneIndex_ = M_MAX_UNSIGNED;
+    boneOrder_.clear();
+    boneParents_.clear();
+}
+
+void Skeleton::UpdateBoneOrder()
+{
+    const unsigned numBones = bones_.size();
+    boneParents_.resize(numBones);
+    for (unsigned i = 0; i < numBones; ++i)
+    {
+        const unsigned parentIndex = bones_[i].parentIndex_;
+        boneParents_[i] = parentIndex != i && parentIndex < numBones ? parentIndex : M_MAX_UNSIGNED;
+    }
+
+    // Sort bones by depth so that parents always precede their children
+    ea::vector<unsigned> depths(numBones);
+    for (unsigned i = 0; i < numBones; ++i)
+    {
+        unsigned depth = 0;
+        for (unsigned j = boneParents_[i]; j != M_MAX_UNSIGNED && depth <= numBones; j = boneParents_[j])
+            ++depth;
+
+        // Treat bones caught in a parent loop as roots
+        if (depth > numBones)
+        {
+            boneParents_[i] = M_MAX_UNSIGNED;
+            depth = 0;
+        }
+        depths[i] = depth;
+    }
+
+    boneOrder_.resize(numBones);
+    for (unsigned i = 0; i < numBones; ++i)
+        boneOrder_[i] = i;
+    ea::stable_sort(boneOrder_.begin(), boneOrder_.end(),
+        [&depths](unsigned lhs, unsigned rhs) { return depths[lhs] < depths[rhs]; });
 }
 
 void Skeleton::Reset()
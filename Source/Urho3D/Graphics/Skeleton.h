@@ -125,6 +125,15 @@ public:
     /// Return number of bones.
     unsigned GetNumBones() const { return bones_.size(); }
 
+    /// Return bone indices in hierarchy order: every bone comes after its parent.
+    const ea::vector<unsigned>& GetBoneOrder() const { return boneOrder_; }
+
+    /// Return parent bone index of each bone, or M_MAX_UNSIGNED for root bones.
+    const ea::vector<unsigned>& GetBoneParents() const { return boneParents_; }
+
+    /// Rebuild the flattened bone hierarchy. Must be called after adding bones or changing parent indices via GetModifiableBones().
+    void UpdateBoneOrder();
+
     /// Return root bone.
     Bone* GetRootBone();
     /// Return index of the bone by name. Return M_MAX_UNSIGNED if not found.
@@ -152,6 +161,10 @@ private:
     ea::vector<Bone> bones_;
     /// Root bone index.
     unsigned rootBoneIndex_;
+    /// Bone indices in hierarchy order.
+    ea::vector<unsigned> boneOrder_;
+    /// Parent bone indices.
+    ea::vector<unsigned> boneParents_;
 };
 
 }
@@ -191,6 +191,29 @@ ea::vector<SharedPtr<ShaderVariation> >& Pass::GetPixelShaders(const StringHash&
         return extraPixelShaders_[extraDefinesHash];
 }
 
+bool Pass::HasShaders(const StringHash& vsExtraDefinesHash, const StringHash& psExtraDefinesHash) const
+{
+    const ea::vector<SharedPtr<ShaderVariation> >* vertexShaders = &vertexShaders_;
+    const ea::vector<SharedPtr<ShaderVariation> >* pixelShaders = &pixelShaders_;
+
+    if (vsExtraDefinesHash.Value())
+    {
+        auto i = extraVertexShaders_.find(vsExtraDefinesHash);
+        if (i == extraVertexShaders_.end())
+            return false;
+        vertexShaders = &i->second;
+    }
+    if (psExtraDefinesHash.Value())
+    {
+        auto i = extraPixelShaders_.find(psExtraDefinesHash);
+        if (i == extraPixelShaders_.end())
+            return false;
+        pixelShaders = &i->second;
+    }
+
+    return !vertexShaders->empty() && !pixelShaders->empty();
+}
+
 unsigned Technique::basePassIndex = 0;
 unsigned Technique::alphaPassIndex = 0;
 unsigned Technique::materialPassIndex = 0;
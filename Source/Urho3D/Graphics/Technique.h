@@ -173,6 +173,8 @@ public:
     ea::vector<SharedPtr<ShaderVariation> >& GetVertexShaders(const StringHash& extraDefinesHash);
     /// Return pixel shaders with extra defines from the renderpath.
     ea::vector<SharedPtr<ShaderVariation> >& GetPixelShaders(const StringHash& extraDefinesHash);
+    /// Return whether shaders have been loaded for the extra defines from the renderpath. Does not create entries, so is safe to call from worker threads.
+    bool HasShaders(const StringHash& vsExtraDefinesHash, const StringHash& psExtraDefinesHash) const;
     /// Return the effective vertex shader defines, accounting for excludes. Called internally by Renderer.
     ea::string GetEffectiveVertexShaderDefines() const;
     /// Return the effective pixel shader defines, accounting for excludes. Called internally by Renderer.
@@ -26,6 +26,7 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/Timer.h"
 #include "../Core/WorkQueue.h"
 #include "../Graphics/Camera.h"
 #include "../Graphics/DebugRenderer.h"
@@ -61,6 +62,9 @@
 namespace Urho3D
 {
 
+/// Minimal number of drawables in one batch collection partition.
+static const unsigned MIN_DRAWABLES_PER_BATCH_PARTITION = 256;
+
 /// Update ambient for Drawable.
 static void UpdateBatchAmbient(Batch& destBatch, GlobalIllumination* gi, Drawable* drawable)
 {
@@ -87,6 +91,12 @@ public:
     {
     }
 
+    /// Intersection test for a range of sibling octants.
+    void TestOctants(const BoundingBoxArrays& boxes, unsigned start, unsigned count, bool inside, Intersection* results) override
+    {
+        TestOctantsInFrustum(boxes, start, count, inside, results);
+    }
+
     /// Intersection test for drawables.
     void TestDrawables(Drawable** start, Drawable** end, bool inside) override
     {
@@ -115,6 +125,12 @@ public:
     {
     }
 
+    /// Intersection test for a range of sibling octants.
+    void TestOctants(const BoundingBoxArrays& boxes, unsigned start, unsigned count, bool inside, Intersection* results) override
+    {
+        TestOctantsInFrustum(boxes, start, count, inside, results);
+    }
+
     /// Intersection test for drawables.
     void TestDrawables(Drawable** start, Drawable** end, bool inside) override
     {
@@ -159,6 +175,17 @@ public:
         }
     }
 
+    /// Intersection test for a range of sibling octants.
+    void TestOctants(const BoundingBoxArrays& boxes, unsigned start, unsigned count, bool inside, Intersection* results) override
+    {
+        TestOctantsInFrustum(boxes, start, count, inside, results);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (results[i] != OUTSIDE && !buffer_->IsVisible(boxes.GetBoundingBox(start + i)))
+                results[i] = OUTSIDE;
+        }
+    }
+
     /// Intersection test for drawables. Note: drawable occlusion is performed later in worker threads.
     void TestDrawables(Drawable** start, Drawable** end, bool inside) override
     {
@@ -178,12 +205,9 @@ public:
     OcclusionBuffer* buffer_;
 };
 
-void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
+void CheckVisibilityWork(View* view, Drawable** start, Drawable** end, unsigned threadIndex)
 {
     URHO3D_PROFILE("CheckVisibilityWork");
-    auto* view = reinterpret_cast<View*>(item->aux_);
-    auto** start = reinterpret_cast<Drawable**>(item->start_);
-    auto** end = reinterpret_cast<Drawable**>(item->end_);
     OcclusionBuffer* buffer = view->occlusionBuffer_;
     const Matrix3x4& viewMatrix = view->cullCamera_->GetView();
     Vector3 viewZ = Vector3(viewMatrix.m20_, viewMatrix.m21_, viewMatrix.m22_);
@@ -278,7 +302,7 @@ void SortBatchQueueFrontToBackWork(const WorkItem* item, unsigned threadIndex)
     URHO3D_PROFILE("SortBatchQueueFrontToBackWork");
     auto* queue = reinterpret_cast<BatchQueue*>(item->start_);
 
-    queue->SortFrontToBack();
+    queue->SortFrontToBack(reinterpret_cast<WorkQueue*>(item->aux_));
 }
 
 void SortBatchQueueBackToFrontWork(const WorkItem* item, unsigned threadIndex)
@@ -286,15 +310,16 @@ void SortBatchQueueBackToFrontWork(const WorkItem* item, unsigned threadIndex)
     URHO3D_PROFILE("SortBatchQueueBackToFrontWork");
     auto* queue = reinterpret_cast<BatchQueue*>(item->start_);
 
-    queue->SortBackToFront();
+    queue->SortBackToFront(reinterpret_cast<WorkQueue*>(item->aux_));
 }
 
 void SortLightQueueWork(const WorkItem* item, unsigned threadIndex)
 {
     URHO3D_PROFILE("SortLightQueueWork");
     auto* start = reinterpret_cast<LightBatchQueue*>(item->start_);
-    start->litBaseBatches_.SortFrontToBack();
-    start->litBatches_.SortFrontToBack();
+    auto* workQueue = reinterpret_cast<WorkQueue*>(item->aux_);
+    start->litBaseBatches_.SortFrontToBack(workQueue);
+    start->litBatches_.SortFrontToBack(workQueue);
 }
 
 void SortShadowQueueWork(const WorkItem* item, unsigned threadIndex)
@@ -302,7 +327,7 @@ void SortShadowQueueWork(const WorkItem* item, unsigned threadIndex)
     URHO3D_PROFILE("SortShadowQueueWork");
     auto* start = reinterpret_cast<LightBatchQueue*>(item->start_);
     for (unsigned i = 0; i < start->shadowSplits_.size(); ++i)
-        start->shadowSplits_[i].shadowBatches_.SortFrontToBack();
+        start->shadowSplits_[i].shadowBatches_.SortFrontToBack(reinterpret_cast<WorkQueue*>(item->aux_));
 }
 
 StringHash ParseTextureTypeXml(ResourceCache* cache, const ea::string& filename);
@@ -333,10 +358,13 @@ bool View::Define(RenderSurface* renderTarget, Viewport* viewport)
     renderTarget_ = renderTarget;
     drawDebug_ = viewport->GetDrawDebug();
 
-    // Validate the rect and calculate size. If zero rect, use whole rendertarget size
-    int rtWidth = renderTarget ? renderTarget->GetWidth() : graphics_->GetWidth();
-    int rtHeight = renderTarget ? renderTarget->GetHeight() : graphics_->GetHeight();
+    // Validate the rect and calculate size. If zero rect, use whole rendertarget size. Without the Graphics subsystem
+    // (headless mode) the backbuffer size is defined by the viewport rect
     const IntRect& rect = viewport->GetRect();
+    int rtWidth = renderTarget ? renderTarget->GetWidth() : graphics_ ? graphics_->GetWidth() : rect.right_;
+    int rtHeight = renderTarget ? renderTarget->GetHeight() : graphics_ ? graphics_->GetHeight() : rect.bottom_;
+    if (!graphics_ && (rtWidth <= 0 || rtHeight <= 0))
+        return false;
 
     if (rect != IntRect::ZERO)
     {
@@ -566,6 +594,8 @@ void View::Update(const FrameInfo& frame)
 
     SendViewEvent(E_BEGINVIEWUPDATE);
 
+    stageTimes_ = ViewStageTimes();
+
     int maxSortedInstances = renderer_->GetMaxSortedInstances();
 
     // Clear buffers, geometry, light, occluder & batch list
@@ -575,9 +605,33 @@ void View::Update(const FrameInfo& frame)
     zones_.clear();
     occluders_.clear();
     activeOccluders_ = 0;
+
+    // Batch groups of the previous frame live in the frame allocator, so release all of them before resetting it.
+    // Only batch groups and their instance data use the allocator. Other per-frame containers keep the heap on purpose:
+    // - tempDrawables_, sceneResults_ and lightQueryResults_ (octree and light query results) are persistent vectors
+    //   that are cleared but keep their capacity, so they do not allocate once warmed up;
+    // - vertexLightQueues_ is filled from worker threads under a mutex, while the allocator is not thread-safe;
+    // - lightQueues_ is only resized, so its elements and their shadow split vectors are reused across frames.
+    // The allocator is reset here per View instead of per thread on E_BEGINFRAME, because Views persist across frames
+    // and are not necessarily updated every frame.
+    for (LightBatchQueue& lightQueue : lightQueues_)
+    {
+        lightQueue.litBaseBatches_.Clear(maxSortedInstances, &frameAllocator_);
+        lightQueue.litBatches_.Clear(maxSortedInstances, &frameAllocator_);
+        for (ShadowBatchQueue& shadowQueue : lightQueue.shadowSplits_)
+            shadowQueue.shadowBatches_.Clear(maxSortedInstances, &frameAllocator_);
+    }
     vertexLightQueues_.clear();
     for (auto i = batchQueues_.begin(); i != batchQueues_.end(); ++i)
-        i->second.Clear(maxSortedInstances);
+        i->second.Clear(maxSortedInstances, &frameAllocator_);
+    frameAllocator_.Reset();
+    for (auto& partition : batchPartitions_)
+    {
+        for (BatchQueue& queue : partition->queues_)
+            queue.Clear(maxSortedInstances, &partition->frameAllocator_);
+        partition->frameAllocator_.Reset();
+    }
+    URHO3D_PROFILE_VALUE("ViewFrameAllocatorPeak", (int64_t)frameAllocator_.GetPeakSize());
 
     if (hasScenePasses_ && (!cullCamera_ || !octree_))
     {
@@ -589,7 +643,9 @@ void View::Update(const FrameInfo& frame)
     if (cullCamera_ && cullCamera_->GetAutoAspectRatio())
         cullCamera_->SetAspectRatioInternal((float)frame_.viewSize_.x_ / (float)frame_.viewSize_.y_);
 
+    HiresTimer stageTimer;
     GetDrawables();
+    stageTimes_.getDrawables_ = stageTimer.GetUSec(false);
     GetBatches();
     renderer_->StorePreparedView(this, cullCamera_);
 
@@ -920,30 +976,11 @@ void View::GetDrawables()
             result.maxZ_ = 0.0f;
         }
 
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = tempDrawables.size() / numWorkItems;
-
-        auto start = tempDrawables.begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
+        queue->ParallelFor(tempDrawables.size(), MIN_DRAWABLES_PER_RANGE,
+            [this, &tempDrawables](unsigned fromIndex, unsigned toIndex, unsigned threadIndex)
         {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = CheckVisibilityWork;
-            item->aux_ = this;
-
-            auto end = tempDrawables.end();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-
-            start = end;
-        }
-
-        queue->Complete(M_MAX_UNSIGNED);
+            CheckVisibilityWork(this, tempDrawables.data() + fromIndex, tempDrawables.data() + toIndex, threadIndex);
+        });
     }
 
     // Combine lights, geometries & scene Z range from the threads
@@ -995,9 +1032,12 @@ void View::GetBatches()
     nonThreadedGeometries_.clear();
     threadedGeometries_.clear();
 
+    HiresTimer stageTimer;
     ProcessLights();
+    stageTimes_.processLights_ = stageTimer.GetUSec(true);
     GetLightBatches();
     GetBaseBatches();
+    stageTimes_.getBatches_ = stageTimer.GetUSec(false);
 }
 
 void View::ProcessLights()
@@ -1069,8 +1109,8 @@ void View::GetLightBatches()
                 lightQueue.light_ = light;
                 lightQueue.negative_ = light->IsNegative();
                 lightQueue.shadowMap_ = nullptr;
-                lightQueue.litBaseBatches_.Clear(maxSortedInstances);
-                lightQueue.litBatches_.Clear(maxSortedInstances);
+                lightQueue.litBaseBatches_.Clear(maxSortedInstances, &frameAllocator_);
+                lightQueue.litBatches_.Clear(maxSortedInstances, &frameAllocator_);
                 if (forwardLightsCommand_)
                 {
                     SetQueueShaderDefines(lightQueue.litBaseBatches_, *forwardLightsCommand_);
@@ -1101,7 +1141,7 @@ void View::GetLightBatches()
                     shadowQueue.shadowCamera_ = shadowCamera;
                     shadowQueue.nearSplit_ = query.shadowNearSplits_[j];
                     shadowQueue.farSplit_ = query.shadowFarSplits_[j];
-                    shadowQueue.shadowBatches_.Clear(maxSortedInstances);
+                    shadowQueue.shadowBatches_.Clear(maxSortedInstances, &frameAllocator_);
 
                     // Setup the shadow split viewport and finalize shadow camera parameters
                     shadowQueue.shadowViewport_ = GetShadowMapViewport(light, j, lightQueue.shadowMap_);
@@ -1148,18 +1188,15 @@ void View::GetLightBatches()
                 }
 
                 // Process lit geometries
-                for (auto j = query.litGeometries_.begin(); j !=
-                    query.litGeometries_.end(); ++j)
+                batchTargets_.clear();
+                batchTargets_.push_back(&lightQueue.litBaseBatches_);
+                batchTargets_.push_back(&lightQueue.litBatches_);
+                batchTargets_.push_back(alphaQueue);
+                CollectBatches(query.litGeometries_.size(), batchTargets_,
+                    [&](unsigned start, unsigned end, BatchPartition* partition)
                 {
-                    Drawable* drawable = *j;
-                    drawable->AddLight(light);
-
-                    // If drawable limits maximum lights, only record the light, and check maximum count / build batches later
-                    if (!drawable->GetMaxLights())
-                        GetLitBatches(drawable, lightQueue, alphaQueue);
-                    else
-                        maxLightsDrawables_.insert(drawable);
-                }
+                    GetLitBatches(query, start, end, lightQueue, alphaQueue, partition);
+                });
 
                 // In deferred modes, store the light volume batch now. Since light mask 8 lowest bits are output to the stencil,
                 // lights that have all zeroes in the low 8 bits can be skipped; they would not affect geometry anyway
@@ -1222,14 +1259,29 @@ void View::GetBaseBatches()
 {
     URHO3D_PROFILE("GetBaseBatches");
 
-    for (auto i = geometries_.begin(); i != geometries_.end(); ++i)
+    batchTargets_.clear();
+    for (const ScenePassInfo& info : scenePasses_)
+        batchTargets_.push_back(info.batchQueue_);
+
+    CollectBatches(geometries_.size(), batchTargets_, [this](unsigned start, unsigned end, BatchPartition* partition)
+    {
+        GetBaseBatches(start, end, partition);
+    });
+}
+
+void View::GetBaseBatches(unsigned start, unsigned end, BatchPartition* partition)
+{
+    ea::vector<Drawable*>& nonThreadedGeometries = partition ? partition->nonThreadedGeometries_ : nonThreadedGeometries_;
+    ea::vector<Drawable*>& threadedGeometries = partition ? partition->threadedGeometries_ : threadedGeometries_;
+
+    for (auto i = geometries_.begin() + start; i != geometries_.begin() + end; ++i)
     {
         Drawable* drawable = *i;
         UpdateGeometryType type = drawable->GetUpdateGeometryType();
         if (type == UPDATE_MAIN_THREAD)
-            nonThreadedGeometries_.push_back(drawable);
+            nonThreadedGeometries.push_back(drawable);
         else if (type == UPDATE_WORKER_THREAD)
-            threadedGeometries_.push_back(drawable);
+            threadedGeometries.push_back(drawable);
 
         const ea::vector<SourceBatch>& batches = drawable->GetBatches();
         bool vertexLightsProcessed = false;
@@ -1239,9 +1291,14 @@ void View::GetBaseBatches()
             const SourceBatch& srcBatch = batches[j];
 
             // Check here if the material refers to a rendertarget texture with camera(s) attached
-            // Only check this for backbuffer views (null rendertarget)
+            // Only check this for backbuffer views (null rendertarget). Render surfaces can only be queued in the main thread
             if (srcBatch.material_ && srcBatch.material_->GetAuxViewFrameNumber() != frame_.frameNumber_ && !renderTarget_)
-                CheckMaterialForAuxView(srcBatch.material_);
+            {
+                if (!partition)
+                    CheckMaterialForAuxView(srcBatch.material_);
+                else if (!partition->auxViewMaterials_.contains(srcBatch.material_))
+                    partition->auxViewMaterials_.push_back(srcBatch.material_);
+            }
 
             Technique* tech = GetTechnique(drawable, srcBatch.material_);
             if (!srcBatch.geometry_ || !srcBatch.numWorldTransforms_ || !tech)
@@ -1282,6 +1339,7 @@ void View::GetBaseBatches()
                     {
                         // Find a vertex light queue. If not found, create new
                         unsigned long long hash = GetVertexLightQueueHash(drawableVertexLights);
+                        MutexLock lock(vertexLightQueuesMutex_);
                         auto i = vertexLightQueues_.find(
                             hash);
                         if (i == vertexLightQueues_.end())
@@ -1302,9 +1360,125 @@ void View::GetBaseBatches()
                 if (allowInstancing && info.markToStencil_ && destBatch.lightMask_ != (destBatch.zone_->GetLightMask() & 0xffu))
                     allowInstancing = false;
 
-                AddBatchToQueue(*info.batchQueue_, destBatch, tech, allowInstancing);
+                AddBatchToQueue(*info.batchQueue_, k, partition, destBatch, tech, allowInstancing);
+            }
+        }
+    }
+}
+
+template <class T> void View::CollectBatches(unsigned numItems, const ea::vector<BatchQueue*>& targets, const T& callback)
+{
+    auto* queue = GetSubsystem<WorkQueue>();
+    const unsigned numPartitions = Min(numItems / MIN_DRAWABLES_PER_BATCH_PARTITION, queue->GetNumThreads() + 1);
+
+    // Collect small amounts directly into the target queues
+    if (numPartitions <= 1)
+    {
+        callback(0, numItems, nullptr);
+        return;
+    }
+
+    // Prepare partitions with the same shader defines as the targets
+    while (batchPartitions_.size() < numPartitions)
+        batchPartitions_.emplace_back(ea::make_unique<BatchPartition>());
+
+    auto maxSortedInstances = (unsigned)renderer_->GetMaxSortedInstances();
+    for (unsigned i = 0; i < numPartitions; ++i)
+    {
+        BatchPartition& partition = *batchPartitions_[i];
+        partition.queues_.resize(targets.size());
+        for (unsigned j = 0; j < targets.size(); ++j)
+        {
+            BatchQueue& partitionQueue = partition.queues_[j];
+            partitionQueue.Clear(maxSortedInstances, &partition.frameAllocator_);
+            if (targets[j])
+            {
+                partitionQueue.hasExtraDefines_ = targets[j]->hasExtraDefines_;
+                partitionQueue.vsExtraDefines_ = targets[j]->vsExtraDefines_;
+                partitionQueue.psExtraDefines_ = targets[j]->psExtraDefines_;
+                partitionQueue.vsExtraDefinesHash_ = targets[j]->vsExtraDefinesHash_;
+                partitionQueue.psExtraDefinesHash_ = targets[j]->psExtraDefinesHash_;
             }
         }
+        partition.deferredBatches_.clear();
+        partition.nonThreadedGeometries_.clear();
+        partition.threadedGeometries_.clear();
+        partition.auxViewMaterials_.clear();
+        partition.maxLightsDrawables_.clear();
+    }
+
+    // Partitions are fixed ranges independent of the thread which processes them
+    const unsigned partitionSize = (numItems + numPartitions - 1) / numPartitions;
+    queue->ParallelFor(numPartitions, 1, [&](unsigned fromIndex, unsigned toIndex)
+    {
+        for (unsigned i = fromIndex; i < toIndex; ++i)
+            callback(Min(i * partitionSize, numItems), Min((i + 1) * partitionSize, numItems), batchPartitions_[i].get());
+    });
+
+    MergeBatchPartitions(numPartitions, targets);
+}
+
+void View::MergeBatchPartitions(unsigned numPartitions, const ea::vector<BatchQueue*>& targets)
+{
+    URHO3D_PROFILE("MergeBatchPartitions");
+
+    for (unsigned i = 0; i < numPartitions; ++i)
+    {
+        BatchPartition& partition = *batchPartitions_[i];
+        nonThreadedGeometries_.insert(nonThreadedGeometries_.end(), partition.nonThreadedGeometries_.begin(),
+            partition.nonThreadedGeometries_.end());
+        threadedGeometries_.insert(threadedGeometries_.end(), partition.threadedGeometries_.begin(),
+            partition.threadedGeometries_.end());
+        for (Drawable* drawable : partition.maxLightsDrawables_)
+            maxLightsDrawables_.insert(drawable);
+        for (Material* material : partition.auxViewMaterials_)
+        {
+            if (material->GetAuxViewFrameNumber() != frame_.frameNumber_)
+                CheckMaterialForAuxView(material);
+        }
+
+        for (unsigned j = 0; j < targets.size(); ++j)
+        {
+            if (targets[j])
+                MergeBatchQueue(*targets[j], partition.queues_[j]);
+        }
+    }
+
+    // Shaders can only be loaded in the main thread, so add the batches which need it last
+    for (unsigned i = 0; i < numPartitions; ++i)
+    {
+        for (DeferredBatch& deferred : batchPartitions_[i]->deferredBatches_)
+        {
+            AddBatchToQueue(*targets[deferred.queueIndex_], deferred.batch_, deferred.tech_, deferred.allowInstancing_,
+                deferred.allowShadows_);
+        }
+    }
+}
+
+void View::MergeBatchQueue(BatchQueue& dest, BatchQueue& source)
+{
+    dest.batches_.insert(dest.batches_.end(), source.batches_.begin(), source.batches_.end());
+
+    for (auto i = source.batchGroups_.begin(); i != source.batchGroups_.end(); ++i)
+    {
+        auto j = dest.batchGroups_.find(i->first);
+        if (j == dest.batchGroups_.end())
+        {
+            // Instances stay in the partition allocator, which is reset together with the view allocator
+            dest.batchGroups_.insert(ea::make_pair(i->first, ea::move(i->second)));
+            continue;
+        }
+
+        BatchGroup& group = j->second;
+        int oldSize = group.instances_.size();
+        group.instances_.insert(group.instances_.end(), i->second.instances_.begin(), i->second.instances_.end());
+        // Convert to using instancing shaders when the merged group reaches the instancing limit
+        if (oldSize < minInstances_ && (int)group.instances_.size() >= minInstances_)
+        {
+            group.geometryType_ = GEOM_INSTANCED;
+            renderer_->SetBatchShaders(group, group.technique_, true, dest);
+            group.CalculateSortKey();
+        }
     }
 }
 
@@ -1319,6 +1493,7 @@ void View::UpdateGeometries()
 
     URHO3D_PROFILE("SortAndUpdateGeometry");
 
+    HiresTimer stageTimer;
     auto* queue = GetSubsystem<WorkQueue>();
 
     // Sort batches
@@ -1336,6 +1511,7 @@ void View::UpdateGeometries()
                 item->workFunction_ =
                     command.sortMode_ == SORT_FRONTTOBACK ? SortBatchQueueFrontToBackWork : SortBatchQueueBackToFrontWork;
                 item->start_ = &batchQueues_[command.passIndex_];
+                item->aux_ = queue;
                 queue->AddWorkItem(item);
             }
         }
@@ -1346,6 +1522,7 @@ void View::UpdateGeometries()
             lightItem->priority_ = M_MAX_UNSIGNED;
             lightItem->workFunction_ = SortLightQueueWork;
             lightItem->start_ = &(*i);
+            lightItem->aux_ = queue;
             queue->AddWorkItem(lightItem);
 
             if (i->shadowSplits_.size())
@@ -1354,6 +1531,7 @@ void View::UpdateGeometries()
                 shadowItem->priority_ = M_MAX_UNSIGNED;
                 shadowItem->workFunction_ = SortShadowQueueWork;
                 shadowItem->start_ = &(*i);
+                shadowItem->aux_ = queue;
                 queue->AddWorkItem(shadowItem);
             }
         }
@@ -1403,12 +1581,36 @@ void View::UpdateGeometries()
             (*i)->UpdateGeometry(frame_);
     }
 
-    // Finally ensure all threaded work has completed
+    // Finally ensure all threaded work has completed, then let the drawables upload data prepared in worker threads
     queue->Complete(M_MAX_UNSIGNED);
+    for (auto i = threadedGeometries_.begin(); i != threadedGeometries_.end(); ++i)
+    {
+        if (*i)
+            (*i)->CommitGeometry(frame_);
+    }
     geometriesUpdated_ = true;
+    stageTimes_.updateGeometries_ = stageTimer.GetUSec(false);
 }
 
-void View::GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQueue* alphaQueue)
+void View::GetLitBatches(const LightQueryResult& query, unsigned start, unsigned end, LightBatchQueue& lightQueue,
+    BatchQueue* alphaQueue, BatchPartition* partition)
+{
+    for (auto i = query.litGeometries_.begin() + start; i != query.litGeometries_.begin() + end; ++i)
+    {
+        Drawable* drawable = *i;
+        drawable->AddLight(query.light_);
+
+        // If drawable limits maximum lights, only record the light, and check maximum count / build batches later
+        if (!drawable->GetMaxLights())
+            GetLitBatches(drawable, lightQueue, alphaQueue, partition);
+        else if (partition)
+            partition->maxLightsDrawables_.push_back(drawable);
+        else
+            maxLightsDrawables_.insert(drawable);
+    }
+}
+
+void View::GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQueue* alphaQueue, BatchPartition* partition)
 {
     Light* light = lightQueue.light_;
     Zone* zone = GetZone(drawable);
@@ -1468,15 +1670,15 @@ void View::GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQ
         if (!isLitAlpha)
         {
             if (destBatch.isBase_)
-                AddBatchToQueue(lightQueue.litBaseBatches_, destBatch, tech);
+                AddBatchToQueue(lightQueue.litBaseBatches_, 0, partition, destBatch, tech);
             else
-                AddBatchToQueue(lightQueue.litBatches_, destBatch, tech);
+                AddBatchToQueue(lightQueue.litBatches_, 1, partition, destBatch, tech);
         }
         else if (alphaQueue)
         {
             // Transparent batches can not be instanced, and shadows on transparencies can only be rendered if shadow maps are
             // not reused
-            AddBatchToQueue(*alphaQueue, destBatch, tech, false, !renderer_->GetReuseShadowMaps());
+            AddBatchToQueue(*alphaQueue, 2, partition, destBatch, tech, false, !renderer_->GetReuseShadowMaps());
         }
     }
 }
@@ -2672,16 +2874,24 @@ void View::SetupDirLightShadowCamera(Camera* shadowCamera, Light* light, float n
     // If focusing enabled, clip the frustum volume by the combined bounding box of the lit geometries within the frustum
     if (parameters.focus_)
     {
-        BoundingBox litGeometriesBox;
-        unsigned lightMask = light->GetLightMaskEffective();
-
-        for (unsigned i = 0; i < geometries_.size(); ++i)
+        const unsigned lightMask = light->GetLightMaskEffective();
+        const BoundingBox litGeometriesBox = GetSubsystem<WorkQueue>()->ParallelReduce(geometries_.size(),
+            MIN_DRAWABLES_PER_RANGE, BoundingBox(), [&](unsigned fromIndex, unsigned toIndex)
         {
-            Drawable* drawable = geometries_[i];
-            if (drawable->GetMinZ() <= farSplit && drawable->GetMaxZ() >= nearSplit &&
-                (GetLightMask(drawable) & lightMask))
-                litGeometriesBox.Merge(drawable->GetWorldBoundingBox());
-        }
+            BoundingBox box;
+            for (unsigned i = fromIndex; i < toIndex; ++i)
+            {
+                Drawable* drawable = geometries_[i];
+                if (drawable->GetMinZ() <= farSplit && drawable->GetMaxZ() >= nearSplit &&
+                    (GetLightMask(drawable) & lightMask))
+                    box.Merge(drawable->GetWorldBoundingBox());
+            }
+            return box;
+        }, [](BoundingBox lhs, const BoundingBox& rhs)
+        {
+            lhs.Merge(rhs);
+            return lhs;
+        });
 
         if (litGeometriesBox.Defined())
         {
@@ -2951,7 +3161,9 @@ void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, boo
             // Create a new group based on the batch
             // In case the group remains below the instancing limit, do not enable instancing shaders yet
             BatchGroup newGroup(batch);
+            newGroup.instances_.set_allocator(queue.batchGroups_.get_allocator());
             newGroup.geometryType_ = GEOM_STATIC;
+            newGroup.technique_ = tech;
             renderer_->SetBatchShaders(newGroup, tech, allowShadows, queue);
             newGroup.CalculateSortKey();
             i = queue.batchGroups_.insert(ea::make_pair(key, newGroup)).first;
@@ -2989,6 +3201,17 @@ void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, boo
     }
 }
 
+void View::AddBatchToQueue(BatchQueue& queue, unsigned queueIndex, BatchPartition* partition, Batch& batch, Technique* tech,
+    bool allowInstancing, bool allowShadows)
+{
+    if (!partition)
+        AddBatchToQueue(queue, batch, tech, allowInstancing, allowShadows);
+    else if (renderer_->HasPassShaders(batch.pass_, queue))
+        AddBatchToQueue(partition->queues_[queueIndex], batch, tech, allowInstancing, allowShadows);
+    else
+        partition->deferredBatches_.push_back(DeferredBatch{batch, tech, queueIndex, allowInstancing, allowShadows});
+}
+
 void View::PrepareInstancingBuffer()
 {
     // Prepare instancing buffer from the source view
@@ -24,6 +24,7 @@
 
 #include <EASTL/unique_ptr.h>
 
+#include "../Core/Mutex.h"
 #include "../Core/Object.h"
 #include "../Graphics/Batch.h"
 #include "../Graphics/Light.h"
@@ -92,6 +93,40 @@ struct ScenePassInfo
     BatchQueue* batchQueue_;
 };
 
+/// Batch that could not be added in a worker thread, because the shaders of its pass were not loaded yet.
+struct DeferredBatch
+{
+    /// Batch.
+    Batch batch_;
+    /// Material technique.
+    Technique* tech_;
+    /// Index of the destination queue.
+    unsigned queueIndex_;
+    /// Allow instancing flag.
+    bool allowInstancing_;
+    /// Allow shadows flag.
+    bool allowShadows_;
+};
+
+/// Batches collected in a worker thread from a contiguous range of drawables. Merged into the view in partition order, so the result does not depend on thread scheduling.
+struct BatchPartition
+{
+    /// Linear allocator for the batch groups of the partition queues.
+    FrameAllocator frameAllocator_;
+    /// Batch queues, one per destination queue.
+    ea::vector<BatchQueue> queues_;
+    /// Batches to add in the main thread.
+    ea::vector<DeferredBatch> deferredBatches_;
+    /// Geometry objects that will be updated in the main thread.
+    ea::vector<Drawable*> nonThreadedGeometries_;
+    /// Geometry objects that will be updated in worker threads.
+    ea::vector<Drawable*> threadedGeometries_;
+    /// Materials to check for auxiliary views in the main thread.
+    ea::vector<Material*> auxViewMaterials_;
+    /// Drawables that limit their maximum light count.
+    ea::vector<Drawable*> maxLightsDrawables_;
+};
+
 /// Per-thread geometry, light and scene range collection structure.
 struct PerThreadSceneResult
 {
@@ -107,10 +142,23 @@ struct PerThreadSceneResult
 
 static const unsigned MAX_VIEWPORT_TEXTURES = 2;
 
+/// CPU time of the view update stages during the last frame, in microseconds.
+struct ViewStageTimes
+{
+    /// Octree query, zone and occluder processing and visibility checks.
+    long long getDrawables_{};
+    /// Lit geometry and shadow caster queries for the visible lights.
+    long long processLights_{};
+    /// Light and base batch construction.
+    long long getBatches_{};
+    /// Batch sorting and geometry update.
+    long long updateGeometries_{};
+};
+
 /// Internal structure for 3D rendering work. Created for each backbuffer and texture viewport, but not for shadow cameras.
 class URHO3D_API View : public Object
 {
-    friend void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex);
+    friend void CheckVisibilityWork(View* view, Drawable** start, Drawable** end, unsigned threadIndex);
     friend void ProcessLightWork(const WorkItem* item, unsigned threadIndex);
 
     URHO3D_OBJECT(View, Object);
@@ -130,6 +178,8 @@ public:
     void Update(const FrameInfo& frame);
     /// Render batches.
     void Render();
+    /// Sort batches and update geometries. Called by Render(), may also be called to prepare a view that is not rendered.
+    void UpdateGeometries();
 
     /// Return scene.
     Scene* GetScene() const { return scene_; }
@@ -180,9 +230,15 @@ public:
     /// Return light batch queues.
     const ea::vector<LightBatchQueue>& GetLightQueues() const { return lightQueues_; }
 
+    /// Return the frame allocator used for batch groups.
+    const FrameAllocator& GetFrameAllocator() const { return frameAllocator_; }
+
     /// Return the last used software occlusion buffer.
     OcclusionBuffer* GetOcclusionBuffer() const { return occlusionBuffer_; }
 
+    /// Return CPU time of the update stages during the last frame.
+    const ViewStageTimes& GetStageTimes() const { return stageTimes_; }
+
     /// Return number of occluders that were actually rendered. Occluders may be rejected if running out of triangles or if behind other occluders.
     unsigned GetNumActiveOccluders() const { return activeOccluders_; }
 
@@ -215,10 +271,19 @@ private:
     void GetLightBatches();
     /// Get unlit batches.
     void GetBaseBatches();
-    /// Update geometries and sort batches.
-    void UpdateGeometries();
+    /// Get unlit batches for a range of visible geometries, into a partition if collecting in a worker thread.
+    void GetBaseBatches(unsigned start, unsigned end, BatchPartition* partition);
+    /// Get pixel lit batches for a range of lit geometries of a light, into a partition if collecting in a worker thread.
+    void GetLitBatches(const LightQueryResult& query, unsigned start, unsigned end, LightBatchQueue& lightQueue, BatchQueue* alphaQueue,
+        BatchPartition* partition);
     /// Get pixel lit batches for a certain light and drawable.
-    void GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQueue* alphaQueue);
+    void GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQueue* alphaQueue, BatchPartition* partition = nullptr);
+    /// Collect batches for a number of items into the target queues. Uses worker threads if there are enough items.
+    template <class T> void CollectBatches(unsigned numItems, const ea::vector<BatchQueue*>& targets, const T& callback);
+    /// Merge the batch partitions into the target queues in partition order.
+    void MergeBatchPartitions(unsigned numPartitions, const ea::vector<BatchQueue*>& targets);
+    /// Merge batches and batch groups of a partition queue into a view queue.
+    void MergeBatchQueue(BatchQueue& dest, BatchQueue& source);
     /// Execute render commands.
     void ExecuteRenderPathCommands();
     /// Set rendertargets for current render command.
@@ -272,6 +337,9 @@ private:
     void SetQueueShaderDefines(BatchQueue& queue, const RenderPathCommand& command);
     /// Choose shaders for a batch and add it to queue.
     void AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, bool allowInstancing = true, bool allowShadows = true);
+    /// Add batch to a target queue, or to the partition queue of the same index if collecting in a worker thread.
+    void AddBatchToQueue(BatchQueue& queue, unsigned queueIndex, BatchPartition* partition, Batch& batch, Technique* tech,
+        bool allowInstancing = true, bool allowShadows = true);
     /// Prepare instancing buffer by filling it with all instance transforms.
     void PrepareInstancingBuffer();
     /// Set up a light volume rendering batch.
@@ -422,12 +490,20 @@ private:
     ea::vector<LightQueryResult> lightQueryResults_;
     /// Info for scene render passes defined by the renderpath.
     ea::vector<ScenePassInfo> scenePasses_;
+    /// Linear allocator for per-frame batch groups and their instance data. Reset in Update(). Must outlive the batch queues below.
+    FrameAllocator frameAllocator_;
     /// Per-pixel light queues.
     ea::vector<LightBatchQueue> lightQueues_;
     /// Per-vertex light queues.
     ea::unordered_map<unsigned long long, LightBatchQueue> vertexLightQueues_;
     /// Batch queues by pass index.
     ea::unordered_map<unsigned, BatchQueue> batchQueues_;
+    /// Batch partitions for collecting batches in worker threads.
+    ea::vector<ea::unique_ptr<BatchPartition> > batchPartitions_;
+    /// Target queues of batch collection.
+    ea::vector<BatchQueue*> batchTargets_;
+    /// Mutex for creating vertex light queues in worker threads.
+    Mutex vertexLightQueuesMutex_;
     /// Index of the GBuffer pass.
     unsigned gBufferPassIndex_{};
     /// Index of the opaque forward base pass.
@@ -448,6 +524,8 @@ private:
     const RenderPathCommand* passCommand_{};
     /// Flag for scene being resolved from the backbuffer.
     bool usedResolve_{};
+    /// CPU time of the update stages.
+    ViewStageTimes stageTimes_;
 };
 
 }
@@ -0,0 +1,718 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/ProcessUtils.h"
+#include "../Core/Thread.h"
+#include "../Core/Timer.h"
+#include "../IO/AsyncFileReader.h"
+#include "../IO/File.h"
+#include "../IO/FileSystem.h"
+#include "../IO/Log.h"
+
+#if defined(__linux__) && !defined(__ANDROID__) && defined(URHO3D_THREADING) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define URHO3D_IO_URING
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#endif
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Default number of blocking reader threads. Reads mostly wait for the device, so this does not depend on the CPU count.
+static const unsigned DEFAULT_NUM_READER_THREADS = 4;
+/// Number of io_uring submission queue entries, which also limits the reads in flight.
+static const unsigned IO_URING_QUEUE_DEPTH = 128;
+
+/// Reader thread running a function.
+class AsyncReaderThread : public Thread
+{
+public:
+    /// Construct.
+    explicit AsyncReaderThread(std::function<void()> function) :
+        function_(ea::move(function))
+    {
+    }
+
+    /// Destruct. Wait for the function to return.
+    ~AsyncReaderThread() override
+    {
+        Stop();
+    }
+
+    /// Run the function.
+    void ThreadFunction() override { function_(); }
+
+private:
+    /// Thread function.
+    std::function<void()> function_;
+};
+
+}
+
+#ifdef URHO3D_IO_URING
+
+/// io_uring backend of the asynchronous file reader. Reads are submitted by the calling threads and completed by a reaper thread.
+class IOUringReader
+{
+public:
+    /// Construct.
+    explicit IOUringReader(AsyncFileReader& owner) :
+        owner_(owner)
+    {
+    }
+
+    /// Destruct. Wait for the reads in flight and release the ring.
+    ~IOUringReader()
+    {
+        if (reaper_)
+        {
+            ea::vector<PendingRead*> failedReads;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+                // Wake up the reaper thread with a no-op
+                if (io_uring_sqe* sqe = GetSqe())
+                {
+                    sqe->opcode = IORING_OP_NOP;
+                    sqe->user_data = 0;
+                }
+                Flush(failedReads);
+            }
+            FailReads(failedReads);
+            reaper_.reset();
+        }
+
+        if (sqes_)
+            munmap(sqes_, sqesSize_);
+        if (cqRing_ && cqRing_ != sqRing_)
+            munmap(cqRing_, cqRingSize_);
+        if (sqRing_)
+            munmap(sqRing_, sqRingSize_);
+        if (ringFd_ >= 0)
+            close(ringFd_);
+    }
+
+    /// Create the ring and start the reaper thread. Return true if successful.
+    bool Initialize(unsigned queueDepth)
+    {
+        io_uring_params params{};
+        ringFd_ = static_cast<int>(syscall(__NR_io_uring_setup, queueDepth, &params));
+        if (ringFd_ < 0)
+            return false;
+
+        sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMmap)
+            sqRingSize_ = cqRingSize_ = Max(sqRingSize_, cqRingSize_);
+
+        sqRing_ = MapRing(sqRingSize_, IORING_OFF_SQ_RING);
+        cqRing_ = singleMmap ? sqRing_ : MapRing(cqRingSize_, IORING_OFF_CQ_RING);
+        sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(MapRing(sqesSize_, IORING_OFF_SQES));
+        if (!sqRing_ || !cqRing_ || !sqes_)
+            return false;
+
+        auto* sqRing = static_cast<unsigned char*>(sqRing_);
+        sqHead_ = reinterpret_cast<unsigned*>(sqRing + params.sq_off.head);
+        sqTail_ = reinterpret_cast<unsigned*>(sqRing + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<unsigned*>(sqRing + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned*>(sqRing + params.sq_off.array);
+        sqEntries_ = params.sq_entries;
+        sqLocalTail_ = *sqTail_;
+
+        auto* cqRing = static_cast<unsigned char*>(cqRing_);
+        cqHead_ = reinterpret_cast<unsigned*>(cqRing + params.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned*>(cqRing + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned*>(cqRing + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cqRing + params.cq_off.cqes);
+
+        reaper_ = ea::make_unique<AsyncReaderThread>([this]() { ReapCompletions(); });
+        reaper_->SetName("AsyncFileReader");
+        if (!reaper_->Run())
+        {
+            reaper_.reset();
+            return false;
+        }
+
+        return true;
+    }
+
+    /// Open the files and submit the reads.
+    void Submit(const ea::vector<AsyncReadRequest*>& requests)
+    {
+        // Open outside the lock. Requests that fail to open or have nothing to read are finished after submitting
+        ea::vector<PendingRead*> reads;
+        ea::vector<ea::pair<AsyncReadRequest*, bool> > finishedRequests;
+        reads.reserve(requests.size());
+        for (AsyncReadRequest* request : requests)
+        {
+            bool success = false;
+            if (PendingRead* read = OpenRead(request, success))
+                reads.push_back(read);
+            else
+                finishedRequests.emplace_back(request, success);
+        }
+
+        ea::vector<PendingRead*> failedReads;
+        if (!reads.empty())
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (PendingRead* read : reads)
+            {
+                if (inFlight_ < sqEntries_)
+                {
+                    PrepareRead(read);
+                    ++inFlight_;
+                }
+                else
+                    overflow_.push_back(read);
+            }
+            Flush(failedReads);
+        }
+
+        FailReads(failedReads);
+        for (const auto& finished : finishedRequests)
+            owner_.FinishRead(finished.first, finished.second);
+    }
+
+private:
+    /// Read in flight.
+    struct PendingRead
+    {
+        /// Request.
+        SharedPtr<AsyncReadRequest> request_;
+        /// File descriptor.
+        int fd_;
+        /// Total number of bytes to read.
+        unsigned size_;
+        /// Number of bytes read so far.
+        unsigned done_;
+        /// Destination of the remaining bytes. Must stay valid until completion.
+        iovec iovec_;
+    };
+
+    /// Map a region of the ring. Return null on failure.
+    void* MapRing(size_t size, off_t offset)
+    {
+        void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, offset);
+        return ptr != MAP_FAILED ? ptr : nullptr;
+    }
+
+    /// Open the file of a request and size its buffer. Return null with the result if there is nothing to read.
+    PendingRead* OpenRead(AsyncReadRequest* request, bool& success)
+    {
+        const int fd = open(GetNativePath(request->fileName_).c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            URHO3D_LOGERROR("Could not open file " + request->fileName_);
+            success = false;
+            return nullptr;
+        }
+
+        struct stat fileStat{};
+        if (fstat(fd, &fileStat) != 0 || request->offset_ > fileStat.st_size)
+        {
+            URHO3D_LOGERROR("Could not read file " + request->fileName_);
+            close(fd);
+            success = false;
+            return nullptr;
+        }
+
+        const auto available = static_cast<unsigned long long>(fileStat.st_size - request->offset_);
+        const auto size = static_cast<unsigned>(Min<unsigned long long>(request->size_, available));
+        request->data_.resize(size);
+        if (!size)
+        {
+            close(fd);
+            success = true;
+            return nullptr;
+        }
+
+        return new PendingRead{SharedPtr<AsyncReadRequest>(request), fd, size, 0, {}};
+    }
+
+    /// Queue the remaining part of a read. Mutex must be held.
+    void PrepareRead(PendingRead* read)
+    {
+        // The number of reads in flight never exceeds the queue size, so there is always a free entry
+        io_uring_sqe* sqe = GetSqe();
+        assert(sqe);
+
+        read->iovec_.iov_base = read->request_->data_.data() + read->done_;
+        read->iovec_.iov_len = read->size_ - read->done_;
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = read->fd_;
+        sqe->addr = reinterpret_cast<unsigned long long>(&read->iovec_);
+        sqe->len = 1;
+        sqe->off = static_cast<unsigned long long>(read->request_->offset_) + read->done_;
+        sqe->user_data = reinterpret_cast<unsigned long long>(read);
+    }
+
+    /// Return a free submission queue entry, or null if the queue is full. Mutex must be held.
+    io_uring_sqe* GetSqe()
+    {
+        const unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if (sqLocalTail_ - head >= sqEntries_)
+            return nullptr;
+
+        const unsigned index = sqLocalTail_ & sqMask_;
+        sqArray_[index] = index;
+        ++sqLocalTail_;
+
+        io_uring_sqe* sqe = &sqes_[index];
+        memset(sqe, 0, sizeof(io_uring_sqe));
+        return sqe;
+    }
+
+    /// Publish the queued entries and submit them to the kernel. On failure, take back the unsubmitted reads and the
+    /// reads waiting for queue entries into failedReads, to be finished with FailReads() after unlocking. Mutex must be held.
+    void Flush(ea::vector<PendingRead*>& failedReads)
+    {
+        __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+        for (;;)
+        {
+            const unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+            const unsigned toSubmit = sqLocalTail_ - head;
+            if (!toSubmit)
+                break;
+
+            const long result = syscall(__NR_io_uring_enter, ringFd_, toSubmit, 0, 0, nullptr, 0);
+            if (result >= 0 || errno == EINTR)
+                continue;
+
+            // Nothing else submits, so the entries stay unconsumed and the tail can be moved back over them
+            URHO3D_LOGERRORF("Could not submit file reads to io_uring, error %d", errno);
+            for (unsigned i = head; i != sqLocalTail_; ++i)
+            {
+                if (auto* read = reinterpret_cast<PendingRead*>(sqes_[sqArray_[i & sqMask_]].user_data))
+                {
+                    failedReads.push_back(read);
+                    --inFlight_;
+                }
+            }
+            sqLocalTail_ = head;
+            __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+
+            // The waiting reads would not be issued either, as no completions are coming for the failed ones
+            failedReads.insert(failedReads.end(), overflow_.begin(), overflow_.end());
+            overflow_.clear();
+            break;
+        }
+    }
+
+    /// Finish reads that failed to submit. Mutex must not be held.
+    void FailReads(const ea::vector<PendingRead*>& failedReads)
+    {
+        for (PendingRead* read : failedReads)
+        {
+            close(read->fd_);
+            owner_.FinishRead(read->request_, false);
+            delete read;
+        }
+    }
+
+    /// Wait for the next completion. Called by the reaper thread only.
+    void WaitCompletion(io_uring_cqe& cqe)
+    {
+        for (;;)
+        {
+            const unsigned head = *cqHead_;
+            if (head != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE))
+            {
+                cqe = cqes_[head & cqMask_];
+                __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+                return;
+            }
+
+            const long result = syscall(__NR_io_uring_enter, ringFd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (result < 0 && errno != EINTR && errno != EAGAIN)
+                Time::Sleep(1);
+        }
+    }
+
+    /// Complete reads until stopped. Called by the reaper thread.
+    void ReapCompletions()
+    {
+        for (;;)
+        {
+            io_uring_cqe cqe{};
+            WaitCompletion(cqe);
+
+            if (cqe.user_data)
+                HandleCompletion(reinterpret_cast<PendingRead*>(cqe.user_data), cqe.res);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_ && !inFlight_ && overflow_.empty())
+                return;
+        }
+    }
+
+    /// Handle a completion of a read: continue short reads, finish the others.
+    void HandleCompletion(PendingRead* read, int result)
+    {
+        bool finished = false;
+        bool success = false;
+        if (result > 0)
+        {
+            read->done_ += result;
+            finished = read->done_ >= read->size_;
+            success = finished;
+        }
+        else if (result != -EAGAIN && result != -EINTR)
+        {
+            // End of file before the expected size or an I/O error
+            URHO3D_LOGERROR("Error while reading from file " + read->request_->fileName_);
+            finished = true;
+        }
+
+        ea::vector<PendingRead*> failedReads;
+        if (!finished)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                PrepareRead(read);
+                Flush(failedReads);
+            }
+            FailReads(failedReads);
+            return;
+        }
+
+        close(read->fd_);
+        owner_.FinishRead(read->request_, success);
+        delete read;
+
+        // Issue reads that did not fit into the queue
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --inFlight_;
+            while (!overflow_.empty() && inFlight_ < sqEntries_)
+            {
+                PrepareRead(overflow_.front());
+                overflow_.pop_front();
+                ++inFlight_;
+            }
+            Flush(failedReads);
+        }
+        FailReads(failedReads);
+    }
+
+    /// Owning reader, which finishes the reads.
+    AsyncFileReader& owner_;
+    /// Ring file descriptor.
+    int ringFd_{-1};
+    /// Submission queue ring mapping.
+    void* sqRing_{};
+    /// Completion queue ring mapping. May be the same as the submission queue mapping.
+    void* cqRing_{};
+    /// Submission queue entries.
+    io_uring_sqe* sqes_{};
+    /// Size of the submission queue ring mapping.
+    size_t sqRingSize_{};
+    /// Size of the completion queue ring mapping.
+    size_t cqRingSize_{};
+    /// Size of the submission queue entries mapping.
+    size_t sqesSize_{};
+    /// Submission queue head, advanced by the kernel.
+    unsigned* sqHead_{};
+    /// Submission queue tail.
+    unsigned* sqTail_{};
+    /// Submission queue index array.
+    unsigned* sqArray_{};
+    /// Submission queue index mask.
+    unsigned sqMask_{};
+    /// Number of submission queue entries.
+    unsigned sqEntries_{};
+    /// Submission queue tail including entries not published yet.
+    unsigned sqLocalTail_{};
+    /// Completion queue head.
+    unsigned* cqHead_{};
+    /// Completion queue tail, advanced by the kernel.
+    unsigned* cqTail_{};
+    /// Completion queue index mask.
+    unsigned cqMask_{};
+    /// Completion queue entries.
+    io_uring_cqe* cqes_{};
+    /// Mutex for the submission queue and the read counters.
+    std::mutex mutex_;
+    /// Number of reads submitted to the ring.
+    unsigned inFlight_{};
+    /// Reads waiting for free queue entries.
+    ea::deque<PendingRead*> overflow_;
+    /// Whether the reader is shutting down.
+    bool stopping_{};
+    /// Reaper thread.
+    ea::unique_ptr<Thread> reaper_;
+};
+
+#else
+
+/// Placeholder of the io_uring backend on platforms that do not support it.
+class IOUringReader
+{
+};
+
+#endif
+
+AsyncReadRequest::AsyncReadRequest(const ea::string& fileName, unsigned offset, unsigned size) :
+    fileName_(fileName),
+    offset_(offset),
+    size_(size)
+{
+}
+
+bool AsyncReadRequest::Wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_.wait(lock, [this]() { return completed_; });
+    return IsSucceeded();
+}
+
+void AsyncReadRequest::Finish(bool success)
+{
+    if (success && processFunction_)
+        success = processFunction_(data_);
+    if (!success)
+        data_.clear();
+
+    state_.store(success ? ASYNC_READ_SUCCEEDED : ASYNC_READ_FAILED, std::memory_order_release);
+    if (callback_)
+        callback_(this);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    completed_ = true;
+    finished_.notify_all();
+}
+
+AsyncFileReader::AsyncFileReader(Context* context) :
+    Object(context),
+    numThreads_(DEFAULT_NUM_READER_THREADS),
+    useIOUring_(true),
+    started_(false),
+    stopping_(false)
+{
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    // Wait for the reads in flight first, as they may queue processing for the pool threads
+    ioUring_.reset();
+
+    // Queued requests are still read before the pool threads exit
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queueCondition_.notify_all();
+    threads_.clear();
+}
+
+void AsyncFileReader::Submit(AsyncReadRequest* request)
+{
+    if (request)
+        Submit(ea::vector<SharedPtr<AsyncReadRequest> >{ SharedPtr<AsyncReadRequest>(request) });
+}
+
+void AsyncFileReader::Submit(const ea::vector<SharedPtr<AsyncReadRequest> >& requests)
+{
+    auto* fileSystem = GetSubsystem<FileSystem>();
+
+    ea::vector<AsyncReadRequest*> directReads;
+    ea::vector<AsyncReadRequest*> deniedReads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Start();
+
+        for (AsyncReadRequest* request : requests)
+        {
+            if (!request)
+                continue;
+
+            if (fileSystem && !request->readFunction_ && !fileSystem->CheckAccess(GetPath(request->fileName_)))
+            {
+                URHO3D_LOGERRORF("Access denied to %s", request->fileName_.c_str());
+                deniedReads.push_back(request);
+            }
+            // Custom reads always go to the pool, as they may block
+            else if (ioUring_ && !request->readFunction_)
+                directReads.push_back(request);
+            else
+                queue_.push_back(SharedPtr<AsyncReadRequest>(request));
+        }
+    }
+
+    // Finish outside the lock, as the callbacks may submit more reads
+    for (AsyncReadRequest* request : deniedReads)
+        request->Finish(false);
+
+#ifdef URHO3D_IO_URING
+    if (!directReads.empty())
+        ioUring_->Submit(directReads);
+#endif
+
+    if (!threads_.empty())
+        queueCondition_.notify_all();
+    else
+    {
+        // Without threads, read on the calling thread
+        for (;;)
+        {
+            SharedPtr<AsyncReadRequest> request;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (queue_.empty())
+                    break;
+                request = ea::move(queue_.front());
+                queue_.pop_front();
+            }
+
+            request->Finish(ReadQueued(request));
+        }
+    }
+}
+
+SharedPtr<AsyncReadRequest> AsyncFileReader::Read(const ea::string& fileName, const AsyncReadRequest::CompletionCallback& callback)
+{
+    auto request = MakeShared<AsyncReadRequest>(fileName);
+    request->SetCallback(callback);
+    Submit(request);
+    return request;
+}
+
+void AsyncFileReader::SetNumThreads(unsigned numThreads)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!started_)
+        numThreads_ = Max(numThreads, 1u);
+}
+
+bool AsyncFileReader::IsUsingIOUring() const
+{
+    return ioUring_ != nullptr;
+}
+
+void AsyncFileReader::Start()
+{
+    if (started_)
+        return;
+    started_ = true;
+
+#ifdef URHO3D_IO_URING
+    if (useIOUring_)
+    {
+        ioUring_ = ea::make_unique<IOUringReader>(*this);
+        if (ioUring_->Initialize(IO_URING_QUEUE_DEPTH))
+            URHO3D_LOGINFO("Using io_uring for asynchronous file reads");
+        else
+            ioUring_.reset();
+    }
+#endif
+
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        auto thread = ea::make_unique<AsyncReaderThread>([this]() { ProcessQueue(); });
+        thread->SetName("AsyncFileReader");
+        if (!thread->Run())
+            break;
+        threads_.push_back(ea::move(thread));
+    }
+}
+
+void AsyncFileReader::ProcessQueue()
+{
+    for (;;)
+    {
+        SharedPtr<AsyncReadRequest> request;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queueCondition_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty())
+                return;
+            request = ea::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        request->Finish(ReadQueued(request));
+    }
+}
+
+bool AsyncFileReader::ReadQueued(AsyncReadRequest* request)
+{
+    if (request->dataRead_)
+        return true;
+    return request->readFunction_ ? request->readFunction_(request->data_) : ReadBlocking(request);
+}
+
+void AsyncFileReader::FinishRead(AsyncReadRequest* request, bool success)
+{
+    // Keep the I/O thread issuing reads: process the data on a pool thread
+    if (success && request->processFunction_)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!threads_.empty())
+        {
+            request->dataRead_ = true;
+            queue_.push_back(SharedPtr<AsyncReadRequest>(request));
+            lock.unlock();
+            queueCondition_.notify_one();
+            return;
+        }
+    }
+
+    request->Finish(success);
+}
+
+bool AsyncFileReader::ReadBlocking(AsyncReadRequest* request)
+{
+    File file(context_);
+    if (!file.Open(request->fileName_))
+        return false;
+
+    if (request->offset_ > file.GetSize())
+    {
+        URHO3D_LOGERROR("Could not read file " + request->fileName_);
+        return false;
+    }
+
+    const unsigned size = Min(request->size_, file.GetSize() - request->offset_);
+    request->data_.resize(size);
+    file.Seek(request->offset_);
+    return file.Read(request->data_.data(), size) == size;
+}
+
+}
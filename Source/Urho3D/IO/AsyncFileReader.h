@@ -0,0 +1,186 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Core/Object.h"
+
+#include <EASTL/deque.h>
+#include <EASTL/unique_ptr.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+namespace Urho3D
+{
+
+class Thread;
+class IOUringReader;
+
+/// State of an asynchronous file read.
+enum AsyncReadState
+{
+    ASYNC_READ_PENDING = 0,
+    ASYNC_READ_SUCCEEDED,
+    ASYNC_READ_FAILED
+};
+
+/// Asynchronous read of a whole file or a range of it. Submitted to the AsyncFileReader subsystem.
+class URHO3D_API AsyncReadRequest : public RefCounted
+{
+public:
+    /// Completion callback. Called on an I/O thread, or on the submitting thread if the read finishes immediately. Wait() returns after it.
+    using CompletionCallback = std::function<void(AsyncReadRequest* request)>;
+    /// Function transforming the read data on a reader pool thread, for example decompressing it. Return false on failure.
+    using ProcessFunction = std::function<bool(ea::vector<unsigned char>& data)>;
+    /// Function producing the data on a pool thread instead of reading the file range. Return false on failure.
+    using ReadFunction = std::function<bool(ea::vector<unsigned char>& data)>;
+
+    /// Construct. Size M_MAX_UNSIGNED reads until the end of the file.
+    explicit AsyncReadRequest(const ea::string& fileName, unsigned offset = 0, unsigned size = M_MAX_UNSIGNED);
+
+    /// Set completion callback. Must be set before submitting.
+    void SetCallback(const CompletionCallback& callback) { callback_ = callback; }
+    /// Set function that transforms the read data. Must be set before submitting.
+    void SetProcessFunction(const ProcessFunction& function) { processFunction_ = function; }
+    /// Set function that produces the data instead of reading the file range. Must be set before submitting.
+    void SetReadFunction(const ReadFunction& function) { readFunction_ = function; }
+
+    /// Block until the read is finished and the callback has returned. Return true if it succeeded.
+    bool Wait();
+
+    /// Return file name.
+    const ea::string& GetFileName() const { return fileName_; }
+    /// Return offset of the read range.
+    unsigned GetOffset() const { return offset_; }
+    /// Return requested size of the read range.
+    unsigned GetSize() const { return size_; }
+    /// Return state.
+    AsyncReadState GetState() const { return state_.load(std::memory_order_acquire); }
+    /// Return whether the read is finished, successfully or not.
+    bool IsFinished() const { return GetState() != ASYNC_READ_PENDING; }
+    /// Return whether the read succeeded.
+    bool IsSucceeded() const { return GetState() == ASYNC_READ_SUCCEEDED; }
+    /// Return read data. Valid after the read succeeded.
+    const ea::vector<unsigned char>& GetData() const { return data_; }
+    /// Return read data for modification, for example to move it out. Valid after the read succeeded.
+    ea::vector<unsigned char>& GetData() { return data_; }
+
+private:
+    friend class AsyncFileReader;
+    friend class IOUringReader;
+
+    /// Process the data, set the final state, call the callback and release the waiters. Called once by the reader.
+    void Finish(bool success);
+
+    /// File name.
+    ea::string fileName_;
+    /// Offset of the read range.
+    unsigned offset_;
+    /// Requested size of the read range.
+    unsigned size_;
+    /// Read data.
+    ea::vector<unsigned char> data_;
+    /// Completion callback.
+    CompletionCallback callback_;
+    /// Data transform function.
+    ProcessFunction processFunction_;
+    /// Custom read function.
+    ReadFunction readFunction_;
+    /// State.
+    std::atomic<AsyncReadState> state_{ASYNC_READ_PENDING};
+    /// Mutex for waiting.
+    std::mutex mutex_;
+    /// Condition signaled when finished.
+    std::condition_variable finished_;
+    /// Whether finished and the callback has returned. Guarded by the mutex.
+    bool completed_{};
+    /// Whether the data was read by the io_uring backend and is queued only for processing.
+    bool dataRead_{};
+};
+
+/// %Asynchronous file reader subsystem. Overlaps many reads using io_uring on Linux, or a pool of blocking reader threads elsewhere.
+class URHO3D_API AsyncFileReader : public Object
+{
+    URHO3D_OBJECT(AsyncFileReader, Object);
+
+    friend class IOUringReader;
+
+public:
+    /// Construct.
+    explicit AsyncFileReader(Context* context);
+    /// Destruct. Wait for the submitted reads to finish.
+    ~AsyncFileReader() override;
+
+    /// Submit a read.
+    void Submit(AsyncReadRequest* request);
+    /// Submit several reads at once. With io_uring they are issued with a single system call.
+    void Submit(const ea::vector<SharedPtr<AsyncReadRequest> >& requests);
+    /// Create and submit a read of a whole file.
+    SharedPtr<AsyncReadRequest> Read(const ea::string& fileName, const AsyncReadRequest::CompletionCallback& callback = {});
+
+    /// Set whether to use io_uring when the platform supports it. Takes effect if set before the first read.
+    void SetUseIOUring(bool enable) { useIOUring_ = enable; }
+    /// Set number of threads in the blocking reader pool. Takes effect if set before the first read.
+    void SetNumThreads(unsigned numThreads);
+
+    /// Return whether reads are issued through io_uring.
+    bool IsUsingIOUring() const;
+    /// Return number of threads in the blocking reader pool.
+    unsigned GetNumThreads() const { return numThreads_; }
+
+private:
+    /// Start the backends on first use. Mutex must be held.
+    void Start();
+    /// Read requests from the pool queue until stopped. Called by the pool threads.
+    void ProcessQueue();
+    /// Read a request taken from the pool queue, unless it was queued only for processing. Return true if successful.
+    bool ReadQueued(AsyncReadRequest* request);
+    /// Read a file range with blocking file I/O. Return true if successful.
+    bool ReadBlocking(AsyncReadRequest* request);
+    /// Finish a read of the io_uring backend. Data to process is queued for the pool threads.
+    void FinishRead(AsyncReadRequest* request, bool success);
+
+    /// Mutex for the pool queue and startup.
+    std::mutex mutex_;
+    /// Condition signaled when requests are queued or the reader is stopping.
+    std::condition_variable queueCondition_;
+    /// Requests waiting for a pool thread.
+    ea::deque<SharedPtr<AsyncReadRequest> > queue_;
+    /// Pool threads.
+    ea::vector<ea::unique_ptr<Thread> > threads_;
+    /// io_uring backend.
+    ea::unique_ptr<IOUringReader> ioUring_;
+    /// Number of pool threads.
+    unsigned numThreads_;
+    /// Whether to use io_uring if supported.
+    bool useIOUring_;
+    /// Whether the backends have been started.
+    bool started_;
+    /// Whether the reader is shutting down.
+    bool stopping_;
+};
+
+}
@@ -136,18 +136,33 @@ bool File::Open(PackageFile* package, const ea::string& fileName)
     if (!entry)
         return false;
 
-    bool success = OpenInternal(package->GetName(), FILE_READ, true);
-    if (!success)
+    // Keep the package alive while the file is open, as the file may be reading from its memory mapping
+    SharedPtr<PackageFile> packageRef(package);
+    if (const unsigned char* mappedData = package->GetMappedData())
+    {
+        Close();
+        readSyncNeeded_ = false;
+        writeSyncNeeded_ = false;
+        mappedData_ = mappedData;
+        absoluteFileName_ = package->GetName();
+        mode_ = FILE_READ;
+        position_ = 0;
+    }
+    else if (!OpenInternal(package->GetName(), FILE_READ, true))
     {
         URHO3D_LOGERROR("Could not open package file " + fileName);
         return false;
     }
 
+    package_ = packageRef;
     fileName_ = fileName;
     offset_ = entry->offset_;
     checksum_ = entry->checksum_;
     size_ = entry->size_;
     compressed_ = package->IsCompressed();
+    packageEntry_ = entry;
+    blockSize_ = entry->blockOffsets_.empty() ? 0 : package->GetBlockSize();
+    bufferedBlock_ = M_MAX_UNSIGNED;
 
     // Seek to beginning of package entry's file data
     SeekInternal(offset_);
@@ -208,6 +223,9 @@ unsigned File::Read(void* dest, unsigned size)
     }
 #endif
 
+    if (compressed_ && blockSize_)
+        return ReadIndexedBlocks(static_cast<unsigned char*>(dest), size);
+
     if (compressed_)
     {
         unsigned sizeLeft = size;
@@ -281,6 +299,13 @@ unsigned File::Seek(unsigned position)
     if (mode_ == FILE_READ && position > size_)
         position = size_;
 
+    // Any block can be located through the block index, so just move the position
+    if (compressed_ && blockSize_)
+    {
+        position_ = position;
+        return position_;
+    }
+
     if (compressed_)
     {
         // Start over from the beginning
@@ -402,6 +427,21 @@ void File::Close()
         offset_ = 0;
         checksum_ = 0;
     }
+
+    if (mappedData_)
+    {
+        mappedData_ = nullptr;
+        mappedPosition_ = 0;
+        position_ = 0;
+        size_ = 0;
+        offset_ = 0;
+        checksum_ = 0;
+    }
+
+    package_.Reset();
+    packageEntry_ = nullptr;
+    blockSize_ = 0;
+    bufferedBlock_ = M_MAX_UNSIGNED;
 }
 
 void File::Flush()
@@ -418,9 +458,9 @@ void File::SetName(const ea::string& name)
 bool File::IsOpen() const
 {
 #ifdef __ANDROID__
-    return handle_ != 0 || assetHandle_ != 0;
+    return handle_ != 0 || assetHandle_ != 0 || mappedData_ != nullptr;
 #else
-    return handle_ != nullptr;
+    return handle_ != nullptr || mappedData_ != nullptr;
 #endif
 }
 
@@ -526,6 +566,15 @@ bool File::OpenInternal(const ea::string& fileName, FileMode mode, bool fromPack
 
 bool File::ReadInternal(void* dest, unsigned size)
 {
+    if (mappedData_)
+    {
+        if (mappedPosition_ + size > package_->GetTotalSize())
+            return false;
+        memcpy(dest, mappedData_ + mappedPosition_, size);
+        mappedPosition_ += size;
+        return true;
+    }
+
 #ifdef __ANDROID__
     if (assetHandle_)
     {
@@ -538,6 +587,12 @@ bool File::ReadInternal(void* dest, unsigned size)
 
 void File::SeekInternal(unsigned newPosition)
 {
+    if (mappedData_)
+    {
+        mappedPosition_ = newPosition;
+        return;
+    }
+
 #ifdef __ANDROID__
     if (assetHandle_)
     {
@@ -551,6 +606,96 @@ void File::SeekInternal(unsigned newPosition)
         fseek((FILE*)handle_, newPosition, SEEK_SET);
 }
 
+unsigned File::ReadIndexedBlocks(unsigned char* dest, unsigned size)
+{
+    unsigned sizeLeft = size;
+
+    while (sizeLeft)
+    {
+        const unsigned blockIndex = position_ / blockSize_;
+        const unsigned blockStart = blockIndex * blockSize_;
+        const unsigned offsetInBlock = position_ - blockStart;
+
+        // Decompress whole blocks straight into the destination. The last block of the file may be partial
+        unsigned numWholeBlocks = offsetInBlock == 0 ? sizeLeft / blockSize_ : 0;
+        if (offsetInBlock == 0 && position_ + sizeLeft == size_ && sizeLeft % blockSize_)
+            ++numWholeBlocks;
+
+        if (numWholeBlocks)
+        {
+            if (!DecompressBlocks(blockIndex, numWholeBlocks, dest))
+                break;
+
+            const unsigned copySize = Min(numWholeBlocks * blockSize_, size_ - position_);
+            dest += copySize;
+            sizeLeft -= copySize;
+            position_ += copySize;
+            continue;
+        }
+
+        if (bufferedBlock_ != blockIndex)
+        {
+            if (!readBuffer_)
+                readBuffer_ = new unsigned char[blockSize_];
+            if (!DecompressBlocks(blockIndex, 1, readBuffer_.get()))
+                break;
+            bufferedBlock_ = blockIndex;
+        }
+
+        const unsigned copySize = Min(Min(blockSize_, size_ - blockStart) - offsetInBlock, sizeLeft);
+        memcpy(dest, readBuffer_.get() + offsetInBlock, copySize);
+        dest += copySize;
+        sizeLeft -= copySize;
+        position_ += copySize;
+    }
+
+    return size - sizeLeft;
+}
+
+bool File::DecompressBlocks(unsigned firstBlock, unsigned numBlocks, unsigned char* dest)
+{
+    const ea::vector<unsigned>& blockOffsets = packageEntry_->blockOffsets_;
+    const unsigned packedStart = blockOffsets[firstBlock];
+    const unsigned packedSize = blockOffsets[firstBlock + numBlocks] - packedStart;
+
+    // Packed data is used in place when the package is mapped, otherwise read with a single call
+    const unsigned char* packedData = nullptr;
+    ea::vector<unsigned char> packedBuffer;
+    if (mappedData_)
+        packedData = mappedData_ + offset_ + packedStart;
+    else
+    {
+        unsigned char* buffer;
+        if (numBlocks == 1)
+        {
+            if (!inputBuffer_)
+                inputBuffer_ = new unsigned char[blockSize_];
+            buffer = inputBuffer_.get();
+        }
+        else
+        {
+            packedBuffer.resize(packedSize);
+            buffer = packedBuffer.data();
+        }
+
+        SeekInternal(offset_ + packedStart);
+        if (packedSize > numBlocks * blockSize_ || !ReadInternal(buffer, packedSize))
+        {
+            URHO3D_LOGERROR("Error while reading from file " + GetName());
+            return false;
+        }
+        packedData = buffer;
+    }
+
+    if (!package_->DecompressBlocks(*packageEntry_, packedData, firstBlock, numBlocks, dest))
+    {
+        URHO3D_LOGERROR("Corrupted compressed data in file " + GetName());
+        return false;
+    }
+
+    return true;
+}
+
 void File::ReadBinary(ea::vector<unsigned char>& buffer)
 {
     buffer.clear();
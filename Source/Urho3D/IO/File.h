@@ -59,6 +59,7 @@ enum FileMode
 };
 
 class PackageFile;
+struct PackageEntry;
 
 /// %File opened either through the filesystem or from within a package file.
 class URHO3D_API File : public Object, public AbstractFile
@@ -88,7 +89,7 @@ public:
     /// Return absolute file name in file system.
     const ea::string& GetAbsoluteName() const { return absoluteFileName_; }
 
-    /// Return a checksum of the file contents using the SDBM hash algorithm.
+    /// Return a checksum of the file contents using the SDBM hash algorithm. Files from version 1 packages return their xxHash32 checksum.
     unsigned GetChecksum() override;
 
     /// Open a filesystem file. Return true if successful.
@@ -108,7 +109,7 @@ public:
     /// Return whether is open.
     bool IsOpen() const;
 
-    /// Return the file handle.
+    /// Return the file handle. Null for files read from a memory-mapped package.
     void* GetHandle() const { return handle_; }
 
     /// Return whether the file originates from a package.
@@ -137,6 +138,10 @@ private:
     bool ReadInternal(void* dest, unsigned size);
     /// Seek in file internally using either C standard IO functions or SDL RWops for Android asset files.
     void SeekInternal(unsigned newPosition);
+    /// Read from a compressed package file with a block index. Return number of bytes actually read.
+    unsigned ReadIndexedBlocks(unsigned char* dest, unsigned size);
+    /// Decompress consecutive indexed blocks into the destination, in parallel if there are enough of them. Return true if successful.
+    bool DecompressBlocks(unsigned firstBlock, unsigned numBlocks, unsigned char* dest);
 
     /// File name. For files from ResourceCache, relative to cache directory.
     ea::string fileName_;
@@ -146,6 +151,18 @@ private:
     FileMode mode_;
     /// File handle.
     void* handle_;
+    /// Package file the file was opened from. Keeps the package memory mapping alive.
+    SharedPtr<PackageFile> package_;
+    /// Memory-mapped package data. Used instead of the file handle when the package is mapped.
+    const unsigned char* mappedData_{};
+    /// Read position within the memory-mapped package data.
+    unsigned mappedPosition_{};
+    /// Package entry of the file. Owned by the package.
+    const PackageEntry* packageEntry_{};
+    /// Uncompressed size of the indexed blocks, 0 if there is no block index.
+    unsigned blockSize_{};
+    /// Index of the block held in the read buffer.
+    unsigned bufferedBlock_{M_MAX_UNSIGNED};
 #ifdef __ANDROID__
     /// SDL RWops context for Android asset loading.
     SDL_RWops* assetHandle_;
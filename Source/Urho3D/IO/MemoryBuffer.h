@@ -47,6 +47,11 @@ public:
     /// Write bytes to the memory area.
     unsigned Write(const void* data, unsigned size) override;
 
+    /// Set name reported to readers, for example the resource name of prefetched file data.
+    void SetName(const ea::string& name) { name_ = name; }
+    /// Return name.
+    const ea::string& GetName() const override { return name_; }
+
     /// Return memory area.
     unsigned char* GetData() { return buffer_; }
 
@@ -58,6 +63,8 @@ private:
     unsigned char* buffer_;
     /// Read-only flag.
     bool readOnly_;
+    /// Name.
+    ea::string name_;
 };
 
 }
@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/Str.h"
+
+namespace Urho3D
+{
+
+/// Read-only view of a whole file mapped into memory. Pages are loaded by the OS on first access.
+class URHO3D_API MemoryMappedFile
+{
+public:
+    /// Construct empty.
+    MemoryMappedFile() = default;
+    /// Construct and map a file.
+    explicit MemoryMappedFile(const ea::string& fileName);
+    /// Destruct. Unmap the file.
+    ~MemoryMappedFile();
+    /// Prevent copy construction.
+    MemoryMappedFile(const MemoryMappedFile& rhs) = delete;
+    /// Prevent copy assignment.
+    MemoryMappedFile& operator =(const MemoryMappedFile& rhs) = delete;
+
+    /// Map a file. Return true if successful.
+    bool Open(const ea::string& fileName);
+    /// Unmap the file.
+    void Close();
+
+    /// Return whether a file is mapped.
+    bool IsOpen() const { return data_ != nullptr; }
+    /// Return mapped data.
+    const unsigned char* GetData() const { return data_; }
+    /// Return size of mapped data.
+    unsigned GetSize() const { return size_; }
+    /// Return file name.
+    const ea::string& GetName() const { return fileName_; }
+
+private:
+    /// Mapped data.
+    const unsigned char* data_{};
+    /// Size of mapped data.
+    unsigned size_{};
+    /// File name.
+    ea::string fileName_;
+#ifdef _WIN32
+    /// File handle.
+    void* fileHandle_{};
+    /// File mapping handle.
+    void* mappingHandle_{};
+#endif
+};
+
+}
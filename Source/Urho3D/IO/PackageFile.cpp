@@ -22,14 +22,21 @@
 
 #include "../Precompiled.h"
 
+#include "../Core/WorkQueue.h"
 #include "../IO/File.h"
 #include "../IO/Log.h"
 #include "../IO/PackageFile.h"
 #include "../IO/FileSystem.h"
 
+#include <atomic>
+#include <LZ4/lz4.h>
+
 namespace Urho3D
 {
 
+/// Minimum number of indexed blocks to decompress them on worker threads.
+static const unsigned PARALLEL_DECOMPRESS_MIN_BLOCKS = 4;
+
 PackageFile::PackageFile(Context* context) :
     Object(context),
     totalSize_(0),
@@ -88,21 +95,38 @@ bool PackageFile::Open(const ea::string& fileName, unsigned startOffset)
     nameHash_ = fileName_;
     totalSize_ = file->GetSize();
     compressed_ = id == "ULZ4" || id == "RLZ4";
+    version_ = 0;
+    blockSize_ = 0;
+    mappedFile_.reset();
     unsigned numFiles = file->ReadUInt();
     checksum_ = file->ReadUInt();
 
     if (id == "RPAK" || id == "RLZ4")
     {
         // New PAK file format includes two extra PAK header fields:
-        // * Version. At this time this field is unused and is always 0. It will be used in the future if PAK format needs to be extended.
+        // * Version. 0 stores compressed blocks with inline headers. 1 stores headerless blocks, an uncompressed block size
+        //   in the header and the packed size of each block in the file list, so any block can be located without decoding
+        //   the preceding ones. Version 1 checksums are xxHash32.
         // * File list offset. New format writes file list in the end of the file. This allows PAK creation without knowing entire file list
         //   beforehand.
-        unsigned version = file->ReadUInt();                        // Reserved for future use.
-        assert(version == 0);
+        version_ = file->ReadUInt();
+        if (version_ > PACKAGE_FORMAT_VERSION)
+        {
+            URHO3D_LOGERROR(fileName + " has unsupported package format version " + ea::to_string(version_));
+            return false;
+        }
         int64_t fileListOffset = file->ReadInt64();                 // New format has file list at the end of the file.
+        if (version_ >= 1)
+            blockSize_ = file->ReadUInt();
         file->Seek(fileListOffset);                                 // TODO: Serializer/Deserializer do not support files bigger than 4 GB
     }
 
+    if (compressed_ && blockSize_ == 0 && version_ >= 1)
+    {
+        URHO3D_LOGERROR(fileName + " has invalid compressed block size");
+        return false;
+    }
+
     for (unsigned i = 0; i < numFiles; ++i)
     {
         ea::string entryName = file->ReadString();
@@ -110,13 +134,35 @@ bool PackageFile::Open(const ea::string& fileName, unsigned startOffset)
         newEntry.offset_ = file->ReadUInt() + startOffset;
         totalDataSize_ += (newEntry.size_ = file->ReadUInt());
         newEntry.checksum_ = file->ReadUInt();
-        if (!compressed_ && newEntry.offset_ + newEntry.size_ > totalSize_)
+
+        if (compressed_ && blockSize_)
+        {
+            const unsigned numBlocks = (newEntry.size_ + blockSize_ - 1) / blockSize_;
+            newEntry.blockOffsets_.resize(numBlocks + 1);
+            newEntry.blockOffsets_[0] = 0;
+            for (unsigned j = 0; j < numBlocks; ++j)
+                newEntry.blockOffsets_[j + 1] = newEntry.blockOffsets_[j] + file->ReadVLE();
+        }
+
+        const unsigned storedSize = !compressed_ ? newEntry.size_ : !newEntry.blockOffsets_.empty() ? newEntry.blockOffsets_.back() : 0;
+        if (newEntry.offset_ + storedSize > totalSize_)
         {
             URHO3D_LOGERROR("File entry " + entryName + " outside package file");
             return false;
         }
         else
-            entries_[entryName] = newEntry;
+            entries_[entryName] = ea::move(newEntry);
+    }
+
+    // Map the package so that files inside it are read without seeking and copying through stdio
+    file->Close();
+#ifdef __ANDROID__
+    if (!URHO3D_IS_ASSET(fileName))
+#endif
+    {
+        mappedFile_ = ea::make_unique<MemoryMappedFile>();
+        if (!mappedFile_->Open(fileName) || mappedFile_->GetSize() != totalSize_)
+            mappedFile_.reset();
     }
 
     return true;
@@ -198,4 +244,91 @@ void PackageFile::Scan(ea::vector<ea::string>& result, const ea::string& pathNam
     }
 }
 
+SharedPtr<AsyncReadRequest> PackageFile::CreateReadRequest(const ea::string& fileName)
+{
+    const PackageEntry* entry = GetEntry(fileName);
+    if (!entry)
+        return nullptr;
+
+    if (!compressed_)
+        return MakeShared<AsyncReadRequest>(fileName_, entry->offset_, entry->size_);
+
+    WeakPtr<PackageFile> weakSelf(this);
+
+    // Indexed blocks are read as one range and decompressed on a reader pool thread, off the I/O completion thread
+    if (!entry->blockOffsets_.empty())
+    {
+        auto request = MakeShared<AsyncReadRequest>(fileName_, entry->offset_, entry->blockOffsets_.back());
+        request->SetProcessFunction([weakSelf, fileName](ea::vector<unsigned char>& data)
+        {
+            SharedPtr<PackageFile> self = weakSelf.Lock();
+            const PackageEntry* entry = self ? self->GetEntry(fileName) : nullptr;
+            if (!entry || data.size() != entry->blockOffsets_.back())
+                return false;
+
+            ea::vector<unsigned char> unpacked(entry->size_);
+            if (!self->DecompressBlocks(*entry, data.data(), 0, entry->blockOffsets_.size() - 1, unpacked.data()))
+            {
+                URHO3D_LOGERROR("Corrupted compressed data in file " + fileName);
+                return false;
+            }
+
+            data.swap(unpacked);
+            return true;
+        });
+        return request;
+    }
+
+    // Blocks with inline headers must be walked sequentially, so read them through a package file
+    auto request = MakeShared<AsyncReadRequest>(fileName_);
+    request->SetReadFunction([weakSelf, fileName](ea::vector<unsigned char>& data)
+    {
+        SharedPtr<PackageFile> self = weakSelf.Lock();
+        if (!self)
+            return false;
+
+        File file(self->GetContext(), self, fileName);
+        if (!file.IsOpen())
+            return false;
+
+        file.ReadBinary(data);
+        return data.size() == file.GetSize();
+    });
+    return request;
+}
+
+bool PackageFile::DecompressBlocks(const PackageEntry& entry, const unsigned char* packedData, unsigned firstBlock,
+    unsigned numBlocks, unsigned char* dest) const
+{
+    const unsigned packedStart = entry.blockOffsets_[firstBlock];
+
+    std::atomic<bool> success{true};
+    const auto decompressBlocks = [&](unsigned fromIndex, unsigned toIndex)
+    {
+        for (unsigned i = firstBlock + fromIndex; i < firstBlock + toIndex; ++i)
+        {
+            const unsigned blockStart = i * blockSize_;
+            const unsigned unpackedSize = Min(blockSize_, entry.size_ - blockStart);
+            const unsigned blockPackedSize = entry.blockOffsets_[i + 1] - entry.blockOffsets_[i];
+            const unsigned char* src = packedData + (entry.blockOffsets_[i] - packedStart);
+            unsigned char* dst = dest + (blockStart - firstBlock * blockSize_);
+
+            // Blocks that did not compress are stored as is
+            if (blockPackedSize == unpackedSize)
+                memcpy(dst, src, unpackedSize);
+            else if (blockPackedSize > unpackedSize ||
+                LZ4_decompress_safe((const char*)src, (char*)dst, (int)blockPackedSize, (int)unpackedSize) != (int)unpackedSize)
+                success = false;
+        }
+    };
+
+    auto* workQueue = numBlocks >= PARALLEL_DECOMPRESS_MIN_BLOCKS ? GetSubsystem<WorkQueue>() : nullptr;
+    if (workQueue && workQueue->GetNumThreads() > 0)
+        workQueue->ParallelFor(numBlocks, 1, decompressBlocks);
+    else
+        decompressBlocks(0, numBlocks);
+
+    return success;
+}
+
 }
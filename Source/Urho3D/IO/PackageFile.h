@@ -23,10 +23,17 @@
 #pragma once
 
 #include "../Core/Object.h"
+#include "../IO/AsyncFileReader.h"
+#include "../IO/MemoryMappedFile.h"
+
+#include <EASTL/unique_ptr.h>
 
 namespace Urho3D
 {
 
+/// Latest version of the RPAK/RLZ4 package format. Version 1 adds a per-entry block index and xxHash checksums.
+static const unsigned PACKAGE_FORMAT_VERSION = 1;
+
 /// %File entry within the package file.
 struct PackageEntry
 {
@@ -36,6 +43,8 @@ struct PackageEntry
     unsigned size_;
     /// File checksum.
     unsigned checksum_;
+    /// Offsets of the compressed blocks relative to the entry offset, followed by the end offset. Empty if the package has no block index.
+    ea::vector<unsigned> blockOffsets_;
 };
 
 /// Stores files of a directory tree sequentially for convenient access.
@@ -82,6 +91,15 @@ public:
     /// Return whether the files are compressed.
     bool IsCompressed() const { return compressed_; }
 
+    /// Return package format version. Always 0 for legacy UPAK/ULZ4 packages.
+    unsigned GetVersion() const { return version_; }
+
+    /// Return uncompressed size of the indexed compressed blocks, or 0 if the package has no block index.
+    unsigned GetBlockSize() const { return blockSize_; }
+
+    /// Return memory-mapped package data, or null if the package could not be mapped and is read through file IO.
+    const unsigned char* GetMappedData() const { return mappedFile_ ? mappedFile_->GetData() : nullptr; }
+
     /// Return list of file names in the package.
     const ea::vector<ea::string> GetEntryNames() const { return entries_.keys(); }
 
@@ -99,6 +117,11 @@ public:
 
     /// Scan package for specified files.
     void Scan(ea::vector<ea::string>& result, const ea::string& pathName, const ea::string& filter, bool recursive) const;
+    /// Create an asynchronous read of a file in the package, to be submitted to the AsyncFileReader. The data is decompressed when the read completes. Return null if not found.
+    SharedPtr<AsyncReadRequest> CreateReadRequest(const ea::string& fileName);
+    /// Decompress consecutive blocks of an entry with a block index. Packed data starts at the first block. Many blocks are decompressed in parallel on the WorkQueue. Return true if successful.
+    bool DecompressBlocks(const PackageEntry& entry, const unsigned char* packedData, unsigned firstBlock, unsigned numBlocks,
+        unsigned char* dest) const;
 
 private:
     /// File entries.
@@ -115,6 +138,12 @@ private:
     unsigned checksum_;
     /// Compressed flag.
     bool compressed_;
+    /// Package format version.
+    unsigned version_{};
+    /// Uncompressed block size of the block index.
+    unsigned blockSize_{};
+    /// Memory mapping of the package file.
+    ea::unique_ptr<MemoryMappedFile> mappedFile_;
 };
 
 }
@@ -24,11 +24,40 @@
 
 #include "../Math/MathDefs.h"
 
+#include <cstring>
+
 #include "../DebugNew.h"
 
 namespace Urho3D
 {
 
+namespace
+{
+
+static const unsigned XXH_PRIME32_1 = 0x9E3779B1u;
+static const unsigned XXH_PRIME32_2 = 0x85EBCA77u;
+static const unsigned XXH_PRIME32_3 = 0xC2B2AE3Du;
+static const unsigned XXH_PRIME32_4 = 0x27D4EB2Fu;
+static const unsigned XXH_PRIME32_5 = 0x165667B1u;
+
+inline unsigned RotateLeft(unsigned value, unsigned bits) { return (value << bits) | (value >> (32u - bits)); }
+
+inline unsigned ReadUnaligned32(const unsigned char* ptr)
+{
+    unsigned value;
+    memcpy(&value, ptr, sizeof value);
+    return value;
+}
+
+inline unsigned XXHashRound(unsigned acc, unsigned input)
+{
+    acc += input * XXH_PRIME32_2;
+    acc = RotateLeft(acc, 13);
+    return acc * XXH_PRIME32_1;
+}
+
+}
+
 void SinCos(float angle, float& sin, float& cos)
 {
     float angleRadians = angle * M_DEGTORAD;
@@ -42,4 +71,58 @@ void SinCos(float angle, float& sin, float& cos)
 #endif
 }
 
+unsigned XXHash32(const void* data, unsigned size, unsigned seed)
+{
+    const auto* ptr = static_cast<const unsigned char*>(data);
+    const unsigned char* end = ptr + size;
+    unsigned hash;
+
+    if (size >= 16)
+    {
+        // Four independent lanes over 16-byte stripes
+        const unsigned char* limit = end - 16;
+        unsigned v1 = seed + XXH_PRIME32_1 + XXH_PRIME32_2;
+        unsigned v2 = seed + XXH_PRIME32_2;
+        unsigned v3 = seed;
+        unsigned v4 = seed - XXH_PRIME32_1;
+
+        do
+        {
+            v1 = XXHashRound(v1, ReadUnaligned32(ptr));
+            v2 = XXHashRound(v2, ReadUnaligned32(ptr + 4));
+            v3 = XXHashRound(v3, ReadUnaligned32(ptr + 8));
+            v4 = XXHashRound(v4, ReadUnaligned32(ptr + 12));
+            ptr += 16;
+        } while (ptr <= limit);
+
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+    }
+    else
+        hash = seed + XXH_PRIME32_5;
+
+    hash += size;
+
+    while (ptr + 4 <= end)
+    {
+        hash += ReadUnaligned32(ptr) * XXH_PRIME32_3;
+        hash = RotateLeft(hash, 17) * XXH_PRIME32_4;
+        ptr += 4;
+    }
+
+    while (ptr < end)
+    {
+        hash += (*ptr) * XXH_PRIME32_5;
+        hash = RotateLeft(hash, 11) * XXH_PRIME32_1;
+        ++ptr;
+    }
+
+    // Final avalanche
+    hash ^= hash >> 15u;
+    hash *= XXH_PRIME32_2;
+    hash ^= hash >> 13u;
+    hash *= XXH_PRIME32_3;
+    hash ^= hash >> 16u;
+    return hash;
+}
+
 }
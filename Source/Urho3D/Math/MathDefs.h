@@ -351,6 +351,9 @@ template<typename T> inline T Wrap(T value, T min, T max)
 /// Calculate both sine and cosine, with angle in degrees.
 URHO3D_API void SinCos(float angle, float& sin, float& cos);
 
+/// Calculate 32-bit xxHash of a memory block.
+URHO3D_API unsigned XXHash32(const void* data, unsigned size, unsigned seed = 0);
+
 }
 
 #ifdef _MSC_VER
@@ -0,0 +1,448 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Math/MathKernels.h"
+
+#if defined(URHO3D_SSE) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#   define URHO3D_KERNELS_AVX2 1
+#   include <immintrin.h>
+#   if defined(_WIN32) || defined(__APPLE__)
+#       include <LibCpuId/libcpuid.h>
+#   endif
+#   if defined(__GNUC__) || defined(__clang__)
+#       define URHO3D_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#   else
+#       define URHO3D_TARGET_AVX2
+#   endif
+#endif
+
+#if !defined(URHO3D_SSE) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#   define URHO3D_KERNELS_NEON 1
+#   include <arm_neon.h>
+#endif
+
+#include <atomic>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Detect the best SIMD instruction set supported by both the CPU and the build.
+SIMDLevel DetectSIMDLevel()
+{
+#if URHO3D_KERNELS_AVX2
+#   if defined(_WIN32) || defined(__APPLE__)
+    struct cpu_raw_data_t raw;
+    struct cpu_id_t data;
+    if (cpuid_present() && cpuid_get_raw_data(&raw) == 0 && cpu_identify(&raw, &data) == 0
+        && data.flags[CPU_FEATURE_AVX2] && data.flags[CPU_FEATURE_FMA3])
+        return SIMD_AVX2;
+#   elif defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SIMD_AVX2;
+#   endif
+#endif
+
+#if defined(URHO3D_SSE)
+    return SIMD_SSE2;
+#elif URHO3D_KERNELS_NEON
+    return SIMD_NEON;
+#else
+    return SIMD_NONE;
+#endif
+}
+
+/// Best supported SIMD instruction set.
+const SIMDLevel supportedSIMDLevel = DetectSIMDLevel();
+/// SIMD instruction set in use. Read by worker threads while the main thread may override it.
+std::atomic<SIMDLevel> currentSIMDLevel{ supportedSIMDLevel };
+
+void IsInsideScalar(const Frustum& frustum, const BoundingBoxArrays& boxes, unsigned start, unsigned count, Intersection* results)
+{
+    for (unsigned i = 0; i < count; ++i)
+    {
+        const unsigned index = start + i;
+        const Vector3 center(boxes.centerX_[index], boxes.centerY_[index], boxes.centerZ_[index]);
+        const Vector3 edge(boxes.halfSizeX_[index], boxes.halfSizeY_[index], boxes.halfSizeZ_[index]);
+
+        Intersection result = INSIDE;
+        for (const Plane& plane : frustum.planes_)
+        {
+            const float dist = plane.normal_.DotProduct(center) + plane.d_;
+            const float absDist = plane.absNormal_.DotProduct(edge);
+
+            if (dist < -absDist)
+            {
+                result = OUTSIDE;
+                break;
+            }
+            else if (dist < absDist)
+                result = INTERSECTS;
+        }
+        results[i] = result;
+    }
+}
+
+void UpdateParticlesScalar(const ParticleUpdateParams& params, const ParticleArrays& particles, unsigned start, unsigned count)
+{
+    const Vector3 velocityDelta = params.timeStep_ * params.constantForce_;
+    const float damping = -params.timeStep_ * params.dampingForce_;
+    const float sizeAdd = params.timeStep_ * params.sizeAdd_;
+    const float sizeScale = params.timeStep_ * (params.sizeMul_ - 1.0f) + 1.0f;
+
+    for (unsigned index = start; index < start + count; ++index)
+    {
+        Vector3 velocity(particles.velocityX_[index], particles.velocityY_[index], particles.velocityZ_[index]);
+        velocity += velocityDelta;
+        velocity += damping * velocity;
+        particles.velocityX_[index] = velocity.x_;
+        particles.velocityY_[index] = velocity.y_;
+        particles.velocityZ_[index] = velocity.z_;
+
+        particles.scale_[index] = Max(particles.scale_[index] + sizeAdd, 0.0f) * sizeScale;
+
+        const Vector3 direction = velocity.Normalized();
+        particles.directionX_[index] = direction.x_;
+        particles.directionY_[index] = direction.y_;
+        particles.directionZ_[index] = direction.z_;
+    }
+}
+
+/// Convert outside and intersection masks to Intersection values.
+inline void StoreIntersections(int outsideMask, int intersectsMask, unsigned count, Intersection* results)
+{
+    for (unsigned j = 0; j < count; ++j)
+    {
+        const int bit = 1 << j;
+        results[j] = (outsideMask & bit) ? OUTSIDE : (intersectsMask & bit) ? INTERSECTS : INSIDE;
+    }
+}
+
+#if defined(URHO3D_SSE)
+
+void IsInsideSSE2(const Frustum& frustum, const BoundingBoxArrays& boxes, unsigned start, unsigned count, Intersection* results)
+{
+    unsigned i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const unsigned index = start + i;
+        const __m128 centerX = _mm_loadu_ps(boxes.centerX_ + index);
+        const __m128 centerY = _mm_loadu_ps(boxes.centerY_ + index);
+        const __m128 centerZ = _mm_loadu_ps(boxes.centerZ_ + index);
+        const __m128 edgeX = _mm_loadu_ps(boxes.halfSizeX_ + index);
+        const __m128 edgeY = _mm_loadu_ps(boxes.halfSizeY_ + index);
+        const __m128 edgeZ = _mm_loadu_ps(boxes.halfSizeZ_ + index);
+
+        __m128 outside = _mm_setzero_ps();
+        __m128 intersects = _mm_setzero_ps();
+        for (const Plane& plane : frustum.planes_)
+        {
+            const __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.normal_.x_), centerX),
+                _mm_mul_ps(_mm_set1_ps(plane.normal_.y_), centerY)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.normal_.z_), centerZ), _mm_set1_ps(plane.d_)));
+            const __m128 absDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.absNormal_.x_), edgeX),
+                _mm_mul_ps(_mm_set1_ps(plane.absNormal_.y_), edgeY)), _mm_mul_ps(_mm_set1_ps(plane.absNormal_.z_), edgeZ));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, _mm_sub_ps(_mm_setzero_ps(), absDist)));
+            intersects = _mm_or_ps(intersects, _mm_cmplt_ps(dist, absDist));
+        }
+
+        StoreIntersections(_mm_movemask_ps(outside), _mm_movemask_ps(intersects), 4, results + i);
+    }
+
+    IsInsideScalar(frustum, boxes, start + i, count - i, results + i);
+}
+
+void UpdateParticlesSSE2(const ParticleUpdateParams& params, const ParticleArrays& particles, unsigned start, unsigned count)
+{
+    const __m128 deltaX = _mm_set1_ps(params.timeStep_ * params.constantForce_.x_);
+    const __m128 deltaY = _mm_set1_ps(params.timeStep_ * params.constantForce_.y_);
+    const __m128 deltaZ = _mm_set1_ps(params.timeStep_ * params.constantForce_.z_);
+    const __m128 damping = _mm_set1_ps(-params.timeStep_ * params.dampingForce_);
+    const __m128 sizeAdd = _mm_set1_ps(params.timeStep_ * params.sizeAdd_);
+    const __m128 sizeScale = _mm_set1_ps(params.timeStep_ * (params.sizeMul_ - 1.0f) + 1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    unsigned i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const unsigned index = start + i;
+        __m128 x = _mm_add_ps(_mm_loadu_ps(particles.velocityX_ + index), deltaX);
+        __m128 y = _mm_add_ps(_mm_loadu_ps(particles.velocityY_ + index), deltaY);
+        __m128 z = _mm_add_ps(_mm_loadu_ps(particles.velocityZ_ + index), deltaZ);
+        x = _mm_add_ps(x, _mm_mul_ps(damping, x));
+        y = _mm_add_ps(y, _mm_mul_ps(damping, y));
+        z = _mm_add_ps(z, _mm_mul_ps(damping, z));
+        _mm_storeu_ps(particles.velocityX_ + index, x);
+        _mm_storeu_ps(particles.velocityY_ + index, y);
+        _mm_storeu_ps(particles.velocityZ_ + index, z);
+
+        const __m128 scale = _mm_add_ps(_mm_loadu_ps(particles.scale_ + index), sizeAdd);
+        _mm_storeu_ps(particles.scale_ + index, _mm_mul_ps(_mm_max_ps(scale, zero), sizeScale));
+
+        // Zero velocities are passed through unchanged, like in Vector3::Normalized()
+        const __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+        const __m128 nonZero = _mm_cmpgt_ps(lengthSquared, zero);
+        const __m128 invLength = _mm_or_ps(_mm_and_ps(nonZero, _mm_div_ps(one, _mm_sqrt_ps(lengthSquared))),
+            _mm_andnot_ps(nonZero, one));
+        _mm_storeu_ps(particles.directionX_ + index, _mm_mul_ps(x, invLength));
+        _mm_storeu_ps(particles.directionY_ + index, _mm_mul_ps(y, invLength));
+        _mm_storeu_ps(particles.directionZ_ + index, _mm_mul_ps(z, invLength));
+    }
+
+    UpdateParticlesScalar(params, particles, start + i, count - i);
+}
+
+#endif
+
+#if URHO3D_KERNELS_AVX2
+
+URHO3D_TARGET_AVX2 void IsInsideAVX2(const Frustum& frustum, const BoundingBoxArrays& boxes, unsigned start, unsigned count, Intersection* results)
+{
+    unsigned i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const unsigned index = start + i;
+        const __m256 centerX = _mm256_loadu_ps(boxes.centerX_ + index);
+        const __m256 centerY = _mm256_loadu_ps(boxes.centerY_ + index);
+        const __m256 centerZ = _mm256_loadu_ps(boxes.centerZ_ + index);
+        const __m256 edgeX = _mm256_loadu_ps(boxes.halfSizeX_ + index);
+        const __m256 edgeY = _mm256_loadu_ps(boxes.halfSizeY_ + index);
+        const __m256 edgeZ = _mm256_loadu_ps(boxes.halfSizeZ_ + index);
+
+        __m256 outside = _mm256_setzero_ps();
+        __m256 intersects = _mm256_setzero_ps();
+        for (const Plane& plane : frustum.planes_)
+        {
+            const __m256 dist = _mm256_fmadd_ps(_mm256_set1_ps(plane.normal_.x_), centerX,
+                _mm256_fmadd_ps(_mm256_set1_ps(plane.normal_.y_), centerY,
+                _mm256_fmadd_ps(_mm256_set1_ps(plane.normal_.z_), centerZ, _mm256_set1_ps(plane.d_))));
+            const __m256 absDist = _mm256_fmadd_ps(_mm256_set1_ps(plane.absNormal_.x_), edgeX,
+                _mm256_fmadd_ps(_mm256_set1_ps(plane.absNormal_.y_), edgeY, _mm256_mul_ps(_mm256_set1_ps(plane.absNormal_.z_), edgeZ)));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(dist, _mm256_sub_ps(_mm256_setzero_ps(), absDist), _CMP_LT_OQ));
+            intersects = _mm256_or_ps(intersects, _mm256_cmp_ps(dist, absDist, _CMP_LT_OQ));
+        }
+
+        StoreIntersections(_mm256_movemask_ps(outside), _mm256_movemask_ps(intersects), 8, results + i);
+    }
+
+    IsInsideSSE2(frustum, boxes, start + i, count - i, results + i);
+}
+
+URHO3D_TARGET_AVX2 void UpdateParticlesAVX2(const ParticleUpdateParams& params, const ParticleArrays& particles, unsigned start, unsigned count)
+{
+    const __m256 deltaX = _mm256_set1_ps(params.timeStep_ * params.constantForce_.x_);
+    const __m256 deltaY = _mm256_set1_ps(params.timeStep_ * params.constantForce_.y_);
+    const __m256 deltaZ = _mm256_set1_ps(params.timeStep_ * params.constantForce_.z_);
+    const __m256 damping = _mm256_set1_ps(-params.timeStep_ * params.dampingForce_);
+    const __m256 sizeAdd = _mm256_set1_ps(params.timeStep_ * params.sizeAdd_);
+    const __m256 sizeScale = _mm256_set1_ps(params.timeStep_ * (params.sizeMul_ - 1.0f) + 1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    unsigned i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const unsigned index = start + i;
+        __m256 x = _mm256_add_ps(_mm256_loadu_ps(particles.velocityX_ + index), deltaX);
+        __m256 y = _mm256_add_ps(_mm256_loadu_ps(particles.velocityY_ + index), deltaY);
+        __m256 z = _mm256_add_ps(_mm256_loadu_ps(particles.velocityZ_ + index), deltaZ);
+        x = _mm256_fmadd_ps(damping, x, x);
+        y = _mm256_fmadd_ps(damping, y, y);
+        z = _mm256_fmadd_ps(damping, z, z);
+        _mm256_storeu_ps(particles.velocityX_ + index, x);
+        _mm256_storeu_ps(particles.velocityY_ + index, y);
+        _mm256_storeu_ps(particles.velocityZ_ + index, z);
+
+        const __m256 scale = _mm256_add_ps(_mm256_loadu_ps(particles.scale_ + index), sizeAdd);
+        _mm256_storeu_ps(particles.scale_ + index, _mm256_mul_ps(_mm256_max_ps(scale, zero), sizeScale));
+
+        const __m256 lengthSquared = _mm256_fmadd_ps(x, x, _mm256_fmadd_ps(y, y, _mm256_mul_ps(z, z)));
+        const __m256 nonZero = _mm256_cmp_ps(lengthSquared, zero, _CMP_GT_OQ);
+        const __m256 invLength = _mm256_blendv_ps(one, _mm256_div_ps(one, _mm256_sqrt_ps(lengthSquared)), nonZero);
+        _mm256_storeu_ps(particles.directionX_ + index, _mm256_mul_ps(x, invLength));
+        _mm256_storeu_ps(particles.directionY_ + index, _mm256_mul_ps(y, invLength));
+        _mm256_storeu_ps(particles.directionZ_ + index, _mm256_mul_ps(z, invLength));
+    }
+
+    UpdateParticlesSSE2(params, particles, start + i, count - i);
+}
+
+#endif
+
+#if URHO3D_KERNELS_NEON
+
+void IsInsideNEON(const Frustum& frustum, const BoundingBoxArrays& boxes, unsigned start, unsigned count, Intersection* results)
+{
+    unsigned i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const unsigned index = start + i;
+        const float32x4_t centerX = vld1q_f32(boxes.centerX_ + index);
+        const float32x4_t centerY = vld1q_f32(boxes.centerY_ + index);
+        const float32x4_t centerZ = vld1q_f32(boxes.centerZ_ + index);
+        const float32x4_t edgeX = vld1q_f32(boxes.halfSizeX_ + index);
+        const float32x4_t edgeY = vld1q_f32(boxes.halfSizeY_ + index);
+        const float32x4_t edgeZ = vld1q_f32(boxes.halfSizeZ_ + index);
+
+        uint32x4_t outside = vdupq_n_u32(0);
+        uint32x4_t intersects = vdupq_n_u32(0);
+        for (const Plane& plane : frustum.planes_)
+        {
+            const float32x4_t dist = vmlaq_n_f32(vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(plane.d_),
+                centerX, plane.normal_.x_), centerY, plane.normal_.y_), centerZ, plane.normal_.z_);
+            const float32x4_t absDist = vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(edgeX, plane.absNormal_.x_),
+                edgeY, plane.absNormal_.y_), edgeZ, plane.absNormal_.z_);
+            outside = vorrq_u32(outside, vcltq_f32(dist, vnegq_f32(absDist)));
+            intersects = vorrq_u32(intersects, vcltq_f32(dist, absDist));
+        }
+
+        uint32_t outsideLanes[4];
+        uint32_t intersectsLanes[4];
+        vst1q_u32(outsideLanes, outside);
+        vst1q_u32(intersectsLanes, intersects);
+        for (unsigned j = 0; j < 4; ++j)
+            results[i + j] = outsideLanes[j] ? OUTSIDE : intersectsLanes[j] ? INTERSECTS : INSIDE;
+    }
+
+    IsInsideScalar(frustum, boxes, start + i, count - i, results + i);
+}
+
+void UpdateParticlesNEON(const ParticleUpdateParams& params, const ParticleArrays& particles, unsigned start, unsigned count)
+{
+    const float32x4_t deltaX = vdupq_n_f32(params.timeStep_ * params.constantForce_.x_);
+    const float32x4_t deltaY = vdupq_n_f32(params.timeStep_ * params.constantForce_.y_);
+    const float32x4_t deltaZ = vdupq_n_f32(params.timeStep_ * params.constantForce_.z_);
+    const float damping = -params.timeStep_ * params.dampingForce_;
+    const float32x4_t sizeAdd = vdupq_n_f32(params.timeStep_ * params.sizeAdd_);
+    const float sizeScale = params.timeStep_ * (params.sizeMul_ - 1.0f) + 1.0f;
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+
+    unsigned i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const unsigned index = start + i;
+        float32x4_t x = vaddq_f32(vld1q_f32(particles.velocityX_ + index), deltaX);
+        float32x4_t y = vaddq_f32(vld1q_f32(particles.velocityY_ + index), deltaY);
+        float32x4_t z = vaddq_f32(vld1q_f32(particles.velocityZ_ + index), deltaZ);
+        x = vmlaq_n_f32(x, x, damping);
+        y = vmlaq_n_f32(y, y, damping);
+        z = vmlaq_n_f32(z, z, damping);
+        vst1q_f32(particles.velocityX_ + index, x);
+        vst1q_f32(particles.velocityY_ + index, y);
+        vst1q_f32(particles.velocityZ_ + index, z);
+
+        const float32x4_t scale = vaddq_f32(vld1q_f32(particles.scale_ + index), sizeAdd);
+        vst1q_f32(particles.scale_ + index, vmulq_n_f32(vmaxq_f32(scale, zero), sizeScale));
+
+        // Reciprocal square root estimate refined with two Newton-Raphson steps
+        const float32x4_t lengthSquared = vmlaq_f32(vmlaq_f32(vmulq_f32(x, x), y, y), z, z);
+        float32x4_t invLength = vrsqrteq_f32(lengthSquared);
+        invLength = vmulq_f32(invLength, vrsqrtsq_f32(vmulq_f32(lengthSquared, invLength), invLength));
+        invLength = vmulq_f32(invLength, vrsqrtsq_f32(vmulq_f32(lengthSquared, invLength), invLength));
+        invLength = vbslq_f32(vcgtq_f32(lengthSquared, zero), invLength, one);
+        vst1q_f32(particles.directionX_ + index, vmulq_f32(x, invLength));
+        vst1q_f32(particles.directionY_ + index, vmulq_f32(y, invLength));
+        vst1q_f32(particles.directionZ_ + index, vmulq_f32(z, invLength));
+    }
+
+    UpdateParticlesScalar(params, particles, start + i, count - i);
+}
+
+#endif
+
+}
+
+SIMDLevel GetSIMDLevel()
+{
+    return currentSIMDLevel.load(std::memory_order_relaxed);
+}
+
+bool SetSIMDLevel(SIMDLevel level)
+{
+    const bool supported = level == SIMD_NONE || level == supportedSIMDLevel
+        || (level == SIMD_SSE2 && supportedSIMDLevel == SIMD_AVX2);
+    if (supported)
+        currentSIMDLevel.store(level, std::memory_order_relaxed);
+    return supported;
+}
+
+void IsInside(const Frustum& frustum, const BoundingBoxArrays& boxes, unsigned start, unsigned count, Intersection* results)
+{
+    switch (currentSIMDLevel.load(std::memory_order_relaxed))
+    {
+#if URHO3D_KERNELS_AVX2
+    case SIMD_AVX2:
+        IsInsideAVX2(frustum, boxes, start, count, results);
+        break;
+#endif
+#if defined(URHO3D_SSE)
+    case SIMD_SSE2:
+        IsInsideSSE2(frustum, boxes, start, count, results);
+        break;
+#endif
+#if URHO3D_KERNELS_NEON
+    case SIMD_NEON:
+        IsInsideNEON(frustum, boxes, start, count, results);
+        break;
+#endif
+    default:
+        IsInsideScalar(frustum, boxes, start, count, results);
+        break;
+    }
+}
+
+void UpdateParticles(const ParticleUpdateParams& params, const ParticleArrays& particles, unsigned start, unsigned count)
+{
+    switch (currentSIMDLevel.load(std::memory_order_relaxed))
+    {
+#if URHO3D_KERNELS_AVX2
+    case SIMD_AVX2:
+        UpdateParticlesAVX2(params, particles, start, count);
+        break;
+#endif
+#if defined(URHO3D_SSE)
+    case SIMD_SSE2:
+        UpdateParticlesSSE2(params, particles, start, count);
+        break;
+#endif
+#if URHO3D_KERNELS_NEON
+    case SIMD_NEON:
+        UpdateParticlesNEON(params, particles, start, count);
+        break;
+#endif
+    default:
+        UpdateParticlesScalar(params, particles, start, count);
+        break;
+    }
+}
+
+}
@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Math/BoundingBox.h"
+#include "../Math/Frustum.h"
+
+namespace Urho3D
+{
+
+/// SIMD instruction set used by the batch math kernels.
+enum SIMDLevel
+{
+    SIMD_NONE = 0,
+    SIMD_SSE2,
+    SIMD_AVX2,
+    SIMD_NEON
+};
+
+/// Bounding boxes stored as separate arrays of center and half size coordinates.
+struct BoundingBoxArrays
+{
+    /// Center X coordinates.
+    const float* centerX_{};
+    /// Center Y coordinates.
+    const float* centerY_{};
+    /// Center Z coordinates.
+    const float* centerZ_{};
+    /// Half size X coordinates.
+    const float* halfSizeX_{};
+    /// Half size Y coordinates.
+    const float* halfSizeY_{};
+    /// Half size Z coordinates.
+    const float* halfSizeZ_{};
+
+    /// Return bounding box at index.
+    BoundingBox GetBoundingBox(unsigned index) const
+    {
+        const Vector3 center(centerX_[index], centerY_[index], centerZ_[index]);
+        const Vector3 halfSize(halfSizeX_[index], halfSizeY_[index], halfSizeZ_[index]);
+        return BoundingBox(center - halfSize, center + halfSize);
+    }
+};
+
+/// Particle state stored as separate arrays, updated in place by UpdateParticles().
+struct ParticleArrays
+{
+    /// Velocity X coordinates.
+    float* velocityX_{};
+    /// Velocity Y coordinates.
+    float* velocityY_{};
+    /// Velocity Z coordinates.
+    float* velocityZ_{};
+    /// Size scaling values.
+    float* scale_{};
+    /// Normalized velocity X coordinates. Output only.
+    float* directionX_{};
+    /// Normalized velocity Y coordinates. Output only.
+    float* directionY_{};
+    /// Normalized velocity Z coordinates. Output only.
+    float* directionZ_{};
+};
+
+/// Particle update parameters shared by all particles of an emitter.
+struct ParticleUpdateParams
+{
+    /// Time step.
+    float timeStep_{};
+    /// Constant force applied to velocity.
+    Vector3 constantForce_;
+    /// Velocity damping force.
+    float dampingForce_{};
+    /// Size scaling additive change per second.
+    float sizeAdd_{};
+    /// Size scaling multiplicative change per second.
+    float sizeMul_{ 1.0f };
+};
+
+/// Return SIMD instruction set used by the batch math kernels. Detected at startup.
+URHO3D_API SIMDLevel GetSIMDLevel();
+/// Override SIMD instruction set used by the batch math kernels, e.g. for benchmarking. Return false if not supported by the CPU or the build.
+URHO3D_API bool SetSIMDLevel(SIMDLevel level);
+
+/// Test a range of bounding boxes stored as arrays against a frustum. Results are INSIDE, INTERSECTS or OUTSIDE, like in Frustum::IsInside().
+URHO3D_API void IsInside(const Frustum& frustum, const BoundingBoxArrays& boxes, unsigned start, unsigned count, Intersection* results);
+/// Apply constant force and damping to a range of particle velocities, update size scaling and output normalized velocities, like ParticleEmitter::Update().
+URHO3D_API void UpdateParticles(const ParticleUpdateParams& params, const ParticleArrays& particles, unsigned start, unsigned count);
+
+}
@@ -30,6 +30,7 @@
 #include "../IO/MemoryBuffer.h"
 #include "../IO/PackageFile.h"
 #include "../Network/Connection.h"
+#include "../Network/InterestGrid.h"
 #include "../Network/Network.h"
 #include "../Network/NetworkEvents.h"
 #include "../Network/NetworkPriority.h"
@@ -57,6 +58,224 @@ namespace Urho3D
 {
 
 static const int STATS_INTERVAL_MSEC = 2000;
+/// Bits of the node ID in a quantized transform update.
+static const unsigned TRANSFORM_NODE_ID_BITS = 24;
+/// Bits of the baseline sequence distance in a quantized transform update.
+static const unsigned TRANSFORM_BASELINE_BITS = 4;
+static_assert((1u << TRANSFORM_BASELINE_BITS) == TRANSFORM_HISTORY_SIZE, "Baseline distance must cover the transform history");
+/// Bits of the bit length prefix of a position component delta.
+static const unsigned POSITION_LENGTH_BITS = 6;
+/// Bits of the bit length prefix of a rotation component delta.
+static const unsigned ROTATION_LENGTH_BITS = 5;
+/// Maximum absolute value of a quantized position component.
+static const float MAX_QUANTIZED_POSITION = 1073741824.0f;
+/// Name of the node position attribute replicated in quantized transform updates.
+static const char* NET_POSITION_ATTRIBUTE = "Network Position";
+/// Name of the node rotation attribute replicated in quantized transform updates.
+static const char* NET_ROTATION_ATTRIBUTE = "Network Rotation";
+/// Square root of two, the range of the three smallest components of a unit quaternion.
+static const float SQRT_TWO = 1.41421356f;
+/// Interest management distance multiplier for keeping already replicated nodes, to avoid recreating nodes near the boundary.
+static const float INTEREST_HYSTERESIS = 1.1f;
+
+namespace
+{
+
+/// Least significant bit first bit stream writer.
+class BitWriter
+{
+public:
+    /// Construct with destination.
+    explicit BitWriter(Serializer& dest) :
+        dest_(dest)
+    {
+    }
+
+    /// Write the lowest bits of a value, at most 32.
+    void Write(unsigned value, unsigned numBits)
+    {
+        buffer_ |= (static_cast<unsigned long long>(value) & ((1ull << numBits) - 1)) << numBits_;
+        numBits_ += numBits;
+        while (numBits_ >= 8)
+        {
+            dest_.WriteUByte(static_cast<unsigned char>(buffer_ & 0xff));
+            buffer_ >>= 8;
+            numBits_ -= 8;
+        }
+    }
+
+    /// Write a value prefixed by its bit length.
+    void WriteVariable(unsigned value, unsigned lengthBits)
+    {
+        unsigned length = 0;
+        while (value >> length)
+            ++length;
+        Write(length, lengthBits);
+        Write(value, length);
+    }
+
+    /// Write the remaining partial byte.
+    void Flush()
+    {
+        if (numBits_)
+            dest_.WriteUByte(static_cast<unsigned char>(buffer_ & 0xff));
+        buffer_ = 0;
+        numBits_ = 0;
+    }
+
+private:
+    /// Destination.
+    Serializer& dest_;
+    /// Bits not yet written.
+    unsigned long long buffer_{};
+    /// Number of bits not yet written.
+    unsigned numBits_{};
+};
+
+/// Least significant bit first bit stream reader.
+class BitReader
+{
+public:
+    /// Construct with source.
+    explicit BitReader(Deserializer& source) :
+        source_(source)
+    {
+    }
+
+    /// Read a value of at most 32 bits. Return zero and mark the reader invalid when out of data.
+    unsigned Read(unsigned numBits)
+    {
+        while (numBits_ < numBits)
+        {
+            if (source_.IsEof())
+            {
+                valid_ = false;
+                return 0;
+            }
+            buffer_ |= static_cast<unsigned long long>(source_.ReadUByte()) << numBits_;
+            numBits_ += 8;
+        }
+        const auto value = static_cast<unsigned>(buffer_ & ((1ull << numBits) - 1));
+        buffer_ >>= numBits;
+        numBits_ -= numBits;
+        return value;
+    }
+
+    /// Read a value prefixed by its bit length.
+    unsigned ReadVariable(unsigned lengthBits)
+    {
+        const unsigned length = Read(lengthBits);
+        if (length > 32)
+        {
+            valid_ = false;
+            return 0;
+        }
+        return Read(length);
+    }
+
+    /// Return whether all reads so far were within the data.
+    bool IsValid() const { return valid_; }
+
+private:
+    /// Source.
+    Deserializer& source_;
+    /// Bits read from the source but not yet returned.
+    unsigned long long buffer_{};
+    /// Number of bits read from the source but not yet returned.
+    unsigned numBits_{};
+    /// Valid flag.
+    bool valid_{true};
+};
+
+/// Map a signed delta to an unsigned value so that small magnitudes use few bits.
+unsigned ZigZagEncode(int from, int to)
+{
+    const long long delta = static_cast<long long>(to) - from;
+    return static_cast<unsigned>((static_cast<unsigned long long>(delta) << 1) ^ static_cast<unsigned long long>(delta >> 63));
+}
+
+/// Apply a zigzag encoded delta.
+int ZigZagDecode(int from, unsigned value)
+{
+    const long long delta = static_cast<long long>(value >> 1) ^ -static_cast<long long>(value & 1);
+    return static_cast<int>(from + delta);
+}
+
+/// Quantize node position and rotation.
+QuantizedTransform QuantizeTransform(const Node* node, float positionStep, unsigned rotationBits)
+{
+    QuantizedTransform result;
+
+    const Vector3& position = node->GetPosition();
+    result.position_.x_ = RoundToInt(Clamp(position.x_ / positionStep, -MAX_QUANTIZED_POSITION, MAX_QUANTIZED_POSITION));
+    result.position_.y_ = RoundToInt(Clamp(position.y_ / positionStep, -MAX_QUANTIZED_POSITION, MAX_QUANTIZED_POSITION));
+    result.position_.z_ = RoundToInt(Clamp(position.z_ / positionStep, -MAX_QUANTIZED_POSITION, MAX_QUANTIZED_POSITION));
+
+    // Smallest three encoding: omit the largest component and make it positive, as q and -q are the same rotation
+    const Quaternion rotation = node->GetRotation().Normalized();
+    const float components[4] = { rotation.w_, rotation.x_, rotation.y_, rotation.z_ };
+    unsigned largest = 0;
+    for (unsigned i = 1; i < 4; ++i)
+    {
+        if (Abs(components[i]) > Abs(components[largest]))
+            largest = i;
+    }
+    const float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+    const int maxValue = (1 << rotationBits) - 1;
+
+    int* rotationData = &result.rotation_.x_;
+    for (unsigned i = 0, j = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        const float normalized = sign * components[i] * SQRT_TWO * 0.5f + 0.5f;
+        rotationData[j++] = Clamp(RoundToInt(normalized * maxValue), 0, maxValue);
+    }
+    result.rotationIndex_ = largest;
+    return result;
+}
+
+/// Return quantized position in world units.
+Vector3 DequantizePosition(const QuantizedTransform& transform, float positionStep)
+{
+    return Vector3(transform.position_.x_ * positionStep, transform.position_.y_ * positionStep,
+        transform.position_.z_ * positionStep);
+}
+
+/// Return quantized rotation.
+Quaternion DequantizeRotation(const QuantizedTransform& transform, unsigned rotationBits)
+{
+    const auto maxValue = static_cast<float>((1 << rotationBits) - 1);
+    const int* rotationData = transform.rotation_.Data();
+
+    float components[4];
+    float sumSquared = 0.0f;
+    for (unsigned i = 0, j = 0; i < 4; ++i)
+    {
+        if (i == transform.rotationIndex_)
+            continue;
+        components[i] = (rotationData[j++] / maxValue - 0.5f) * SQRT_TWO;
+        sumSquared += components[i] * components[i];
+    }
+    components[transform.rotationIndex_] = sqrtf(Max(1.0f - sumSquared, 0.0f));
+
+    return Quaternion(components[0], components[1], components[2], components[3]).Normalized();
+}
+
+/// Apply a received quantized transform to a replicated node.
+void ApplyQuantizedTransform(Node* node, const QuantizedTransform& transform, float positionStep, unsigned rotationBits)
+{
+    node->SetNetPositionAttr(DequantizePosition(transform, positionStep));
+
+    const Quaternion rotation = DequantizeRotation(transform, rotationBits);
+    auto* smoothedTransform = node->GetComponent<SmoothedTransform>();
+    if (smoothedTransform)
+        smoothedTransform->SetTargetRotation(rotation);
+    else
+        node->SetRotation(rotation);
+}
+
+}
 
 PackageDownload::PackageDownload() :
     totalFragments_(0),
@@ -187,6 +406,10 @@ void Connection::SetScene(Scene* newScene)
     if (isClient_)
     {
         sceneState_.Clear();
+        relevantNodes_.clear();
+        interestManaged_ = false;
+        unackedTransforms_.clear();
+        ResetTransformBaselines();
 
         // When scene is assigned on the server, instruct the client to load it. This may require downloading packages
         const ea::vector<SharedPtr<PackageFile> >& packages = scene_->GetRequiredPackageFiles();
@@ -250,11 +473,46 @@ void Connection::Disconnect(int waitMSec)
     peer_->CloseConnection(*address_, true);
 }
 
+void Connection::PrepareServerUpdate()
+{
+    if (!scene_ || !sceneLoaded_)
+        return;
+
+    // World transforms are updated lazily on access, which must not happen from the parallel server updates.
+    // The root node is processed in every update, the other nodes when dirty
+    auto snapshotPosition = [this](unsigned nodeID)
+    {
+        auto i = sceneState_.nodeStates_.find(nodeID);
+        if (i != sceneState_.nodeStates_.end() && i->second.node_)
+            i->second.worldPosition_ = i->second.node_->GetWorldPosition();
+    };
+
+    snapshotPosition(scene_->GetID());
+    for (unsigned nodeID : sceneState_.dirtyNodes_)
+        snapshotPosition(nodeID);
+}
+
 void Connection::SendServerUpdate()
 {
     if (!scene_ || !sceneLoaded_)
         return;
 
+    // Delta baselines are only valid for the quantization they were encoded with
+    auto* network = GetSubsystem<Network>();
+    if (network->GetPositionQuantization() != transformPositionStep_ || network->GetRotationQuantization() != transformRotationBits_)
+    {
+        transformPositionStep_ = network->GetPositionQuantization();
+        transformRotationBits_ = network->GetRotationQuantization();
+        ResetTransformBaselines();
+    }
+
+    // Create and remove nodes on the client as they enter and leave the interest distance
+    const InterestGrid* interestGrid = network->GetInterestGrid(scene_);
+    if (interestGrid)
+        UpdateInterest(*interestGrid, network->GetInterestDistance());
+    else if (interestManaged_)
+        ResetInterest();
+
     // Always check the root node (scene) first so that the scene-wide components get sent first,
     // and all other replicated nodes get added to the dirty set for sending the initial state
     unsigned sceneID = scene_->GetID();
@@ -270,6 +528,8 @@ void Connection::SendServerUpdate()
         unsigned nodeID = *nodesToProcess_.begin();
         ProcessNode(nodeID);
     }
+
+    SendTransformUpdate();
 }
 
 void Connection::SendClientUpdate()
@@ -289,6 +549,15 @@ void Connection::SendClientUpdate()
         msg_.WritePackedQuaternion(rotation_);
     SendMessage(MSG_CONTROLS, false, false, msg_, CONTROLS_CONTENT_ID);
 
+    // Acknowledge the latest transform update so that the server can delta encode against it
+    if (transformAckPending_)
+    {
+        msg_.Clear();
+        msg_.WriteUInt(receivedTransformSequence_);
+        SendMessage(MSG_NODETRANSFORMACK, false, false, msg_);
+        transformAckPending_ = false;
+    }
+
     ++timeStamp_;
 }
 
@@ -404,6 +673,23 @@ void Connection::ProcessPendingLatestData()
             componentLatestData_.erase(current);
         }
     }
+
+    // Iterate through pending transforms and see if we can find the nodes now
+    for (auto i = pendingTransforms_.begin(); i != pendingTransforms_.end();)
+    {
+        auto current = i++;
+        Node* node = scene_->GetNode(*current);
+        if (node)
+        {
+            auto history = receivedTransforms_.find(*current);
+            if (history != receivedTransforms_.end())
+            {
+                const unsigned index = history->second.latestSequence_ % TRANSFORM_HISTORY_SIZE;
+                ApplyQuantizedTransform(node, history->second.transforms_[index], transformPositionStep_, transformRotationBits_);
+            }
+            pendingTransforms_.erase(current);
+        }
+    }
 }
 
 bool Connection::ProcessMessage(int msgID, MemoryBuffer& msg)
@@ -423,6 +709,10 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer& msg)
         ProcessControls(msgID, msg);
         break;
 
+    case MSG_NODETRANSFORMACK:
+        ProcessTransformAck(msgID, msg);
+        break;
+
     case MSG_SCENELOADED:
         ProcessSceneLoaded(msgID, msg);
         break;
@@ -448,6 +738,7 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer& msg)
     case MSG_COMPONENTDELTAUPDATE:
     case MSG_COMPONENTLATESTDATA:
     case MSG_REMOVECOMPONENT:
+    case MSG_NODETRANSFORMUPDATE:
         ProcessSceneUpdate(msgID, msg);
         break;
 
@@ -496,6 +787,8 @@ void Connection::ProcessLoadScene(int msgID, MemoryBuffer& msg)
     // Clear previous pending latest data and package downloads if any
     nodeLatestData_.clear();
     componentLatestData_.clear();
+    receivedTransforms_.clear();
+    pendingTransforms_.clear();
     downloads_.clear();
 
     // In case we have joined other scenes in this session, remove first all downloaded package files from the resource system
@@ -660,6 +953,8 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             if (node)
                 node->Remove();
             nodeLatestData_.erase(nodeID);
+            receivedTransforms_.erase(nodeID);
+            pendingTransforms_.erase(nodeID);
         }
         break;
 
@@ -740,6 +1035,10 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
         }
         break;
 
+    case MSG_NODETRANSFORMUPDATE:
+        ProcessTransformUpdate(msg);
+        break;
+
     default: break;
     }
 }
@@ -1156,7 +1455,13 @@ void Connection::ProcessNode(unsigned nodeID)
     {
         // Replication state found: the node is either be existing or removed
         Node* node = i->second.node_;
-        if (!node)
+        if (node && interestManaged_ && !IsRelevant(node))
+        {
+            // Reparented under a node that is not relevant
+            RemoveIrrelevantNode(node);
+            sceneState_.dirtyNodes_.erase(nodeID);
+        }
+        else if (!node)
         {
             msg_.Clear();
             msg_.WriteNetID(nodeID);
@@ -1174,11 +1479,12 @@ void Connection::ProcessNode(unsigned nodeID)
     {
         // Replication state not found: this is a new node
         Node* node = scene_->GetNode(nodeID);
-        if (node)
+        if (node && (!interestManaged_ || IsRelevant(node)))
             ProcessNewNode(node);
         else
         {
-            // Did not find the new node (may have been created, then removed immediately): erase from dirty set.
+            // Did not find the new node (may have been created, then removed immediately), or it is not relevant to
+            // this connection: erase from dirty set.
             sceneState_.dirtyNodes_.erase(nodeID);
         }
     }
@@ -1202,7 +1508,14 @@ void Connection::ProcessNewNode(Node* node)
     nodeState.connection_ = this;
     nodeState.sceneState_ = &sceneState_;
     nodeState.node_ = node;
-    node->AddReplicationState(&nodeState);
+    nodeState.firstTransformSequence_ = transformSequence_ + 1;
+
+    // Replication states of other connections may be added to the same node concurrently
+    Mutex& replicationMutex = GetSubsystem<Network>()->GetReplicationMutex();
+    {
+        MutexLock lock(replicationMutex);
+        node->AddReplicationState(&nodeState);
+    }
 
     // Write node's attributes
     node->WriteInitialDeltaUpdate(msg_, timeStamp_);
@@ -1230,7 +1543,10 @@ void Connection::ProcessNewNode(Node* node)
         componentState.connection_ = this;
         componentState.nodeState_ = &nodeState;
         componentState.component_ = component;
-        component->AddReplicationState(&componentState);
+        {
+            MutexLock lock(replicationMutex);
+            component->AddReplicationState(&componentState);
+        }
 
         msg_.WriteStringHash(component->GetType());
         msg_.WriteNetID(component->GetID());
@@ -1259,7 +1575,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
     auto* priority = node->GetComponent<NetworkPriority>();
     if (priority && (!priority->GetAlwaysUpdateOwner() || node->GetOwner() != this))
     {
-        float distance = (node->GetWorldPosition() - position_).Length();
+        float distance = (nodeState.worldPosition_ - position_).Length();
         if (!priority->CheckUpdate(distance, nodeState.priorityAcc_))
             return;
     }
@@ -1269,17 +1585,27 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
     {
         const ea::vector<AttributeInfo>* attributes = node->GetNetworkAttributes();
         unsigned numAttributes = attributes->size();
+        const bool quantizeTransform = transformPositionStep_ > 0.0f;
         bool hasLatestData = false;
+        bool hasTransform = false;
 
         for (unsigned i = 0; i < numAttributes; ++i)
         {
-            if (nodeState.dirtyAttributes_.IsSet(i) && (attributes->at(i).mode_ & AM_LATESTDATA))
+            const AttributeInfo& attr = attributes->at(i);
+            if (nodeState.dirtyAttributes_.IsSet(i) && (attr.mode_ & AM_LATESTDATA))
             {
-                hasLatestData = true;
+                if (quantizeTransform && (attr.name_ == NET_POSITION_ATTRIBUTE || attr.name_ == NET_ROTATION_ATTRIBUTE))
+                    hasTransform = true;
+                else
+                    hasLatestData = true;
                 nodeState.dirtyAttributes_.Clear(i);
             }
         }
 
+        // Send the transform in the transform update, which also skips changes below the quantization
+        if (hasTransform)
+            unackedTransforms_.insert(node->GetID());
+
         // Send latestdata message if necessary
         if (hasLatestData)
         {
@@ -1403,7 +1729,10 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 componentState.connection_ = this;
                 componentState.nodeState_ = &nodeState;
                 componentState.component_ = component;
-                component->AddReplicationState(&componentState);
+                {
+                    MutexLock lock(GetSubsystem<Network>()->GetReplicationMutex());
+                    component->AddReplicationState(&componentState);
+                }
 
                 msg_.Clear();
                 msg_.WriteNetID(node->GetID());
@@ -1420,6 +1749,379 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
     sceneState_.dirtyNodes_.erase(node->GetID());
 }
 
+void Connection::UpdateInterest(const InterestGrid& grid, float distance)
+{
+    URHO3D_PROFILE("UpdateInterest");
+
+    if (!interestManaged_)
+    {
+        // Start from the top-level nodes the client already has
+        relevantNodes_.clear();
+        for (auto i = sceneState_.nodeStates_.begin(); i != sceneState_.nodeStates_.end(); ++i)
+        {
+            Node* node = i->second.node_;
+            while (node && node->GetParent() && node->GetParent() != scene_)
+                node = node->GetParent();
+            if (node && node != scene_)
+                relevantNodes_.insert(node->GetID());
+        }
+        interestManaged_ = true;
+    }
+
+    newRelevantNodes_.clear();
+    for (Node* node : grid.GetAlwaysRelevantNodes())
+        newRelevantNodes_.insert(node->GetID());
+    for (Node* node : grid.GetOwnedNodes())
+    {
+        if (node->GetOwner() == this)
+            newRelevantNodes_.insert(node->GetID());
+    }
+
+    // Nodes already on the client are kept until slightly farther than new nodes are created
+    const float keepDistance = distance * INTEREST_HYSTERESIS;
+    interestQueryResult_.clear();
+    grid.Query(interestQueryResult_, position_, keepDistance);
+    for (const InterestGridEntry* entry : interestQueryResult_)
+    {
+        const unsigned nodeID = entry->node_->GetID();
+        const float nodeDistance = (entry->position_ - position_).Length();
+        if (nodeDistance <= (relevantNodes_.contains(nodeID) ? keepDistance : distance))
+            newRelevantNodes_.insert(nodeID);
+    }
+
+    for (auto i = relevantNodes_.begin(); i != relevantNodes_.end(); ++i)
+    {
+        // Removed nodes are handled by the regular replication update
+        if (!newRelevantNodes_.contains(*i))
+        {
+            Node* node = scene_->GetNode(*i);
+            if (node)
+                RemoveIrrelevantNode(node);
+        }
+    }
+
+    for (auto i = newRelevantNodes_.begin(); i != newRelevantNodes_.end(); ++i)
+    {
+        if (!relevantNodes_.contains(*i))
+        {
+            Node* node = scene_->GetNode(*i);
+            if (node)
+                MarkNodeDirtyRecursive(node);
+        }
+    }
+
+    relevantNodes_.swap(newRelevantNodes_);
+}
+
+void Connection::ResetInterest()
+{
+    const ea::vector<SharedPtr<Node> >& children = scene_->GetChildren();
+    for (Node* node : children)
+    {
+        if (!relevantNodes_.contains(node->GetID()))
+            MarkNodeDirtyRecursive(node);
+    }
+
+    relevantNodes_.clear();
+    interestManaged_ = false;
+}
+
+bool Connection::IsRelevant(Node* node) const
+{
+    while (node->GetParent() && node->GetParent() != scene_)
+        node = node->GetParent();
+
+    return node == scene_ || relevantNodes_.contains(node->GetID());
+}
+
+void Connection::RemoveIrrelevantNode(Node* node)
+{
+    auto i = sceneState_.nodeStates_.find(node->GetID());
+    if (i != sceneState_.nodeStates_.end())
+    {
+        NodeReplicationState& nodeState = i->second;
+        {
+            MutexLock lock(GetSubsystem<Network>()->GetReplicationMutex());
+            node->RemoveReplicationState(&nodeState);
+            for (auto j = nodeState.componentStates_.begin(); j != nodeState.componentStates_.end(); ++j)
+            {
+                if (Component* component = j->second.component_)
+                    component->RemoveReplicationState(&j->second);
+            }
+        }
+
+        // The node may have been queued for a transform update earlier in the same replication update
+        for (auto j = transformUpdates_.begin(); j != transformUpdates_.end();)
+        {
+            if (j->first == &nodeState)
+                j = transformUpdates_.erase(j);
+            else
+                ++j;
+        }
+
+        msg_.Clear();
+        msg_.WriteNetID(node->GetID());
+        SendMessage(MSG_REMOVENODE, true, true, msg_);
+        sceneState_.nodeStates_.erase(i);
+    }
+
+    const ea::vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (Node* child : children)
+        RemoveIrrelevantNode(child);
+}
+
+void Connection::MarkNodeDirtyRecursive(Node* node)
+{
+    if (node->IsReplicated())
+        sceneState_.dirtyNodes_.insert(node->GetID());
+
+    const ea::vector<SharedPtr<Node> >& children = node->GetChildren();
+    for (Node* child : children)
+        MarkNodeDirtyRecursive(child);
+}
+
+void Connection::SendTransformUpdate()
+{
+    transformUpdates_.clear();
+    for (auto i = unackedTransforms_.begin(); i != unackedTransforms_.end();)
+    {
+        auto current = i++;
+        auto nodeState = sceneState_.nodeStates_.find(*current);
+        Node* node = nodeState != sceneState_.nodeStates_.end() ? nodeState->second.node_ : nullptr;
+        if (!node)
+        {
+            unackedTransforms_.erase(current);
+            continue;
+        }
+
+        // Done when the client has acknowledged the last sent transform and the node has not moved from it by a
+        // quantization step. Otherwise resend, as the update that carried it may have been lost
+        const QuantizedTransform transform = QuantizeTransform(node, transformPositionStep_, transformRotationBits_);
+        NodeReplicationState& state = nodeState->second;
+        if (state.baselineSequence_ && state.baselineSequence_ >= state.sentSequence_ && transform == state.baselineTransform_)
+        {
+            unackedTransforms_.erase(current);
+            continue;
+        }
+
+        transformUpdates_.emplace_back(&state, transform);
+    }
+
+    if (transformUpdates_.empty())
+        return;
+
+    const unsigned sequence = ++transformSequence_;
+    SentTransformUpdate& sentUpdate = sentTransformUpdates_[sequence % TRANSFORM_HISTORY_SIZE];
+    sentUpdate.sequence_ = sequence;
+    sentUpdate.transforms_.clear();
+
+    msg_.Clear();
+    msg_.WriteUInt(sequence);
+    msg_.WriteFloat(transformPositionStep_);
+    msg_.WriteUByte(static_cast<unsigned char>(transformRotationBits_));
+    msg_.WriteVLE(transformUpdates_.size());
+
+    BitWriter writer(msg_);
+    for (const auto& update : transformUpdates_)
+    {
+        NodeReplicationState* nodeState = update.first;
+        const QuantizedTransform& transform = update.second;
+        const unsigned nodeID = nodeState->node_->GetID();
+
+        // Delta encode against the acknowledged baseline while the client still keeps it, otherwise send the full
+        // transform, which is encoded as a delta from a zero baseline
+        unsigned distance = nodeState->baselineSequence_ ? sequence - nodeState->baselineSequence_ : 0;
+        if (distance >= TRANSFORM_HISTORY_SIZE)
+            distance = 0;
+        const QuantizedTransform baseline = distance ? nodeState->baselineTransform_ : QuantizedTransform();
+
+        writer.Write(nodeID, TRANSFORM_NODE_ID_BITS);
+        writer.Write(distance, TRANSFORM_BASELINE_BITS);
+
+        const bool positionChanged = transform.position_ != baseline.position_;
+        writer.Write(positionChanged, 1);
+        if (positionChanged)
+        {
+            writer.WriteVariable(ZigZagEncode(baseline.position_.x_, transform.position_.x_), POSITION_LENGTH_BITS);
+            writer.WriteVariable(ZigZagEncode(baseline.position_.y_, transform.position_.y_), POSITION_LENGTH_BITS);
+            writer.WriteVariable(ZigZagEncode(baseline.position_.z_, transform.position_.z_), POSITION_LENGTH_BITS);
+        }
+
+        const bool rotationChanged = transform.rotation_ != baseline.rotation_ || transform.rotationIndex_ != baseline.rotationIndex_;
+        writer.Write(rotationChanged, 1);
+        if (rotationChanged)
+        {
+            // Components are only delta encoded when they refer to the same omitted component
+            const bool sameIndex = transform.rotationIndex_ == baseline.rotationIndex_;
+            writer.Write(sameIndex, 1);
+            if (sameIndex)
+            {
+                writer.WriteVariable(ZigZagEncode(baseline.rotation_.x_, transform.rotation_.x_), ROTATION_LENGTH_BITS);
+                writer.WriteVariable(ZigZagEncode(baseline.rotation_.y_, transform.rotation_.y_), ROTATION_LENGTH_BITS);
+                writer.WriteVariable(ZigZagEncode(baseline.rotation_.z_, transform.rotation_.z_), ROTATION_LENGTH_BITS);
+            }
+            else
+            {
+                writer.Write(transform.rotationIndex_, 2);
+                writer.Write(transform.rotation_.x_, transformRotationBits_);
+                writer.Write(transform.rotation_.y_, transformRotationBits_);
+                writer.Write(transform.rotation_.z_, transformRotationBits_);
+            }
+        }
+
+        nodeState->sentSequence_ = sequence;
+        sentUpdate.transforms_.emplace_back(nodeID, transform);
+    }
+    writer.Flush();
+
+    // Unreliable, so that a lost update does not hold back the later ones. Unacknowledged transforms are resent
+    SendMessage(MSG_NODETRANSFORMUPDATE, false, false, msg_);
+}
+
+void Connection::ResetTransformBaselines()
+{
+    for (SentTransformUpdate& sentUpdate : sentTransformUpdates_)
+    {
+        sentUpdate.sequence_ = 0;
+        sentUpdate.transforms_.clear();
+    }
+
+    for (auto i = sceneState_.nodeStates_.begin(); i != sceneState_.nodeStates_.end(); ++i)
+    {
+        i->second.baselineTransform_ = QuantizedTransform();
+        i->second.baselineSequence_ = 0;
+    }
+}
+
+void Connection::ProcessTransformUpdate(MemoryBuffer& msg)
+{
+    // Updates are unreliable and may arrive out of order. Older ones than the last received are obsolete
+    const unsigned sequence = msg.ReadUInt();
+    if (sequence <= receivedTransformSequence_)
+        return;
+
+    const float positionStep = msg.ReadFloat();
+    const unsigned rotationBits = msg.ReadUByte();
+    const unsigned numNodes = msg.ReadVLE();
+    if (positionStep <= 0.0f || rotationBits < 4 || rotationBits > 16)
+    {
+        URHO3D_LOGERROR("Invalid quantization in node transform update");
+        return;
+    }
+
+    // Received transforms can not be used as baselines with another quantization
+    if (positionStep != transformPositionStep_ || rotationBits != transformRotationBits_)
+    {
+        transformPositionStep_ = positionStep;
+        transformRotationBits_ = rotationBits;
+        receivedTransforms_.clear();
+        pendingTransforms_.clear();
+    }
+
+    BitReader reader(msg);
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        const unsigned nodeID = reader.Read(TRANSFORM_NODE_ID_BITS);
+        const unsigned distance = reader.Read(TRANSFORM_BASELINE_BITS);
+        ReceivedTransformHistory& history = receivedTransforms_[nodeID];
+
+        QuantizedTransform transform;
+        bool hasBaseline = true;
+        if (distance)
+        {
+            const unsigned baselineSequence = sequence - distance;
+            const unsigned baselineIndex = baselineSequence % TRANSFORM_HISTORY_SIZE;
+            if (history.sequences_[baselineIndex] == baselineSequence)
+                transform = history.transforms_[baselineIndex];
+            else
+                hasBaseline = false;
+        }
+
+        if (reader.Read(1))
+        {
+            transform.position_.x_ = ZigZagDecode(transform.position_.x_, reader.ReadVariable(POSITION_LENGTH_BITS));
+            transform.position_.y_ = ZigZagDecode(transform.position_.y_, reader.ReadVariable(POSITION_LENGTH_BITS));
+            transform.position_.z_ = ZigZagDecode(transform.position_.z_, reader.ReadVariable(POSITION_LENGTH_BITS));
+        }
+
+        if (reader.Read(1))
+        {
+            if (reader.Read(1))
+            {
+                transform.rotation_.x_ = ZigZagDecode(transform.rotation_.x_, reader.ReadVariable(ROTATION_LENGTH_BITS));
+                transform.rotation_.y_ = ZigZagDecode(transform.rotation_.y_, reader.ReadVariable(ROTATION_LENGTH_BITS));
+                transform.rotation_.z_ = ZigZagDecode(transform.rotation_.z_, reader.ReadVariable(ROTATION_LENGTH_BITS));
+            }
+            else
+            {
+                transform.rotationIndex_ = reader.Read(2);
+                transform.rotation_.x_ = reader.Read(rotationBits);
+                transform.rotation_.y_ = reader.Read(rotationBits);
+                transform.rotation_.z_ = reader.Read(rotationBits);
+            }
+        }
+
+        if (!reader.IsValid())
+        {
+            URHO3D_LOGERROR("Truncated node transform update");
+            return;
+        }
+
+        if (!hasBaseline)
+        {
+            URHO3D_LOGWARNING("NodeTransformUpdate message received without baseline for node " + ea::to_string(nodeID));
+            continue;
+        }
+
+        const unsigned index = sequence % TRANSFORM_HISTORY_SIZE;
+        history.transforms_[index] = transform;
+        history.sequences_[index] = sequence;
+        history.latestSequence_ = sequence;
+
+        // Transform updates may be received before node creation, so apply later if necessary
+        Node* node = scene_->GetNode(nodeID);
+        if (node)
+            ApplyQuantizedTransform(node, transform, positionStep, rotationBits);
+        else
+            pendingTransforms_.insert(nodeID);
+    }
+
+    receivedTransformSequence_ = sequence;
+    transformAckPending_ = true;
+}
+
+void Connection::ProcessTransformAck(int msgID, MemoryBuffer& msg)
+{
+    if (!IsClient())
+    {
+        URHO3D_LOGWARNING("Received unexpected NodeTransformAck message from server");
+        return;
+    }
+
+    const unsigned sequence = msg.ReadUInt();
+    SentTransformUpdate& sentUpdate = sentTransformUpdates_[sequence % TRANSFORM_HISTORY_SIZE];
+    if (!sequence || sentUpdate.sequence_ != sequence)
+        return;
+
+    // The client now keeps the transforms of this update, so they can be used as baselines
+    for (const auto& sent : sentUpdate.transforms_)
+    {
+        auto i = sceneState_.nodeStates_.find(sent.first);
+        if (i == sceneState_.nodeStates_.end())
+            continue;
+
+        NodeReplicationState& nodeState = i->second;
+        if (sequence >= nodeState.firstTransformSequence_ && sequence > nodeState.baselineSequence_)
+        {
+            nodeState.baselineTransform_ = sent.second;
+            nodeState.baselineSequence_ = sequence;
+        }
+    }
+
+    sentUpdate.sequence_ = 0;
+    sentUpdate.transforms_.clear();
+}
+
 bool Connection::RequestNeededPackages(unsigned numPackages, MemoryBuffer& msg)
 {
     auto* cache = GetSubsystem<ResourceCache>();
@@ -30,6 +30,7 @@
 #include "../Core/Timer.h"
 #include "../Input/Controls.h"
 #include "../IO/VectorBuffer.h"
+#include "../Network/Protocol.h"
 #include "../Scene/ReplicationState.h"
 
 namespace SLNet
@@ -46,11 +47,13 @@ namespace Urho3D
 {
 
 class File;
+class InterestGrid;
 class MemoryBuffer;
 class Node;
 class Scene;
 class Serializable;
 class PackageFile;
+struct InterestGridEntry;
 
 /// Queued remote event.
 struct RemoteEvent
@@ -99,6 +102,26 @@ struct PackageUpload
     unsigned totalFragments_;
 };
 
+/// Quantized transforms of a node received in the recent transform updates, indexed by sequence number modulo the history size.
+struct ReceivedTransformHistory
+{
+    /// Received transforms.
+    QuantizedTransform transforms_[TRANSFORM_HISTORY_SIZE];
+    /// Sequence numbers of the transform updates the transforms were received in.
+    unsigned sequences_[TRANSFORM_HISTORY_SIZE]{};
+    /// Sequence number of the latest received transform.
+    unsigned latestSequence_{};
+};
+
+/// Sent transform update waiting for acknowledgement.
+struct SentTransformUpdate
+{
+    /// Sequence number, or zero if acknowledged or discarded.
+    unsigned sequence_{};
+    /// Node IDs and their sent transforms.
+    ea::vector<ea::pair<unsigned, QuantizedTransform> > transforms_;
+};
+
 /// Send modes for observer position/rotation. Activated by the client setting either position or rotation.
 enum ObserverPositionSendMode
 {
@@ -147,7 +170,9 @@ public:
     void SetLogStatistics(bool enable);
     /// Disconnect. If wait time is non-zero, will block while waiting for disconnect to finish.
     void Disconnect(int waitMSec = 0);
-    /// Send scene update messages. Called by Network.
+    /// Snapshot the world positions of the dirty nodes before the scene update messages are built. Called by Network from the main thread.
+    void PrepareServerUpdate();
+    /// Send scene update messages. Called by Network, possibly in parallel with other connections.
     void SendServerUpdate();
     /// Send latest controls from the client. Called by Network.
     void SendClientUpdate();
@@ -269,6 +294,24 @@ private:
     void ProcessNewNode(Node* node);
     /// Process a node that the client has already received.
     void ProcessExistingNode(Node* node, NodeReplicationState& nodeState);
+    /// Update the top-level nodes relevant to this connection from the interest management grid. Removes the nodes that are no longer relevant from the client and queues the newly relevant ones for creation.
+    void UpdateInterest(const InterestGrid& grid, float distance);
+    /// Stop interest management and queue all nodes missing from the client for creation.
+    void ResetInterest();
+    /// Return whether a node is replicated to this connection according to interest management.
+    bool IsRelevant(Node* node) const;
+    /// Remove a node and its children from the client, when they are no longer relevant.
+    void RemoveIrrelevantNode(Node* node);
+    /// Queue a node and its children for replication.
+    void MarkNodeDirtyRecursive(Node* node);
+    /// Send the quantized transform update for nodes whose transform the client has not acknowledged.
+    void SendTransformUpdate();
+    /// Discard the sent transform updates and the delta encoding baselines of the nodes.
+    void ResetTransformBaselines();
+    /// Process a quantized transform update message from the server.
+    void ProcessTransformUpdate(MemoryBuffer& msg);
+    /// Process a transform update acknowledgement message from the client.
+    void ProcessTransformAck(int msgID, MemoryBuffer& msg);
     /// Process a SyncPackagesInfo message from server.
     void ProcessPackageInfo(int msgID, MemoryBuffer& msg);
     /// Check a package list received from server and initiate package downloads as necessary. Return true on success, or false if failed to initialze downloads (cache dir not set).
@@ -298,6 +341,34 @@ private:
     ea::unordered_map<unsigned, ea::vector<unsigned char> > componentLatestData_;
     /// Node ID's to process during a replication update.
     ea::hash_set<unsigned> nodesToProcess_;
+    /// IDs of the top-level nodes replicated to the client according to interest management.
+    ea::hash_set<unsigned> relevantNodes_;
+    /// IDs of the top-level nodes relevant in the current replication update.
+    ea::hash_set<unsigned> newRelevantNodes_;
+    /// Interest management grid query result.
+    ea::vector<const InterestGridEntry*> interestQueryResult_;
+    /// Whether interest management is active.
+    bool interestManaged_{};
+    /// IDs of nodes whose latest transform the client has not acknowledged. Resent in every transform update until it has.
+    ea::hash_set<unsigned> unackedTransforms_;
+    /// Nodes and their quantized transforms to send in the current transform update.
+    ea::vector<ea::pair<NodeReplicationState*, QuantizedTransform> > transformUpdates_;
+    /// Sent transform updates waiting for acknowledgement, indexed by sequence number modulo the history size.
+    SentTransformUpdate sentTransformUpdates_[TRANSFORM_HISTORY_SIZE];
+    /// Sequence number of the last sent transform update.
+    unsigned transformSequence_{};
+    /// Recently received quantized transforms by node ID, which transform updates are delta decoded against.
+    ea::unordered_map<unsigned, ReceivedTransformHistory> receivedTransforms_;
+    /// IDs of not yet received nodes whose transform has been received.
+    ea::hash_set<unsigned> pendingTransforms_;
+    /// Sequence number of the last received transform update.
+    unsigned receivedTransformSequence_{};
+    /// Whether the last received transform update should be acknowledged in the next client update.
+    bool transformAckPending_{};
+    /// Position quantization step of the sent or received transform updates.
+    float transformPositionStep_{};
+    /// Rotation bits per component of the sent or received transform updates.
+    unsigned transformRotationBits_{};
     /// Reusable message buffer.
     VectorBuffer msg_;
     /// Queued remote events.
@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Network/InterestGrid.h"
+#include "../Scene/Scene.h"
+
+#include <EASTL/algorithm.h>
+#include <EASTL/sort.h>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+void InterestGrid::Build(Scene* scene, float cellSize)
+{
+    cellSize_ = cellSize;
+    entries_.clear();
+    alwaysRelevantNodes_.clear();
+    ownedNodes_.clear();
+
+    const ea::vector<SharedPtr<Node> >& children = scene->GetChildren();
+    for (Node* node : children)
+    {
+        if (!node->IsReplicated())
+            continue;
+
+        if (node->IsAlwaysRelevant())
+            alwaysRelevantNodes_.push_back(node);
+        else
+        {
+            // Owned nodes are also binned, as they are relevant to other connections by distance
+            if (node->GetOwner())
+                ownedNodes_.push_back(node);
+
+            const Vector3 position = node->GetWorldPosition();
+            entries_.push_back({ GetCellKey(GetCellCoordinate(position.x_), GetCellCoordinate(position.z_)), node, position });
+        }
+    }
+
+    ea::sort(entries_.begin(), entries_.end(),
+        [](const InterestGridEntry& lhs, const InterestGridEntry& rhs) { return lhs.cell_ < rhs.cell_; });
+}
+
+void InterestGrid::Query(ea::vector<const InterestGridEntry*>& dest, const Vector3& center, float radius) const
+{
+    const int minX = GetCellCoordinate(center.x_ - radius);
+    const int maxX = GetCellCoordinate(center.x_ + radius);
+    const int minZ = GetCellCoordinate(center.z_ - radius);
+    const int maxZ = GetCellCoordinate(center.z_ + radius);
+
+    // Cells of a row are contiguous in the sorted entries
+    for (int z = minZ; z <= maxZ; ++z)
+    {
+        const unsigned long long firstKey = GetCellKey(minX, z);
+        const unsigned long long lastKey = GetCellKey(maxX, z);
+        auto i = ea::lower_bound(entries_.begin(), entries_.end(), firstKey,
+            [](const InterestGridEntry& entry, unsigned long long key) { return entry.cell_ < key; });
+        for (; i != entries_.end() && i->cell_ <= lastKey; ++i)
+            dest.push_back(&*i);
+    }
+}
+
+unsigned long long InterestGrid::GetCellKey(int x, int z)
+{
+    // Flip the sign bits so that unsigned order matches signed order
+    return (static_cast<unsigned long long>(static_cast<unsigned>(z) ^ 0x80000000u) << 32u) |
+        (static_cast<unsigned>(x) ^ 0x80000000u);
+}
+
+int InterestGrid::GetCellCoordinate(float value) const
+{
+    return FloorToInt(Clamp(value / cellSize_, -1073741824.0f, 1073741824.0f));
+}
+
+}
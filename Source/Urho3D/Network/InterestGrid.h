@@ -0,0 +1,78 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Math/Vector3.h"
+
+#include <EASTL/vector.h>
+
+namespace Urho3D
+{
+
+class Node;
+class Scene;
+
+/// Top-level scene node binned to an interest grid cell.
+struct InterestGridEntry
+{
+    /// Cell key, ordered by row and then column.
+    unsigned long long cell_;
+    /// Node.
+    Node* node_;
+    /// World position of the node when the grid was built.
+    Vector3 position_;
+};
+
+/// Grid of a scene's top-level replicated nodes on the XZ plane for network interest management. Rebuilt once per network update and shared by all connections to the scene.
+class URHO3D_API InterestGrid
+{
+public:
+    /// Rebuild from the top-level replicated nodes of a scene.
+    void Build(Scene* scene, float cellSize);
+    /// Append nodes from the cells overlapping a circle on the XZ plane. May include nodes outside the circle.
+    void Query(ea::vector<const InterestGridEntry*>& dest, const Vector3& center, float radius) const;
+
+    /// Return top-level nodes that are always relevant.
+    const ea::vector<Node*>& GetAlwaysRelevantNodes() const { return alwaysRelevantNodes_; }
+
+    /// Return top-level nodes that have an owner connection.
+    const ea::vector<Node*>& GetOwnedNodes() const { return ownedNodes_; }
+
+private:
+    /// Return cell key for cell coordinates.
+    static unsigned long long GetCellKey(int x, int z);
+    /// Return cell coordinate for a world coordinate.
+    int GetCellCoordinate(float value) const;
+
+    /// Nodes sorted by cell.
+    ea::vector<InterestGridEntry> entries_;
+    /// Top-level nodes that are always relevant.
+    ea::vector<Node*> alwaysRelevantNodes_;
+    /// Top-level nodes that have an owner connection.
+    ea::vector<Node*> ownedNodes_;
+    /// Cell size.
+    float cellSize_{1.0f};
+};
+
+}
@@ -25,6 +25,7 @@
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../Engine/EngineEvents.h"
 #include "../IO/FileSystem.h"
 #include "../Input/InputEvents.h"
@@ -191,6 +192,7 @@ static const char* RAKNET_MESSAGEID_STRINGS[] = {
 };
 
 static const int DEFAULT_UPDATE_FPS = 30;
+static const unsigned DEFAULT_ROTATION_QUANTIZATION = 12;
 static const int SERVER_TIMEOUT_TIME = 10000;
 
 Network::Network(Context* context) :
@@ -198,6 +200,9 @@ Network::Network(Context* context) :
     updateFps_(DEFAULT_UPDATE_FPS),
     simulatedLatency_(0),
     simulatedPacketLoss_(0.0f),
+    positionQuantization_(0.0f),
+    rotationQuantization_(DEFAULT_ROTATION_QUANTIZATION),
+    interestDistance_(0.0f),
     updateInterval_(1.0f / (float)DEFAULT_UPDATE_FPS),
     updateAcc_(0.0f),
     isServer_(false),
@@ -586,6 +591,21 @@ void Network::SetUpdateFps(int fps)
     updateAcc_ = 0.0f;
 }
 
+void Network::SetPositionQuantization(float step)
+{
+    positionQuantization_ = Max(step, 0.0f);
+}
+
+void Network::SetRotationQuantization(unsigned bits)
+{
+    rotationQuantization_ = Clamp(bits, 4u, 16u);
+}
+
+void Network::SetInterestDistance(float distance)
+{
+    interestDistance_ = Max(distance, 0.0f);
+}
+
 void Network::SetSimulatedLatency(int ms)
 {
     simulatedLatency_ = Max(ms, 0);
@@ -673,6 +693,12 @@ Connection* Network::GetConnection(const SLNet::AddressOrGUID& connection) const
     }
 }
 
+const InterestGrid* Network::GetInterestGrid(Scene* scene) const
+{
+    auto i = interestGrids_.find(scene);
+    return i != interestGrids_.end() ? &i->second : nullptr;
+}
+
 Connection* Network::GetServerConnection() const
 {
     return serverConnection_;
@@ -947,17 +973,45 @@ void Network::PostUpdate(float timeStep)
 
                 for (auto i = networkScenes_.begin(); i != networkScenes_.end(); ++i)
                     (*i)->PrepareNetworkUpdate();
+
+                // Bin top-level nodes once per scene for the connections' interest management
+                for (auto i = interestGrids_.begin(); i != interestGrids_.end();)
+                {
+                    if (interestDistance_ > 0.0f && networkScenes_.contains(i->first))
+                        ++i;
+                    else
+                        i = interestGrids_.erase(i);
+                }
+                if (interestDistance_ > 0.0f)
+                {
+                    for (auto i = networkScenes_.begin(); i != networkScenes_.end(); ++i)
+                        interestGrids_[*i].Build(*i, interestDistance_);
+                }
             }
 
             {
                 URHO3D_PROFILE("SendServerUpdate");
 
-                // Then send server updates for each client connection
+                // Then build server updates for each client connection in parallel. The scenes are only read from this
+                // point on, and each connection writes only its own replication state. SLikeNet queues the messages
+                // for sending on its network thread
+                updateConnections_.clear();
                 for (auto i = clientConnections_.begin(); i != clientConnections_.end(); ++i)
                 {
-                    i->second->SendServerUpdate();
-                    i->second->SendRemoteEvents();
-                    i->second->SendPackages();
+                    i->second->PrepareServerUpdate();
+                    updateConnections_.push_back(i->second);
+                }
+
+                GetSubsystem<WorkQueue>()->ParallelFor(updateConnections_.size(), 1, [this](unsigned fromIndex, unsigned toIndex)
+                {
+                    for (unsigned i = fromIndex; i < toIndex; ++i)
+                        updateConnections_[i]->SendServerUpdate();
+                });
+
+                for (Connection* connection : updateConnections_)
+                {
+                    connection->SendRemoteEvents();
+                    connection->SendPackages();
                 }
             }
         }
@@ -24,9 +24,11 @@
 
 #include <EASTL/hash_set.h>
 
+#include "../Core/Mutex.h"
 #include "../Core/Object.h"
 #include "../IO/VectorBuffer.h"
 #include "../Network/Connection.h"
+#include "../Network/InterestGrid.h"
 
 namespace Urho3D
 {
@@ -91,6 +93,12 @@ public:
     void SetSimulatedLatency(int ms);
     /// Set simulated packet loss probability between 0.0 - 1.0.
     void SetSimulatedPacketLoss(float probability);
+    /// Set position quantization step in world units for replicated node transforms. Zero (default) disables quantization and replicates transforms as full precision latest data.
+    void SetPositionQuantization(float step);
+    /// Set bits per component for quantized replicated node rotations, between 4 and 16.
+    void SetRotationQuantization(unsigned bits);
+    /// Set distance from a connection's observer position beyond which top-level scene nodes and their children are not replicated to it. Zero (default) replicates the whole scene.
+    void SetInterestDistance(float distance);
     /// Register a remote event as allowed to be received. There is also a fixed blacklist of events that can not be allowed in any case, such as ConsoleCommand.
     void RegisterRemoteEvent(StringHash eventType);
     /// Unregister a remote event as allowed to received.
@@ -114,6 +122,21 @@ public:
     /// Return simulated packet loss probability.
     float GetSimulatedPacketLoss() const { return simulatedPacketLoss_; }
 
+    /// Return position quantization step for replicated node transforms.
+    float GetPositionQuantization() const { return positionQuantization_; }
+
+    /// Return bits per component for quantized replicated node rotations.
+    unsigned GetRotationQuantization() const { return rotationQuantization_; }
+
+    /// Return interest management distance.
+    float GetInterestDistance() const { return interestDistance_; }
+
+    /// Return mutex for adding and removing scene objects' replication states while connections build their updates in parallel.
+    Mutex& GetReplicationMutex() { return replicationMutex_; }
+
+    /// Return interest management grid of a scene for the current network update, or null if interest management is disabled.
+    const InterestGrid* GetInterestGrid(Scene* scene) const;
+
     /// Return a client or server connection by RakNet connection address, or null if none exist.
     Connection* GetConnection(const SLNet::AddressOrGUID& connection) const;
     /// Return the connection to the server. Null if not connected.
@@ -169,6 +192,18 @@ private:
     int simulatedLatency_;
     /// Simulated packet loss probability between 0.0 - 1.0.
     float simulatedPacketLoss_;
+    /// Position quantization step for replicated node transforms.
+    float positionQuantization_;
+    /// Bits per component for quantized replicated node rotations.
+    unsigned rotationQuantization_;
+    /// Interest management distance.
+    float interestDistance_;
+    /// Interest management grids of networked scenes.
+    ea::unordered_map<Scene*, InterestGrid> interestGrids_;
+    /// Client connections being updated in parallel.
+    ea::vector<Connection*> updateConnections_;
+    /// Replication state mutex.
+    Mutex replicationMutex_;
     /// Update time interval.
     float updateInterval_;
     /// Update time accumulator.
@@ -63,10 +63,16 @@ static const int MSG_REMOTEEVENT = 0x96;
 static const int MSG_REMOTENODEEVENT = 0x97;
 /// Server->client: info about package.
 static const int MSG_PACKAGEINFO = 0x98;
+/// Server->client: quantized and delta encoded node transforms.
+static const int MSG_NODETRANSFORMUPDATE = 0x99;
+/// Client->server: acknowledge the latest received node transform update.
+static const int MSG_NODETRANSFORMACK = 0x9A;
 
 /// Fixed content ID for client controls update.
 static const unsigned CONTROLS_CONTENT_ID = 1;
 /// Package file fragment size.
 static const unsigned PACKAGE_FRAGMENT_SIZE = 1024;
+/// Number of recent node transform updates whose transforms can be used as delta encoding baselines.
+static const unsigned TRANSFORM_HISTORY_SIZE = 16;
 
 }
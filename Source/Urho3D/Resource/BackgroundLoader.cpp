@@ -25,147 +25,213 @@
 #include "../Precompiled.h"
 
 #include "../Core/Context.h"
+#include "../Core/ProcessUtils.h"
 #include "../Core/Profiler.h"
+#include "../Core/Timer.h"
 #include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
 #include "../Resource/BackgroundLoader.h"
 #include "../Resource/ResourceCache.h"
 #include "../Resource/ResourceEvents.h"
 
+#include <EASTL/sort.h>
+
 #include "../DebugNew.h"
 
 namespace Urho3D
 {
 
+namespace
+{
+
+/// Maximum number of queued resources whose files are read ahead of loading. Bounds the memory held by prefetched data.
+static const unsigned MAX_PREFETCHED_RESOURCES = 32;
+
+/// Loader thread that loads queued resources until stopped.
+class BackgroundLoaderThread : public Thread
+{
+public:
+    /// Construct.
+    explicit BackgroundLoaderThread(BackgroundLoader* loader) :
+        loader_(loader)
+    {
+    }
+
+    /// Destruct. Wait for the resource being loaded.
+    ~BackgroundLoaderThread() override
+    {
+        Stop();
+    }
+
+    /// Resource background loading loop.
+    void ThreadFunction() override
+    {
+        while (shouldRun_)
+        {
+            if (!loader_->LoadNextResource())
+                Time::Sleep(5);
+        }
+    }
+
+private:
+    /// Background loader.
+    BackgroundLoader* loader_;
+};
+
+}
+
 BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
-    owner_(owner)
+    owner_(owner),
+    numThreads_(Clamp(GetNumPhysicalCPUs() - 1, 1u, 4u)),
+    numPrefetched_(0)
 {
 }
 
 BackgroundLoader::~BackgroundLoader()
 {
+    StopThreads();
+
     MutexLock lock(backgroundLoadMutex_);
 
     backgroundLoadQueue_.clear();
+    for (ea::deque<ItemKey>& queue : loadQueues_)
+        queue.clear();
+    numPrefetched_ = 0;
 }
 
-void BackgroundLoader::ThreadFunction()
+bool BackgroundLoader::LoadNextResource()
 {
-    while (shouldRun_)
-    {
-        backgroundLoadMutex_.Acquire();
+    backgroundLoadMutex_.Acquire();
 
-        // Search for a queued resource that has not been loaded yet
-        auto i = backgroundLoadQueue_.begin();
-        while (i != backgroundLoadQueue_.end())
+    // Take the oldest queued resource of the highest priority, skipping stale keys
+    BackgroundLoadItem* item = nullptr;
+    for (int priority = MAX_LOAD_PRIORITIES - 1; priority >= 0 && !item; --priority)
+    {
+        ea::deque<ItemKey>& queue = loadQueues_[priority];
+        while (!queue.empty())
         {
-            if (i->second.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
+            auto i = backgroundLoadQueue_.find(queue.front());
+            queue.pop_front();
+            if (i != backgroundLoadQueue_.end() && i->second.priority_ == priority && ClaimResource(i->second))
+            {
+                item = &i->second;
                 break;
-            else
-                ++i;
+            }
         }
+    }
+
+    // We can be sure that the item is not removed from the queue as long as it is in the "loading" state
+    backgroundLoadMutex_.Release();
+
+    if (!item)
+        return false;
+
+    LoadResource(*item);
+    return true;
+}
 
-        if (i == backgroundLoadQueue_.end())
+bool BackgroundLoader::QueueResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller,
+    ResourceLoadPriority priority)
+{
+    StringHash nameHash(name);
+    ItemKey key = ea::make_pair(type, nameHash);
+
+    // The file read is issued after releasing the mutex, as it may block or complete immediately
+    PrefetchList prefetches;
+    {
+        MutexLock lock(backgroundLoadMutex_);
+
+        // Check if already exists in the queue. A new request revokes cancellation and may raise the priority
+        auto existing = backgroundLoadQueue_.find(key);
+        if (existing != backgroundLoadQueue_.end())
         {
-            // No resources to load found
-            backgroundLoadMutex_.Release();
-            Time::Sleep(5);
+            existing->second.cancelled_ = false;
+            RaisePriority(key, priority);
+            return false;
         }
-        else
-        {
-            BackgroundLoadItem& item = i->second;
-            Resource* resource = item.resource_;
-            // We can be sure that the item is not removed from the queue as long as it is in the
-            // "queued" or "loading" state
-            backgroundLoadMutex_.Release();
 
-            bool success = false;
-            SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
-            if (file)
-            {
-                resource->SetAsyncLoadState(ASYNC_LOADING);
-                success = resource->BeginLoad(*file);
-            }
+        BackgroundLoadItem& item = backgroundLoadQueue_[key];
+        item.sendEventOnFailure_ = sendEventOnFailure;
+        item.priority_ = priority;
+        item.cancelled_ = false;
+        item.prefetchAttempted_ = false;
 
-            // Process dependencies now
-            // Need to lock the queue again when manipulating other entries
-            ea::pair<StringHash, StringHash> key = ea::make_pair(resource->GetType(), resource->GetNameHash());
-            backgroundLoadMutex_.Acquire();
-            if (item.dependents_.size())
+        // Make sure the pointer is non-null and is a Resource subclass
+        item.resource_ = DynamicCast<Resource>(owner_->GetContext()->CreateObject(type));
+        if (!item.resource_)
+        {
+            URHO3D_LOGERROR("Could not load unknown resource type " + type.ToString());
+
+            if (sendEventOnFailure && Thread::IsMainThread())
             {
-                for (auto i = item.dependents_.begin(); i != item.dependents_.end(); ++i)
-                {
-                    auto j = backgroundLoadQueue_.find(*i);
-                    if (j != backgroundLoadQueue_.end())
-                        j->second.dependencies_.erase(key);
-                }
+                using namespace UnknownResourceType;
 
-                item.dependents_.clear();
+                VariantMap& eventData = owner_->GetEventDataMap();
+                eventData[P_RESOURCETYPE] = type;
+                owner_->SendEvent(E_UNKNOWNRESOURCETYPE, eventData);
             }
 
-            resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
-            backgroundLoadMutex_.Release();
+            backgroundLoadQueue_.erase(key);
+            return false;
         }
-    }
-}
 
-bool BackgroundLoader::QueueResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller)
-{
-    StringHash nameHash(name);
-    ea::pair<StringHash, StringHash> key = ea::make_pair(type, nameHash);
+        URHO3D_LOGDEBUG("Background loading resource " + name);
 
-    MutexLock lock(backgroundLoadMutex_);
-
-    // Check if already exists in the queue
-    if (backgroundLoadQueue_.find(key) != backgroundLoadQueue_.end())
-        return false;
-
-    BackgroundLoadItem& item = backgroundLoadQueue_[key];
-    item.sendEventOnFailure_ = sendEventOnFailure;
-
-    // Make sure the pointer is non-null and is a Resource subclass
-    item.resource_ = DynamicCast<Resource>(owner_->GetContext()->CreateObject(type));
-    if (!item.resource_)
-    {
-        URHO3D_LOGERROR("Could not load unknown resource type " + type.ToString());
+        item.resource_->SetName(name);
+        item.resource_->SetAsyncLoadState(ASYNC_QUEUED);
 
-        if (sendEventOnFailure && Thread::IsMainThread())
+        // If this is a resource calling for the background load of more resources, mark the dependency as necessary
+        if (caller)
         {
-            using namespace UnknownResourceType;
-
-            VariantMap& eventData = owner_->GetEventDataMap();
-            eventData[P_RESOURCETYPE] = type;
-            owner_->SendEvent(E_UNKNOWNRESOURCETYPE, eventData);
+            ItemKey callerKey = ea::make_pair(caller->GetType(), caller->GetNameHash());
+            auto j = backgroundLoadQueue_.find(
+                callerKey);
+            if (j != backgroundLoadQueue_.end())
+            {
+                BackgroundLoadItem& callerItem = j->second;
+                item.dependents_.insert(callerKey);
+                callerItem.dependencies_.insert(key);
+                // Dependencies are needed as soon as the caller
+                item.priority_ = Max(item.priority_, callerItem.priority_);
+            }
+            else
+                URHO3D_LOGWARNING("Resource " + caller->GetName() +
+                           " requested for a background loaded resource but was not in the background load queue");
         }
 
-        backgroundLoadQueue_.erase(key);
-        return false;
+        loadQueues_[item.priority_].push_back(key);
+
+        // Read the file ahead so that the loader threads do not block on one read at a time
+        if (numPrefetched_ < MAX_PREFETCHED_RESOURCES)
+            ReservePrefetch(key, item, prefetches);
+
+        // Start the background loader threads now
+        StartThreads();
     }
 
-    URHO3D_LOGDEBUG("Background loading resource " + name);
+    IssuePrefetches(prefetches);
+    return true;
+}
 
-    item.resource_->SetName(name);
-    item.resource_->SetAsyncLoadState(ASYNC_QUEUED);
+bool BackgroundLoader::CancelResource(StringHash type, StringHash nameHash)
+{
+    MutexLock lock(backgroundLoadMutex_);
+
+    auto i = backgroundLoadQueue_.find(ea::make_pair(type, nameHash));
+    if (i == backgroundLoadQueue_.end() || !i->second.dependents_.empty())
+        return false;
 
-    // If this is a resource calling for the background load of more resources, mark the dependency as necessary
-    if (caller)
+    BackgroundLoadItem& item = i->second;
+    if (item.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
     {
-        ea::pair<StringHash, StringHash> callerKey = ea::make_pair(caller->GetType(), caller->GetNameHash());
-        auto j = backgroundLoadQueue_.find(
-            callerKey);
-        if (j != backgroundLoadQueue_.end())
-        {
-            BackgroundLoadItem& callerItem = j->second;
-            item.dependents_.insert(callerKey);
-            callerItem.dependencies_.insert(key);
-        }
-        else
-            URHO3D_LOGWARNING("Resource " + caller->GetName() +
-                       " requested for a background loaded resource but was not in the background load queue");
+        // Not picked up by a loader thread yet, its key in the priority queue becomes stale
+        item.resource_->SetAsyncLoadState(ASYNC_DONE);
+        if (item.prefetch_)
+            --numPrefetched_;
+        backgroundLoadQueue_.erase(i);
     }
-
-    // Start the background loader thread now
-    if (!IsStarted())
-        Run();
+    else
+        item.cancelled_ = true;
 
     return true;
 }
@@ -175,21 +241,49 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
     backgroundLoadMutex_.Acquire();
 
     // Check if the resource in question is being background loaded
-    ea::pair<StringHash, StringHash> key = ea::make_pair(type, nameHash);
+    ItemKey key = ea::make_pair(type, nameHash);
     auto i = backgroundLoadQueue_.find(
         key);
     if (i != backgroundLoadQueue_.end())
     {
+        BackgroundLoadItem& item = i->second;
+        item.cancelled_ = false;
+
+        // Load on this thread rather than wait for a loader thread to pick the resource up
+        const bool loadNow = ClaimResource(item);
         backgroundLoadMutex_.Release();
 
+        if (loadNow)
+            LoadResource(item);
+
         {
-            Resource* resource = i->second.resource_;
+            Resource* resource = item.resource_;
             HiresTimer waitTimer;
             bool didWait = false;
 
             for (;;)
             {
-                unsigned numDeps = i->second.dependencies_.size();
+                // Load still queued dependencies on this thread as well
+                BackgroundLoadItem* dependency = nullptr;
+                backgroundLoadMutex_.Acquire();
+                const unsigned numDeps = item.dependencies_.size();
+                for (const ItemKey& dependencyKey : item.dependencies_)
+                {
+                    auto j = backgroundLoadQueue_.find(dependencyKey);
+                    if (j != backgroundLoadQueue_.end() && ClaimResource(j->second))
+                    {
+                        dependency = &j->second;
+                        break;
+                    }
+                }
+                backgroundLoadMutex_.Release();
+
+                if (dependency)
+                {
+                    LoadResource(*dependency);
+                    continue;
+                }
+
                 AsyncLoadState state = resource->GetAsyncLoadState();
                 if (numDeps > 0 || state == ASYNC_QUEUED || state == ASYNC_LOADING)
                 {
@@ -206,10 +300,10 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
         }
 
         // This may take a long time and may potentially wait on other resources, so it is important we do not hold the mutex during this
-        FinishBackgroundLoading(i->second);
+        FinishBackgroundLoading(item);
 
         backgroundLoadMutex_.Acquire();
-        backgroundLoadQueue_.erase(i);
+        backgroundLoadQueue_.erase(key);
         backgroundLoadMutex_.Release();
     }
     else
@@ -218,45 +312,224 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
 
 void BackgroundLoader::FinishResources(int maxMs)
 {
-    if (IsStarted())
+    if (threads_.empty())
+        return;
+
+    HiresTimer timer;
+
+    // Collect resources ready to finish, highest priority first
+    ea::vector<ea::pair<int, ItemKey> > readyKeys;
+    backgroundLoadMutex_.Acquire();
+    for (auto i = backgroundLoadQueue_.begin(); i != backgroundLoadQueue_.end(); ++i)
     {
-        HiresTimer timer;
+        const BackgroundLoadItem& item = i->second;
+        AsyncLoadState state = item.resource_->GetAsyncLoadState();
+        if (state == ASYNC_SUCCESS || state == ASYNC_FAIL)
+        {
+            if (item.cancelled_ || item.dependencies_.empty())
+                readyKeys.emplace_back(-static_cast<int>(item.priority_), i->first);
+        }
+    }
+    backgroundLoadMutex_.Release();
 
+    ea::stable_sort(readyKeys.begin(), readyKeys.end(),
+        [](const ea::pair<int, ItemKey>& lhs, const ea::pair<int, ItemKey>& rhs) { return lhs.first < rhs.first; });
+
+    for (const auto& readyKey : readyKeys)
+    {
+        // Finishing another resource may have already finished this one
         backgroundLoadMutex_.Acquire();
+        auto i = backgroundLoadQueue_.find(readyKey.second);
+        BackgroundLoadItem* item = i != backgroundLoadQueue_.end() ? &i->second : nullptr;
+        backgroundLoadMutex_.Release();
 
-        for (auto i = backgroundLoadQueue_.begin();
-             i != backgroundLoadQueue_.end();)
+        if (item)
         {
-            Resource* resource = i->second.resource_;
-            unsigned numDeps = i->second.dependencies_.size();
-            AsyncLoadState state = resource->GetAsyncLoadState();
-            if (numDeps > 0 || state == ASYNC_QUEUED || state == ASYNC_LOADING)
-                ++i;
+            // Finishing a resource may need it to wait for other resources to load, in which case we can not
+            // hold on to the mutex
+            if (item->cancelled_)
+                item->resource_->SetAsyncLoadState(ASYNC_DONE);
             else
-            {
-                // Finishing a resource may need it to wait for other resources to load, in which case we can not
-                // hold on to the mutex
-                backgroundLoadMutex_.Release();
-                FinishBackgroundLoading(i->second);
-                backgroundLoadMutex_.Acquire();
-                i = backgroundLoadQueue_.erase(i);
-            }
+                FinishBackgroundLoading(*item);
 
-            // Break when the time limit passed so that we keep sufficient FPS
-            if (timer.GetUSec(false) >= maxMs * 1000LL)
-                break;
+            backgroundLoadMutex_.Acquire();
+            backgroundLoadQueue_.erase(readyKey.second);
+            backgroundLoadMutex_.Release();
         }
 
-        backgroundLoadMutex_.Release();
+        // Break when the time limit passed so that we keep sufficient FPS
+        if (timer.GetUSec(false) >= maxMs * 1000LL)
+            break;
     }
 }
 
+void BackgroundLoader::SetNumThreads(unsigned numThreads)
+{
+    numThreads = Max(numThreads, 1u);
+    if (numThreads == numThreads_)
+        return;
+
+    const bool wasStarted = !threads_.empty();
+    StopThreads();
+    numThreads_ = numThreads;
+    if (wasStarted)
+        StartThreads();
+}
+
 unsigned BackgroundLoader::GetNumQueuedResources() const
 {
     MutexLock lock(backgroundLoadMutex_);
     return backgroundLoadQueue_.size();
 }
 
+void BackgroundLoader::StartThreads()
+{
+    if (!threads_.empty())
+        return;
+
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        auto thread = ea::make_unique<BackgroundLoaderThread>(this);
+        thread->SetName("BackgroundLoader");
+        thread->Run();
+        threads_.push_back(ea::move(thread));
+    }
+}
+
+void BackgroundLoader::StopThreads()
+{
+    // Destructing the threads waits for them to finish
+    threads_.clear();
+}
+
+void BackgroundLoader::LoadResource(BackgroundLoadItem& item)
+{
+    Resource* resource = item.resource_;
+
+    SharedPtr<AsyncReadRequest> prefetch;
+    PrefetchList prefetches;
+    {
+        MutexLock lock(backgroundLoadMutex_);
+        prefetch = ea::move(item.prefetch_);
+        if (prefetch)
+        {
+            --numPrefetched_;
+            ReserveQueuedPrefetches(prefetches);
+        }
+    }
+    IssuePrefetches(prefetches);
+
+    bool success = false;
+    if (prefetch && prefetch->Wait())
+    {
+        MemoryBuffer buffer(prefetch->GetData());
+        buffer.SetName(resource->GetName());
+        success = resource->BeginLoad(buffer);
+    }
+    else
+    {
+        // Not prefetched or the read failed, open the file to get the usual error reporting
+        SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
+        if (file)
+            success = resource->BeginLoad(*file);
+    }
+
+    // Process dependencies now
+    // Need to lock the queue again when manipulating other entries
+    ItemKey key = ea::make_pair(resource->GetType(), resource->GetNameHash());
+    MutexLock lock(backgroundLoadMutex_);
+    if (item.dependents_.size())
+    {
+        for (auto i = item.dependents_.begin(); i != item.dependents_.end(); ++i)
+        {
+            auto j = backgroundLoadQueue_.find(*i);
+            if (j != backgroundLoadQueue_.end())
+                j->second.dependencies_.erase(key);
+        }
+
+        item.dependents_.clear();
+    }
+
+    resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
+}
+
+bool BackgroundLoader::ClaimResource(BackgroundLoadItem& item) const
+{
+    if (item.resource_->GetAsyncLoadState() != ASYNC_QUEUED)
+        return false;
+
+    item.resource_->SetAsyncLoadState(ASYNC_LOADING);
+    return true;
+}
+
+void BackgroundLoader::RaisePriority(const ItemKey& key, ResourceLoadPriority priority)
+{
+    auto i = backgroundLoadQueue_.find(key);
+    if (i == backgroundLoadQueue_.end() || i->second.priority_ >= priority)
+        return;
+
+    BackgroundLoadItem& item = i->second;
+    item.priority_ = priority;
+    // The key in the lower priority queue becomes stale
+    if (item.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
+        loadQueues_[priority].push_back(key);
+
+    for (const ItemKey& dependencyKey : item.dependencies_)
+        RaisePriority(dependencyKey, priority);
+}
+
+void BackgroundLoader::ReservePrefetch(const ItemKey& key, BackgroundLoadItem& item, PrefetchList& prefetches)
+{
+    item.prefetchAttempted_ = true;
+    ++numPrefetched_;
+    prefetches.emplace_back(key, item.resource_->GetName());
+}
+
+void BackgroundLoader::ReserveQueuedPrefetches(PrefetchList& prefetches)
+{
+    for (int priority = MAX_LOAD_PRIORITIES - 1; priority >= 0; --priority)
+    {
+        for (const ItemKey& key : loadQueues_[priority])
+        {
+            if (numPrefetched_ >= MAX_PREFETCHED_RESOURCES)
+                return;
+
+            auto i = backgroundLoadQueue_.find(key);
+            if (i == backgroundLoadQueue_.end())
+                continue;
+
+            BackgroundLoadItem& item = i->second;
+            if (item.priority_ != priority || item.prefetchAttempted_ || item.resource_->GetAsyncLoadState() != ASYNC_QUEUED)
+                continue;
+
+            ReservePrefetch(key, item, prefetches);
+        }
+    }
+}
+
+void BackgroundLoader::IssuePrefetches(const PrefetchList& prefetches)
+{
+    if (prefetches.empty())
+        return;
+
+    ea::vector<ea::string> names;
+    names.reserve(prefetches.size());
+    for (const auto& prefetch : prefetches)
+        names.push_back(prefetch.second);
+    const ea::vector<SharedPtr<AsyncReadRequest> > requests = owner_->ReadFilesAsync(names);
+
+    // The resources may have been claimed by a loader or cancelled meanwhile, then they open the file themselves
+    MutexLock lock(backgroundLoadMutex_);
+    for (unsigned i = 0; i < prefetches.size(); ++i)
+    {
+        auto j = backgroundLoadQueue_.find(prefetches[i].first);
+        if (requests[i] && j != backgroundLoadQueue_.end() && j->second.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
+            j->second.prefetch_ = requests[i];
+        else
+            --numPrefetched_;
+    }
+}
+
 void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
 {
     Resource* resource = item.resource_;
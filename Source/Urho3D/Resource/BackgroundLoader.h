@@ -22,18 +22,21 @@
 
 #pragma once
 
+#include <EASTL/deque.h>
 #include <EASTL/hash_set.h>
+#include <EASTL/unique_ptr.h>
 #include <EASTL/unordered_map.h>
 
 #include "../Core/Mutex.h"
 #include "../Container/Ptr.h"
 #include "../Core/Thread.h"
+#include "../IO/AsyncFileReader.h"
 #include "../Math/StringHash.h"
+#include "../Resource/Resource.h"
 
 namespace Urho3D
 {
 
-class Resource;
 class ResourceCache;
 
 /// Queue item for background loading of a resource.
@@ -47,32 +50,68 @@ struct URHO3D_API BackgroundLoadItem
     ea::hash_set<ea::pair<StringHash, StringHash> > dependents_;
     /// Whether to send failure event.
     bool sendEventOnFailure_;
+    /// Load priority.
+    ResourceLoadPriority priority_;
+    /// Whether the load was cancelled while in progress. The result is discarded unless the resource is requested again.
+    bool cancelled_;
+    /// Asynchronous read of the resource file issued ahead of loading. Only queued resources hold one.
+    SharedPtr<AsyncReadRequest> prefetch_;
+    /// Whether reading ahead was attempted.
+    bool prefetchAttempted_;
 };
 
-/// Background loader of resources. Owned by the ResourceCache.
-class URHO3D_API BackgroundLoader : public RefCounted, public Thread
+/// Background loader of resources. Owned by the ResourceCache. Runs BeginLoad() on a pool of loader threads.
+class URHO3D_API BackgroundLoader : public RefCounted
 {
 public:
     /// Construct.
     explicit BackgroundLoader(ResourceCache* owner);
 
-    /// Destruct. Forcibly clear the load queue.
+    /// Destruct. Stop the loader threads and forcibly clear the load queue.
     ~BackgroundLoader() override;
 
-    /// Resource background loading loop.
-    void ThreadFunction() override;
+    /// Load the next queued resource with the highest priority. Return false if there was nothing to load. Called from the loader threads.
+    bool LoadNextResource();
 
-    /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Return true if queued (not a duplicate and resource was a known type).
-    bool QueueResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller);
+    /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Return true if queued (not a duplicate and resource was a known type). A duplicate request may raise the priority.
+    bool QueueResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller,
+        ResourceLoadPriority priority = LOAD_PRIORITY_NORMAL);
+    /// Cancel loading of a resource. A resource that is already loading is discarded when finished. Return false if not queued or needed by another queued resource.
+    bool CancelResource(StringHash type, StringHash nameHash);
     /// Wait and finish possible loading of a resource when being requested from the cache.
     void WaitForResource(StringHash type, StringHash nameHash);
     /// Process resources that are ready to finish.
     void FinishResources(int maxMs);
 
+    /// Set number of loader threads. Threads are started on the first queued resource.
+    void SetNumThreads(unsigned numThreads);
+    /// Return number of loader threads.
+    unsigned GetNumThreads() const { return numThreads_; }
     /// Return amount of resources in the load queue.
     unsigned GetNumQueuedResources() const;
 
 private:
+    /// Key of a queued resource.
+    using ItemKey = ea::pair<StringHash, StringHash>;
+    /// Keys and names of the queued resources whose files are to be read ahead.
+    using PrefetchList = ea::vector<ea::pair<ItemKey, ea::string> >;
+
+    /// Start the loader threads if not started yet.
+    void StartThreads();
+    /// Stop the loader threads. Resources being loaded are finished first.
+    void StopThreads();
+    /// Call BeginLoad() for a resource claimed for loading by the calling thread.
+    void LoadResource(BackgroundLoadItem& item);
+    /// Claim a queued resource for loading by the calling thread. Return true if claimed. Mutex must be held.
+    bool ClaimResource(BackgroundLoadItem& item) const;
+    /// Raise priority of a queued resource and the resources it depends on. Mutex must be held.
+    void RaisePriority(const ItemKey& key, ResourceLoadPriority priority);
+    /// Reserve reading the file of a queued resource ahead of loading. Mutex must be held.
+    void ReservePrefetch(const ItemKey& key, BackgroundLoadItem& item, PrefetchList& prefetches);
+    /// Reserve reading the files of the next queued resources up to the prefetch limit, highest priority first. Mutex must be held.
+    void ReserveQueuedPrefetches(PrefetchList& prefetches);
+    /// Start the reserved file reads and hand them to the resources still queued. Mutex must not be held.
+    void IssuePrefetches(const PrefetchList& prefetches);
     /// Finish one background loaded resource.
     void FinishBackgroundLoading(BackgroundLoadItem& item);
 
@@ -81,7 +120,15 @@ private:
     /// Mutex for thread-safe access to the background load queue.
     mutable Mutex backgroundLoadMutex_;
     /// Resources that are queued for background loading.
-    ea::unordered_map<ea::pair<StringHash, StringHash>, BackgroundLoadItem> backgroundLoadQueue_;
+    ea::unordered_map<ItemKey, BackgroundLoadItem> backgroundLoadQueue_;
+    /// Keys of resources waiting to be loaded, per priority. May contain stale keys of loaded, cancelled or reprioritized resources.
+    ea::deque<ItemKey> loadQueues_[MAX_LOAD_PRIORITIES];
+    /// Loader threads.
+    ea::vector<ea::unique_ptr<Thread> > threads_;
+    /// Number of loader threads.
+    unsigned numThreads_;
+    /// Number of queued resources with a file read reserved, in progress or completed.
+    unsigned numPrefetched_;
 };
 
 }
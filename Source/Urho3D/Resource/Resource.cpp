@@ -102,6 +102,7 @@ void Resource::SetMemoryUse(unsigned size)
 void Resource::ResetUseTimer()
 {
     useTimer_.Reset();
+    ++useCount_;
 }
 
 void Resource::SetAsyncLoadState(AsyncLoadState newState)
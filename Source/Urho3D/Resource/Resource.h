@@ -50,6 +50,18 @@ enum AsyncLoadState
     ASYNC_FAIL = 4
 };
 
+/// Priority of a background loaded resource. Resources with higher priority are loaded first.
+enum ResourceLoadPriority
+{
+    /// Speculatively loaded resource that may be needed later.
+    LOAD_PRIORITY_PREFETCH = 0,
+    /// Default priority.
+    LOAD_PRIORITY_NORMAL,
+    /// Resource needed for what is visible now.
+    LOAD_PRIORITY_VISIBLE,
+    MAX_LOAD_PRIORITIES
+};
+
 /// Base class for resources.
 class URHO3D_API Resource : public Object
 {
@@ -77,8 +89,10 @@ public:
     void SetName(const ea::string& name);
     /// Set memory use in bytes, possibly approximate.
     void SetMemoryUse(unsigned size);
-    /// Reset last used timer.
+    /// Reset last used timer and count the use.
     void ResetUseTimer();
+    /// Set whether the resource is pinned. Pinned resources are never released to keep within the memory budget.
+    void SetPinned(bool enable) { pinned_ = enable; }
     /// Set the asynchronous loading state. Called by ResourceCache. Resources in the middle of asynchronous loading are not normally returned to user.
     void SetAsyncLoadState(AsyncLoadState newState);
     /// Set absolute file name.
@@ -95,6 +109,10 @@ public:
 
     /// Return time since last use in milliseconds. If referred to elsewhere than in the resource cache, returns always zero.
     unsigned GetUseTimer();
+    /// Return number of times the resource has been requested from the resource cache.
+    unsigned GetUseCount() const { return useCount_; }
+    /// Return whether the resource is pinned.
+    bool IsPinned() const { return pinned_; }
 
     /// Return the asynchronous loading state.
     AsyncLoadState GetAsyncLoadState() const { return asyncLoadState_; }
@@ -111,6 +129,10 @@ private:
     ea::string absoluteFileName_;
     /// Last used timer.
     Timer useTimer_;
+    /// Number of uses.
+    unsigned useCount_{};
+    /// Pinned flag.
+    bool pinned_{};
     /// Memory use in bytes.
     unsigned memoryUse_;
     /// Asynchronous loading state.
@@ -42,6 +42,8 @@
 
 #include "../DebugNew.h"
 
+#include <EASTL/sort.h>
+
 #include <cstdio>
 
 namespace Urho3D
@@ -69,6 +71,9 @@ static const char* checkDirs[] =
 
 static const SharedPtr<Resource> noResource;
 
+/// Interval of enforcing memory budgets when no resources are added or released.
+static const unsigned MEMORY_BUDGET_CHECK_INTERVAL_MS = 1000;
+
 ResourceCache::ResourceCache(Context* context) :
     Object(context),
     autoReloadResources_(false),
@@ -449,6 +454,13 @@ void ResourceCache::SetMemoryBudget(StringHash type, unsigned long long budget)
     resourceGroups_[type].memoryBudget_ = budget;
 }
 
+void ResourceCache::SetResourcePinned(StringHash type, const ea::string& name, bool pinned)
+{
+    const SharedPtr<Resource>& resource = FindResource(type, StringHash(SanitateResourceName(name)));
+    if (resource)
+        resource->SetPinned(pinned);
+}
+
 void ResourceCache::SetAutoReloadResources(bool enable)
 {
     if (enable != autoReloadResources_)
@@ -544,6 +556,32 @@ SharedPtr<File> ResourceCache::GetFile(const ea::string& name, bool sendEventOnF
     return SharedPtr<File>();
 }
 
+SharedPtr<AsyncReadRequest> ResourceCache::ReadFileAsync(const ea::string& name)
+{
+    auto* reader = GetSubsystem<AsyncFileReader>();
+    if (!reader)
+        return nullptr;
+
+    SharedPtr<AsyncReadRequest> request = CreateReadRequest(name);
+    if (request)
+        reader->Submit(request);
+    return request;
+}
+
+ea::vector<SharedPtr<AsyncReadRequest> > ResourceCache::ReadFilesAsync(const ea::vector<ea::string>& names)
+{
+    ea::vector<SharedPtr<AsyncReadRequest> > requests(names.size());
+
+    auto* reader = GetSubsystem<AsyncFileReader>();
+    if (!reader)
+        return requests;
+
+    for (unsigned i = 0; i < names.size(); ++i)
+        requests[i] = CreateReadRequest(names[i]);
+    reader->Submit(requests);
+    return requests;
+}
+
 Resource* ResourceCache::GetExistingResource(StringHash type, const ea::string& name)
 {
     ea::string sanitatedName = SanitateResourceName(name);
@@ -587,12 +625,18 @@ Resource* ResourceCache::GetResource(StringHash type, const ea::string& name, bo
 
     const SharedPtr<Resource>& existing = FindResource(type, nameHash);
     if (existing)
+    {
+        existing->ResetUseTimer();
+        ++resourceGroups_[type].hits_;
         return existing;
+    }
 
     SharedPtr<Resource> resource;
     // Make sure the pointer is non-null and is a Resource subclass
     resource = DynamicCast<Resource>(context_->CreateObject(type));
-    if (!resource)
+    if (resource)
+        ++resourceGroups_[type].misses_;
+    else
     {
         URHO3D_LOGERROR("Could not load unknown resource type " + type.ToString());
 
@@ -641,7 +685,8 @@ Resource* ResourceCache::GetResource(StringHash type, const ea::string& name, bo
     return resource;
 }
 
-bool ResourceCache::BackgroundLoadResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller)
+bool ResourceCache::BackgroundLoadResource(StringHash type, const ea::string& name, bool sendEventOnFailure, Resource* caller,
+    ResourceLoadPriority priority)
 {
 #ifdef URHO3D_THREADING
     // If empty name, fail immediately
@@ -654,13 +699,22 @@ bool ResourceCache::BackgroundLoadResource(StringHash type, const ea::string& na
     if (FindResource(type, nameHash) != noResource)
         return false;
 
-    return backgroundLoader_->QueueResource(type, sanitatedName, sendEventOnFailure, caller);
+    return backgroundLoader_->QueueResource(type, sanitatedName, sendEventOnFailure, caller, priority);
 #else
     // When threading not supported, fall back to synchronous loading
     return GetResource(type, name, sendEventOnFailure);
 #endif
 }
 
+bool ResourceCache::CancelBackgroundLoadResource(StringHash type, const ea::string& name)
+{
+#ifdef URHO3D_THREADING
+    return backgroundLoader_->CancelResource(type, StringHash(SanitateResourceName(name)));
+#else
+    return false;
+#endif
+}
+
 SharedPtr<Resource> ResourceCache::GetTempResource(StringHash type, const ea::string& name, bool sendEventOnFailure)
 {
     ea::string sanitatedName = SanitateResourceName(name);
@@ -715,6 +769,22 @@ SharedPtr<Resource> ResourceCache::GetTempResource(StringHash type, const ea::st
     return resource;
 }
 
+void ResourceCache::SetNumBackgroundLoadThreads(unsigned numThreads)
+{
+#ifdef URHO3D_THREADING
+    backgroundLoader_->SetNumThreads(numThreads);
+#endif
+}
+
+unsigned ResourceCache::GetNumBackgroundLoadThreads() const
+{
+#ifdef URHO3D_THREADING
+    return backgroundLoader_->GetNumThreads();
+#else
+    return 0;
+#endif
+}
+
 unsigned ResourceCache::GetNumBackgroundLoadResources() const
 {
 #ifdef URHO3D_THREADING
@@ -769,6 +839,41 @@ unsigned long long ResourceCache::GetMemoryBudget(StringHash type) const
     return i != resourceGroups_.end() ? i->second.memoryBudget_ : 0;
 }
 
+void ResourceCache::GetResidencyReport(ea::vector<ResourceResidency>& result) const
+{
+    result.clear();
+    for (auto i = resourceGroups_.begin(); i != resourceGroups_.end(); ++i)
+    {
+        const ResourceGroup& group = i->second;
+        ResourceResidency& residency = result.emplace_back();
+        residency.type_ = i->first;
+        residency.numResources_ = group.resources_.size();
+        residency.memoryUse_ = group.memoryUse_;
+        residency.memoryBudget_ = group.memoryBudget_;
+        residency.hits_ = group.hits_;
+        residency.misses_ = group.misses_;
+        residency.evictions_ = group.evictions_;
+        residency.evictedMemory_ = group.evictedMemory_;
+        for (auto j = group.resources_.begin(); j != group.resources_.end(); ++j)
+        {
+            if (j->second->IsPinned())
+                ++residency.numPinned_;
+        }
+    }
+}
+
+void ResourceCache::ResetResidencyCounters()
+{
+    for (auto i = resourceGroups_.begin(); i != resourceGroups_.end(); ++i)
+    {
+        ResourceGroup& group = i->second;
+        group.hits_ = 0;
+        group.misses_ = 0;
+        group.evictions_ = 0;
+        group.evictedMemory_ = 0;
+    }
+}
+
 unsigned long long ResourceCache::GetMemoryUse(StringHash type) const
 {
     auto i = resourceGroups_.find(type);
@@ -1046,37 +1151,43 @@ void ResourceCache::UpdateResourceGroup(StringHash type)
     if (i == resourceGroups_.end())
         return;
 
-    for (;;)
-    {
-        unsigned totalSize = 0;
-        unsigned oldestTimer = 0;
-        auto oldestResource = i->second.resources_.end();
+    ResourceGroup& group = i->second;
+    unsigned long long totalSize = 0;
+    for (auto j = group.resources_.begin(); j != group.resources_.end(); ++j)
+        totalSize += j->second->GetMemoryUse();
+    group.memoryUse_ = totalSize;
 
-        for (auto j = i->second.resources_.begin();
-             j != i->second.resources_.end(); ++j)
-        {
-            totalSize += j->second->GetMemoryUse();
-            unsigned useTimer = j->second->GetUseTimer();
-            if (useTimer > oldestTimer)
-            {
-                oldestTimer = useTimer;
-                oldestResource = j;
-            }
-        }
+    if (!group.memoryBudget_ || group.memoryUse_ <= group.memoryBudget_)
+        return;
 
-        i->second.memoryUse_ = totalSize;
+    // Rank release candidates by idle time, weighted down by how often they have been requested so that frequently
+    // used resources survive short idle periods. Resources in use always return a zero timer and can not be removed
+    ea::vector<ea::pair<float, StringHash> > candidates;
+    for (auto j = group.resources_.begin(); j != group.resources_.end(); ++j)
+    {
+        Resource* resource = j->second;
+        const unsigned useTimer = resource->GetUseTimer();
+        if (useTimer && !resource->IsPinned())
+            candidates.emplace_back(useTimer / (1.0f + Ln(1.0f + resource->GetUseCount())), j->first);
+    }
 
-        // If memory budget defined and is exceeded, remove the oldest resource and loop again
-        // (resources in use always return a zero timer and can not be removed)
-        if (i->second.memoryBudget_ && i->second.memoryUse_ > i->second.memoryBudget_ &&
-            oldestResource != i->second.resources_.end())
-        {
-            URHO3D_LOGDEBUG("Resource group " + oldestResource->second->GetTypeName() + " over memory budget, releasing resource " +
-                     oldestResource->second->GetName());
-            i->second.resources_.erase(oldestResource);
-        }
-        else
+    ea::sort(candidates.begin(), candidates.end(),
+        [](const ea::pair<float, StringHash>& lhs, const ea::pair<float, StringHash>& rhs) { return lhs.first > rhs.first; });
+
+    for (const auto& candidate : candidates)
+    {
+        if (group.memoryUse_ <= group.memoryBudget_)
             break;
+
+        auto j = group.resources_.find(candidate.second);
+        const unsigned memoryUse = j->second->GetMemoryUse();
+        URHO3D_LOGDEBUG("Resource group " + j->second->GetTypeName() + " over memory budget, releasing resource " +
+                 j->second->GetName());
+
+        group.memoryUse_ -= memoryUse;
+        group.evictedMemory_ += memoryUse;
+        ++group.evictions_;
+        group.resources_.erase(j);
     }
 }
 
@@ -1106,6 +1217,17 @@ void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData
         }
     }
 
+    // Resources may fall out of use or change size without the cache noticing, so enforce the budgets periodically
+    if (memoryBudgetTimer_.GetMSec(false) >= MEMORY_BUDGET_CHECK_INTERVAL_MS)
+    {
+        memoryBudgetTimer_.Reset();
+        for (auto i = resourceGroups_.begin(); i != resourceGroups_.end(); ++i)
+        {
+            if (i->second.memoryBudget_)
+                UpdateResourceGroup(i->first);
+        }
+    }
+
     // Check for background loaded resources that can be finished
 #ifdef URHO3D_THREADING
     {
@@ -1148,6 +1270,46 @@ File* ResourceCache::SearchPackages(const ea::string& name)
     return nullptr;
 }
 
+SharedPtr<AsyncReadRequest> ResourceCache::CreateReadRequest(const ea::string& name)
+{
+    MutexLock lock(resourceMutex_);
+
+    ea::string sanitatedName = SanitateResourceName(name);
+    RouteResourceName(sanitatedName, RESOURCE_GETFILE);
+    if (sanitatedName.empty())
+        return nullptr;
+
+    const auto searchPackages = [&]() -> SharedPtr<AsyncReadRequest>
+    {
+        for (PackageFile* package : packages_)
+        {
+            if (SharedPtr<AsyncReadRequest> request = package->CreateReadRequest(sanitatedName))
+                return request;
+        }
+        return nullptr;
+    };
+
+    const auto searchResourceDirs = [&]() -> SharedPtr<AsyncReadRequest>
+    {
+        auto* fileSystem = GetSubsystem<FileSystem>();
+        for (const ea::string& resourceDir : resourceDirs_)
+        {
+            if (fileSystem->FileExists(resourceDir + sanitatedName))
+                return MakeShared<AsyncReadRequest>(resourceDir + sanitatedName);
+        }
+
+        // Fallback using absolute path
+        if (fileSystem->FileExists(sanitatedName))
+            return MakeShared<AsyncReadRequest>(sanitatedName);
+        return nullptr;
+    };
+
+    SharedPtr<AsyncReadRequest> request = searchPackagesFirst_ ? searchPackages() : searchResourceDirs();
+    if (!request)
+        request = searchPackagesFirst_ ? searchResourceDirs() : searchPackages();
+    return request;
+}
+
 void RegisterResourceLibrary(Context* context)
 {
     BinaryFile::RegisterObject(context);
@@ -29,6 +29,8 @@
 
 #include "../Container/Ptr.h"
 #include "../Core/Mutex.h"
+#include "../Core/Timer.h"
+#include "../IO/AsyncFileReader.h"
 #include "../IO/File.h"
 #include "../Resource/Resource.h"
 
@@ -48,7 +50,11 @@ struct ResourceGroup
     /// Construct with defaults.
     ResourceGroup() :
         memoryBudget_(0),
-        memoryUse_(0)
+        memoryUse_(0),
+        hits_(0),
+        misses_(0),
+        evictions_(0),
+        evictedMemory_(0)
     {
     }
 
@@ -56,10 +62,41 @@ struct ResourceGroup
     unsigned long long memoryBudget_;
     /// Current memory use.
     unsigned long long memoryUse_;
+    /// Number of requests served from the cache.
+    unsigned long long hits_;
+    /// Number of requests that loaded the resource.
+    unsigned long long misses_;
+    /// Number of resources released to keep within the memory budget.
+    unsigned long long evictions_;
+    /// Memory released to keep within the memory budget.
+    unsigned long long evictedMemory_;
     /// Resources.
     ea::unordered_map<StringHash, SharedPtr<Resource> > resources_;
 };
 
+/// Memory residency statistics of one resource type.
+struct ResourceResidency
+{
+    /// Resource type.
+    StringHash type_;
+    /// Number of resources in the cache.
+    unsigned numResources_{};
+    /// Number of pinned resources.
+    unsigned numPinned_{};
+    /// Current memory use.
+    unsigned long long memoryUse_{};
+    /// Memory budget, zero if unlimited.
+    unsigned long long memoryBudget_{};
+    /// Number of requests served from the cache.
+    unsigned long long hits_{};
+    /// Number of requests that loaded the resource.
+    unsigned long long misses_{};
+    /// Number of resources released to keep within the memory budget.
+    unsigned long long evictions_{};
+    /// Memory released to keep within the memory budget.
+    unsigned long long evictedMemory_{};
+};
+
 /// Resource request types.
 enum ResourceRequest
 {
@@ -124,6 +161,8 @@ public:
     void ReloadResourceWithDependencies(const ea::string& fileName);
     /// Set memory budget for a specific resource type, default 0 is unlimited.
     void SetMemoryBudget(StringHash type, unsigned long long budget);
+    /// Set whether a loaded resource is pinned, so that it is never released to keep within the memory budget.
+    void SetResourcePinned(StringHash type, const ea::string& name, bool pinned);
     /// Enable or disable automatic reloading of resources as files are modified. Default false.
     void SetAutoReloadResources(bool enable);
     /// Enable or disable returning resources that failed to load. Default false. This may be useful in editing to not lose resource ref attributes.
@@ -134,6 +173,8 @@ public:
 
     /// Set how many milliseconds maximum per frame to spend on finishing background loaded resources.
     void SetFinishBackgroundResourcesMs(int ms) { finishBackgroundResourcesMs_ = Max(ms, 1); }
+    /// Set number of threads used for background loading of resources.
+    void SetNumBackgroundLoadThreads(unsigned numThreads);
 
     /// Add a resource router object. By default there is none, so the routing process is skipped.
     void AddResourceRouter(ResourceRouter* router, bool addAsFirst = false);
@@ -142,12 +183,19 @@ public:
 
     /// Open and return a file from the resource load paths or from inside a package file. If not found, use a fallback search with absolute path. Return null if fails. Can be called from outside the main thread.
     SharedPtr<File> GetFile(const ea::string& name, bool sendEventOnFailure = true);
+    /// Start an asynchronous read of a file from the resource load paths or from inside a package file, searched like GetFile(). Return null if not found or if there is no AsyncFileReader subsystem. Can be called from outside the main thread.
+    SharedPtr<AsyncReadRequest> ReadFileAsync(const ea::string& name);
+    /// Start asynchronous reads of several files with a single submission so that they overlap. Files not found get null requests. Can be called from outside the main thread.
+    ea::vector<SharedPtr<AsyncReadRequest> > ReadFilesAsync(const ea::vector<ea::string>& names);
     /// Return a resource by type and name. Load if not loaded yet. Return null if not found or if fails, unless SetReturnFailedResources(true) has been called. Can be called only from the main thread.
     Resource* GetResource(StringHash type, const ea::string& name, bool sendEventOnFailure = true);
     /// Load a resource without storing it in the resource cache. Return null if not found or if fails. Can be called from outside the main thread if the resource itself is safe to load completely (it does not possess for example GPU data).
     SharedPtr<Resource> GetTempResource(StringHash type, const ea::string& name, bool sendEventOnFailure = true);
-    /// Background load a resource. An event will be sent when complete. Return true if successfully stored to the load queue, false if eg. already exists. Can be called from outside the main thread.
-    bool BackgroundLoadResource(StringHash type, const ea::string& name, bool sendEventOnFailure = true, Resource* caller = nullptr);
+    /// Background load a resource. An event will be sent when complete. Return true if successfully stored to the load queue, false if eg. already exists. Requesting an already queued resource with a higher priority raises its priority. Can be called from outside the main thread.
+    bool BackgroundLoadResource(StringHash type, const ea::string& name, bool sendEventOnFailure = true, Resource* caller = nullptr,
+        ResourceLoadPriority priority = LOAD_PRIORITY_NORMAL);
+    /// Cancel background loading of a resource. No event is sent for a cancelled resource. Return false if not queued or needed by another queued resource.
+    bool CancelBackgroundLoadResource(StringHash type, const ea::string& name);
     /// Return number of pending background-loaded resources.
     unsigned GetNumBackgroundLoadResources() const;
     /// Return all loaded resources of a specific type.
@@ -173,13 +221,20 @@ public:
     /// Template version of releasing a resource by name.
     template <class T> void ReleaseResource(const ea::string& name, bool force = false);
     /// Template version of queueing a resource background load.
-    template <class T> bool BackgroundLoadResource(const ea::string& name, bool sendEventOnFailure = true, Resource* caller = nullptr);
+    template <class T> bool BackgroundLoadResource(const ea::string& name, bool sendEventOnFailure = true, Resource* caller = nullptr,
+        ResourceLoadPriority priority = LOAD_PRIORITY_NORMAL);
+    /// Template version of cancelling a resource background load.
+    template <class T> bool CancelBackgroundLoadResource(const ea::string& name);
     /// Template version of returning loaded resources of a specific type.
     template <class T> void GetResources(ea::vector<T*>& result) const;
     /// Return whether a file exists in the resource directories or package files. Does not check manually added in-memory resources.
     bool Exists(const ea::string& name) const;
     /// Return memory budget for a resource type.
     unsigned long long GetMemoryBudget(StringHash type) const;
+    /// Return memory residency statistics of all resource types.
+    void GetResidencyReport(ea::vector<ResourceResidency>& result) const;
+    /// Reset request and eviction counters of all resource types.
+    void ResetResidencyCounters();
     /// Return total memory use for a resource type.
     unsigned long long GetMemoryUse(StringHash type) const;
     /// Return total memory use for all resources.
@@ -198,6 +253,8 @@ public:
 
     /// Return how many milliseconds maximum to spend on finishing background loaded resources.
     int GetFinishBackgroundResourcesMs() const { return finishBackgroundResourcesMs_; }
+    /// Return number of threads used for background loading of resources.
+    unsigned GetNumBackgroundLoadThreads() const;
 
     /// Return a resource router by index.
     ResourceRouter* GetResourceRouter(unsigned index) const;
@@ -251,6 +308,8 @@ private:
     File* SearchResourceDirs(const ea::string& name);
     /// Search resource packages for file.
     File* SearchPackages(const ea::string& name);
+    /// Create an unsubmitted asynchronous read of a file, searched like GetFile(). Return null if not found.
+    SharedPtr<AsyncReadRequest> CreateReadRequest(const ea::string& name);
 
     /// Mutex for thread-safe access to the resource directories, resource packages and resource dependencies.
     mutable Mutex resourceMutex_;
@@ -278,6 +337,8 @@ private:
     mutable bool isRouting_;
     /// How many milliseconds maximum per frame to spend on finishing background loaded resources.
     int finishBackgroundResourcesMs_;
+    /// Timer for periodically enforcing memory budgets.
+    Timer memoryBudgetTimer_;
     /// List of resources that will not be auto-reloaded if reloading event triggers.
     ea::vector<ea::string> ignoreResourceAutoReload_;
 };
@@ -306,10 +367,17 @@ template <class T> SharedPtr<T> ResourceCache::GetTempResource(const ea::string&
     return StaticCast<T>(GetTempResource(type, name, sendEventOnFailure));
 }
 
-template <class T> bool ResourceCache::BackgroundLoadResource(const ea::string& name, bool sendEventOnFailure, Resource* caller)
+template <class T> bool ResourceCache::BackgroundLoadResource(const ea::string& name, bool sendEventOnFailure, Resource* caller,
+    ResourceLoadPriority priority)
+{
+    StringHash type = T::GetTypeStatic();
+    return BackgroundLoadResource(type, name, sendEventOnFailure, caller, priority);
+}
+
+template <class T> bool ResourceCache::CancelBackgroundLoadResource(const ea::string& name)
 {
     StringHash type = T::GetTypeStatic();
-    return BackgroundLoadResource(type, name, sendEventOnFailure, caller);
+    return CancelBackgroundLoadResource(type, name);
 }
 
 template <class T> void ResourceCache::GetResources(ea::vector<T*>& result) const
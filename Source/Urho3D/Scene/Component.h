@@ -47,6 +47,7 @@ enum AutoRemoveMode
 class URHO3D_API Component : public Animatable
 {
     URHO3D_OBJECT(Component, Animatable);
+    URHO3D_SMALL_OBJECT_ALLOCATED();
 
     friend class Node;
     friend class Scene;
@@ -105,6 +106,8 @@ public:
 
     /// Add a replication state that is tracking this component.
     void AddReplicationState(ComponentReplicationState* state);
+    /// Remove a replication state that is no longer tracking this component.
+    void RemoveReplicationState(ComponentReplicationState* state);
     /// Prepare network update by comparing attributes and marking replication states dirty as necessary.
     void PrepareNetworkUpdate();
     /// Clean up all references to a network connection that is about to be removed.
@@ -64,6 +64,7 @@ Node::Node(Context* context) :
 {
     impl_ = ea::make_unique<NodeImpl>();
     impl_->owner_ = nullptr;
+    impl_->alwaysRelevant_ = false;
 }
 
 Node::~Node()
@@ -255,6 +256,11 @@ bool Node::Load(Deserializer& source)
 }
 
 bool Node::Save(Serializer& dest) const
+{
+    return Save(dest, true);
+}
+
+bool Node::Save(Serializer& dest, bool saveChildren) const
 {
     // Write node ID
     if (!dest.WriteUInt(id_))
@@ -280,6 +286,9 @@ bool Node::Save(Serializer& dest) const
         dest.Write(compBuffer.GetData(), compBuffer.GetSize());
     }
 
+    if (!saveChildren)
+        return true;
+
     // Write child nodes
     dest.WriteVLE(GetNumPersistentChildren());
     for (unsigned i = 0; i < children_.size(); ++i)
@@ -440,6 +449,12 @@ void Node::AddReplicationState(NodeReplicationState* state)
     networkState_->replicationStates_.push_back(state);
 }
 
+void Node::RemoveReplicationState(NodeReplicationState* state)
+{
+    if (networkState_)
+        networkState_->replicationStates_.erase_first(state);
+}
+
 bool Node::SaveXML(Serializer& dest, const ea::string& indentation) const
 {
     SharedPtr<XMLFile> xml(context_->CreateObject<XMLFile>());
@@ -882,8 +897,17 @@ void Node::SetOwner(Connection* owner)
     impl_->owner_ = owner;
 }
 
+void Node::SetAlwaysRelevant(bool enable)
+{
+    impl_->alwaysRelevant_ = enable;
+}
+
 void Node::MarkDirty()
 {
+    // The topmost newly dirty node of a subtree is remembered by the scene for batched world transform update
+    if (!dirty_ && scene_ && scene_ != this && scene_->IsBatchedTransformUpdate() && (!parent_ || parent_ == scene_ || !parent_->dirty_))
+        scene_->MarkTransformDirty(this);
+
     Node *cur = this;
     for (;;)
     {
@@ -61,6 +61,8 @@ struct URHO3D_API NodeImpl
     ea::vector<Node*> dependencyNodes_;
     /// Network owner connection.
     Connection* owner_;
+    /// Whether is replicated to all connections regardless of network interest management.
+    bool alwaysRelevant_;
     /// Name.
     ea::string name_;
     /// Tag strings.
@@ -75,8 +77,10 @@ struct URHO3D_API NodeImpl
 class URHO3D_API Node : public Animatable
 {
     URHO3D_OBJECT(Node, Animatable);
+    URHO3D_SMALL_OBJECT_ALLOCATED();
 
     friend class Connection;
+    friend class TransformHierarchy;
 
 public:
     /// Construct.
@@ -85,6 +89,8 @@ public:
     ~Node() override;
     /// Register object factory.
     static void RegisterObject(Context* context);
+    /// Return whether binary load and save may access typed attributes directly. True for this class, but not for subclasses.
+    bool IsDirectAttributeAccessAllowed() const override { return IsExactType<Node>(); }
 
     /// Serialize from/to archive. Return true if successful.
     bool Serialize(Archive& archive) override;
@@ -114,6 +120,8 @@ public:
     void MarkNetworkUpdate() override;
     /// Add a replication state that is tracking this node.
     virtual void AddReplicationState(NodeReplicationState* state);
+    /// Remove a replication state that is no longer tracking this node.
+    void RemoveReplicationState(NodeReplicationState* state);
 
     /// Save to an XML file. Return true if successful.
     bool SaveXML(Serializer& dest, const ea::string& indentation = "\t") const;
@@ -289,6 +297,8 @@ public:
     void SetEnabledRecursive(bool enable);
     /// Set owner connection for networking.
     void SetOwner(Connection* owner);
+    /// Set whether is replicated to all connections regardless of network interest management distance. Only affects nodes directly under the scene.
+    void SetAlwaysRelevant(bool enable);
     /// Mark node and child nodes to need world transform recalculation. Notify listener components.
     void MarkDirty();
     /// Create a child scene node (with specified ID if provided).
@@ -379,6 +389,9 @@ public:
     /// Return owner connection in networking.
     Connection* GetOwner() const { return impl_->owner_; }
 
+    /// Return whether is replicated to all connections regardless of network interest management distance.
+    bool IsAlwaysRelevant() const { return impl_->alwaysRelevant_; }
+
     /// Return position in parent space.
     const Vector3& GetPosition() const { return position_; }
 
@@ -603,6 +616,8 @@ public:
     /// Load components and optionally load child nodes.
     bool Load(Deserializer& source, SceneResolver& resolver, bool loadChildren = true, bool rewriteIDs = false,
         CreateMode mode = REPLICATED);
+    /// Save ID, attributes, components and optionally child nodes. Without child nodes the data is readable by Load() with loadChildren set to false.
+    bool Save(Serializer& dest, bool saveChildren) const;
     /// Load components from XML data and optionally load child nodes.
     bool LoadXML(const XMLElement& source, SceneResolver& resolver, bool loadChildren = true, bool rewriteIDs = false,
         CreateMode mode = REPLICATED);
@@ -27,6 +27,7 @@
 
 #include "../Core/Attribute.h"
 #include "../Math/StringHash.h"
+#include "../Math/Vector3.h"
 
 #include <cstring>
 
@@ -117,6 +118,26 @@ struct URHO3D_API DirtyBits
     unsigned char count_{};
 };
 
+/// Node transform quantized for network replication.
+struct URHO3D_API QuantizedTransform
+{
+    /// Position in quantization steps.
+    IntVector3 position_;
+    /// Rotation as the three smallest quaternion components in quantization steps.
+    IntVector3 rotation_;
+    /// Index of the largest quaternion component, which is omitted.
+    unsigned rotationIndex_{};
+
+    /// Test for equality with another quantized transform.
+    bool operator ==(const QuantizedTransform& rhs) const
+    {
+        return position_ == rhs.position_ && rotation_ == rhs.rotation_ && rotationIndex_ == rhs.rotationIndex_;
+    }
+
+    /// Test for inequality with another quantized transform.
+    bool operator !=(const QuantizedTransform& rhs) const { return !(*this == rhs); }
+};
+
 /// Per-object attribute state for network replication, allocated on demand.
 struct URHO3D_API NetworkState
 {
@@ -167,6 +188,16 @@ struct URHO3D_API NodeReplicationState : public ReplicationState
     ea::unordered_map<unsigned, ComponentReplicationState> componentStates_;
     /// Interest management priority accumulator.
     float priorityAcc_{};
+    /// World position snapshot for the interest management priority check of the current network update.
+    Vector3 worldPosition_;
+    /// Transform acknowledged by the client, which sent transforms are delta encoded against.
+    QuantizedTransform baselineTransform_;
+    /// Sequence number of the transform update the baseline was sent in, or zero if there is none.
+    unsigned baselineSequence_{};
+    /// Sequence number of the transform update the transform was last sent in.
+    unsigned sentSequence_{};
+    /// Sequence number of the first transform update sent after the node was replicated. Older acknowledgements are ignored.
+    unsigned firstTransformSequence_{};
     /// Whether exists in the SceneState's dirty set.
     bool markedDirty_{};
 };
@@ -731,6 +731,13 @@ void Scene::SetSnapThreshold(float threshold)
     Node::MarkNetworkUpdate();
 }
 
+void Scene::SetBatchedTransformUpdate(bool enable)
+{
+    batchedTransformUpdate_ = enable;
+    if (!batchedTransformUpdate_)
+        transformHierarchy_.Clear();
+}
+
 void Scene::SetAsyncLoadingMs(int ms)
 {
     asyncLoadingMs_ = Max(ms, 1);
@@ -877,6 +884,10 @@ void Scene::Update(float timeStep)
     // Post-update variable timestep logic
     SendEvent(E_SCENEPOSTUPDATE, eventData);
 
+    // Update the dirty world transforms also when there is no octree to do it, e.g. on a headless server, so that
+    // the dirty subtrees do not accumulate
+    UpdateTransforms();
+
     // Note: using a float for elapsed time accumulation is inherently inaccurate. The purpose of this value is
     // primarily to update material animation effects, as it is available to shaders. It can be reset by calling
     // SetElapsedTime()
@@ -914,6 +925,23 @@ void Scene::DelayedMarkedDirty(Component* component)
     delayedDirtyComponents_.push_back(component);
 }
 
+void Scene::MarkTransformDirty(Node* node)
+{
+    if (threadedUpdate_)
+    {
+        MutexLock lock(sceneMutex_);
+        transformHierarchy_.AddDirtyRoot(node);
+    }
+    else
+        transformHierarchy_.AddDirtyRoot(node);
+}
+
+void Scene::UpdateTransforms()
+{
+    if (batchedTransformUpdate_)
+        transformHierarchy_.Update(this, GetSubsystem<WorkQueue>());
+}
+
 unsigned Scene::GetFreeNodeID(CreateMode mode)
 {
     if (mode == REPLICATED)
@@ -32,6 +32,7 @@
 #include "../Resource/JSONFile.h"
 #include "../Scene/Node.h"
 #include "../Scene/SceneResolver.h"
+#include "../Scene/TransformHierarchy.h"
 
 namespace Urho3D
 {
@@ -105,6 +106,8 @@ public:
     ~Scene() override;
     /// Register object factory. Node must be registered first.
     static void RegisterObject(Context* context);
+    /// Return whether binary load and save may access typed attributes directly. True for this class, but not for subclasses.
+    bool IsDirectAttributeAccessAllowed() const override { return IsExactType<Scene>(); }
 
     /// Create component index. Scene must be empty.
     bool CreateComponentIndex(StringHash componentType);
@@ -183,6 +186,8 @@ public:
     void SetSnapThreshold(float threshold);
     /// Set maximum milliseconds per frame to spend on async scene loading.
     void SetAsyncLoadingMs(int ms);
+    /// Enable or disable batched world transform update. When enabled, world transforms of moved nodes are updated together at the end of the scene update and before rendering instead of on demand.
+    void SetBatchedTransformUpdate(bool enable);
     /// Add a required package file for networking. To be called on the server.
     void AddRequiredPackageFile(PackageFile* package);
     /// Clear required package files.
@@ -239,6 +244,9 @@ public:
     /// Return maximum milliseconds per frame to spend on async loading.
     int GetAsyncLoadingMs() const { return asyncLoadingMs_; }
 
+    /// Return whether batched world transform update is enabled.
+    bool IsBatchedTransformUpdate() const { return batchedTransformUpdate_; }
+
     /// Return required package files.
     const ea::vector<SharedPtr<PackageFile> >& GetRequiredPackageFiles() const { return requiredPackageFiles_; }
 
@@ -253,6 +261,10 @@ public:
     void EndThreadedUpdate();
     /// Add a component to the delayed dirty notify queue. Is thread-safe.
     void DelayedMarkedDirty(Component* component);
+    /// Add the topmost dirty node of a subtree for batched world transform update. Is thread-safe during threaded update.
+    void MarkTransformDirty(Node* node);
+    /// Update world transforms of all dirty nodes if batched world transform update is enabled. Called at the end of the scene update and before the octree update.
+    void UpdateTransforms();
 
     /// Return threaded update flag.
     bool IsThreadedUpdate() const { return threadedUpdate_; }
@@ -377,6 +389,10 @@ private:
     bool asyncLoading_;
     /// Threaded update flag.
     bool threadedUpdate_;
+    /// Batched world transform update flag.
+    bool batchedTransformUpdate_{};
+    /// Dirty node hierarchy for batched world transform update.
+    TransformHierarchy transformHierarchy_;
 
     /// Lightmap textures names.
     ResourceRefList lightmaps_;
@@ -0,0 +1,291 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/Profiler.h"
+#include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
+#include "../IO/VectorBuffer.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneResolver.h"
+#include "../Scene/SceneStreamer.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Streamable scene file format version.
+const unsigned SCENE_STREAM_VERSION = 1;
+/// Size of the file header: file ID, version, number of subtrees, root data offset and size.
+const unsigned SCENE_STREAM_HEADER_SIZE = 5 * sizeof(unsigned);
+/// Size of one subtree index entry: node ID, bounding box, offset and size.
+const unsigned SCENE_STREAM_CHUNK_SIZE = 3 * sizeof(unsigned) + 2 * sizeof(Vector3);
+
+/// Merge world positions of a node and its persistent descendants into a bounding box.
+void MergeSubtreeBounds(const Node* node, BoundingBox& bounds)
+{
+    bounds.Merge(node->GetWorldPosition());
+    for (Node* child : node->GetChildren())
+    {
+        if (!child->IsTemporary())
+            MergeSubtreeBounds(child, bounds);
+    }
+}
+
+}
+
+SceneStreamer::SceneStreamer(Context* context) :
+    Object(context)
+{
+}
+
+SceneStreamer::~SceneStreamer() = default;
+
+bool SceneStreamer::Save(const Scene* scene, Serializer& dest)
+{
+    URHO3D_PROFILE("SaveStreamableScene");
+
+    // Serialize subtrees first to know the offsets that go into the index
+    VectorBuffer data;
+    if (!scene->Node::Save(data, false))
+    {
+        URHO3D_LOGERROR("Could not save scene attributes and components");
+        return false;
+    }
+    const unsigned rootSize = data.GetSize();
+
+    ea::vector<SceneStreamChunk> chunks;
+    for (Node* child : scene->GetChildren())
+    {
+        if (child->IsTemporary())
+            continue;
+
+        SceneStreamChunk chunk;
+        chunk.nodeID_ = child->GetID();
+        MergeSubtreeBounds(child, chunk.bounds_);
+        chunk.offset_ = data.GetSize();
+        if (!child->Save(data))
+        {
+            URHO3D_LOGERROR("Could not save node " + ea::to_string(chunk.nodeID_));
+            return false;
+        }
+        chunk.size_ = data.GetSize() - chunk.offset_;
+        chunks.push_back(chunk);
+    }
+
+    const unsigned dataOffset = SCENE_STREAM_HEADER_SIZE + chunks.size() * SCENE_STREAM_CHUNK_SIZE;
+
+    bool success = dest.WriteFileID("USST");
+    success &= dest.WriteUInt(SCENE_STREAM_VERSION);
+    success &= dest.WriteUInt(chunks.size());
+    success &= dest.WriteUInt(dataOffset);
+    success &= dest.WriteUInt(rootSize);
+    for (const SceneStreamChunk& chunk : chunks)
+    {
+        success &= dest.WriteUInt(chunk.nodeID_);
+        success &= dest.WriteVector3(chunk.bounds_.min_);
+        success &= dest.WriteVector3(chunk.bounds_.max_);
+        success &= dest.WriteUInt(dataOffset + chunk.offset_);
+        success &= dest.WriteUInt(chunk.size_);
+    }
+    success &= dest.Write(data.GetData(), data.GetSize()) == data.GetSize();
+
+    if (!success)
+        URHO3D_LOGERROR("Could not save streamable scene, writing to stream failed");
+    return success;
+}
+
+bool SceneStreamer::Open(const ea::string& fileName, Scene* scene)
+{
+    URHO3D_PROFILE("OpenStreamableScene");
+
+    Close();
+
+    if (!scene)
+    {
+        URHO3D_LOGERROR("Null scene for streaming");
+        return false;
+    }
+
+    if (!file_.Open(fileName))
+        return false;
+
+    MemoryBuffer header(file_.GetData(), file_.GetSize());
+    if (file_.GetSize() < SCENE_STREAM_HEADER_SIZE || header.ReadFileID() != "USST")
+    {
+        URHO3D_LOGERROR(fileName + " is not a valid streamable scene file");
+        file_.Close();
+        return false;
+    }
+
+    const unsigned version = header.ReadUInt();
+    const unsigned numChunks = header.ReadUInt();
+    const unsigned rootOffset = header.ReadUInt();
+    const unsigned rootSize = header.ReadUInt();
+    const unsigned long long indexEnd = SCENE_STREAM_HEADER_SIZE + static_cast<unsigned long long>(numChunks) * SCENE_STREAM_CHUNK_SIZE;
+    if (version != SCENE_STREAM_VERSION || indexEnd > file_.GetSize()
+        || static_cast<unsigned long long>(rootOffset) + rootSize > file_.GetSize())
+    {
+        URHO3D_LOGERROR(fileName + " has unsupported version or is truncated");
+        file_.Close();
+        return false;
+    }
+
+    chunks_.resize(numChunks);
+    for (SceneStreamChunk& chunk : chunks_)
+    {
+        chunk.nodeID_ = header.ReadUInt();
+        chunk.bounds_.min_ = header.ReadVector3();
+        chunk.bounds_.max_ = header.ReadVector3();
+        chunk.offset_ = header.ReadUInt();
+        chunk.size_ = header.ReadUInt();
+        if (static_cast<unsigned long long>(chunk.offset_) + chunk.size_ > file_.GetSize())
+        {
+            URHO3D_LOGERROR(fileName + " has subtree data out of range");
+            Close();
+            return false;
+        }
+    }
+    chunkNodes_.clear();
+    chunkNodes_.resize(numChunks);
+
+    URHO3D_LOGINFO("Opening streamable scene " + fileName + " with " + ea::to_string(numChunks) + " subtrees");
+
+    scene->Clear();
+    scene_ = scene;
+
+    // Only the scene node itself is loaded now, subtrees are instantiated on demand
+    MemoryBuffer source(file_.GetData() + rootOffset, rootSize);
+    SceneResolver resolver;
+    resolver.AddNode(source.ReadUInt(), scene);
+    if (!static_cast<Node*>(scene)->Load(source, resolver, false))
+    {
+        URHO3D_LOGERROR("Could not load scene attributes and components from " + fileName);
+        Close();
+        return false;
+    }
+    resolver.Resolve();
+    scene->ApplyAttributes();
+    return true;
+}
+
+void SceneStreamer::Close()
+{
+    file_.Close();
+    chunks_.clear();
+    chunkNodes_.clear();
+    scene_ = nullptr;
+}
+
+Node* SceneStreamer::LoadChunk(unsigned index)
+{
+    if (index >= chunks_.size() || !scene_)
+        return nullptr;
+
+    if (chunkNodes_[index])
+        return chunkNodes_[index];
+
+    URHO3D_PROFILE("LoadSceneChunk");
+
+    const SceneStreamChunk& chunk = chunks_[index];
+    MemoryBuffer source(file_.GetData() + chunk.offset_, chunk.size_);
+
+    // Keep the saved IDs so that the subtree can be unloaded and loaded again with the same identity
+    SceneResolver resolver;
+    const unsigned nodeID = source.ReadUInt();
+    Node* node = scene_->CreateChild(nodeID, Scene::IsReplicatedID(nodeID) ? REPLICATED : LOCAL);
+    resolver.AddNode(nodeID, node);
+    if (!node->Load(source, resolver))
+    {
+        URHO3D_LOGERROR("Could not load subtree " + ea::to_string(nodeID) + " from " + file_.GetName());
+        node->Remove();
+        return nullptr;
+    }
+
+    resolver.Resolve();
+    node->ApplyAttributes();
+    chunkNodes_[index] = node;
+    return node;
+}
+
+void SceneStreamer::UnloadChunk(unsigned index)
+{
+    if (index >= chunkNodes_.size())
+        return;
+
+    if (Node* node = chunkNodes_[index])
+        node->Remove();
+    chunkNodes_[index] = nullptr;
+}
+
+void SceneStreamer::GetChunks(ea::vector<unsigned>& result, const BoundingBox& box) const
+{
+    result.clear();
+    for (unsigned i = 0; i < chunks_.size(); ++i)
+    {
+        if (box.IsInsideFast(chunks_[i].bounds_) != OUTSIDE)
+            result.push_back(i);
+    }
+}
+
+unsigned SceneStreamer::UpdateStreaming(const Vector3& position, float loadDistance, float unloadDistance)
+{
+    URHO3D_PROFILE("UpdateSceneStreaming");
+
+    unloadDistance = Max(unloadDistance, loadDistance);
+
+    unsigned numChanged = 0;
+    for (unsigned i = 0; i < chunks_.size(); ++i)
+    {
+        const float distance = chunks_[i].bounds_.DistanceToPoint(position);
+        if (!chunkNodes_[i] && distance <= loadDistance)
+        {
+            if (LoadChunk(i))
+                ++numChanged;
+        }
+        else if (chunkNodes_[i] && distance > unloadDistance)
+        {
+            UnloadChunk(i);
+            ++numChanged;
+        }
+    }
+    return numChanged;
+}
+
+unsigned SceneStreamer::GetNumLoadedChunks() const
+{
+    unsigned numLoaded = 0;
+    for (const WeakPtr<Node>& node : chunkNodes_)
+    {
+        if (node)
+            ++numLoaded;
+    }
+    return numLoaded;
+}
+
+}
@@ -0,0 +1,104 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Core/Object.h"
+#include "../IO/MemoryMappedFile.h"
+#include "../Math/BoundingBox.h"
+
+namespace Urho3D
+{
+
+class Node;
+class Scene;
+class Serializer;
+
+/// Index entry of a top-level subtree in a streamable scene file.
+struct SceneStreamChunk
+{
+    /// ID of the subtree root node.
+    unsigned nodeID_{};
+    /// Bounds of the world positions of all nodes in the subtree.
+    BoundingBox bounds_;
+    /// Offset of the subtree data from the beginning of the file.
+    unsigned offset_{};
+    /// Size of the subtree data.
+    unsigned size_{};
+};
+
+/// Memory-mapped binary scene file with an index of top-level subtrees, which are instantiated and released on demand.
+class URHO3D_API SceneStreamer : public Object
+{
+    URHO3D_OBJECT(SceneStreamer, Object);
+
+public:
+    /// Construct.
+    explicit SceneStreamer(Context* context);
+    /// Destruct. Loaded subtrees stay in the scene.
+    ~SceneStreamer() override;
+
+    /// Save scene in streamable format. Every top-level child node becomes a separately loadable subtree.
+    static bool Save(const Scene* scene, Serializer& dest);
+
+    /// Map a streamable scene file and load the scene attributes and components into the scene, leaving subtrees unloaded. Return true if successful.
+    bool Open(const ea::string& fileName, Scene* scene);
+    /// Unmap the file. Loaded subtrees stay in the scene.
+    void Close();
+
+    /// Instantiate a subtree if not loaded yet. Return its root node or null on failure.
+    Node* LoadChunk(unsigned index);
+    /// Remove a loaded subtree from the scene.
+    void UnloadChunk(unsigned index);
+    /// Return indices of subtrees whose bounds intersect the box.
+    void GetChunks(ea::vector<unsigned>& result, const BoundingBox& box) const;
+    /// Load subtrees within load distance of the position and unload those farther than unload distance. Return number of loaded and unloaded subtrees.
+    unsigned UpdateStreaming(const Vector3& position, float loadDistance, float unloadDistance);
+
+    /// Return whether a file is open.
+    bool IsOpen() const { return file_.IsOpen(); }
+    /// Return number of subtrees.
+    unsigned GetNumChunks() const { return chunks_.size(); }
+    /// Return subtree index entry.
+    const SceneStreamChunk& GetChunk(unsigned index) const { return chunks_[index]; }
+    /// Return whether a subtree is loaded.
+    bool IsChunkLoaded(unsigned index) const { return chunkNodes_[index] != nullptr; }
+    /// Return root node of a loaded subtree, or null if not loaded.
+    Node* GetChunkNode(unsigned index) const { return chunkNodes_[index]; }
+    /// Return number of loaded subtrees.
+    unsigned GetNumLoadedChunks() const;
+    /// Return scene.
+    Scene* GetScene() const { return scene_; }
+
+private:
+    /// Mapped file.
+    MemoryMappedFile file_;
+    /// Scene.
+    WeakPtr<Scene> scene_;
+    /// Subtree index.
+    ea::vector<SceneStreamChunk> chunks_;
+    /// Root nodes of loaded subtrees.
+    ea::vector<WeakPtr<Node>> chunkNodes_;
+};
+
+}
@@ -40,6 +40,8 @@
 
 #include <EASTL/fixed_vector.h>
 
+#include <atomic>
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -83,6 +85,29 @@ static bool SaveAttributeWithName(Archive& archive, const AttributeInfo& attr, c
     }
 }
 
+/// Whether typed attributes bypass Variant conversion when saving and loading.
+static std::atomic<bool> directAttributeSerialization{true};
+
+static bool IsDirectAttributeAccessEnabled(const Serializable* serializable)
+{
+    return directAttributeSerialization.load(std::memory_order_relaxed) && serializable->IsDirectAttributeAccessAllowed();
+}
+
+static bool IsDirectAttribute(const AttributeInfo& attr)
+{
+    return attr.accessor_ && !attr.enumNames_ && attr.accessor_->IsDirect();
+}
+
+static bool SaveDirectAttributeWithName(Archive& archive, const Serializable* serializable, const AttributeInfo& attr)
+{
+    assert(!archive.IsInput());
+
+    if (!SerializeStringHashKey(archive, const_cast<StringHash&>(attr.nameHash_), attr.name_))
+        return false;
+
+    return attr.accessor_->Serialize(const_cast<Serializable*>(serializable), archive, "attribute");
+}
+
 static bool LoadAttribute(Archive& archive, const AttributeInfo& attr, Variant& value)
 {
     assert(archive.IsInput());
@@ -350,6 +375,9 @@ bool Serializable::Load(Deserializer& source)
     if (!attributes)
         return true;
 
+    // Instance defaults are stored as Variants, so only read directly when not recording them
+    const bool directAccess = !setInstanceDefault_ && IsDirectAttributeAccessEnabled(this);
+
     for (unsigned i = 0; i < attributes->size(); ++i)
     {
         const AttributeInfo& attr = attributes->at(i);
@@ -362,6 +390,12 @@ bool Serializable::Load(Deserializer& source)
             return false;
         }
 
+        if (directAccess && IsDirectAttribute(attr))
+        {
+            attr.accessor_->Read(this, source);
+            continue;
+        }
+
         Variant varValue = source.ReadVariant(attr.type_, context_);
         OnSetAttribute(attr, varValue);
     }
@@ -376,6 +410,7 @@ bool Serializable::Save(Serializer& dest) const
         return true;
 
     Variant value;
+    const bool directAccess = IsDirectAttributeAccessEnabled(this);
 
     for (unsigned i = 0; i < attributes->size(); ++i)
     {
@@ -383,6 +418,16 @@ bool Serializable::Save(Serializer& dest) const
         if (!attr.ShouldSave())
             continue;
 
+        if (directAccess && IsDirectAttribute(attr))
+        {
+            if (!attr.accessor_->Write(this, dest))
+            {
+                URHO3D_LOGERROR("Could not save " + GetTypeName() + ", writing to stream failed");
+                return false;
+            }
+            continue;
+        }
+
         OnGetAttribute(attr, value);
 
         if (!dest.WriteVariantData(value))
@@ -684,6 +729,8 @@ bool Serializable::Serialize(Archive& archive, ArchiveBlock& block)
     ea::fixed_vector<Variant, MAX_STACK_ATTRIBUTE_COUNT> attributeValues;
     const unsigned numAttributes = attributes->size();
     const bool saveDefaults = !archive.IsHumanReadable();
+    // Human-readable archives have their own encoding of each Variant type, so typed access is for binary only
+    const bool directAccess = !archive.IsHumanReadable() && IsDirectAttributeAccessEnabled(this);
 
     // Caclculate number of attributes to write
     unsigned numAttributesToWrite = 0;
@@ -749,6 +796,17 @@ bool Serializable::Serialize(Archive& archive, ArchiveBlock& block)
                 if (nextAttributeIndex < numAttributes && (*attributes)[nextAttributeIndex].nameHash_ == attrNameHash)
                 {
                     const AttributeInfo& attr = (*attributes)[nextAttributeIndex];
+                    if (directAccess && !setInstanceDefault_ && IsDirectAttribute(attr))
+                    {
+                        if (!attr.accessor_->Serialize(this, archive, "attribute"))
+                        {
+                            URHO3D_LOGERROR("Could not load " + GetTypeName() + ", failed to read attribute " + attr.name_);
+                            return false;
+                        }
+                        ++nextAttributeIndex;
+                        continue;
+                    }
+
                     Variant value;
                     if (!LoadAttribute(archive, attr, value))
                     {
@@ -819,6 +877,16 @@ bool Serializable::Serialize(Archive& archive, ArchiveBlock& block)
                     if (!attr.ShouldSave())
                         continue;
 
+                    if (directAccess && IsDirectAttribute(attr))
+                    {
+                        if (!SaveDirectAttributeWithName(archive, this, attr))
+                        {
+                            URHO3D_LOGERROR("Could not save " + GetTypeName() + ", failed to write attribute " + attr.name_);
+                            return false;
+                        }
+                        continue;
+                    }
+
                     OnGetAttribute(attr, value);
 
                     if (!SaveAttributeWithName(archive, attr, value))
@@ -939,6 +1007,16 @@ void Serializable::RemoveInstanceDefault()
     instanceDefaultValues_.reset();
 }
 
+void Serializable::SetDirectAttributeSerialization(bool enable)
+{
+    directAttributeSerialization.store(enable, std::memory_order_relaxed);
+}
+
+bool Serializable::GetDirectAttributeSerialization()
+{
+    return directAttributeSerialization.load(std::memory_order_relaxed);
+}
+
 void Serializable::SetTemporary(bool enable)
 {
     if (enable != temporary_)
@@ -24,8 +24,12 @@
 
 #include "../Core/Attribute.h"
 #include "../Core/Object.h"
+#include "../IO/ArchiveSerialization.h"
+#include "../IO/Deserializer.h"
+#include "../IO/Serializer.h"
 
 #include <cstddef>
+#include <typeinfo>
 
 namespace Urho3D
 {
@@ -57,6 +61,8 @@ public:
     virtual void OnSetAttribute(const AttributeInfo& attr, const Variant& src);
     /// Handle attribute read access. Default implementation reads the variable at offset, or invokes the get accessor.
     virtual void OnGetAttribute(const AttributeInfo& attr, Variant& dest) const;
+    /// Return whether binary load and save may access typed attributes directly, bypassing OnSetAttribute() and OnGetAttribute(). Default false. Classes that do not override those may opt in for their exact type with IsExactType().
+    virtual bool IsDirectAttributeAccessAllowed() const { return false; }
     /// Return attribute descriptions, or null if none defined.
     virtual const ea::vector<AttributeInfo>* GetAttributes() const;
     /// Return network replication attribute descriptions, or null if none defined.
@@ -113,6 +119,10 @@ public:
     void RemoveInstanceDefault();
     /// Set temporary flag. Temporary objects will not be saved.
     void SetTemporary(bool enable);
+    /// Enable or disable saving and loading typed attributes without converting them to Variants. Enabled by default; disable to compare against the Variant path.
+    static void SetDirectAttributeSerialization(bool enable);
+    /// Return whether typed attributes are saved and loaded without converting them to Variants.
+    static bool GetDirectAttributeSerialization();
     /// Enable interception of an attribute from network updates. Intercepted attributes are sent as events instead of applying directly. This can be used to implement client side prediction.
     void SetInterceptNetworkUpdate(const ea::string& attributeName, bool enable);
     /// Allocate network attribute state.
@@ -151,6 +161,9 @@ public:
     NetworkState* GetNetworkState() const { return networkState_.get(); }
 
 protected:
+    /// Return whether the object is of exactly the given class. Subclasses, including script classes, may override OnSetAttribute() or OnGetAttribute().
+    template <class T> bool IsExactType() const { return typeid(*this) == typeid(T); }
+
     /// Network attribute state.
     ea::unique_ptr<NetworkState> networkState_;
 
@@ -203,15 +216,191 @@ SharedPtr<AttributeAccessor> MakeVariantAttributeAccessor(TGetFunction getFuncti
     return SharedPtr<AttributeAccessor>(new VariantAttributeAccessorImpl<TClassType, TGetFunction, TSetFunction>(getFunction, setFunction));
 }
 
+namespace Detail
+{
+
+/// Type of the value stored in Variant for an attribute type that can be serialized directly, or void if it can not.
+template <class T> struct DirectAttributeType { using Type = void; };
+template <> struct DirectAttributeType<bool> { using Type = bool; };
+template <> struct DirectAttributeType<int> { using Type = int; };
+template <> struct DirectAttributeType<unsigned> { using Type = int; };
+template <> struct DirectAttributeType<long long> { using Type = long long; };
+template <> struct DirectAttributeType<unsigned long long> { using Type = long long; };
+template <> struct DirectAttributeType<float> { using Type = float; };
+template <> struct DirectAttributeType<double> { using Type = double; };
+template <> struct DirectAttributeType<Vector2> { using Type = Vector2; };
+template <> struct DirectAttributeType<Vector3> { using Type = Vector3; };
+template <> struct DirectAttributeType<Vector4> { using Type = Vector4; };
+template <> struct DirectAttributeType<Quaternion> { using Type = Quaternion; };
+template <> struct DirectAttributeType<Color> { using Type = Color; };
+template <> struct DirectAttributeType<ea::string> { using Type = ea::string; };
+template <> struct DirectAttributeType<ResourceRef> { using Type = ResourceRef; };
+template <> struct DirectAttributeType<ResourceRefList> { using Type = ResourceRefList; };
+template <> struct DirectAttributeType<IntRect> { using Type = IntRect; };
+template <> struct DirectAttributeType<IntVector2> { using Type = IntVector2; };
+template <> struct DirectAttributeType<IntVector3> { using Type = IntVector3; };
+template <> struct DirectAttributeType<Rect> { using Type = Rect; };
+template <> struct DirectAttributeType<Matrix3> { using Type = Matrix3; };
+template <> struct DirectAttributeType<Matrix3x4> { using Type = Matrix3x4; };
+template <> struct DirectAttributeType<Matrix4> { using Type = Matrix4; };
+
+/// Write directly serialized attribute values in the same format as Serializer::WriteVariantData.
+inline bool WriteDirectAttribute(Serializer& dest, bool value) { return dest.WriteBool(value); }
+inline bool WriteDirectAttribute(Serializer& dest, int value) { return dest.WriteInt(value); }
+inline bool WriteDirectAttribute(Serializer& dest, long long value) { return dest.WriteInt64(value); }
+inline bool WriteDirectAttribute(Serializer& dest, float value) { return dest.WriteFloat(value); }
+inline bool WriteDirectAttribute(Serializer& dest, double value) { return dest.WriteDouble(value); }
+inline bool WriteDirectAttribute(Serializer& dest, const Vector2& value) { return dest.WriteVector2(value); }
+inline bool WriteDirectAttribute(Serializer& dest, const Vector3& value) { return dest.WriteVector3(value); }
+inline bool WriteDirectAttribute(Serializer& dest, const Vector4& value) { return dest.WriteVector4(value); }
+inline bool WriteDirectAttribute(Serializer& dest, const Quaternion& value) { return dest.WriteQuaternion(value); }
+inline bool WriteDirectAttribute(Serializer& dest, const Color& value) { return dest.WriteColor(value); }
+inline bool WriteDirectAttribute(Serializer& dest, const ea::string& value) { return dest.WriteString(value); }
+inline bool WriteDirectAttribute(Serializer& dest, const ResourceRef& value) { return dest.WriteResourceRef(value); }
+inline bool WriteDirectAttribute(Serializer& dest, const ResourceRefList& value) { return dest.WriteResourceRefList(value); }
+inline bool WriteDirectAttribute(Serializer& dest, const IntRect& value) { return dest.WriteIntRect(value); }
+inline bool WriteDirectAttribute(Serializer& dest, const IntVector2& value) { return dest.WriteIntVector2(value); }
+inline bool WriteDirectAttribute(Serializer& dest, const IntVector3& value) { return dest.WriteIntVector3(value); }
+inline bool WriteDirectAttribute(Serializer& dest, const Rect& value) { return dest.WriteRect(value); }
+inline bool WriteDirectAttribute(Serializer& dest, const Matrix3& value) { return dest.WriteMatrix3(value); }
+inline bool WriteDirectAttribute(Serializer& dest, const Matrix3x4& value) { return dest.WriteMatrix3x4(value); }
+inline bool WriteDirectAttribute(Serializer& dest, const Matrix4& value) { return dest.WriteMatrix4(value); }
+
+/// Read directly serialized attribute values in the same format as Deserializer::ReadVariant.
+inline void ReadDirectAttribute(Deserializer& source, bool& value) { value = source.ReadBool(); }
+inline void ReadDirectAttribute(Deserializer& source, int& value) { value = source.ReadInt(); }
+inline void ReadDirectAttribute(Deserializer& source, long long& value) { value = source.ReadInt64(); }
+inline void ReadDirectAttribute(Deserializer& source, float& value) { value = source.ReadFloat(); }
+inline void ReadDirectAttribute(Deserializer& source, double& value) { value = source.ReadDouble(); }
+inline void ReadDirectAttribute(Deserializer& source, Vector2& value) { value = source.ReadVector2(); }
+inline void ReadDirectAttribute(Deserializer& source, Vector3& value) { value = source.ReadVector3(); }
+inline void ReadDirectAttribute(Deserializer& source, Vector4& value) { value = source.ReadVector4(); }
+inline void ReadDirectAttribute(Deserializer& source, Quaternion& value) { value = source.ReadQuaternion(); }
+inline void ReadDirectAttribute(Deserializer& source, Color& value) { value = source.ReadColor(); }
+inline void ReadDirectAttribute(Deserializer& source, ea::string& value) { value = source.ReadString(); }
+inline void ReadDirectAttribute(Deserializer& source, ResourceRef& value) { value = source.ReadResourceRef(); }
+inline void ReadDirectAttribute(Deserializer& source, ResourceRefList& value) { value = source.ReadResourceRefList(); }
+inline void ReadDirectAttribute(Deserializer& source, IntRect& value) { value = source.ReadIntRect(); }
+inline void ReadDirectAttribute(Deserializer& source, IntVector2& value) { value = source.ReadIntVector2(); }
+inline void ReadDirectAttribute(Deserializer& source, IntVector3& value) { value = source.ReadIntVector3(); }
+inline void ReadDirectAttribute(Deserializer& source, Rect& value) { value = source.ReadRect(); }
+inline void ReadDirectAttribute(Deserializer& source, Matrix3& value) { value = source.ReadMatrix3(); }
+inline void ReadDirectAttribute(Deserializer& source, Matrix3x4& value) { value = source.ReadMatrix3x4(); }
+inline void ReadDirectAttribute(Deserializer& source, Matrix4& value) { value = source.ReadMatrix4(); }
+
+}
+
+/// Template implementation of the attribute accessor for attributes of known type. Attributes of simple types are serialized directly, without a Variant.
+template <class TClassType, class TAttributeType, class TGetFunction, class TSetFunction>
+class TypedAttributeAccessorImpl : public AttributeAccessor
+{
+public:
+    /// Type of the value stored in Variant, or void if not serialized directly.
+    using DirectType = typename Detail::DirectAttributeType<TAttributeType>::Type;
+
+    /// Construct.
+    TypedAttributeAccessorImpl(TGetFunction getFunction, TSetFunction setFunction) : getFunction_(getFunction), setFunction_(setFunction) { }
+
+    /// Invoke getter function.
+    void Get(const Serializable* ptr, Variant& value) const override
+    {
+        assert(ptr);
+        const auto classPtr = static_cast<const TClassType*>(ptr);
+        value = getFunction_(*classPtr);
+    }
+
+    /// Invoke setter function.
+    void Set(Serializable* ptr, const Variant& value) override
+    {
+        assert(ptr);
+        auto classPtr = static_cast<TClassType*>(ptr);
+        setFunction_(*classPtr, value.Get<TAttributeType>());
+    }
+
+    /// Return whether the attribute can be serialized directly.
+    bool IsDirect() const override { return !std::is_void_v<DirectType>; }
+
+    /// Write the attribute directly.
+    bool Write(const Serializable* ptr, Serializer& dest) const override
+    {
+        if constexpr (!std::is_void_v<DirectType>)
+        {
+            assert(ptr);
+            const auto classPtr = static_cast<const TClassType*>(ptr);
+            return Detail::WriteDirectAttribute(dest, static_cast<const DirectType&>(getFunction_(*classPtr)));
+        }
+        else
+            return false;
+    }
+
+    /// Read the attribute directly.
+    bool Read(Serializable* ptr, Deserializer& source) override
+    {
+        if constexpr (!std::is_void_v<DirectType>)
+        {
+            assert(ptr);
+            auto classPtr = static_cast<TClassType*>(ptr);
+            DirectType value{};
+            Detail::ReadDirectAttribute(source, value);
+            setFunction_(*classPtr, static_cast<TAttributeType>(value));
+            return true;
+        }
+        else
+            return false;
+    }
+
+    /// Serialize the attribute directly.
+    bool Serialize(Serializable* ptr, Archive& archive, const char* name) override
+    {
+        if constexpr (!std::is_void_v<DirectType>)
+        {
+            assert(ptr);
+            auto classPtr = static_cast<TClassType*>(ptr);
+            if (archive.IsInput())
+            {
+                DirectType value{};
+                if (!SerializeValue(archive, name, value))
+                    return false;
+                setFunction_(*classPtr, static_cast<TAttributeType>(value));
+                return true;
+            }
+            else
+            {
+                DirectType value = static_cast<DirectType>(getFunction_(*classPtr));
+                return SerializeValue(archive, name, value);
+            }
+        }
+        else
+            return false;
+    }
+
+private:
+    /// Get functor.
+    TGetFunction getFunction_;
+    /// Set functor.
+    TSetFunction setFunction_;
+};
+
+/// Make typed attribute accessor implementation.
+/// \tparam TClassType Serializable class type.
+/// \tparam TAttributeType Attribute value type.
+/// \tparam TGetFunction Functional object with call signature `TAttributeType getFunction(const TClassType& self)`
+/// \tparam TSetFunction Functional object with call signature `void setFunction(TClassType& self, const TAttributeType& value)`
+template <class TClassType, class TAttributeType, class TGetFunction, class TSetFunction>
+SharedPtr<AttributeAccessor> MakeTypedAttributeAccessor(TGetFunction getFunction, TSetFunction setFunction)
+{
+    return SharedPtr<AttributeAccessor>(new TypedAttributeAccessorImpl<TClassType, TAttributeType, TGetFunction, TSetFunction>(getFunction, setFunction));
+}
+
 /// Make member attribute accessor.
-#define URHO3D_MAKE_MEMBER_ATTRIBUTE_ACCESSOR(typeName, variable) Urho3D::MakeVariantAttributeAccessor<ClassName>( \
-    [](const ClassName& self, Urho3D::Variant& value) { value = self.variable; }, \
-    [](ClassName& self, const Urho3D::Variant& value) { self.variable = value.Get<typeName>(); })
+#define URHO3D_MAKE_MEMBER_ATTRIBUTE_ACCESSOR(typeName, variable) Urho3D::MakeTypedAttributeAccessor<ClassName, typeName >( \
+    [](const ClassName& self) -> decltype(auto) { return (self.variable); }, \
+    [](ClassName& self, const typeName& value) { self.variable = value; })
 
 /// Make member attribute accessor with custom post-set callback.
-#define URHO3D_MAKE_MEMBER_ATTRIBUTE_ACCESSOR_EX(typeName, variable, postSetCallback) Urho3D::MakeVariantAttributeAccessor<ClassName>( \
-    [](const ClassName& self, Urho3D::Variant& value) { value = self.variable; }, \
-    [](ClassName& self, const Urho3D::Variant& value) { self.variable = value.Get<typeName>(); self.postSetCallback(); })
+#define URHO3D_MAKE_MEMBER_ATTRIBUTE_ACCESSOR_EX(typeName, variable, postSetCallback) Urho3D::MakeTypedAttributeAccessor<ClassName, typeName >( \
+    [](const ClassName& self) -> decltype(auto) { return (self.variable); }, \
+    [](ClassName& self, const typeName& value) { self.variable = value; self.postSetCallback(); })
 
 /// Make custom member attribute accessor.
 #define URHO3D_MAKE_CUSTOM_MEMBER_ATTRIBUTE_ACCESSOR(typeName, variable) Urho3D::MakeVariantAttributeAccessor<ClassName>( \
@@ -219,9 +408,9 @@ SharedPtr<AttributeAccessor> MakeVariantAttributeAccessor(TGetFunction getFuncti
     [](ClassName& self, const Urho3D::Variant& value) { self.variable = value.GetCustom<typeName>(); })
 
 /// Make get/set attribute accessor.
-#define URHO3D_MAKE_GET_SET_ATTRIBUTE_ACCESSOR(getFunction, setFunction, typeName) Urho3D::MakeVariantAttributeAccessor<ClassName>( \
-    [](const ClassName& self, Urho3D::Variant& value) { value = self.getFunction(); }, \
-    [](ClassName& self, const Urho3D::Variant& value) { self.setFunction(value.Get<typeName>()); })
+#define URHO3D_MAKE_GET_SET_ATTRIBUTE_ACCESSOR(getFunction, setFunction, typeName) Urho3D::MakeTypedAttributeAccessor<ClassName, typeName >( \
+    [](const ClassName& self) -> decltype(auto) { return self.getFunction(); }, \
+    [](ClassName& self, const typeName& value) { self.setFunction(value); })
 
 /// Make member enum attribute accessor.
 #define URHO3D_MAKE_MEMBER_ENUM_ATTRIBUTE_ACCESSOR(variable) Urho3D::MakeVariantAttributeAccessor<ClassName>( \
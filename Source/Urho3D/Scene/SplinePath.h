@@ -49,6 +49,8 @@ public:
     ~SplinePath() override = default;
     /// Register object factory.
     static void RegisterObject(Context* context);
+    /// Return whether binary load and save may access typed attributes directly. True for this class, but not for subclasses.
+    bool IsDirectAttributeAccessAllowed() const override { return IsExactType<SplinePath>(); }
 
     /// Apply Attributes to the SplinePath.
     void ApplyAttributes() override;
@@ -0,0 +1,169 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
+#include "../Scene/Scene.h"
+#include "../Scene/TransformHierarchy.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Minimum number of nodes in a level to update it in parallel.
+static const unsigned MIN_NODES_PER_PARALLEL_LEVEL = 1024;
+/// Minimum number of nodes per parallel range.
+static const unsigned MIN_NODES_PER_RANGE = 256;
+
+void TransformHierarchy::Update(Scene* scene, WorkQueue* workQueue)
+{
+    nodes_.clear();
+    parentIndices_.clear();
+    levelOffsets_.clear();
+
+    if (dirtyRoots_.empty())
+        return;
+
+    URHO3D_PROFILE("UpdateTransformHierarchy");
+
+    Gather(scene);
+
+    worldTransforms_.resize(nodes_.size());
+    worldRotations_.resize(nodes_.size());
+
+    // Parents are always at the previous level, so each level can be updated in parallel
+    for (unsigned level = 0; level + 1 < levelOffsets_.size(); ++level)
+    {
+        const unsigned levelStart = levelOffsets_[level];
+        const unsigned levelEnd = levelOffsets_[level + 1];
+
+        if (workQueue && levelEnd - levelStart >= MIN_NODES_PER_PARALLEL_LEVEL)
+        {
+            workQueue->ParallelFor(levelEnd - levelStart, MIN_NODES_PER_RANGE, [&](unsigned fromIndex, unsigned toIndex)
+            {
+                UpdateRange(scene, levelStart + fromIndex, levelStart + toIndex);
+            });
+        }
+        else
+            UpdateRange(scene, levelStart, levelEnd);
+    }
+
+    URHO3D_PROFILE_VALUE("TransformHierarchyNodes", static_cast<int64_t>(nodes_.size()));
+}
+
+void TransformHierarchy::Clear()
+{
+    dirtyRoots_.clear();
+}
+
+void TransformHierarchy::Gather(Scene* scene)
+{
+    currentLevel_.clear();
+    for (const WeakPtr<Node>& dirtyRoot : dirtyRoots_)
+    {
+        Node* node = dirtyRoot.Get();
+        if (!node || node == scene || node->GetScene() != scene)
+            continue;
+
+        // If an ancestor is dirty as well, the node is reached from the dirty root of the ancestor
+        bool dirtyAncestor = false;
+        for (Node* parent = node->parent_; parent && parent != scene; parent = parent->parent_)
+        {
+            if (parent->dirty_)
+            {
+                dirtyAncestor = true;
+                break;
+            }
+        }
+
+        if (!dirtyAncestor)
+            currentLevel_.emplace_back(node, -1);
+    }
+    dirtyRoots_.clear();
+
+    levelOffsets_.push_back(0);
+    while (!currentLevel_.empty())
+    {
+        for (const auto& entry : currentLevel_)
+        {
+            Node* node = entry.first;
+            int index = -1;
+
+            // Nodes already updated on demand are skipped, but their children may still be dirty
+            if (node->dirty_)
+            {
+                index = static_cast<int>(nodes_.size());
+                nodes_.push_back(node);
+                parentIndices_.push_back(entry.second);
+                // Clear the flag already now to gather the node only once if it is reachable from several dirty roots
+                node->dirty_ = false;
+            }
+
+            for (const SharedPtr<Node>& child : node->children_)
+                nextLevel_.emplace_back(child.Get(), index);
+        }
+
+        levelOffsets_.push_back(nodes_.size());
+        ea::swap(currentLevel_, nextLevel_);
+        nextLevel_.clear();
+    }
+}
+
+void TransformHierarchy::UpdateRange(Scene* scene, unsigned fromIndex, unsigned toIndex)
+{
+    for (unsigned i = fromIndex; i < toIndex; ++i)
+    {
+        Node* node = nodes_[i];
+        const Matrix3x4 transform(node->position_, node->rotation_, node->scale_);
+        const int parentIndex = parentIndices_[i];
+
+        if (parentIndex >= 0)
+        {
+            worldTransforms_[i] = worldTransforms_[parentIndex] * transform;
+            worldRotations_[i] = worldRotations_[parentIndex] * node->rotation_;
+        }
+        else
+        {
+            // Assume the root node (scene) has identity transform
+            Node* parent = node->parent_;
+            if (!parent || parent == scene)
+            {
+                worldTransforms_[i] = transform;
+                worldRotations_[i] = node->rotation_;
+            }
+            else
+            {
+                worldTransforms_[i] = parent->worldTransform_ * transform;
+                worldRotations_[i] = parent->worldRotation_ * node->rotation_;
+            }
+        }
+
+        node->worldTransform_ = worldTransforms_[i];
+        node->worldRotation_ = worldRotations_[i];
+    }
+}
+
+}
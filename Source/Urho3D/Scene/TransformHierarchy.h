@@ -0,0 +1,78 @@
+//
+// Copyright (c) 2008-2020 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <EASTL/vector.h>
+
+#include <Urho3D/Urho3D.h>
+#include "../Container/Ptr.h"
+#include "../Math/Matrix3x4.h"
+#include "../Math/Quaternion.h"
+
+namespace Urho3D
+{
+
+class Node;
+class Scene;
+class WorkQueue;
+
+/// Batched world transform update for the dirty subtrees of a scene. Dirty nodes are gathered into contiguous arrays sorted by hierarchy depth and updated level by level, in parallel for wide levels.
+class URHO3D_API TransformHierarchy
+{
+public:
+    /// Add the topmost dirty node of a subtree. Not thread-safe.
+    void AddDirtyRoot(Node* node) { dirtyRoots_.emplace_back(node); }
+    /// Update world transforms of all dirty nodes in the scene. Must be called from the main thread.
+    void Update(Scene* scene, WorkQueue* workQueue);
+    /// Forget all dirty nodes.
+    void Clear();
+
+    /// Return number of nodes updated by the last update.
+    unsigned GetNumUpdatedNodes() const { return nodes_.size(); }
+
+private:
+    /// Gather the dirty nodes of all dirty subtrees into the arrays, level by level.
+    void Gather(Scene* scene);
+    /// Update world transforms of nodes in range.
+    void UpdateRange(Scene* scene, unsigned fromIndex, unsigned toIndex);
+
+    /// Topmost dirty nodes added since the last update.
+    ea::vector<WeakPtr<Node>> dirtyRoots_;
+    /// Nodes to update, sorted by depth relative to their dirty root.
+    ea::vector<Node*> nodes_;
+    /// Index of the parent node in the arrays, or -1 if the world transform of the parent is up to date.
+    ea::vector<int> parentIndices_;
+    /// World transforms.
+    ea::vector<Matrix3x4> worldTransforms_;
+    /// World rotations.
+    ea::vector<Quaternion> worldRotations_;
+    /// Start index of each depth level, followed by the total number of nodes.
+    ea::vector<unsigned> levelOffsets_;
+    /// Nodes and their parent indices at the current level of traversal.
+    ea::vector<ea::pair<Node*, int>> currentLevel_;
+    /// Nodes and their parent indices at the next level of traversal.
+    ea::vector<ea::pair<Node*, int>> nextLevel_;
+};
+
+}
@@ -31,6 +31,7 @@
 #include "../Graphics/Renderer.h"
 #include "../Graphics/GraphicsEvents.h"
 #include "../IO/Log.h"
+#include "../Resource/ResourceCache.h"
 #include "../UI/UI.h"
 #include "../SystemUI/SystemUI.h"
 #include "../SystemUI/DebugHud.h"
@@ -166,6 +167,8 @@ void DebugHud::RenderUI(DebugHudModeFlags mode)
         ui::SetCursorPosX(left_offset);
         ui::Text("Batches %u", batches);
         ui::SetCursorPosX(left_offset);
+        ui::Text("State changes %u (%u avoided)", renderer->GetNumStateChanges(), renderer->GetNumStateChangesAvoided());
+        ui::SetCursorPosX(left_offset);
         ui::Text("Views %u", renderer->GetNumViews());
         ui::SetCursorPosX(left_offset);
         ui::Text("Lights %u", renderer->GetNumLights(true));
@@ -182,6 +185,33 @@ void DebugHud::RenderUI(DebugHudModeFlags mode)
         }
     }
 
+    if (mode & DEBUGHUD_SHOW_MEMORY)
+    {
+        auto* cache = GetSubsystem<ResourceCache>();
+        ea::vector<ResourceResidency> residency;
+        cache->GetResidencyReport(residency);
+        ea::sort(residency.begin(), residency.end(),
+            [](const ResourceResidency& lhs, const ResourceResidency& rhs) { return lhs.memoryUse_ > rhs.memoryUse_; });
+
+        float left_offset = ui::GetCursorPos().x;
+
+        ui::Text("Resources %s", GetFileSizeString(cache->GetTotalMemoryUse()).c_str());
+        ui::SetCursorPosX(left_offset);
+        for (const ResourceResidency& group : residency)
+        {
+            if (!group.numResources_ && !group.evictions_)
+                continue;
+
+            const unsigned long long requests = group.hits_ + group.misses_;
+            const unsigned hitRate = requests ? static_cast<unsigned>(group.hits_ * 100 / requests) : 0;
+            ui::Text("%s %u %s / %s, hits %u%%, evicted %u %s", context_->GetTypeName(group.type_).c_str(),
+                group.numResources_, GetFileSizeString(group.memoryUse_).c_str(),
+                group.memoryBudget_ ? GetFileSizeString(group.memoryBudget_).c_str() : "-", hitRate,
+                static_cast<unsigned>(group.evictions_), GetFileSizeString(group.evictedMemory_).c_str());
+            ui::SetCursorPosX(left_offset);
+        }
+    }
+
     if (mode & DEBUGHUD_SHOW_MODE)
     {
         const ImGuiStyle& style = ui::GetStyle();
@@ -70,8 +70,6 @@ class URHO3D_API Renderer2D : public Drawable
 {
     URHO3D_OBJECT(Renderer2D, Drawable);
 
-    friend void CheckDrawableVisibilityWork(const WorkItem* item, unsigned threadIndex);
-
 public:
     /// Construct.
     explicit Renderer2D(Context* context);